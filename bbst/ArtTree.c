@@ -0,0 +1,916 @@
+//
+// This file implements the functions for the adaptive radix tree. Every ID is
+// split in 4 bytes and each byte picks the child one level down, an event sits
+// in the first level where its ID is alone. Inner nodes grow and shrink between
+// 4, 16, 48 and 256 children as keys come and go
+//
+
+#include "RbTree.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Local Function Declarations
+PRB_TREE_NODE       __insertArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count);
+VOID                __deleteArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+PRB_TREE_NODE       __updateArtTreeNodeCount(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count);
+PRB_TREE_NODE       __findArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID);
+VOID                __findArtTreeNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, INT *pIDList, UINT NumIDs, PRB_TREE_NODE *ppRbTreeNodeList);
+PRB_TREE_NODE       __getNextIDArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+PRB_TREE_NODE       __getPrevIDArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+VOID                __initializeArtTree(struct _RB_TREE_CONTEXT *pRbTreeContext);
+VOID                __appendArtTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT StartIndex, UINT EndIndex);
+VOID                __printArtTreeStats(struct _RB_TREE_CONTEXT *pRbTreeContext);
+PRB_TREE_NODE       __insertArtTreeLeaf(PRB_TREE_CONTEXT pRbTreeContext, INT ID, INT Count, PRB_TREE_NODE pLeafRbTreeNode);
+VOID*               __buildArtTreeNodeList(PRB_TREE_CONTEXT pRbTreeContext, UINT StartIndex, UINT EndIndex, UINT Depth);
+PART_TREE_NODE      __allocateArtTreeNode(PART_TREE_CONTEXT pArtTreeContext, UINT Type);
+VOID                __freeArtTreeNode(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE pArtTreeNode);
+VOID                __freeArtTreeNodeList(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE pArtTreeNode);
+size_t              __getArtTreeNodeSize(UINT Type);
+VOID**              __findArtTreeChild(PART_TREE_NODE pArtTreeNode, UINT Byte);
+VOID*               __getNeighbourArtTreeChild(PART_TREE_NODE pArtTreeNode, UINT Byte, BOOLEAN bAbove);
+VOID*               __getEdgeArtTreeChild(PART_TREE_NODE pArtTreeNode, BOOLEAN bMin);
+PRB_TREE_NODE       __getEdgeArtTreeLeaf(VOID *pChild, BOOLEAN bMin);
+PRB_TREE_NODE       __getCeilArtTreeLeaf(PART_TREE_NODE pArtTreeNode, UINT Depth, UINT Key);
+PRB_TREE_NODE       __getFloorArtTreeLeaf(PART_TREE_NODE pArtTreeNode, UINT Depth, UINT Key);
+VOID**              __addArtTreeChild(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE *ppArtTreeNode, UINT Byte, VOID *pChild);
+VOID                __removeArtTreeChild(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE *ppArtTreeNode, UINT Byte);
+PART_TREE_NODE      __copyArtTreeNode(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE pArtTreeNode, UINT Type);
+UINT                __getArtTreeLowBit(UINT Mask);
+UINT                __getArtTreeHighBit(UINT Mask);
+
+
+// initializeArtTreeFnTbl()
+// This function creates the radix tree and points the function table of the context to it. The events are
+// the tree nodes of the array list and the node pool, the radix tree only indexes them, so the loaded file
+// goes through the same array list as for the tree. Range delete and range increase walk the events one
+// by one, versions and the weighted and rank selects are not supported
+VOID initializeArtTreeFnTbl(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    pRbTreeContext->pArtTreeContext = (PART_TREE_CONTEXT)calloc(1, sizeof(ART_TREE_CONTEXT));
+
+    pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode              = __insertArtTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode              = __deleteArtTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.deleteRangeRbTreeNode         = NULL;
+    pRbTreeContext->stRbTreeFnTbl.increaseRangeRbTreeNode       = NULL;
+    pRbTreeContext->stRbTreeFnTbl.updateRbTreeNodeCount         = __updateArtTreeNodeCount;
+    pRbTreeContext->stRbTreeFnTbl.findRbTreeNode                = __findArtTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.findRbTreeNodeBatch           = __findArtTreeNodeBatch;
+    pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode           = __getNextIDArtTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.getPrevIDRbTreeNode           = __getPrevIDArtTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTree              = __initializeArtTree;
+    pRbTreeContext->stRbTreeFnTbl.appendRbTreeNodeArrayList     = __appendArtTreeNodeArrayList;
+    pRbTreeContext->stRbTreeFnTbl.getPrefixCountRbTreeNode      = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNode         = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNodeBatch    = NULL;
+    pRbTreeContext->stRbTreeFnTbl.getRankRbTreeNode             = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectRankRbTreeNode          = NULL;
+    pRbTreeContext->stRbTreeFnTbl.printRbTreeStats              = __printArtTreeStats;
+}
+
+// destroyArtTree()
+// This function frees the inner nodes of the radix tree, the events go with the array list and the node pool
+VOID destroyArtTree(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    PART_TREE_CONTEXT   pArtTreeContext = pRbTreeContext->pArtTreeContext;
+
+    if (pArtTreeContext == NULL)
+    {
+        return;
+    }
+
+    __freeArtTreeNodeList(pArtTreeContext, pArtTreeContext->pRootArtTreeNode);
+    free(pArtTreeContext);
+    pRbTreeContext->pArtTreeContext = NULL;
+}
+
+// __insertArtTreeNode()
+// This function adds Count to the event with the ID, the event is added if it doesnt exist yet
+PRB_TREE_NODE __insertArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count)
+{
+    return __insertArtTreeLeaf(pRbTreeContext, ID, Count, NULL);
+}
+
+// __insertArtTreeLeaf()
+// This function walks down the bytes of the ID. An event that is there already gets Count added, otherwise
+// pLeafRbTreeNode is put in the first free slot on the way, or a new node if it is NULL. An event found in
+// the slot is pushed down together with the new one till their bytes differ
+PRB_TREE_NODE __insertArtTreeLeaf(PRB_TREE_CONTEXT pRbTreeContext, INT ID, INT Count, PRB_TREE_NODE pLeafRbTreeNode)
+{
+    PART_TREE_CONTEXT   pArtTreeContext     = pRbTreeContext->pArtTreeContext;
+    PART_TREE_NODE      *ppArtTreeNode      = &pArtTreeContext->pRootArtTreeNode;
+    PRB_TREE_NODE       pOldRbTreeNode      = NULL;
+    VOID                **ppChild           = NULL;
+    UINT                Key                 = ART_TREE_KEY(ID);
+    UINT                OldKey              = 0;
+    UINT                Depth               = 0;
+
+    if (*ppArtTreeNode == NULL)
+    {
+        *ppArtTreeNode = __allocateArtTreeNode(pArtTreeContext, ART_TREE_TYPE4);
+    }
+
+    for (Depth = 0; Depth < ART_TREE_LEVELS; Depth++)
+    {
+        ppChild = __findArtTreeChild(*ppArtTreeNode, ART_TREE_BYTE(Key, Depth));
+        if (ppChild == NULL || ART_TREE_IS_LEAF(*ppChild))
+        {
+            break;
+        }
+
+        ppArtTreeNode = (PART_TREE_NODE*)ppChild;
+    }
+
+    if (ppChild && ((PRB_TREE_NODE)ART_TREE_UNTAG(*ppChild))->ID == ID)
+    {
+        return __updateArtTreeNodeCount(pRbTreeContext, (PRB_TREE_NODE)ART_TREE_UNTAG(*ppChild), Count);
+    }
+
+    if (pLeafRbTreeNode == NULL)
+    {
+        pLeafRbTreeNode = __buildRbTreeNode(pRbTreeContext, ID, Count);
+    }
+    pArtTreeContext->NumLeaves++;
+
+    if (ppChild == NULL)
+    {
+        __addArtTreeChild(pArtTreeContext, ppArtTreeNode, ART_TREE_BYTE(Key, Depth), ART_TREE_TAG(pLeafRbTreeNode));
+        return pLeafRbTreeNode;
+    }
+
+    // Slot has another event, a node goes in its place for every byte the two IDs still share
+    pOldRbTreeNode  = (PRB_TREE_NODE)ART_TREE_UNTAG(*ppChild);
+    OldKey          = ART_TREE_KEY(pOldRbTreeNode->ID);
+    *ppChild        = __allocateArtTreeNode(pArtTreeContext, ART_TREE_TYPE4);
+    ppArtTreeNode   = (PART_TREE_NODE*)ppChild;
+    for (Depth++; ART_TREE_BYTE(OldKey, Depth) == ART_TREE_BYTE(Key, Depth); Depth++)
+    {
+        ppArtTreeNode = (PART_TREE_NODE*)__addArtTreeChild(pArtTreeContext, ppArtTreeNode, ART_TREE_BYTE(Key, Depth), __allocateArtTreeNode(pArtTreeContext, ART_TREE_TYPE4));
+    }
+
+    __addArtTreeChild(pArtTreeContext, ppArtTreeNode, ART_TREE_BYTE(OldKey, Depth), ART_TREE_TAG(pOldRbTreeNode));
+    __addArtTreeChild(pArtTreeContext, ppArtTreeNode, ART_TREE_BYTE(Key, Depth), ART_TREE_TAG(pLeafRbTreeNode));
+
+    return pLeafRbTreeNode;
+}
+
+// __deleteArtTreeNode()
+// This function removes the event from the radix tree and gives its node back to the node pool. Inner nodes
+// left without children are removed from their parents and a node left with just one event below the root is
+// replaced by the event, so the tree stays as it would be built. Others shrink when they get too sparse
+VOID __deleteArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    PART_TREE_CONTEXT   pArtTreeContext                 = pRbTreeContext->pArtTreeContext;
+    PART_TREE_NODE      *ppArtTreeNodeList[ART_TREE_LEVELS];
+    PART_TREE_NODE      pArtTreeNode                    = NULL;
+    VOID                **ppChild                       = NULL;
+    VOID                *pChild                         = NULL;
+    UINT                Key                             = ART_TREE_KEY(pRbTreeNode->ID);
+    INT                 Depth                           = 0;
+
+    // Remember the slot of every inner node on the path
+    ppArtTreeNodeList[0] = &pArtTreeContext->pRootArtTreeNode;
+    for (Depth = 0; Depth < ART_TREE_LEVELS; Depth++)
+    {
+        if (*ppArtTreeNodeList[Depth] == NULL)
+        {
+            return;
+        }
+
+        ppChild = __findArtTreeChild(*ppArtTreeNodeList[Depth], ART_TREE_BYTE(Key, Depth));
+        if (ppChild == NULL)
+        {
+            return;
+        }
+
+        if (ART_TREE_IS_LEAF(*ppChild))
+        {
+            break;
+        }
+
+        ppArtTreeNodeList[Depth + 1] = (PART_TREE_NODE*)ppChild;
+    }
+
+    if (Depth == ART_TREE_LEVELS || ART_TREE_UNTAG(*ppChild) != pRbTreeNode)
+    {
+        return;
+    }
+
+    __removeArtTreeChild(pArtTreeContext, ppArtTreeNodeList[Depth], ART_TREE_BYTE(Key, Depth));
+    while (TRUE)
+    {
+        pArtTreeNode = *ppArtTreeNodeList[Depth];
+        if (pArtTreeNode->NumChildren == 0)
+        {
+            __freeArtTreeNode(pArtTreeContext, pArtTreeNode);
+            if (Depth == 0)
+            {
+                pArtTreeContext->pRootArtTreeNode = NULL;
+                break;
+            }
+
+            Depth--;
+            __removeArtTreeChild(pArtTreeContext, ppArtTreeNodeList[Depth], ART_TREE_BYTE(Key, Depth));
+            continue;
+        }
+
+        pChild = __getEdgeArtTreeChild(pArtTreeNode, TRUE);
+        if (Depth == 0 || pArtTreeNode->NumChildren > 1 || !ART_TREE_IS_LEAF(pChild))
+        {
+            break;
+        }
+
+        *ppArtTreeNodeList[Depth] = (PART_TREE_NODE)pChild;
+        __freeArtTreeNode(pArtTreeContext, pArtTreeNode);
+        Depth--;
+    }
+
+    pArtTreeContext->NumLeaves--;
+
+    // Nodes of the Array List go to the pool as well, the list itself is freed with the context
+    pRbTreeContext->pNodePoolContext->stNodePoolFnTbl.freeNode(pRbTreeContext->pNodePoolContext, pRbTreeNode);
+}
+
+// __updateArtTreeNodeCount()
+// This function adds Count to the Count of an existing event and returns its node
+PRB_TREE_NODE __updateArtTreeNodeCount(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count)
+{
+    // Events keep no sums up the tree, the context is there for the function table
+    (VOID)pRbTreeContext;
+
+    pRbTreeNode->Count += Count;
+
+    return pRbTreeNode;
+}
+
+// __findArtTreeNode()
+// This function finds the node with the particular ID or if the ID doesnt exist returns the node
+// with the largest ID less than it, or the first node if there is none. Will return NULL if the tree is empty
+PRB_TREE_NODE __findArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID)
+{
+    PART_TREE_NODE  pRootArtTreeNode    = pRbTreeContext->pArtTreeContext->pRootArtTreeNode;
+    PRB_TREE_NODE   pRbTreeNode         = NULL;
+
+    pRbTreeNode = __getFloorArtTreeLeaf(pRootArtTreeNode, 0, ART_TREE_KEY(ID));
+    if (pRbTreeNode == NULL && pRootArtTreeNode)
+    {
+        pRbTreeNode = __getEdgeArtTreeLeaf(pRootArtTreeNode, TRUE);
+    }
+
+    return pRbTreeNode;
+}
+
+// __findArtTreeNodeBatch()
+// This function does __findArtTreeNode for a list of IDs. Walks are at most 4 levels, so the walks of a group of
+// RB_TREE_MAX_BATCH_SIZE go down one level at a time and prefetch the nodes of the next level for all of them,
+// the cache misses of the different walks overlap. IDs that are not there search for the closest event after
+VOID __findArtTreeNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, INT *pIDList, UINT NumIDs, PRB_TREE_NODE *ppRbTreeNodeList)
+{
+    VOID            *pChildList[RB_TREE_MAX_BATCH_SIZE];
+    VOID            **ppChild       = NULL;
+    PRB_TREE_NODE   pRbTreeNode     = NULL;
+    UINT            GroupStart      = 0;
+    UINT            NumLanes        = 0;
+    UINT            Lane            = 0;
+    UINT            Depth           = 0;
+
+    for (GroupStart = 0; GroupStart < NumIDs; GroupStart += RB_TREE_MAX_BATCH_SIZE)
+    {
+        NumLanes = NumIDs - GroupStart;
+        if (NumLanes > RB_TREE_MAX_BATCH_SIZE)
+        {
+            NumLanes = RB_TREE_MAX_BATCH_SIZE;
+        }
+
+        for (Lane = 0; Lane < NumLanes; Lane++)
+        {
+            pChildList[Lane] = pRbTreeContext->pArtTreeContext->pRootArtTreeNode;
+        }
+
+        for (Depth = 0; Depth < ART_TREE_LEVELS; Depth++)
+        {
+            for (Lane = 0; Lane < NumLanes; Lane++)
+            {
+                if (pChildList[Lane] && !ART_TREE_IS_LEAF(pChildList[Lane]))
+                {
+                    ppChild = __findArtTreeChild((PART_TREE_NODE)pChildList[Lane], ART_TREE_BYTE(ART_TREE_KEY(pIDList[GroupStart + Lane]), Depth));
+                    pChildList[Lane] = ppChild ? *ppChild : NULL;
+                    if (pChildList[Lane])
+                    {
+                        PREFETCH(ART_TREE_UNTAG(pChildList[Lane]));
+                    }
+                }
+            }
+        }
+
+        for (Lane = 0; Lane < NumLanes; Lane++)
+        {
+            pRbTreeNode = (PRB_TREE_NODE)ART_TREE_UNTAG(pChildList[Lane]);
+            ppRbTreeNodeList[GroupStart + Lane] = (pRbTreeNode && pRbTreeNode->ID == pIDList[GroupStart + Lane]) ? pRbTreeNode :
+                __findArtTreeNode(pRbTreeContext, pIDList[GroupStart + Lane]);
+        }
+    }
+}
+
+// __getNextIDArtTreeNode()
+// This function returns the next node with ID greater than the current node
+PRB_TREE_NODE __getNextIDArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    UINT    Key = ART_TREE_KEY(pRbTreeNode->ID);
+
+    if (Key == UINT_MAX)
+    {
+        return NULL;
+    }
+
+    return __getCeilArtTreeLeaf(pRbTreeContext->pArtTreeContext->pRootArtTreeNode, 0, Key + 1);
+}
+
+// __getPrevIDArtTreeNode()
+// This function returns the next node with ID less than the current node
+PRB_TREE_NODE __getPrevIDArtTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    UINT    Key = ART_TREE_KEY(pRbTreeNode->ID);
+
+    if (Key == 0)
+    {
+        return NULL;
+    }
+
+    return __getFloorArtTreeLeaf(pRbTreeContext->pArtTreeContext->pRootArtTreeNode, 0, Key - 1);
+}
+
+// __initializeArtTree()
+// This function builds the radix tree from the Array list in O(n) time. The events are sorted and merged as
+// for the tree, then every inner node is made with the type for the number of distinct bytes under it
+VOID __initializeArtTree(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    PART_TREE_CONTEXT   pArtTreeContext = pRbTreeContext->pArtTreeContext;
+
+    __sortRbTreeNodeArrayList(pRbTreeContext);
+
+    if (pRbTreeContext->NumNodesRbTree)
+    {
+        pArtTreeContext->pRootArtTreeNode   = (PART_TREE_NODE)__buildArtTreeNodeList(pRbTreeContext, 0, pRbTreeContext->NumNodesRbTree, 0);
+        pArtTreeContext->NumLeaves          = pRbTreeContext->NumNodesRbTree;
+    }
+}
+
+// __buildArtTreeNodeList()
+// This is the recursive function to build the radix tree from the sorted array list. Events from StartIndex
+// up to EndIndex share the bytes above Depth, the ones with the same byte at Depth go under one child. An
+// event that is alone below the root is put in the slot as it is
+VOID* __buildArtTreeNodeList(PRB_TREE_CONTEXT pRbTreeContext, UINT StartIndex, UINT EndIndex, UINT Depth)
+{
+    PART_TREE_CONTEXT   pArtTreeContext         = pRbTreeContext->pArtTreeContext;
+    PRB_TREE_NODE       pRbTreeNodeArrayList    = pRbTreeContext->pRbTreeNodeArrayList;
+    PART_TREE_NODE      pArtTreeNode            = NULL;
+    UINT                NumChildren             = 0;
+    UINT                GroupStart              = StartIndex;
+    UINT                Index                   = 0;
+    UINT                Byte                    = 0;
+
+    if (Depth > 0 && EndIndex - StartIndex == 1)
+    {
+        return ART_TREE_TAG(&pRbTreeNodeArrayList[StartIndex]);
+    }
+
+    for (Index = StartIndex; Index < EndIndex; Index++)
+    {
+        if (Index == StartIndex || ART_TREE_BYTE(ART_TREE_KEY(pRbTreeNodeArrayList[Index].ID), Depth) != Byte)
+        {
+            Byte = ART_TREE_BYTE(ART_TREE_KEY(pRbTreeNodeArrayList[Index].ID), Depth);
+            NumChildren++;
+        }
+    }
+
+    pArtTreeNode = __allocateArtTreeNode(pArtTreeContext, (NumChildren <= 4) ? ART_TREE_TYPE4 : (NumChildren <= 16) ? ART_TREE_TYPE16 :
+        (NumChildren <= 48) ? ART_TREE_TYPE48 : ART_TREE_TYPE256);
+
+    Byte = ART_TREE_BYTE(ART_TREE_KEY(pRbTreeNodeArrayList[StartIndex].ID), Depth);
+    for (Index = StartIndex + 1; Index <= EndIndex; Index++)
+    {
+        if (Index == EndIndex || ART_TREE_BYTE(ART_TREE_KEY(pRbTreeNodeArrayList[Index].ID), Depth) != Byte)
+        {
+            __addArtTreeChild(pArtTreeContext, &pArtTreeNode, Byte, __buildArtTreeNodeList(pRbTreeContext, GroupStart, Index, Depth + 1));
+            if (Index < EndIndex)
+            {
+                GroupStart  = Index;
+                Byte        = ART_TREE_BYTE(ART_TREE_KEY(pRbTreeNodeArrayList[Index].ID), Depth);
+            }
+        }
+    }
+
+    return pArtTreeNode;
+}
+
+// __appendArtTreeNodeArrayList()
+// This function adds the events from StartIndex to EndIndex of the array list, so a sorted input can be loaded
+// in chunks. Each event takes a walk down the tree, the IDs of the chunk dont have to be greater than the rest
+VOID __appendArtTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT StartIndex, UINT EndIndex)
+{
+    PRB_TREE_NODE   pRbTreeNode = NULL;
+    UINT            Index       = 0;
+
+    for (Index = StartIndex; Index <= EndIndex; Index++)
+    {
+        pRbTreeNode = &pRbTreeContext->pRbTreeNodeArrayList[Index];
+        __insertArtTreeLeaf(pRbTreeContext, pRbTreeNode->ID, pRbTreeNode->Count, pRbTreeNode);
+    }
+}
+
+// __printArtTreeStats()
+// This function prints the number of events, the number of inner nodes of each type and the bytes they take
+VOID __printArtTreeStats(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    PART_TREE_CONTEXT   pArtTreeContext = pRbTreeContext->pArtTreeContext;
+
+    printf("art events %llu node4 %llu node16 %llu node48 %llu node256 %llu nodebytes %llu\n", pArtTreeContext->NumLeaves,
+        pArtTreeContext->NumNodeList[ART_TREE_TYPE4], pArtTreeContext->NumNodeList[ART_TREE_TYPE16],
+        pArtTreeContext->NumNodeList[ART_TREE_TYPE48], pArtTreeContext->NumNodeList[ART_TREE_TYPE256], pArtTreeContext->NodeBytes);
+}
+
+// __getArtTreeNodeSize()
+// This function returns the size of an inner node of the type
+size_t __getArtTreeNodeSize(UINT Type)
+{
+    switch (Type)
+    {
+    case ART_TREE_TYPE4:
+        return sizeof(ART_TREE_NODE4);
+    case ART_TREE_TYPE16:
+        return sizeof(ART_TREE_NODE16);
+    case ART_TREE_TYPE48:
+        return sizeof(ART_TREE_NODE48);
+    default:
+        return sizeof(ART_TREE_NODE256);
+    }
+}
+
+// __allocateArtTreeNode()
+// This function allocates an inner node of the type without children
+PART_TREE_NODE __allocateArtTreeNode(PART_TREE_CONTEXT pArtTreeContext, UINT Type)
+{
+    PART_TREE_NODE  pArtTreeNode = NULL;
+
+    pArtTreeNode = (PART_TREE_NODE)calloc(1, __getArtTreeNodeSize(Type));
+    pArtTreeNode->Type = (UCHAR)Type;
+
+    pArtTreeContext->NumNodeList[Type]++;
+    pArtTreeContext->NodeBytes += __getArtTreeNodeSize(Type);
+
+    return pArtTreeNode;
+}
+
+// __freeArtTreeNode()
+// This function frees an inner node, its children are not touched
+VOID __freeArtTreeNode(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE pArtTreeNode)
+{
+    pArtTreeContext->NumNodeList[pArtTreeNode->Type]--;
+    pArtTreeContext->NodeBytes -= __getArtTreeNodeSize(pArtTreeNode->Type);
+
+    free(pArtTreeNode);
+}
+
+// __freeArtTreeNodeList()
+// This function frees the inner nodes of the subtree, events stay
+VOID __freeArtTreeNodeList(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE pArtTreeNode)
+{
+    VOID    **ppChild   = NULL;
+    UINT    Byte        = 0;
+
+    if (pArtTreeNode == NULL)
+    {
+        return;
+    }
+
+    for (Byte = 0; Byte < 256; Byte++)
+    {
+        ppChild = __findArtTreeChild(pArtTreeNode, Byte);
+        if (ppChild && !ART_TREE_IS_LEAF(*ppChild))
+        {
+            __freeArtTreeNodeList(pArtTreeContext, (PART_TREE_NODE)*ppChild);
+        }
+    }
+
+    __freeArtTreeNode(pArtTreeContext, pArtTreeNode);
+}
+
+// __findArtTreeChild()
+// This function returns the slot of the child for the byte, NULL if there is none. Node16 compares
+// the byte with all of its keys at once
+VOID** __findArtTreeChild(PART_TREE_NODE pArtTreeNode, UINT Byte)
+{
+    PART_TREE_NODE4     pArtTreeNode4   = NULL;
+    PART_TREE_NODE16    pArtTreeNode16  = NULL;
+    PART_TREE_NODE48    pArtTreeNode48  = NULL;
+    UINT                Index           = 0;
+#if defined(ART_TREE_SIMD)
+    UINT                Mask            = 0;
+#endif
+
+    switch (pArtTreeNode->Type)
+    {
+    case ART_TREE_TYPE4:
+        pArtTreeNode4 = (PART_TREE_NODE4)pArtTreeNode;
+        for (Index = 0; Index < pArtTreeNode->NumChildren; Index++)
+        {
+            if (pArtTreeNode4->KeyList[Index] == Byte)
+            {
+                return &pArtTreeNode4->pChildList[Index];
+            }
+        }
+        return NULL;
+
+    case ART_TREE_TYPE16:
+        pArtTreeNode16 = (PART_TREE_NODE16)pArtTreeNode;
+#if defined(ART_TREE_SIMD)
+        Mask = (UINT)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((CHAR)Byte), _mm_loadu_si128((const __m128i*)pArtTreeNode16->KeyList)));
+        Mask &= (1U << pArtTreeNode->NumChildren) - 1;
+        return Mask ? &pArtTreeNode16->pChildList[__getArtTreeLowBit(Mask)] : NULL;
+#else
+        for (Index = 0; Index < pArtTreeNode->NumChildren; Index++)
+        {
+            if (pArtTreeNode16->KeyList[Index] == Byte)
+            {
+                return &pArtTreeNode16->pChildList[Index];
+            }
+        }
+        return NULL;
+#endif
+
+    case ART_TREE_TYPE48:
+        pArtTreeNode48 = (PART_TREE_NODE48)pArtTreeNode;
+        return pArtTreeNode48->ChildIndexList[Byte] ? &pArtTreeNode48->pChildList[pArtTreeNode48->ChildIndexList[Byte] - 1] : NULL;
+
+    default:
+        return ((PART_TREE_NODE256)pArtTreeNode)->pChildList[Byte] ? &((PART_TREE_NODE256)pArtTreeNode)->pChildList[Byte] : NULL;
+    }
+}
+
+// __getNeighbourArtTreeChild()
+// This function returns the child with the smallest byte greater than Byte if bAbove, else the one with the
+// largest byte less than Byte. NULL if there is none
+VOID* __getNeighbourArtTreeChild(PART_TREE_NODE pArtTreeNode, UINT Byte, BOOLEAN bAbove)
+{
+    PART_TREE_NODE4     pArtTreeNode4   = NULL;
+    PART_TREE_NODE16    pArtTreeNode16  = NULL;
+    PART_TREE_NODE48    pArtTreeNode48  = NULL;
+    PART_TREE_NODE256   pArtTreeNode256 = NULL;
+    INT                 Index           = 0;
+#if defined(ART_TREE_SIMD)
+    __m128i             KeyList;
+    __m128i             Probe;
+    UINT                Mask            = 0;
+#endif
+
+    switch (pArtTreeNode->Type)
+    {
+    case ART_TREE_TYPE4:
+        pArtTreeNode4 = (PART_TREE_NODE4)pArtTreeNode;
+        if (bAbove)
+        {
+            for (Index = 0; Index < pArtTreeNode->NumChildren; Index++)
+            {
+                if (pArtTreeNode4->KeyList[Index] > Byte)
+                {
+                    return pArtTreeNode4->pChildList[Index];
+                }
+            }
+        }
+        else
+        {
+            for (Index = pArtTreeNode->NumChildren - 1; Index >= 0; Index--)
+            {
+                if (pArtTreeNode4->KeyList[Index] < Byte)
+                {
+                    return pArtTreeNode4->pChildList[Index];
+                }
+            }
+        }
+        return NULL;
+
+    case ART_TREE_TYPE16:
+        pArtTreeNode16 = (PART_TREE_NODE16)pArtTreeNode;
+#if defined(ART_TREE_SIMD)
+        // Keys are sorted, bytes are compared signed with the top bit flipped to get the unsigned order
+        KeyList = _mm_xor_si128(_mm_loadu_si128((const __m128i*)pArtTreeNode16->KeyList), _mm_set1_epi8((CHAR)0x80));
+        Probe   = _mm_set1_epi8((CHAR)(Byte ^ 0x80));
+        if (bAbove)
+        {
+            Mask = (UINT)_mm_movemask_epi8(_mm_cmpgt_epi8(KeyList, Probe)) & ((1U << pArtTreeNode->NumChildren) - 1);
+            return Mask ? pArtTreeNode16->pChildList[__getArtTreeLowBit(Mask)] : NULL;
+        }
+        Mask = (UINT)_mm_movemask_epi8(_mm_cmplt_epi8(KeyList, Probe)) & ((1U << pArtTreeNode->NumChildren) - 1);
+        return Mask ? pArtTreeNode16->pChildList[__getArtTreeHighBit(Mask)] : NULL;
+#else
+        if (bAbove)
+        {
+            for (Index = 0; Index < pArtTreeNode->NumChildren; Index++)
+            {
+                if (pArtTreeNode16->KeyList[Index] > Byte)
+                {
+                    return pArtTreeNode16->pChildList[Index];
+                }
+            }
+        }
+        else
+        {
+            for (Index = pArtTreeNode->NumChildren - 1; Index >= 0; Index--)
+            {
+                if (pArtTreeNode16->KeyList[Index] < Byte)
+                {
+                    return pArtTreeNode16->pChildList[Index];
+                }
+            }
+        }
+        return NULL;
+#endif
+
+    case ART_TREE_TYPE48:
+        pArtTreeNode48 = (PART_TREE_NODE48)pArtTreeNode;
+        for (Index = bAbove ? (INT)Byte + 1 : (INT)Byte - 1; Index >= 0 && Index < 256; Index += bAbove ? 1 : -1)
+        {
+            if (pArtTreeNode48->ChildIndexList[Index])
+            {
+                return pArtTreeNode48->pChildList[pArtTreeNode48->ChildIndexList[Index] - 1];
+            }
+        }
+        return NULL;
+
+    default:
+        pArtTreeNode256 = (PART_TREE_NODE256)pArtTreeNode;
+        for (Index = bAbove ? (INT)Byte + 1 : (INT)Byte - 1; Index >= 0 && Index < 256; Index += bAbove ? 1 : -1)
+        {
+            if (pArtTreeNode256->pChildList[Index])
+            {
+                return pArtTreeNode256->pChildList[Index];
+            }
+        }
+        return NULL;
+    }
+}
+
+// __getEdgeArtTreeChild()
+// This function returns the child with the smallest byte if bMin, else the one with the largest byte
+VOID* __getEdgeArtTreeChild(PART_TREE_NODE pArtTreeNode, BOOLEAN bMin)
+{
+    VOID    **ppChild = NULL;
+
+    switch (pArtTreeNode->Type)
+    {
+    case ART_TREE_TYPE4:
+        return ((PART_TREE_NODE4)pArtTreeNode)->pChildList[bMin ? 0 : pArtTreeNode->NumChildren - 1];
+
+    case ART_TREE_TYPE16:
+        return ((PART_TREE_NODE16)pArtTreeNode)->pChildList[bMin ? 0 : pArtTreeNode->NumChildren - 1];
+
+    default:
+        ppChild = __findArtTreeChild(pArtTreeNode, bMin ? 0 : 255);
+        return ppChild ? *ppChild : __getNeighbourArtTreeChild(pArtTreeNode, bMin ? 0 : 255, bMin);
+    }
+}
+
+// __getEdgeArtTreeLeaf()
+// This function returns the event with the smallest ID under the child if bMin, else the one with the largest
+PRB_TREE_NODE __getEdgeArtTreeLeaf(VOID *pChild, BOOLEAN bMin)
+{
+    while (!ART_TREE_IS_LEAF(pChild))
+    {
+        pChild = __getEdgeArtTreeChild((PART_TREE_NODE)pChild, bMin);
+    }
+
+    return (PRB_TREE_NODE)ART_TREE_UNTAG(pChild);
+}
+
+// __getCeilArtTreeLeaf()
+// This function returns the event with the smallest key greater than or equal to Key under the node, NULL if
+// there is none. Path of Key is followed down as far as it goes, then the next greater child on the way back
+PRB_TREE_NODE __getCeilArtTreeLeaf(PART_TREE_NODE pArtTreeNode, UINT Depth, UINT Key)
+{
+    PRB_TREE_NODE   pRbTreeNode = NULL;
+    VOID            **ppChild   = NULL;
+    VOID            *pChild     = NULL;
+
+    if (pArtTreeNode == NULL)
+    {
+        return NULL;
+    }
+
+    ppChild = __findArtTreeChild(pArtTreeNode, ART_TREE_BYTE(Key, Depth));
+    if (ppChild)
+    {
+        if (ART_TREE_IS_LEAF(*ppChild))
+        {
+            pRbTreeNode = (PRB_TREE_NODE)ART_TREE_UNTAG(*ppChild);
+            if (ART_TREE_KEY(pRbTreeNode->ID) >= Key)
+            {
+                return pRbTreeNode;
+            }
+        }
+        else
+        {
+            pRbTreeNode = __getCeilArtTreeLeaf((PART_TREE_NODE)*ppChild, Depth + 1, Key);
+            if (pRbTreeNode)
+            {
+                return pRbTreeNode;
+            }
+        }
+    }
+
+    pChild = __getNeighbourArtTreeChild(pArtTreeNode, ART_TREE_BYTE(Key, Depth), TRUE);
+    return pChild ? __getEdgeArtTreeLeaf(pChild, TRUE) : NULL;
+}
+
+// __getFloorArtTreeLeaf()
+// This function returns the event with the largest key less than or equal to Key under the node, NULL if
+// there is none
+PRB_TREE_NODE __getFloorArtTreeLeaf(PART_TREE_NODE pArtTreeNode, UINT Depth, UINT Key)
+{
+    PRB_TREE_NODE   pRbTreeNode = NULL;
+    VOID            **ppChild   = NULL;
+    VOID            *pChild     = NULL;
+
+    if (pArtTreeNode == NULL)
+    {
+        return NULL;
+    }
+
+    ppChild = __findArtTreeChild(pArtTreeNode, ART_TREE_BYTE(Key, Depth));
+    if (ppChild)
+    {
+        if (ART_TREE_IS_LEAF(*ppChild))
+        {
+            pRbTreeNode = (PRB_TREE_NODE)ART_TREE_UNTAG(*ppChild);
+            if (ART_TREE_KEY(pRbTreeNode->ID) <= Key)
+            {
+                return pRbTreeNode;
+            }
+        }
+        else
+        {
+            pRbTreeNode = __getFloorArtTreeLeaf((PART_TREE_NODE)*ppChild, Depth + 1, Key);
+            if (pRbTreeNode)
+            {
+                return pRbTreeNode;
+            }
+        }
+    }
+
+    pChild = __getNeighbourArtTreeChild(pArtTreeNode, ART_TREE_BYTE(Key, Depth), FALSE);
+    return pChild ? __getEdgeArtTreeLeaf(pChild, FALSE) : NULL;
+}
+
+// __addArtTreeChild()
+// This function adds the child for a byte that isnt in the node yet and returns its slot. A full node is
+// replaced by one of the next bigger type first, the slot of the node in its parent is pointed at it
+VOID** __addArtTreeChild(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE *ppArtTreeNode, UINT Byte, VOID *pChild)
+{
+    PART_TREE_NODE      pArtTreeNode    = *ppArtTreeNode;
+    PART_TREE_NODE48    pArtTreeNode48  = NULL;
+    UCHAR               *pKeyList       = NULL;
+    VOID                **ppChildList   = NULL;
+    UINT                Position        = 0;
+    UINT                Slot            = 0;
+
+    if ((pArtTreeNode->Type == ART_TREE_TYPE4 && pArtTreeNode->NumChildren == 4) ||
+        (pArtTreeNode->Type == ART_TREE_TYPE16 && pArtTreeNode->NumChildren == 16) ||
+        (pArtTreeNode->Type == ART_TREE_TYPE48 && pArtTreeNode->NumChildren == 48))
+    {
+        pArtTreeNode    = __copyArtTreeNode(pArtTreeContext, pArtTreeNode, pArtTreeNode->Type + 1);
+        *ppArtTreeNode  = pArtTreeNode;
+    }
+
+    switch (pArtTreeNode->Type)
+    {
+    case ART_TREE_TYPE4:
+    case ART_TREE_TYPE16:
+        // Keep the keys sorted, the ones greater than the byte move up one
+        pKeyList    = (pArtTreeNode->Type == ART_TREE_TYPE4) ? ((PART_TREE_NODE4)pArtTreeNode)->KeyList : ((PART_TREE_NODE16)pArtTreeNode)->KeyList;
+        ppChildList = (pArtTreeNode->Type == ART_TREE_TYPE4) ? ((PART_TREE_NODE4)pArtTreeNode)->pChildList : ((PART_TREE_NODE16)pArtTreeNode)->pChildList;
+        while (Position < pArtTreeNode->NumChildren && pKeyList[Position] < Byte)
+        {
+            Position++;
+        }
+        memmove(&pKeyList[Position + 1], &pKeyList[Position], pArtTreeNode->NumChildren - Position);
+        memmove(&ppChildList[Position + 1], &ppChildList[Position], sizeof(VOID*) * (pArtTreeNode->NumChildren - Position));
+        pKeyList[Position]      = (UCHAR)Byte;
+        ppChildList[Position]   = pChild;
+        pArtTreeNode->NumChildren++;
+        return &ppChildList[Position];
+
+    case ART_TREE_TYPE48:
+        pArtTreeNode48 = (PART_TREE_NODE48)pArtTreeNode;
+        while (pArtTreeNode48->pChildList[Slot])
+        {
+            Slot++;
+        }
+        pArtTreeNode48->pChildList[Slot]        = pChild;
+        pArtTreeNode48->ChildIndexList[Byte]    = (UCHAR)(Slot + 1);
+        pArtTreeNode->NumChildren++;
+        return &pArtTreeNode48->pChildList[Slot];
+
+    default:
+        ((PART_TREE_NODE256)pArtTreeNode)->pChildList[Byte] = pChild;
+        pArtTreeNode->NumChildren++;
+        return &((PART_TREE_NODE256)pArtTreeNode)->pChildList[Byte];
+    }
+}
+
+// __removeArtTreeChild()
+// This function removes the child for the byte from the node. A node that got too sparse is replaced by one of
+// the next smaller type, a little below its size so that a key coming and going doesnt flip the type each time
+VOID __removeArtTreeChild(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE *ppArtTreeNode, UINT Byte)
+{
+    PART_TREE_NODE      pArtTreeNode    = *ppArtTreeNode;
+    PART_TREE_NODE48    pArtTreeNode48  = NULL;
+    PART_TREE_NODE      pNewArtTreeNode = NULL;
+    UCHAR               *pKeyList       = NULL;
+    VOID                **ppChildList   = NULL;
+    UINT                Position        = 0;
+
+    switch (pArtTreeNode->Type)
+    {
+    case ART_TREE_TYPE4:
+    case ART_TREE_TYPE16:
+        pKeyList    = (pArtTreeNode->Type == ART_TREE_TYPE4) ? ((PART_TREE_NODE4)pArtTreeNode)->KeyList : ((PART_TREE_NODE16)pArtTreeNode)->KeyList;
+        ppChildList = (pArtTreeNode->Type == ART_TREE_TYPE4) ? ((PART_TREE_NODE4)pArtTreeNode)->pChildList : ((PART_TREE_NODE16)pArtTreeNode)->pChildList;
+        while (pKeyList[Position] != Byte)
+        {
+            Position++;
+        }
+        memmove(&pKeyList[Position], &pKeyList[Position + 1], pArtTreeNode->NumChildren - Position - 1);
+        memmove(&ppChildList[Position], &ppChildList[Position + 1], sizeof(VOID*) * (pArtTreeNode->NumChildren - Position - 1));
+        pArtTreeNode->NumChildren--;
+        break;
+
+    case ART_TREE_TYPE48:
+        pArtTreeNode48 = (PART_TREE_NODE48)pArtTreeNode;
+        pArtTreeNode48->pChildList[pArtTreeNode48->ChildIndexList[Byte] - 1]   = NULL;
+        pArtTreeNode48->ChildIndexList[Byte]                                    = 0;
+        pArtTreeNode->NumChildren--;
+        break;
+
+    default:
+        ((PART_TREE_NODE256)pArtTreeNode)->pChildList[Byte] = NULL;
+        pArtTreeNode->NumChildren--;
+        break;
+    }
+
+    if ((pArtTreeNode->Type == ART_TREE_TYPE16 && pArtTreeNode->NumChildren <= ART_TREE_SHRINK16) ||
+        (pArtTreeNode->Type == ART_TREE_TYPE48 && pArtTreeNode->NumChildren <= ART_TREE_SHRINK48) ||
+        (pArtTreeNode->Type == ART_TREE_TYPE256 && pArtTreeNode->NumChildren <= ART_TREE_SHRINK256))
+    {
+        pNewArtTreeNode = __copyArtTreeNode(pArtTreeContext, pArtTreeNode, pArtTreeNode->Type - 1);
+        *ppArtTreeNode  = pNewArtTreeNode;
+    }
+}
+
+// __copyArtTreeNode()
+// This function moves the children of the node in byte order to a new node of the type and frees the old one
+PART_TREE_NODE __copyArtTreeNode(PART_TREE_CONTEXT pArtTreeContext, PART_TREE_NODE pArtTreeNode, UINT Type)
+{
+    PART_TREE_NODE  pNewArtTreeNode = __allocateArtTreeNode(pArtTreeContext, Type);
+    VOID            **ppChild       = NULL;
+    UINT            Byte            = 0;
+
+    for (Byte = 0; Byte < 256; Byte++)
+    {
+        ppChild = __findArtTreeChild(pArtTreeNode, Byte);
+        if (ppChild)
+        {
+            __addArtTreeChild(pArtTreeContext, &pNewArtTreeNode, Byte, *ppChild);
+        }
+    }
+
+    __freeArtTreeNode(pArtTreeContext, pArtTreeNode);
+    return pNewArtTreeNode;
+}
+
+// __getArtTreeLowBit()
+// This function returns the position of the lowest set bit of a non zero mask
+UINT __getArtTreeLowBit(UINT Mask)
+{
+#if defined(_MSC_VER)
+    unsigned long   Position = 0;
+
+    _BitScanForward(&Position, Mask);
+    return (UINT)Position;
+#else
+    return (UINT)__builtin_ctz(Mask);
+#endif
+}
+
+// __getArtTreeHighBit()
+// This function returns the position of the highest set bit of a non zero mask
+UINT __getArtTreeHighBit(UINT Mask)
+{
+#if defined(_MSC_VER)
+    unsigned long   Position = 0;
+
+    _BitScanReverse(&Position, Mask);
+    return (UINT)Position;
+#else
+    return (UINT)(31 - __builtin_clz(Mask));
+#endif
+}
@@ -0,0 +1,94 @@
+//
+// This file contains all the header definitions for
+// the adaptive radix tree that can stand in for the tree
+//
+
+#ifndef _ART_TREE_H_
+#define _ART_TREE_H_
+
+#include "Types.h"
+
+// Definitions
+#define ART_TREE_LEVELS         4
+#define ART_TREE_TYPE4          0
+#define ART_TREE_TYPE16         1
+#define ART_TREE_TYPE48         2
+#define ART_TREE_TYPE256        3
+#define ART_TREE_NUM_TYPES      4
+#define ART_TREE_SHRINK16       3
+#define ART_TREE_SHRINK48       12
+#define ART_TREE_SHRINK256      40
+
+// IDs are compared as unsigned keys with the sign bit flipped, so that the byte order of the key is the
+// order of the IDs. Byte at Depth 0 is the most significant one
+#define ART_TREE_KEY(ID)            ((UINT)(ID) ^ 0x80000000U)
+#define ART_TREE_BYTE(Key, Depth)   ((UINT)((Key) >> (24 - 8 * (Depth))) & 0xFF)
+
+// Child slots hold inner nodes or events, events are tagged with the low bit
+#define ART_TREE_LEAF               ((size_t)1)
+#define ART_TREE_IS_LEAF(pChild)    (((size_t)(pChild)) & ART_TREE_LEAF)
+#define ART_TREE_TAG(pLeaf)         ((VOID*)((size_t)(pLeaf) | ART_TREE_LEAF))
+#define ART_TREE_UNTAG(pChild)      ((VOID*)((size_t)(pChild) & ~ART_TREE_LEAF))
+
+// Node16 is searched with one SSE2 compare of all the keys where it is there
+#if defined(_MSC_VER) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ART_TREE_SIMD   1
+#endif
+
+// Header of the inner nodes, the type tells how the children are kept
+typedef struct _ART_TREE_NODE
+{
+    UCHAR   Type;
+    UCHAR   Reserved;
+    USHORT  NumChildren;
+}ART_TREE_NODE, *PART_TREE_NODE;
+
+// Up to 4 and up to 16 children, the keys are kept sorted with the children in the same order
+typedef struct _ART_TREE_NODE4
+{
+    ART_TREE_NODE   Header;
+    UCHAR           KeyList[4];
+    VOID            *pChildList[4];
+}ART_TREE_NODE4, *PART_TREE_NODE4;
+
+typedef struct _ART_TREE_NODE16
+{
+    ART_TREE_NODE   Header;
+    UCHAR           KeyList[16];
+    VOID            *pChildList[16];
+}ART_TREE_NODE16, *PART_TREE_NODE16;
+
+// Up to 48 children, ChildIndexList has the slot of the child of every key plus 1 or 0 if there is none
+typedef struct _ART_TREE_NODE48
+{
+    ART_TREE_NODE   Header;
+    UCHAR           ChildIndexList[256];
+    VOID            *pChildList[48];
+}ART_TREE_NODE48, *PART_TREE_NODE48;
+
+// Child of every key
+typedef struct _ART_TREE_NODE256
+{
+    ART_TREE_NODE   Header;
+    VOID            *pChildList[256];
+}ART_TREE_NODE256, *PART_TREE_NODE256;
+
+// Art Tree Context Definition
+// Every ID is ART_TREE_LEVELS bytes. An event sits in the first level where no other ID shares its bytes so
+// far, so it is at most 4 inner nodes down from the root and sparse IDs dont need a node on every level.
+// Inner nodes take the smallest type that holds their children, the root is always an inner node
+typedef struct _ART_TREE_CONTEXT
+{
+    PART_TREE_NODE  pRootArtTreeNode;
+    ULONGLONG       NumLeaves;
+    ULONGLONG       NumNodeList[ART_TREE_NUM_TYPES];
+    ULONGLONG       NodeBytes;
+}ART_TREE_CONTEXT, *PART_TREE_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside ArtTree.c
+struct _RB_TREE_CONTEXT;
+VOID    initializeArtTreeFnTbl(struct _RB_TREE_CONTEXT *pRbTreeContext);
+VOID    destroyArtTree(struct _RB_TREE_CONTEXT *pRbTreeContext);
+#endif
@@ -0,0 +1,701 @@
+//
+// This file implements the compressed store of the frozen event ID ranges. Each segment keeps its
+// IDs Elias Fano coded in about 2 + log(Range / Events) bits an event and the counts bit packed,
+// count, next, previous and inrange are answered with select on the high bits of the IDs
+//
+
+#include "ColdStore.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Local Function Declarations
+VOID                __insertColdStoreRecords(struct _COLD_STORE_CONTEXT *pColdStoreContext, PRADIX_SORT_RECORD pRecordList, UINT NumRecords);
+UINT                __thawColdStoreSegments(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID1, INT ID2, PRADIX_SORT_RECORD *ppRecordList);
+UINT                __readColdStoreSegment(struct _COLD_STORE_CONTEXT *pColdStoreContext, UINT SegmentIndex, PRADIX_SORT_RECORD *ppRecordList);
+BOOLEAN             __getCeilColdStoreRecord(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID, PRADIX_SORT_RECORD pRecord);
+BOOLEAN             __getFloorColdStoreRecord(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID, PRADIX_SORT_RECORD pRecord);
+LONGLONG            __getColdStoreRangeCount(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID1, INT ID2);
+ULONGLONG           __getColdStoreRangeEvents(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID1, INT ID2);
+VOID                __printColdStoreStats(struct _COLD_STORE_CONTEXT *pColdStoreContext);
+ULONGLONG           __getColdStoreBytes(struct _COLD_STORE_CONTEXT *pColdStoreContext);
+UINT                __findColdStoreSegment(PCOLD_STORE_CONTEXT pColdStoreContext, LONGLONG ID);
+PCOLD_STORE_SEGMENT __createColdStoreSegment(PRADIX_SORT_RECORD pRecordList, UINT NumRecords);
+VOID                __destroyColdStoreSegment(PCOLD_STORE_SEGMENT *ppColdStoreSegment);
+ULONGLONG           __getColdStoreSegmentBytes(PCOLD_STORE_SEGMENT pColdStoreSegment);
+VOID                __decodeColdStoreSegment(PCOLD_STORE_SEGMENT pColdStoreSegment, PRADIX_SORT_RECORD pRecordList);
+UINT                __getColdStoreLowerBound(PCOLD_STORE_SEGMENT pColdStoreSegment, LONGLONG ID);
+VOID                __getColdStoreRecord(PCOLD_STORE_SEGMENT pColdStoreSegment, UINT Index, PRADIX_SORT_RECORD pRecord);
+LONGLONG            __getColdStorePrefixCount(PCOLD_STORE_SEGMENT pColdStoreSegment, UINT Index);
+ULONGLONG           __selectColdStoreHighBit(PCOLD_STORE_SEGMENT pColdStoreSegment, ULONGLONG Rank, BOOLEAN bSet);
+BOOLEAN             __testColdStoreBit(ULONGLONG *pWordList, ULONGLONG BitIndex);
+VOID                __setColdStoreBits(ULONGLONG *pWordList, ULONGLONG BitIndex, UINT NumBits, ULONGLONG Value);
+ULONGLONG           __getColdStoreBits(ULONGLONG *pWordList, ULONGLONG BitIndex, UINT NumBits);
+UINT                __countColdStoreBits(ULONGLONG Word);
+UINT                __selectColdStoreBit(ULONGLONG Word, UINT Rank);
+ULONGLONG           __getColdStoreNumWords(ULONGLONG NumBits);
+
+
+// createColdStoreContext()
+// This function allocates memory for the context and initilize the function pointers.
+// Frozen events are split into segments of SegmentSize events, 0 keeps every freeze in one segment
+PCOLD_STORE_CONTEXT createColdStoreContext(UINT SegmentSize)
+{
+    PCOLD_STORE_CONTEXT pColdStoreContext = NULL;
+
+    pColdStoreContext = (PCOLD_STORE_CONTEXT)malloc(sizeof(COLD_STORE_CONTEXT));
+    memset(pColdStoreContext, 0, sizeof(COLD_STORE_CONTEXT));
+    pColdStoreContext->SegmentSize = SegmentSize;
+
+    // Initilize the function table
+    pColdStoreContext->stColdStoreFnTbl.insertColdStoreRecords  = __insertColdStoreRecords;
+    pColdStoreContext->stColdStoreFnTbl.thawColdStoreSegments   = __thawColdStoreSegments;
+    pColdStoreContext->stColdStoreFnTbl.readColdStoreSegment    = __readColdStoreSegment;
+    pColdStoreContext->stColdStoreFnTbl.getCeilColdStoreRecord  = __getCeilColdStoreRecord;
+    pColdStoreContext->stColdStoreFnTbl.getFloorColdStoreRecord = __getFloorColdStoreRecord;
+    pColdStoreContext->stColdStoreFnTbl.getColdStoreRangeCount  = __getColdStoreRangeCount;
+    pColdStoreContext->stColdStoreFnTbl.getColdStoreRangeEvents = __getColdStoreRangeEvents;
+    pColdStoreContext->stColdStoreFnTbl.printColdStoreStats     = __printColdStoreStats;
+    pColdStoreContext->stColdStoreFnTbl.getColdStoreBytes       = __getColdStoreBytes;
+
+    return pColdStoreContext;
+}
+
+// destroyColdStoreContext()
+// This function frees up all the segments and the context
+VOID destroyColdStoreContext(PCOLD_STORE_CONTEXT *ppColdStoreContext)
+{
+    UINT    Index = 0;
+
+    if (*ppColdStoreContext)
+    {
+        for (Index = 0; Index < (*ppColdStoreContext)->NumSegments; Index++)
+        {
+            __destroyColdStoreSegment(&(*ppColdStoreContext)->ppSegmentList[Index]);
+        }
+        free((*ppColdStoreContext)->ppSegmentList);
+        free(*ppColdStoreContext);
+        *ppColdStoreContext = NULL;
+    }
+}
+
+// __insertColdStoreRecords()
+// This function freezes the records into new segments. Records have to be sorted by ID without duplicates
+// and must not overlap the ID range of any segment already in the store
+VOID __insertColdStoreRecords(struct _COLD_STORE_CONTEXT *pColdStoreContext, PRADIX_SORT_RECORD pRecordList, UINT NumRecords)
+{
+    UINT    StartIndex          = 0;
+    UINT    NumSegmentEvents    = 0;
+    UINT    SegmentIndex        = 0;
+
+    if (NumRecords == 0)
+    {
+        return;
+    }
+
+    SegmentIndex = __findColdStoreSegment(pColdStoreContext, pRecordList[0].ID);
+
+    for (StartIndex = 0; StartIndex < NumRecords; StartIndex += NumSegmentEvents)
+    {
+        NumSegmentEvents = NumRecords - StartIndex;
+        if (pColdStoreContext->SegmentSize && NumSegmentEvents > pColdStoreContext->SegmentSize)
+        {
+            NumSegmentEvents = pColdStoreContext->SegmentSize;
+        }
+
+        // Grow the segment list by doubling
+        if (pColdStoreContext->NumSegments == pColdStoreContext->MaxSegments)
+        {
+            pColdStoreContext->MaxSegments = pColdStoreContext->MaxSegments ? pColdStoreContext->MaxSegments * 2 : COLD_STORE_MIN_SEGMENTS;
+            pColdStoreContext->ppSegmentList = (PCOLD_STORE_SEGMENT*)realloc(pColdStoreContext->ppSegmentList,
+                sizeof(PCOLD_STORE_SEGMENT) * pColdStoreContext->MaxSegments);
+        }
+
+        // Records are consecutive, so each segment goes right after the one before
+        memmove(&pColdStoreContext->ppSegmentList[SegmentIndex + 1], &pColdStoreContext->ppSegmentList[SegmentIndex],
+            sizeof(PCOLD_STORE_SEGMENT) * (pColdStoreContext->NumSegments - SegmentIndex));
+        pColdStoreContext->ppSegmentList[SegmentIndex++] = __createColdStoreSegment(&pRecordList[StartIndex], NumSegmentEvents);
+        pColdStoreContext->NumSegments++;
+    }
+
+    pColdStoreContext->NumEvents += NumRecords;
+}
+
+// __thawColdStoreSegments()
+// This function takes all the segments whose ID range overlaps ID1 to ID2 out of the store and hands back
+// their events in ID order. The record list is allocated here and freed by the caller, returns the number
+// of records, 0 if no segment overlaps the range
+UINT __thawColdStoreSegments(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID1, INT ID2, PRADIX_SORT_RECORD *ppRecordList)
+{
+    UINT    StartIndex  = 0;
+    UINT    EndIndex    = 0;
+    UINT    Index       = 0;
+    UINT    NumRecords  = 0;
+
+    *ppRecordList = NULL;
+    if (ID1 > ID2)
+    {
+        return 0;
+    }
+
+    StartIndex = __findColdStoreSegment(pColdStoreContext, ID1);
+    for (EndIndex = StartIndex; EndIndex < pColdStoreContext->NumSegments && pColdStoreContext->ppSegmentList[EndIndex]->MinID <= ID2; EndIndex++)
+    {
+        NumRecords += pColdStoreContext->ppSegmentList[EndIndex]->NumEvents;
+    }
+
+    if (NumRecords == 0)
+    {
+        return 0;
+    }
+
+    *ppRecordList = (PRADIX_SORT_RECORD)malloc(sizeof(RADIX_SORT_RECORD) * NumRecords);
+    NumRecords = 0;
+    for (Index = StartIndex; Index < EndIndex; Index++)
+    {
+        __decodeColdStoreSegment(pColdStoreContext->ppSegmentList[Index], &(*ppRecordList)[NumRecords]);
+        NumRecords += pColdStoreContext->ppSegmentList[Index]->NumEvents;
+        __destroyColdStoreSegment(&pColdStoreContext->ppSegmentList[Index]);
+    }
+
+    memmove(&pColdStoreContext->ppSegmentList[StartIndex], &pColdStoreContext->ppSegmentList[EndIndex],
+        sizeof(PCOLD_STORE_SEGMENT) * (pColdStoreContext->NumSegments - EndIndex));
+    pColdStoreContext->NumSegments  -= EndIndex - StartIndex;
+    pColdStoreContext->NumEvents    -= NumRecords;
+
+    return NumRecords;
+}
+
+// __readColdStoreSegment()
+// This function hands back the events of the segment at SegmentIndex in ID order, leaving the segment in the store.
+// The record list is allocated here and freed by the caller, returns the number of records
+UINT __readColdStoreSegment(struct _COLD_STORE_CONTEXT *pColdStoreContext, UINT SegmentIndex, PRADIX_SORT_RECORD *ppRecordList)
+{
+    PCOLD_STORE_SEGMENT pColdStoreSegment = pColdStoreContext->ppSegmentList[SegmentIndex];
+
+    *ppRecordList = (PRADIX_SORT_RECORD)malloc(sizeof(RADIX_SORT_RECORD) * pColdStoreSegment->NumEvents);
+    __decodeColdStoreSegment(pColdStoreSegment, *ppRecordList);
+
+    return pColdStoreSegment->NumEvents;
+}
+
+// __getCeilColdStoreRecord()
+// This function gets the frozen event with the smallest ID greater than or equal to ID.
+// Returns FALSE if there is no such event
+BOOLEAN __getCeilColdStoreRecord(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID, PRADIX_SORT_RECORD pRecord)
+{
+    PCOLD_STORE_SEGMENT pColdStoreSegment   = NULL;
+    UINT                SegmentIndex        = 0;
+
+    // First segment that ends at or after the ID has the event
+    SegmentIndex = __findColdStoreSegment(pColdStoreContext, ID);
+    if (SegmentIndex == pColdStoreContext->NumSegments)
+    {
+        return FALSE;
+    }
+
+    pColdStoreSegment = pColdStoreContext->ppSegmentList[SegmentIndex];
+    __getColdStoreRecord(pColdStoreSegment, __getColdStoreLowerBound(pColdStoreSegment, ID), pRecord);
+
+    return TRUE;
+}
+
+// __getFloorColdStoreRecord()
+// This function gets the frozen event with the greatest ID less than or equal to ID.
+// Returns FALSE if there is no such event
+BOOLEAN __getFloorColdStoreRecord(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID, PRADIX_SORT_RECORD pRecord)
+{
+    PCOLD_STORE_SEGMENT pColdStoreSegment   = NULL;
+    UINT                SegmentIndex        = 0;
+
+    SegmentIndex = __findColdStoreSegment(pColdStoreContext, ID);
+    if (SegmentIndex < pColdStoreContext->NumSegments && pColdStoreContext->ppSegmentList[SegmentIndex]->MinID <= ID)
+    {
+        // ID is inside this segment, take the last event not greater than it
+        pColdStoreSegment = pColdStoreContext->ppSegmentList[SegmentIndex];
+        __getColdStoreRecord(pColdStoreSegment, __getColdStoreLowerBound(pColdStoreSegment, (LONGLONG)ID + 1) - 1, pRecord);
+        return TRUE;
+    }
+
+    if (SegmentIndex == 0)
+    {
+        return FALSE;
+    }
+
+    // Otherwise it is the last event of the segment before
+    pColdStoreSegment = pColdStoreContext->ppSegmentList[SegmentIndex - 1];
+    __getColdStoreRecord(pColdStoreSegment, pColdStoreSegment->NumEvents - 1, pRecord);
+
+    return TRUE;
+}
+
+// __getColdStoreRangeCount()
+// This function gets the total count of the frozen events with IDs between ID1 and ID2 inclusively.
+// Segments inside the range add their total, the ones at the ends add the difference of two prefix sums
+LONGLONG __getColdStoreRangeCount(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID1, INT ID2)
+{
+    PCOLD_STORE_SEGMENT pColdStoreSegment   = NULL;
+    UINT                SegmentIndex        = 0;
+    LONGLONG            TotalCount          = 0;
+
+    if (ID1 > ID2)
+    {
+        return 0;
+    }
+
+    for (SegmentIndex = __findColdStoreSegment(pColdStoreContext, ID1); SegmentIndex < pColdStoreContext->NumSegments; SegmentIndex++)
+    {
+        pColdStoreSegment = pColdStoreContext->ppSegmentList[SegmentIndex];
+        if (pColdStoreSegment->MinID > ID2)
+        {
+            break;
+        }
+
+        if (pColdStoreSegment->MinID >= ID1 && pColdStoreSegment->MaxID <= ID2)
+        {
+            TotalCount += pColdStoreSegment->TotalCount;
+        }
+        else
+        {
+            TotalCount += __getColdStorePrefixCount(pColdStoreSegment, __getColdStoreLowerBound(pColdStoreSegment, (LONGLONG)ID2 + 1)) -
+                          __getColdStorePrefixCount(pColdStoreSegment, __getColdStoreLowerBound(pColdStoreSegment, ID1));
+        }
+    }
+
+    return TotalCount;
+}
+
+// __getColdStoreRangeEvents()
+// This function returns the number of frozen events with IDs between ID1 and ID2 inclusively, whole
+// segments in the range add their number of events and the ones on the ends take the difference of
+// the lower bounds
+ULONGLONG __getColdStoreRangeEvents(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID1, INT ID2)
+{
+    PCOLD_STORE_SEGMENT pColdStoreSegment   = NULL;
+    UINT                SegmentIndex        = 0;
+    ULONGLONG           NumEvents           = 0;
+
+    if (ID1 > ID2)
+    {
+        return 0;
+    }
+
+    for (SegmentIndex = __findColdStoreSegment(pColdStoreContext, ID1); SegmentIndex < pColdStoreContext->NumSegments; SegmentIndex++)
+    {
+        pColdStoreSegment = pColdStoreContext->ppSegmentList[SegmentIndex];
+        if (pColdStoreSegment->MinID > ID2)
+        {
+            break;
+        }
+
+        if (pColdStoreSegment->MinID >= ID1 && pColdStoreSegment->MaxID <= ID2)
+        {
+            NumEvents += pColdStoreSegment->NumEvents;
+        }
+        else
+        {
+            NumEvents += __getColdStoreLowerBound(pColdStoreSegment, (LONGLONG)ID2 + 1) - __getColdStoreLowerBound(pColdStoreSegment, ID1);
+        }
+    }
+
+    return NumEvents;
+}
+
+// __printColdStoreStats()
+// This function prints the number of frozen events and the memory they take
+VOID __printColdStoreStats(struct _COLD_STORE_CONTEXT *pColdStoreContext)
+{
+    ULONGLONG   NumBytes    = 0;
+
+    if (pColdStoreContext->NumSegments == 0)
+    {
+        return;
+    }
+
+    NumBytes = __getColdStoreBytes(pColdStoreContext);
+    printf("coldstore segments %u events %llu bytes %llu bits/event %.2f\n", pColdStoreContext->NumSegments,
+        pColdStoreContext->NumEvents, NumBytes, (8.0 * NumBytes) / pColdStoreContext->NumEvents);
+}
+
+// __getColdStoreBytes()
+// This function gets the memory taken by the segments and the segment list
+ULONGLONG __getColdStoreBytes(struct _COLD_STORE_CONTEXT *pColdStoreContext)
+{
+    ULONGLONG   NumBytes    = sizeof(PCOLD_STORE_SEGMENT) * pColdStoreContext->MaxSegments;
+    UINT        Index       = 0;
+
+    for (Index = 0; Index < pColdStoreContext->NumSegments; Index++)
+    {
+        NumBytes += __getColdStoreSegmentBytes(pColdStoreContext->ppSegmentList[Index]);
+    }
+
+    return NumBytes;
+}
+
+// __findColdStoreSegment()
+// This function binary searches for the first segment whose largest ID is not less than ID,
+// returns the number of segments if there is none
+UINT __findColdStoreSegment(PCOLD_STORE_CONTEXT pColdStoreContext, LONGLONG ID)
+{
+    UINT    Low     = 0;
+    UINT    High    = pColdStoreContext->NumSegments;
+    UINT    Mid     = 0;
+
+    while (Low < High)
+    {
+        Mid = Low + (High - Low) / 2;
+        if (pColdStoreContext->ppSegmentList[Mid]->MaxID < ID)
+        {
+            Low = Mid + 1;
+        }
+        else
+        {
+            High = Mid;
+        }
+    }
+
+    return Low;
+}
+
+// __createColdStoreSegment()
+// This function encodes the sorted records into a segment. The low bits are chosen as log2(Range / Events),
+// which leaves on average less than 2 high bits an event
+PCOLD_STORE_SEGMENT __createColdStoreSegment(PRADIX_SORT_RECORD pRecordList, UINT NumRecords)
+{
+    PCOLD_STORE_SEGMENT pColdStoreSegment   = NULL;
+    ULONGLONG           Range               = 0;
+    ULONGLONG           Offset              = 0;
+    ULONGLONG           NumHighWords        = 0;
+    UINT                MaxCount            = 0;
+    UINT                NumBlocks           = 0;
+    UINT                Index               = 0;
+    UINT                NumOnes             = 0;
+    LONGLONG            TotalCount          = 0;
+
+    pColdStoreSegment = (PCOLD_STORE_SEGMENT)malloc(sizeof(COLD_STORE_SEGMENT));
+    memset(pColdStoreSegment, 0, sizeof(COLD_STORE_SEGMENT));
+
+    pColdStoreSegment->MinID        = pRecordList[0].ID;
+    pColdStoreSegment->MaxID        = pRecordList[NumRecords - 1].ID;
+    pColdStoreSegment->NumEvents    = NumRecords;
+
+    Range = (ULONGLONG)((LONGLONG)pColdStoreSegment->MaxID - pColdStoreSegment->MinID) + 1;
+    while (((ULONGLONG)NumRecords << (pColdStoreSegment->LowBits + 1)) <= Range)
+    {
+        pColdStoreSegment->LowBits++;
+    }
+
+    // Negative counts take all the bits, they are read back through the same cast
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        if ((UINT)pRecordList[Index].Count > MaxCount)
+        {
+            MaxCount = (UINT)pRecordList[Index].Count;
+        }
+    }
+    while (pColdStoreSegment->CountBits < 32 && (MaxCount >> pColdStoreSegment->CountBits))
+    {
+        pColdStoreSegment->CountBits++;
+    }
+
+    Offset                          = (ULONGLONG)((LONGLONG)pColdStoreSegment->MaxID - pColdStoreSegment->MinID);
+    pColdStoreSegment->NumHighBits  = NumRecords + (UINT)(Offset >> pColdStoreSegment->LowBits) + 1;
+    NumHighWords                    = __getColdStoreNumWords(pColdStoreSegment->NumHighBits);
+    NumBlocks                       = (UINT)((NumHighWords + COLD_STORE_RANK_BLOCK_WORDS - 1) / COLD_STORE_RANK_BLOCK_WORDS);
+
+    pColdStoreSegment->pLowWordList     = (ULONGLONG*)calloc(__getColdStoreNumWords((ULONGLONG)NumRecords * pColdStoreSegment->LowBits), sizeof(ULONGLONG));
+    pColdStoreSegment->pHighWordList    = (ULONGLONG*)calloc(NumHighWords, sizeof(ULONGLONG));
+    pColdStoreSegment->pHighRankList    = (UINT*)calloc(NumBlocks + 1, sizeof(UINT));
+    pColdStoreSegment->pCountWordList   = (ULONGLONG*)calloc(__getColdStoreNumWords((ULONGLONG)NumRecords * pColdStoreSegment->CountBits), sizeof(ULONGLONG));
+    pColdStoreSegment->pCountSumList    = (LONGLONG*)calloc(NumRecords / COLD_STORE_SUM_BLOCK_EVENTS + 1, sizeof(LONGLONG));
+
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        Offset = (ULONGLONG)((LONGLONG)pRecordList[Index].ID - pColdStoreSegment->MinID);
+        __setColdStoreBits(pColdStoreSegment->pLowWordList, (ULONGLONG)Index * pColdStoreSegment->LowBits, pColdStoreSegment->LowBits, Offset);
+        __setColdStoreBits(pColdStoreSegment->pHighWordList, (Offset >> pColdStoreSegment->LowBits) + Index, 1, 1);
+        __setColdStoreBits(pColdStoreSegment->pCountWordList, (ULONGLONG)Index * pColdStoreSegment->CountBits, pColdStoreSegment->CountBits, (UINT)pRecordList[Index].Count);
+
+        if (Index % COLD_STORE_SUM_BLOCK_EVENTS == 0)
+        {
+            pColdStoreSegment->pCountSumList[Index / COLD_STORE_SUM_BLOCK_EVENTS] = TotalCount;
+        }
+        TotalCount += pRecordList[Index].Count;
+    }
+    pColdStoreSegment->TotalCount = TotalCount;
+
+    // Prefix at the end of a full last block
+    if (NumRecords % COLD_STORE_SUM_BLOCK_EVENTS == 0)
+    {
+        pColdStoreSegment->pCountSumList[NumRecords / COLD_STORE_SUM_BLOCK_EVENTS] = TotalCount;
+    }
+
+    // Rank directory of the high bits, set bits before each block of words
+    for (Index = 0; Index < NumHighWords; Index++)
+    {
+        if (Index % COLD_STORE_RANK_BLOCK_WORDS == 0)
+        {
+            pColdStoreSegment->pHighRankList[Index / COLD_STORE_RANK_BLOCK_WORDS] = NumOnes;
+        }
+        NumOnes += __countColdStoreBits(pColdStoreSegment->pHighWordList[Index]);
+    }
+    pColdStoreSegment->pHighRankList[NumBlocks] = NumOnes;
+
+    return pColdStoreSegment;
+}
+
+// __destroyColdStoreSegment()
+// This function frees up the segment
+VOID __destroyColdStoreSegment(PCOLD_STORE_SEGMENT *ppColdStoreSegment)
+{
+    if (*ppColdStoreSegment)
+    {
+        free((*ppColdStoreSegment)->pLowWordList);
+        free((*ppColdStoreSegment)->pHighWordList);
+        free((*ppColdStoreSegment)->pHighRankList);
+        free((*ppColdStoreSegment)->pCountWordList);
+        free((*ppColdStoreSegment)->pCountSumList);
+        free(*ppColdStoreSegment);
+        *ppColdStoreSegment = NULL;
+    }
+}
+
+// __getColdStoreSegmentBytes()
+// This function gets the memory taken by the segment
+ULONGLONG __getColdStoreSegmentBytes(PCOLD_STORE_SEGMENT pColdStoreSegment)
+{
+    ULONGLONG   NumHighWords = __getColdStoreNumWords(pColdStoreSegment->NumHighBits);
+
+    return sizeof(COLD_STORE_SEGMENT) +
+        sizeof(ULONGLONG) * __getColdStoreNumWords((ULONGLONG)pColdStoreSegment->NumEvents * pColdStoreSegment->LowBits) +
+        sizeof(ULONGLONG) * NumHighWords +
+        sizeof(UINT) * ((NumHighWords + COLD_STORE_RANK_BLOCK_WORDS - 1) / COLD_STORE_RANK_BLOCK_WORDS + 1) +
+        sizeof(ULONGLONG) * __getColdStoreNumWords((ULONGLONG)pColdStoreSegment->NumEvents * pColdStoreSegment->CountBits) +
+        sizeof(LONGLONG) * (pColdStoreSegment->NumEvents / COLD_STORE_SUM_BLOCK_EVENTS + 1);
+}
+
+// __decodeColdStoreSegment()
+// This function decodes all the events of the segment in one pass over the high bits
+VOID __decodeColdStoreSegment(PCOLD_STORE_SEGMENT pColdStoreSegment, PRADIX_SORT_RECORD pRecordList)
+{
+    ULONGLONG   Position    = 0;
+    UINT        Index       = 0;
+
+    for (Index = 0; Index < pColdStoreSegment->NumEvents; Index++, Position++)
+    {
+        // Every clear bit before the event moves it to the next bucket of high bits
+        while (!__testColdStoreBit(pColdStoreSegment->pHighWordList, Position))
+        {
+            Position++;
+        }
+
+        pRecordList[Index].ID = (INT)((LONGLONG)pColdStoreSegment->MinID + (LONGLONG)(((Position - Index) << pColdStoreSegment->LowBits) |
+            __getColdStoreBits(pColdStoreSegment->pLowWordList, (ULONGLONG)Index * pColdStoreSegment->LowBits, pColdStoreSegment->LowBits)));
+        pRecordList[Index].Count = (INT)(UINT)__getColdStoreBits(pColdStoreSegment->pCountWordList, (ULONGLONG)Index * pColdStoreSegment->CountBits, pColdStoreSegment->CountBits);
+    }
+}
+
+// __getColdStoreLowerBound()
+// This function gets the index of the first event of the segment with ID not less than ID. The bucket of
+// the high bits of the ID starts right after clear bit number High - 1, only the events in that bucket
+// need their low bits compared
+UINT __getColdStoreLowerBound(PCOLD_STORE_SEGMENT pColdStoreSegment, LONGLONG ID)
+{
+    ULONGLONG   Offset      = 0;
+    ULONGLONG   High        = 0;
+    ULONGLONG   Low         = 0;
+    ULONGLONG   Position    = 0;
+    UINT        Index       = 0;
+
+    if (ID <= pColdStoreSegment->MinID)
+    {
+        return 0;
+    }
+    if (ID > pColdStoreSegment->MaxID)
+    {
+        return pColdStoreSegment->NumEvents;
+    }
+
+    Offset  = (ULONGLONG)(ID - pColdStoreSegment->MinID);
+    High    = Offset >> pColdStoreSegment->LowBits;
+    Low     = Offset & ((1ULL << pColdStoreSegment->LowBits) - 1);
+
+    Position    = High ? __selectColdStoreHighBit(pColdStoreSegment, High - 1, FALSE) + 1 : 0;
+    Index       = (UINT)(Position - High);
+
+    while (Position < pColdStoreSegment->NumHighBits && __testColdStoreBit(pColdStoreSegment->pHighWordList, Position))
+    {
+        if (__getColdStoreBits(pColdStoreSegment->pLowWordList, (ULONGLONG)Index * pColdStoreSegment->LowBits, pColdStoreSegment->LowBits) >= Low)
+        {
+            break;
+        }
+        Index++;
+        Position++;
+    }
+
+    return Index;
+}
+
+// __getColdStoreRecord()
+// This function decodes the event at Index of the segment
+VOID __getColdStoreRecord(PCOLD_STORE_SEGMENT pColdStoreSegment, UINT Index, PRADIX_SORT_RECORD pRecord)
+{
+    ULONGLONG   High = __selectColdStoreHighBit(pColdStoreSegment, Index, TRUE) - Index;
+
+    pRecord->ID = (INT)((LONGLONG)pColdStoreSegment->MinID + (LONGLONG)((High << pColdStoreSegment->LowBits) |
+        __getColdStoreBits(pColdStoreSegment->pLowWordList, (ULONGLONG)Index * pColdStoreSegment->LowBits, pColdStoreSegment->LowBits)));
+    pRecord->Count = (INT)(UINT)__getColdStoreBits(pColdStoreSegment->pCountWordList, (ULONGLONG)Index * pColdStoreSegment->CountBits, pColdStoreSegment->CountBits);
+}
+
+// __getColdStorePrefixCount()
+// This function gets the total count of the events before Index, from the sum of the block and the counts left in it
+LONGLONG __getColdStorePrefixCount(PCOLD_STORE_SEGMENT pColdStoreSegment, UINT Index)
+{
+    LONGLONG    TotalCount  = pColdStoreSegment->pCountSumList[Index / COLD_STORE_SUM_BLOCK_EVENTS];
+    UINT        CountIndex  = 0;
+
+    for (CountIndex = Index - Index % COLD_STORE_SUM_BLOCK_EVENTS; CountIndex < Index; CountIndex++)
+    {
+        TotalCount += (INT)(UINT)__getColdStoreBits(pColdStoreSegment->pCountWordList, (ULONGLONG)CountIndex * pColdStoreSegment->CountBits, pColdStoreSegment->CountBits);
+    }
+
+    return TotalCount;
+}
+
+// __selectColdStoreHighBit()
+// This function gets the position of set (or clear) high bit number Rank, counting from 0. The rank directory
+// is binary searched for the block, then the words of the block are counted through
+ULONGLONG __selectColdStoreHighBit(PCOLD_STORE_SEGMENT pColdStoreSegment, ULONGLONG Rank, BOOLEAN bSet)
+{
+    ULONGLONG   NumHighWords    = __getColdStoreNumWords(pColdStoreSegment->NumHighBits);
+    UINT        Low             = 0;
+    UINT        High            = (UINT)((NumHighWords + COLD_STORE_RANK_BLOCK_WORDS - 1) / COLD_STORE_RANK_BLOCK_WORDS) - 1;
+    UINT        Mid             = 0;
+    ULONGLONG   NumBefore       = 0;
+    ULONGLONG   WordIndex       = 0;
+    ULONGLONG   Word            = 0;
+    UINT        NumBits         = 0;
+
+    // Last block with fewer than Rank + 1 matching bits before it
+    while (Low < High)
+    {
+        Mid = Low + (High - Low + 1) / 2;
+        NumBefore = bSet ? pColdStoreSegment->pHighRankList[Mid] :
+            (ULONGLONG)Mid * COLD_STORE_RANK_BLOCK_WORDS * COLD_STORE_WORD_BITS - pColdStoreSegment->pHighRankList[Mid];
+        if (NumBefore <= Rank)
+        {
+            Low = Mid;
+        }
+        else
+        {
+            High = Mid - 1;
+        }
+    }
+
+    NumBefore = bSet ? pColdStoreSegment->pHighRankList[Low] :
+        (ULONGLONG)Low * COLD_STORE_RANK_BLOCK_WORDS * COLD_STORE_WORD_BITS - pColdStoreSegment->pHighRankList[Low];
+    Rank -= NumBefore;
+
+    for (WordIndex = (ULONGLONG)Low * COLD_STORE_RANK_BLOCK_WORDS; WordIndex < NumHighWords; WordIndex++)
+    {
+        Word    = bSet ? pColdStoreSegment->pHighWordList[WordIndex] : ~pColdStoreSegment->pHighWordList[WordIndex];
+        NumBits = __countColdStoreBits(Word);
+        if (Rank < NumBits)
+        {
+            break;
+        }
+        Rank -= NumBits;
+    }
+
+    return WordIndex * COLD_STORE_WORD_BITS + __selectColdStoreBit(Word, (UINT)Rank);
+}
+
+// __testColdStoreBit()
+// This function checks if the bit at BitIndex is set
+BOOLEAN __testColdStoreBit(ULONGLONG *pWordList, ULONGLONG BitIndex)
+{
+    return (pWordList[BitIndex / COLD_STORE_WORD_BITS] >> (BitIndex % COLD_STORE_WORD_BITS)) & 1;
+}
+
+// __setColdStoreBits()
+// This function ors the NumBits low bits of Value into the list at BitIndex, the bits may cross a word boundary
+VOID __setColdStoreBits(ULONGLONG *pWordList, ULONGLONG BitIndex, UINT NumBits, ULONGLONG Value)
+{
+    ULONGLONG   WordIndex   = BitIndex / COLD_STORE_WORD_BITS;
+    UINT        Shift       = (UINT)(BitIndex % COLD_STORE_WORD_BITS);
+
+    if (NumBits == 0)
+    {
+        return;
+    }
+
+    Value &= (NumBits < COLD_STORE_WORD_BITS) ? ((1ULL << NumBits) - 1) : ~0ULL;
+    pWordList[WordIndex] |= Value << Shift;
+    if (Shift + NumBits > COLD_STORE_WORD_BITS)
+    {
+        pWordList[WordIndex + 1] |= Value >> (COLD_STORE_WORD_BITS - Shift);
+    }
+}
+
+// __getColdStoreBits()
+// This function reads NumBits bits of the list at BitIndex
+ULONGLONG __getColdStoreBits(ULONGLONG *pWordList, ULONGLONG BitIndex, UINT NumBits)
+{
+    ULONGLONG   WordIndex   = BitIndex / COLD_STORE_WORD_BITS;
+    UINT        Shift       = (UINT)(BitIndex % COLD_STORE_WORD_BITS);
+    ULONGLONG   Value       = 0;
+
+    if (NumBits == 0)
+    {
+        return 0;
+    }
+
+    Value = pWordList[WordIndex] >> Shift;
+    if (Shift + NumBits > COLD_STORE_WORD_BITS)
+    {
+        Value |= pWordList[WordIndex + 1] << (COLD_STORE_WORD_BITS - Shift);
+    }
+
+    return Value & ((NumBits < COLD_STORE_WORD_BITS) ? ((1ULL << NumBits) - 1) : ~0ULL);
+}
+
+// __countColdStoreBits()
+// This function counts the set bits of the word
+UINT __countColdStoreBits(ULONGLONG Word)
+{
+#if defined(_MSC_VER)
+    return (UINT)__popcnt64(Word);
+#else
+    return (UINT)__builtin_popcountll(Word);
+#endif
+}
+
+// __selectColdStoreBit()
+// This function gets the position of set bit number Rank of the word, counting from 0
+UINT __selectColdStoreBit(ULONGLONG Word, UINT Rank)
+{
+#if defined(_MSC_VER)
+    unsigned long   Position = 0;
+#endif
+
+    // Drop the lower set bits
+    while (Rank--)
+    {
+        Word &= Word - 1;
+    }
+
+#if defined(_MSC_VER)
+    _BitScanForward64(&Position, Word);
+    return (UINT)Position;
+#else
+    return (UINT)__builtin_ctzll(Word);
+#endif
+}
+
+// __getColdStoreNumWords()
+// This function gets the number of words to allocate for NumBits bits, with a spare word so that
+// the bits read across a word boundary at the end stay in bounds
+ULONGLONG __getColdStoreNumWords(ULONGLONG NumBits)
+{
+    return (NumBits + COLD_STORE_WORD_BITS - 1) / COLD_STORE_WORD_BITS + 1;
+}
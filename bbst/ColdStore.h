@@ -0,0 +1,66 @@
+//
+// This file contains all the header definitions for
+// the compressed store of the frozen (cold) event ID ranges
+//
+
+#ifndef _COLD_STORE_H_
+#define _COLD_STORE_H_
+
+#include "Types.h"
+#include "RadixSort.h"
+
+// Definitions
+#define COLD_STORE_WORD_BITS        64
+#define COLD_STORE_RANK_BLOCK_WORDS 8
+#define COLD_STORE_SUM_BLOCK_EVENTS 64
+#define COLD_STORE_MIN_SEGMENTS     16
+
+// Frozen run of events. IDs are Elias Fano coded as offsets from MinID, the low LowBits of every offset
+// are packed in the low list and the rest is unary coded in the high list, where event i is the bit set
+// at (Offset >> LowBits) + i. Rank list has the number of set high bits before every block of words for
+// select, counts are packed in CountBits each with the sum of the counts before every block of events
+typedef struct _COLD_STORE_SEGMENT
+{
+    INT         MinID;
+    INT         MaxID;
+    UINT        NumEvents;
+    UINT        LowBits;
+    UINT        CountBits;
+    UINT        NumHighBits;
+    LONGLONG    TotalCount;
+    ULONGLONG   *pLowWordList;
+    ULONGLONG   *pHighWordList;
+    UINT        *pHighRankList;
+    ULONGLONG   *pCountWordList;
+    LONGLONG    *pCountSumList;
+}COLD_STORE_SEGMENT, *PCOLD_STORE_SEGMENT;
+
+// Cold Store Context Definition
+// Segments are kept sorted by ID and never overlap, a segment holds at most SegmentSize events
+// (all the events frozen together when 0)
+typedef struct _COLD_STORE_CONTEXT
+{
+    UINT                SegmentSize;
+    PCOLD_STORE_SEGMENT *ppSegmentList;
+    UINT                NumSegments;
+    UINT                MaxSegments;
+    ULONGLONG           NumEvents;
+    struct _COLD_STORE_FN_TBL
+    {
+        VOID(*insertColdStoreRecords)(struct _COLD_STORE_CONTEXT *pColdStoreContext, PRADIX_SORT_RECORD pRecordList, UINT NumRecords);
+        UINT(*thawColdStoreSegments)(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID1, INT ID2, PRADIX_SORT_RECORD *ppRecordList);
+        UINT(*readColdStoreSegment)(struct _COLD_STORE_CONTEXT *pColdStoreContext, UINT SegmentIndex, PRADIX_SORT_RECORD *ppRecordList);
+        BOOLEAN(*getCeilColdStoreRecord)(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID, PRADIX_SORT_RECORD pRecord);
+        BOOLEAN(*getFloorColdStoreRecord)(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID, PRADIX_SORT_RECORD pRecord);
+        LONGLONG(*getColdStoreRangeCount)(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID1, INT ID2);
+        ULONGLONG(*getColdStoreRangeEvents)(struct _COLD_STORE_CONTEXT *pColdStoreContext, INT ID1, INT ID2);
+        VOID(*printColdStoreStats)(struct _COLD_STORE_CONTEXT *pColdStoreContext);
+        ULONGLONG(*getColdStoreBytes)(struct _COLD_STORE_CONTEXT *pColdStoreContext);
+    }stColdStoreFnTbl;
+}COLD_STORE_CONTEXT, *PCOLD_STORE_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside ColdStore.c
+PCOLD_STORE_CONTEXT createColdStoreContext(UINT SegmentSize);
+VOID                destroyColdStoreContext(PCOLD_STORE_CONTEXT *ppColdStoreContext);
+#endif
@@ -0,0 +1,175 @@
+//
+// This file implements the functions for the
+// count-min sketch in front of the tree
+//
+
+#include "CountMin.h"
+
+// Local Function Declarations
+UINT        __getCountMinEstimate(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID);
+UINT        __updateCountMinSketch(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID, UINT Value);
+VOID        __markCountMinResident(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID);
+BOOLEAN     __isCountMinResident(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID);
+VOID        __printCountMinStats(struct _COUNT_MIN_CONTEXT *pCountMinContext);
+ULONGLONG   __getCountMinBytes(struct _COUNT_MIN_CONTEXT *pCountMinContext);
+UINT        __getCountMinSlot(PCOUNT_MIN_CONTEXT pCountMinContext, INT ID, UINT Row);
+
+
+// createCountMinContext()
+// This function allocates memory for the context and the counters, and initilize the function pointers
+// Width is rounded up to a power of 2 so that the counter can be computed with a shift
+PCOUNT_MIN_CONTEXT createCountMinContext(UINT Width)
+{
+    PCOUNT_MIN_CONTEXT  pCountMinContext    = NULL;
+    UINT                Log2Width           = 0;
+    ULONGLONG           HashState           = COUNT_MIN_HASH_SEED;
+    UINT                Row                 = 0;
+
+    // Allocate memory for the sketch
+    pCountMinContext = (PCOUNT_MIN_CONTEXT)malloc(sizeof(COUNT_MIN_CONTEXT));
+    memset(pCountMinContext, 0, sizeof(COUNT_MIN_CONTEXT));
+
+    // Round up the width to a power of 2, 0 takes the default
+    if (Width == 0)
+    {
+        Width = COUNT_MIN_DEFAULT_WIDTH;
+    }
+    if (Width < COUNT_MIN_MIN_WIDTH)
+    {
+        Width = COUNT_MIN_MIN_WIDTH;
+    }
+    while (Log2Width < 31 && (1U << Log2Width) < Width)
+    {
+        Log2Width++;
+    }
+
+    pCountMinContext->Width         = 1U << Log2Width;
+    pCountMinContext->HashShift     = 64 - Log2Width;
+    pCountMinContext->pCounterList  = (UINT*)calloc((size_t)pCountMinContext->Width * COUNT_MIN_DEPTH, sizeof(UINT));
+    pCountMinContext->pResidentIndexContext = createHashIndexContext(HASH_INDEX_MIN_CAPACITY);
+
+    // Every row hashes with its own odd multiplier, taken from a splitmix64 sequence
+    for (Row = 0; Row < COUNT_MIN_DEPTH; Row++)
+    {
+        HashState += 0x9E3779B97F4A7C15ULL;
+        pCountMinContext->HashList[Row] = (HashState ^ (HashState >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        pCountMinContext->HashList[Row] = (pCountMinContext->HashList[Row] ^ (pCountMinContext->HashList[Row] >> 27)) * 0x94D049BB133111EBULL;
+        pCountMinContext->HashList[Row] = (pCountMinContext->HashList[Row] ^ (pCountMinContext->HashList[Row] >> 31)) | 1;
+    }
+
+    // Initilize the function table
+    pCountMinContext->stCountMinFnTbl.getCountMinEstimate   = __getCountMinEstimate;
+    pCountMinContext->stCountMinFnTbl.updateCountMinSketch  = __updateCountMinSketch;
+    pCountMinContext->stCountMinFnTbl.markCountMinResident  = __markCountMinResident;
+    pCountMinContext->stCountMinFnTbl.isCountMinResident    = __isCountMinResident;
+    pCountMinContext->stCountMinFnTbl.printCountMinStats    = __printCountMinStats;
+    pCountMinContext->stCountMinFnTbl.getCountMinBytes      = __getCountMinBytes;
+
+    return pCountMinContext;
+}
+
+// destroyCountMinContext()
+// This function deallocates and frees up the context
+VOID destroyCountMinContext(PCOUNT_MIN_CONTEXT *ppCountMinContext)
+{
+    if (*ppCountMinContext)
+    {
+        free((*ppCountMinContext)->pCounterList);
+        destroyHashIndexContext(&(*ppCountMinContext)->pResidentIndexContext);
+        free(*ppCountMinContext);
+        *ppCountMinContext = NULL;
+    }
+}
+
+// __getCountMinSlot()
+// This function returns the index of the counter of the ID in the row, multiply shift hashing of the ID
+// with the multiplier of the row
+UINT __getCountMinSlot(PCOUNT_MIN_CONTEXT pCountMinContext, INT ID, UINT Row)
+{
+    return Row * pCountMinContext->Width + (UINT)(((ULONGLONG)(UINT)ID * pCountMinContext->HashList[Row]) >> pCountMinContext->HashShift);
+}
+
+// __getCountMinEstimate()
+// This function returns the smallest counter of the ID, which is never below the count added for it
+UINT __getCountMinEstimate(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID)
+{
+    UINT    Estimate    = UINT_MAX;
+    UINT    Counter     = 0;
+    UINT    Row         = 0;
+
+    for (Row = 0; Row < COUNT_MIN_DEPTH; Row++)
+    {
+        Counter = pCountMinContext->pCounterList[__getCountMinSlot(pCountMinContext, ID, Row)];
+        if (Counter < Estimate)
+        {
+            Estimate = Counter;
+        }
+    }
+
+    return Estimate;
+}
+
+// __updateCountMinSketch()
+// This function adds Value to the count of the ID and returns its new estimate. Conservative update, the
+// counters of the ID below the old estimate plus Value are raised to it and the others are left alone.
+// Counters stop at UINT_MAX
+UINT __updateCountMinSketch(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID, UINT Value)
+{
+    UINT    SlotList[COUNT_MIN_DEPTH];
+    UINT    Estimate    = UINT_MAX;
+    UINT    Row         = 0;
+
+    for (Row = 0; Row < COUNT_MIN_DEPTH; Row++)
+    {
+        SlotList[Row] = __getCountMinSlot(pCountMinContext, ID, Row);
+        if (pCountMinContext->pCounterList[SlotList[Row]] < Estimate)
+        {
+            Estimate = pCountMinContext->pCounterList[SlotList[Row]];
+        }
+    }
+
+    Estimate = (Value > UINT_MAX - Estimate) ? UINT_MAX : Estimate + Value;
+    for (Row = 0; Row < COUNT_MIN_DEPTH; Row++)
+    {
+        if (pCountMinContext->pCounterList[SlotList[Row]] < Estimate)
+        {
+            pCountMinContext->pCounterList[SlotList[Row]] = Estimate;
+        }
+    }
+
+    pCountMinContext->NumUpdates++;
+    return Estimate;
+}
+
+// __markCountMinResident()
+// This function marks the counters of the ID as stale, its count is no longer in the sketch
+VOID __markCountMinResident(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID)
+{
+    // Any non NULL value marks the ID
+    pCountMinContext->pResidentIndexContext->stHashIndexFnTbl.insertHashIndexEntry(pCountMinContext->pResidentIndexContext, ID, pCountMinContext);
+}
+
+// __isCountMinResident()
+// This function returns TRUE if the counters of the ID are stale
+BOOLEAN __isCountMinResident(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID)
+{
+    return pCountMinContext->pResidentIndexContext->stHashIndexFnTbl.findHashIndexEntry(pCountMinContext->pResidentIndexContext, ID) != NULL;
+}
+
+// __printCountMinStats()
+// This function prints the size of the sketch, how many increases it took, how many events it let in and
+// how many IDs are resident
+VOID __printCountMinStats(struct _COUNT_MIN_CONTEXT *pCountMinContext)
+{
+    printf("countmin width %u depth %u bytes %llu updates %llu promotions %llu resident %u\n", pCountMinContext->Width, COUNT_MIN_DEPTH,
+        __getCountMinBytes(pCountMinContext), pCountMinContext->NumUpdates, pCountMinContext->NumPromotions,
+        pCountMinContext->pResidentIndexContext->NumEntries);
+}
+
+// __getCountMinBytes()
+// This function returns the memory taken by the counters and the resident index
+ULONGLONG __getCountMinBytes(struct _COUNT_MIN_CONTEXT *pCountMinContext)
+{
+    return (ULONGLONG)pCountMinContext->Width * COUNT_MIN_DEPTH * sizeof(UINT) +
+           (ULONGLONG)pCountMinContext->pResidentIndexContext->Capacity * sizeof(HASH_INDEX_ENTRY);
+}
@@ -0,0 +1,49 @@
+//
+// This file contains all the header definitions for
+// the count-min sketch in front of the tree
+//
+
+#ifndef _COUNT_MIN_H_
+#define _COUNT_MIN_H_
+
+#include "Types.h"
+#include "HashIndex.h"
+
+// Definitions
+#define COUNT_MIN_DEPTH         4
+#define COUNT_MIN_MIN_WIDTH     1024
+#define COUNT_MIN_DEFAULT_WIDTH (1 << 20)
+#define COUNT_MIN_HASH_SEED     0x636D736B65746368ULL
+
+// Count Min Context Definition
+// Depth rows of Width counters, an event has one counter in every row picked by the hash of the row. Every
+// counter of an event is at least its count, so the smallest one is an estimate that is never below the count.
+// Updates are conservative, counters are only raised up to the new estimate of the event, which keeps the
+// estimates of the other events sharing them lower.
+// Counters cant be lowered without going under the count of another event, so the IDs whose counters are
+// stale (events that left the tree or were reduced) are kept in the resident index and read 0 out of the tree
+typedef struct _COUNT_MIN_CONTEXT
+{
+    UINT                Width;
+    UINT                HashShift;
+    UINT                *pCounterList;
+    ULONGLONG           HashList[COUNT_MIN_DEPTH];
+    PHASH_INDEX_CONTEXT pResidentIndexContext;
+    ULONGLONG           NumUpdates;
+    ULONGLONG           NumPromotions;
+    struct _COUNT_MIN_FN_TBL
+    {
+        UINT(*getCountMinEstimate)(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID);
+        UINT(*updateCountMinSketch)(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID, UINT Value);
+        VOID(*markCountMinResident)(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID);
+        BOOLEAN(*isCountMinResident)(struct _COUNT_MIN_CONTEXT *pCountMinContext, INT ID);
+        VOID(*printCountMinStats)(struct _COUNT_MIN_CONTEXT *pCountMinContext);
+        ULONGLONG(*getCountMinBytes)(struct _COUNT_MIN_CONTEXT *pCountMinContext);
+    }stCountMinFnTbl;
+}COUNT_MIN_CONTEXT, *PCOUNT_MIN_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside CountMin.c
+PCOUNT_MIN_CONTEXT  createCountMinContext(UINT Width);
+VOID                destroyCountMinContext(PCOUNT_MIN_CONTEXT *ppCountMinContext);
+#endif
@@ -0,0 +1,273 @@
+//
+// This file implements the ordered dump of the events. The tree is walked once from the first ID with the
+// frozen segments merged in, events are formatted straight into large buffers and the buffers are
+// written out together with writev, so the dump costs one system call per few MiB
+//
+
+#if !defined(_MSC_VER)
+#include <errno.h>
+#include <sys/uio.h>
+#else
+#include <io.h>
+#endif
+#include "Dump.h"
+
+// Local Function Declarations
+BOOLEAN __dumpEvents(struct _DUMP_CONTEXT *pDumpContext, PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext, INT ID1, INT ID2, DUMP_FORMAT Format);
+VOID    __appendDumpEvent(PDUMP_CONTEXT pDumpContext, INT ID, INT Count, DUMP_FORMAT Format);
+UINT    __formatDumpInteger(CHAR *pBuffer, INT Value);
+VOID    __flushDumpBuffers(PDUMP_CONTEXT pDumpContext);
+
+
+// createDumpContext()
+// This function allocates memory for the context and initilize the function pointers
+// Events are written to the file descriptor Fd, buffers are allocated by the first dump
+PDUMP_CONTEXT createDumpContext(INT Fd)
+{
+    PDUMP_CONTEXT   pDumpContext = NULL;
+
+    pDumpContext = (PDUMP_CONTEXT)malloc(sizeof(DUMP_CONTEXT));
+    memset(pDumpContext, 0, sizeof(DUMP_CONTEXT));
+    pDumpContext->Fd = Fd;
+
+    // Initilize the function table
+    pDumpContext->stDumpFnTbl.dumpEvents = __dumpEvents;
+
+    return pDumpContext;
+}
+
+// destroyDumpContext()
+// This function frees up the buffers and the context
+VOID destroyDumpContext(PDUMP_CONTEXT *ppDumpContext)
+{
+    if (*ppDumpContext)
+    {
+        free((*ppDumpContext)->pBufferList);
+        free(*ppDumpContext);
+        *ppDumpContext = NULL;
+    }
+}
+
+// __dumpEvents()
+// This function writes the events with IDs between ID1 and ID2 inclusively in ID order, followed by the
+// end event 0 0. Frozen segments outside the range are skipped without decoding them. Prints the events,
+// bytes and writes on stderr when done. Returns FALSE if the output cant be written
+BOOLEAN __dumpEvents(struct _DUMP_CONTEXT *pDumpContext, PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext, INT ID1, INT ID2, DUMP_FORMAT Format)
+{
+    PRB_TREE_NODE       pRbTreeNode     = NULL;
+    PCOLD_STORE_SEGMENT pSegment        = NULL;
+    PRADIX_SORT_RECORD  pRecordList     = NULL;
+    UINT                NumRecords      = 0;
+    UINT                SegmentIndex    = 0;
+    UINT                Index           = 0;
+
+    if (pDumpContext->pBufferList == NULL)
+    {
+        pDumpContext->pBufferList = (CHAR*)malloc((size_t)DUMP_NUM_BUFFERS * DUMP_BUFFER_SIZE);
+    }
+    pDumpContext->BufferIndex   = 0;
+    pDumpContext->BufferOffset  = 0;
+    pDumpContext->bFailed       = FALSE;
+    pDumpContext->NumEvents     = 0;
+    pDumpContext->NumBytes      = 0;
+    pDumpContext->NumWrites     = 0;
+
+    // Closest node to ID1, moved to the first event in the range
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID1);
+    if (pRbTreeNode && pRbTreeNode->ID < ID1)
+    {
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+    }
+
+    // Merge in the frozen events, segments are sorted and dont overlap
+    for (SegmentIndex = 0; pColdStoreContext && SegmentIndex < pColdStoreContext->NumSegments && !pDumpContext->bFailed; SegmentIndex++)
+    {
+        pSegment = pColdStoreContext->ppSegmentList[SegmentIndex];
+        if (pSegment->MaxID < ID1)
+        {
+            continue;
+        }
+        if (pSegment->MinID > ID2)
+        {
+            break;
+        }
+
+        NumRecords = pColdStoreContext->stColdStoreFnTbl.readColdStoreSegment(pColdStoreContext, SegmentIndex, &pRecordList);
+        for (Index = 0; Index < NumRecords && pRecordList[Index].ID <= ID2; Index++)
+        {
+            if (pRecordList[Index].ID < ID1)
+            {
+                continue;
+            }
+
+            while (pRbTreeNode && pRbTreeNode->ID < pRecordList[Index].ID)
+            {
+                __appendDumpEvent(pDumpContext, pRbTreeNode->ID, pRbTreeNode->Count, Format);
+                pDumpContext->NumEvents++;
+                pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+            }
+            __appendDumpEvent(pDumpContext, pRecordList[Index].ID, pRecordList[Index].Count, Format);
+            pDumpContext->NumEvents++;
+        }
+        free(pRecordList);
+    }
+
+    while (pRbTreeNode && pRbTreeNode->ID <= ID2 && !pDumpContext->bFailed)
+    {
+        __appendDumpEvent(pDumpContext, pRbTreeNode->ID, pRbTreeNode->Count, Format);
+        pDumpContext->NumEvents++;
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+    }
+
+    // End event and whatever is left in the buffers
+    __appendDumpEvent(pDumpContext, 0, 0, Format);
+    __flushDumpBuffers(pDumpContext);
+
+    if (pDumpContext->bFailed)
+    {
+        fprintf(stderr, "dump: Write failed after %llu bytes\n", pDumpContext->NumBytes);
+        return FALSE;
+    }
+
+    fprintf(stderr, "dump: %llu events, %llu bytes in %llu writes\n", pDumpContext->NumEvents, pDumpContext->NumBytes, pDumpContext->NumWrites);
+    return TRUE;
+}
+
+// __appendDumpEvent()
+// This function formats the event at the end of the buffer being filled. The buffer is closed if the event
+// may not fit in it, and the buffers are written out once all of them are closed
+VOID __appendDumpEvent(PDUMP_CONTEXT pDumpContext, INT ID, INT Count, DUMP_FORMAT Format)
+{
+    CHAR        *pBuffer    = NULL;
+    UINT        Length      = 0;
+    DUMP_RECORD DumpRecord  = { 0 };
+
+    if (pDumpContext->BufferOffset + DUMP_MAX_EVENT_LENGTH > DUMP_BUFFER_SIZE)
+    {
+        pDumpContext->LengthList[pDumpContext->BufferIndex++]   = pDumpContext->BufferOffset;
+        pDumpContext->BufferOffset                              = 0;
+        if (pDumpContext->BufferIndex == DUMP_NUM_BUFFERS)
+        {
+            __flushDumpBuffers(pDumpContext);
+        }
+    }
+
+    pBuffer = pDumpContext->pBufferList + (size_t)pDumpContext->BufferIndex * DUMP_BUFFER_SIZE + pDumpContext->BufferOffset;
+
+    if (Format == DUMP_FORMAT_BINARY)
+    {
+        DumpRecord.ID       = ID;
+        DumpRecord.Count    = Count;
+        memcpy(pBuffer, &DumpRecord, sizeof(DUMP_RECORD));
+        Length = sizeof(DUMP_RECORD);
+    }
+    else
+    {
+        Length = __formatDumpInteger(pBuffer, ID);
+        pBuffer[Length++] = ' ';
+        Length += __formatDumpInteger(pBuffer + Length, Count);
+        pBuffer[Length++] = '\n';
+    }
+
+    pDumpContext->BufferOffset += Length;
+}
+
+// __formatDumpInteger()
+// This function writes the decimal digits of the value to the buffer and returns how many characters it wrote.
+// Same output as printf %d without going through the format string for every event
+UINT __formatDumpInteger(CHAR *pBuffer, INT Value)
+{
+    CHAR    DigitList[12];
+    UINT    NumDigits   = 0;
+    UINT    Length      = 0;
+    UINT    Magnitude   = (Value < 0) ? 0u - (UINT)Value : (UINT)Value;
+
+    if (Value < 0)
+    {
+        pBuffer[Length++] = '-';
+    }
+
+    do
+    {
+        DigitList[NumDigits++] = (CHAR)('0' + Magnitude % 10);
+        Magnitude /= 10;
+    } while (Magnitude);
+
+    while (NumDigits)
+    {
+        pBuffer[Length++] = DigitList[--NumDigits];
+    }
+
+    return Length;
+}
+
+// __flushDumpBuffers()
+// This function writes the closed buffers and the one being filled with as few writev calls as the output
+// takes, picking up after a short write. Nothing is written once a write failed
+VOID __flushDumpBuffers(PDUMP_CONTEXT pDumpContext)
+{
+    UINT            NumBuffers  = pDumpContext->BufferIndex;
+    UINT            Index       = 0;
+#if !defined(_MSC_VER)
+    struct iovec    IoVectorList[DUMP_NUM_BUFFERS];
+    struct iovec    *pIoVector  = IoVectorList;
+    UINT            NumVectors  = 0;
+    ssize_t         Written     = 0;
+#else
+    INT             Written     = 0;
+#endif
+
+    if (pDumpContext->BufferOffset)
+    {
+        pDumpContext->LengthList[NumBuffers++] = pDumpContext->BufferOffset;
+    }
+    pDumpContext->BufferIndex   = 0;
+    pDumpContext->BufferOffset  = 0;
+
+#if !defined(_MSC_VER)
+    for (Index = 0; Index < NumBuffers; Index++)
+    {
+        IoVectorList[Index].iov_base    = pDumpContext->pBufferList + (size_t)Index * DUMP_BUFFER_SIZE;
+        IoVectorList[Index].iov_len     = pDumpContext->LengthList[Index];
+    }
+    NumVectors = NumBuffers;
+
+    while (NumVectors && !pDumpContext->bFailed)
+    {
+        Written = writev(pDumpContext->Fd, pIoVector, NumVectors);
+        if (Written < 0)
+        {
+            pDumpContext->bFailed = (errno != EINTR);
+            continue;
+        }
+        pDumpContext->NumWrites++;
+        pDumpContext->NumBytes += Written;
+
+        // Skip the buffers that went out, a pipe may take only a part of them
+        while (NumVectors && (size_t)Written >= pIoVector->iov_len)
+        {
+            Written -= pIoVector->iov_len;
+            pIoVector++;
+            NumVectors--;
+        }
+        if (NumVectors)
+        {
+            pIoVector->iov_base = (CHAR*)pIoVector->iov_base + Written;
+            pIoVector->iov_len -= Written;
+        }
+    }
+#else
+    // No writev on Windows, one write per buffer
+    for (Index = 0; Index < NumBuffers && !pDumpContext->bFailed; Index++)
+    {
+        Written = _write(pDumpContext->Fd, pDumpContext->pBufferList + (size_t)Index * DUMP_BUFFER_SIZE, pDumpContext->LengthList[Index]);
+        if (Written != (INT)pDumpContext->LengthList[Index])
+        {
+            pDumpContext->bFailed = TRUE;
+            break;
+        }
+        pDumpContext->NumWrites++;
+        pDumpContext->NumBytes += Written;
+    }
+#endif
+}
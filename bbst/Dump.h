@@ -0,0 +1,57 @@
+//
+// This file contains all the header definitions for
+// the ordered dump of the events with vectored writes
+//
+
+#ifndef _DUMP_H_
+#define _DUMP_H_
+
+#include "Types.h"
+#include "RbTree.h"
+#include "ColdStore.h"
+
+// Definitions
+#define DUMP_BUFFER_SIZE        (1 << 18)
+#define DUMP_NUM_BUFFERS        16
+#define DUMP_MAX_EVENT_LENGTH   24
+
+// Output format, text has a line "<ID> <Count>" per event like next, binary has a DUMP_RECORD per event.
+// Both end with the event 0 0, which cant be a real event
+typedef enum _DUMP_FORMAT
+{
+    DUMP_FORMAT_TEXT,
+    DUMP_FORMAT_BINARY
+}DUMP_FORMAT;
+
+// Event in the binary format, native byte order
+typedef struct _DUMP_RECORD
+{
+    INT     ID;
+    INT     Count;
+}DUMP_RECORD, *PDUMP_RECORD;
+
+// Dump Context Definition
+// Events are formatted into DUMP_NUM_BUFFERS buffers, a buffer is closed when the next event may not fit
+// and all of them go out in one writev once the last one is closed. Buffers are kept between dumps
+typedef struct _DUMP_CONTEXT
+{
+    INT         Fd;
+    CHAR        *pBufferList;
+    UINT        LengthList[DUMP_NUM_BUFFERS];
+    UINT        BufferIndex;
+    UINT        BufferOffset;
+    BOOLEAN     bFailed;
+    ULONGLONG   NumEvents;
+    ULONGLONG   NumBytes;
+    ULONGLONG   NumWrites;
+    struct _DUMP_FN_TBL
+    {
+        BOOLEAN(*dumpEvents)(struct _DUMP_CONTEXT *pDumpContext, PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext, INT ID1, INT ID2, DUMP_FORMAT Format);
+    }stDumpFnTbl;
+}DUMP_CONTEXT, *PDUMP_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside Dump.c
+PDUMP_CONTEXT   createDumpContext(INT Fd);
+VOID            destroyDumpContext(PDUMP_CONTEXT *ppDumpContext);
+#endif
@@ -7,14 +7,64 @@
 // Local Function Declarations
 PEVENT_COUNTER_CONTEXT  __createEventCounterContext();
 VOID                    __destroyEventCounterContext(PEVENT_COUNTER_CONTEXT *ppEventCounterContext);
-BOOLEAN                 __parseEventCounterArgs(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR* argv[]);
+BOOLEAN                 __parseEventCounterArgs(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT argc, CHAR* argv[]);
 BOOLEAN                 __parseInputFile(PEVENT_COUNTER_CONTEXT pEventCounterContext);
-VOID                    __increaseEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT IncrementValue);
-VOID                    __reduceEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT DecrementValue);
+BOOLEAN                 __parseColdInputFile(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+INT                     __increaseEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT IncrementValue);
+INT                     __reduceEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT DecrementValue);
+VOID                    __setEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT Count);
 VOID                    __getEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID);
 VOID                    __getPrevEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID);
 VOID                    __getNextEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID);
 VOID                    __getTotalCountInRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2);
+VOID                    __selectEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, LONGLONG CountIndex);
+VOID                    __getEventQuantile(PEVENT_COUNTER_CONTEXT pEventCounterContext, double Percent);
+ULONGLONG               __getEventRank(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID);
+VOID                    __countDistinctEvents(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2);
+VOID                    __selectEventRank(PEVENT_COUNTER_CONTEXT pEventCounterContext, ULONGLONG Rank);
+LONGLONG                __getEventPrefixCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID);
+VOID                    __printEventCountIndex(PEVENT_COUNTER_CONTEXT pEventCounterContext, LONGLONG CountIndex);
+VOID                    __sampleEvents(PEVENT_COUNTER_CONTEXT pEventCounterContext, UINT NumSamples, INT ID1, INT ID2, BOOLEAN bSorted);
+INT                     __compareEventCountIndex(const VOID *pFirst, const VOID *pSecond);
+ULONGLONG               __getEventCounterRandom(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+INT                     __admitEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT IncrementValue);
+UINT                    __getAdmitEstimate(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID);
+VOID                    __retireAdmitEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID);
+INT                     __applyEventIncrease(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT IncrementValue);
+BOOLEAN                 __combineEventCounterCommand(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *CommandString);
+VOID                    __flushEventCounterCombine(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+VOID                    __touchEventCounterTtl(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID);
+VOID                    __expireEventCounterEvents(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+VOID                    __deleteEventRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2);
+VOID                    __increaseEventRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2, INT IncrementValue);
+VOID                    __freezeEventRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2);
+VOID                    __thawEventRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2);
+VOID                    __printEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, PRB_TREE_NODE pRbTreeNode);
+LONGLONG                __readEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, PRB_TREE_NODE pRbTreeNode);
+VOID                    __printNextEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, PRB_TREE_NODE pRbTreeNode);
+VOID                    __printPrevEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, PRB_TREE_NODE pRbTreeNode);
+BOOLEAN                 __queueEventCounterBatch(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *Token);
+VOID                    __flushEventCounterBatch(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+BOOLEAN                 __selectEventCounterVersion(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *VersionToken);
+VOID                    __commitEventCounterVersion(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+VOID                    __takeEventCounterSnapshot(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *pPath);
+VOID                    __dumpEventCounterEvents(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2, DUMP_FORMAT Format);
+VOID                    __lockEventCounterLoad(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *CommandString);
+VOID                    __unlockEventCounterLoad(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+CHAR*                   __getEventCounterNamespaceToken(CHAR *CommandCopy);
+VOID                    __selectEventCounterNamespace(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *CommandString);
+UINT                    __findEventCounterNamespace(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *pName);
+UINT                    __addEventCounterNamespace(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *pName, PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext);
+VOID                    __printEventCounterMemStats(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+VOID                    __createEventCounterNodePools(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+VOID                    __printEventCounterNumaStats(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+VOID                    __printEventCounterPageStats(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+VOID                    __switchEventCounterNamespace(PEVENT_COUNTER_CONTEXT pEventCounterContext, UINT NamespaceIndex);
+BOOLEAN                 __startEventCounterReplica(PEVENT_COUNTER_CONTEXT pEventCounterContext);
+VOID                    __replicateEventCounterUpdate(PEVENT_COUNTER_CONTEXT pEventCounterContext, REPLICA_OP Op, INT ID1, INT ID2, INT Value);
+BOOLEAN                 __isEventCounterReplicaUpdate(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *Token);
+VOID                    __applyEventCounterReplicaRecords(VOID *pApplyContext, PREPLICA_RECORD pRecordList, UINT NumRecords);
+VOID                    __buildEventCounterBootstrap(PEVENT_COUNTER_CONTEXT pEventCounterContext);
 
 // Main Function for the project
 INT main(INT argc, CHAR *argv[])
@@ -24,14 +74,16 @@ INT main(INT argc, CHAR *argv[])
     CHAR                    CommandString[100];
     CHAR                    *Token = NULL;
     INT                     EventID = 0;
+    INT                     EventID2 = 0;
     INT                     CountValue = 0;
+    UINT                    SampleCount = 0;
 
     do
     {
         // validate the number of arguements entered by user
-        if (argc != 2)
+        if (argc < 2)
         {
-            printf("main : syntax -- bbst <filename>\r\n");
+            printf("main : syntax -- bbst <filename> [-hashindex] [-hotcache <entries>] [-batch <size>] [-topdown] [-skiplist] [-art] [-persistent <versions>] [-streamload] [-streamchunk <events>] [-cold <events>] [-numa] [-hugepages] [-perf] [-leader <port> [-followers <n>]] [-seed <seed>] [-admit <threshold>] [-sketchwidth <counters>] [-combine <entries>] [-combinems <ms>] [-ryw] [-ttl <ms>] [-ttlbatch <events>] [-ttlstep <ms>]\r\n       bbst -follow <host:port> [options]\r\n");
             RetStatus = -1;
             break;
         }
@@ -40,24 +92,77 @@ INT main(INT argc, CHAR *argv[])
         pEventCounterContext =  __createEventCounterContext();
 
         // Parse the arguements and get the filename
-        if (!__parseEventCounterArgs(pEventCounterContext, argv))
+        if (!__parseEventCounterArgs(pEventCounterContext, argc, argv))
         {
             RetStatus = -1;
             break;
         }
 
-        // parse the input file and get the event IDs & counts, also builds the red black tree
-        if (!__parseInputFile(pEventCounterContext))
+        // Samples are drawn again with the same seed, a different one every run by default
+        pEventCounterContext->RandomState = pEventCounterContext->EventCounterArgs.RandomSeed ?
+            pEventCounterContext->EventCounterArgs.RandomSeed : (ULONGLONG)time(NULL);
+
+        // Node memory of all the trees on huge pages
+        if (pEventCounterContext->EventCounterArgs.bHugePages)
+        {
+            pEventCounterContext->pHugePageContext = createHugePageContext();
+            pEventCounterContext->EventCounterArgs.RbTreeArgs.pHugePageContext = pEventCounterContext->pHugePageContext;
+        }
+
+        // Trees of all the namespaces on a node take their nodes from one pool, the default namespace is on the first node
+        __createEventCounterNodePools(pEventCounterContext);
+
+        // create the red black tree with the options given by the user, the input file goes to the default namespace
+        pEventCounterContext->pRbTreeContext = createRbTreeContext(&pEventCounterContext->EventCounterArgs.RbTreeArgs);
+        pEventCounterContext->pColdStoreContext = createColdStoreContext(pEventCounterContext->EventCounterArgs.ColdSegmentSize);
+        __addEventCounterNamespace(pEventCounterContext, EVENT_COUNTER_DEFAULT_NAMESPACE, pEventCounterContext->pRbTreeContext, pEventCounterContext->pColdStoreContext);
+        pEventCounterContext->pCountMinContext = pEventCounterContext->pNamespaceList[0].pCountMinContext;
+        pEventCounterContext->pTimerWheelContext = pEventCounterContext->pNamespaceList[0].pTimerWheelContext;
+        pEventCounterContext->pSnapshotContext = createSnapshotContext(pEventCounterContext->pRbTreeContext, pEventCounterContext->pColdStoreContext);
+        pEventCounterContext->pDumpContext = createDumpContext(fileno(stdout));
+
+        // parse the input file and get the event IDs & counts, also builds the red black tree. A follower
+        // gets its events from the snapshot of the leader instead
+        if (pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress == NULL && !__parseInputFile(pEventCounterContext))
+        {
+            RetStatus = -1;
+            break;
+        }
+
+        // Start taking followers, or follow the leader and wait for its snapshot
+        if (!__startEventCounterReplica(pEventCounterContext))
         {
             RetStatus = -1;
             break;
         }
 
+        // Buffer of the increases when they are write combined
+        if (pEventCounterContext->EventCounterArgs.CombineEntries)
+        {
+            pEventCounterContext->pWriteCombineContext = createWriteCombineContext(pEventCounterContext->EventCounterArgs.CombineEntries);
+        }
+
+        // IDs the timer wheels expire before a command, at most a batch of them
+        if (pEventCounterContext->EventCounterArgs.TtlMs)
+        {
+            pEventCounterContext->pExpiredIDList = (INT*)malloc(sizeof(INT) * pEventCounterContext->EventCounterArgs.TtlBatch);
+        }
+
+        // Count the dTLB loads and misses of the commands where the hardware lets us, only when asked for
+        // since opening the counters costs a few syscalls at start
+        if (pEventCounterContext->EventCounterArgs.bHugePages || pEventCounterContext->EventCounterArgs.bPerf)
+        {
+            pEventCounterContext->pPerfCounterContext = createPerfCounterContext();
+            pEventCounterContext->pPerfCounterContext->stPerfCounterFnTbl.addPerfCounter(pEventCounterContext->pPerfCounterContext, PERF_COUNTER_DTLB_LOADS);
+            pEventCounterContext->pPerfCounterContext->stPerfCounterFnTbl.addPerfCounter(pEventCounterContext->pPerfCounterContext, PERF_COUNTER_DTLB_LOAD_MISSES);
+            pEventCounterContext->pPerfCounterContext->stPerfCounterFnTbl.startPerfCounters(pEventCounterContext->pPerfCounterContext);
+        }
+
         // Wait for commands, quit to exit the program
         do
         {
             // First get the command string from standard input
-            fgets(CommandString, 20, stdin);
+            fgets(CommandString, sizeof(CommandString), stdin);
 
             // Make sure that string has an EOL character at the end, if its a new line, 
             // convert it into EOL
@@ -66,54 +171,295 @@ INT main(INT argc, CHAR *argv[])
                 CommandString[strlen(CommandString) - 1] = '\0';
             }
 
+            // While the file is still loading, wait till the events the command needs are in
+            if (pEventCounterContext->pStreamLoaderContext || pEventCounterContext->pReplicaContext)
+            {
+                __lockEventCounterLoad(pEventCounterContext, CommandString);
+            }
+
+            // A namespace name right after the command runs the command on that namespace
+            __selectEventCounterNamespace(pEventCounterContext, CommandString);
+
+            // Events not increased for the -ttl time go before the command sees them
+            if (pEventCounterContext->pExpiredIDList)
+            {
+                __expireEventCounterEvents(pEventCounterContext);
+            }
+
+            // Print the progress of a snapshot running in the background
+            if (pEventCounterContext->pSnapshotContext->bRunning)
+            {
+                pEventCounterContext->pSnapshotContext->stSnapshotFnTbl.pollSnapshot(pEventCounterContext->pSnapshotContext);
+            }
+
+            // With write combining increases of the default namespace are coalesced in the buffer, the
+            // other commands flush it first when they need the pending deltas
+            if (pEventCounterContext->pWriteCombineContext && pEventCounterContext->NamespaceIndex == 0 &&
+                __combineEventCounterCommand(pEventCounterContext, CommandString))
+            {
+                __unlockEventCounterLoad(pEventCounterContext);
+                continue;
+            }
+
             // Get the First Token to select the command, tokenize with white spaces
             Token = strtok(CommandString, " ");
 
-            if (strcmp(Token, "increase") == 0)
+            // In batch mode point lookups are queued and run together, any other command runs 
+            // the queued ones first. Only the default namespace is batched
+            if (pEventCounterContext->EventCounterArgs.BatchSize && pEventCounterContext->NamespaceIndex == 0 &&
+                !__isEventCounterReplicaUpdate(pEventCounterContext, Token) && __queueEventCounterBatch(pEventCounterContext, Token))
+            {
+                __unlockEventCounterLoad(pEventCounterContext);
+                continue;
+            }
+
+            if (pEventCounterContext->pReplicaContext && __isEventCounterReplicaUpdate(pEventCounterContext, Token))
             {
-                // Get the event ID, increment value and call the function 
+                // A follower only serves reads
+                __flushEventCounterBatch(pEventCounterContext);
+                printf("Replica of %s is read only, updates go to the leader\n", pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress);
+            }
+            else if (strcmp(Token, "increase") == 0)
+            {
+                // Get the event ID, increment value and call the function, followers get the new count
                 EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
                 CountValue = (int)strtol(strtok(NULL, " "), NULL, 10);
-                __increaseEventCount(pEventCounterContext, EventID, CountValue);
+                CountValue = __increaseEventCount(pEventCounterContext, EventID, CountValue);
+                __replicateEventCounterUpdate(pEventCounterContext, REPLICA_OP_SET, EventID, EventID, CountValue);
+                __commitEventCounterVersion(pEventCounterContext);
             }
             else if (strcmp(Token, "reduce") == 0)
             {
-                // Get the event ID, decrement value and call the function 
+                // Get the event ID, decrement value and call the function, followers get the new count
                 EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
                 CountValue = (int)strtol(strtok(NULL, " "), NULL, 10);
-                __reduceEventCount(pEventCounterContext, EventID, CountValue);
+                CountValue = __reduceEventCount(pEventCounterContext, EventID, CountValue);
+                __replicateEventCounterUpdate(pEventCounterContext, REPLICA_OP_SET, EventID, EventID, CountValue);
+                __commitEventCounterVersion(pEventCounterContext);
             }
             else if (strcmp(Token, "count") == 0)
             {
-                // Get the Event ID and call function to get count
-                __getEventCount(pEventCounterContext, (int)strtol(strtok(NULL, " "), NULL, 10));
+                // Get the Event ID and the optional version, call function to get count
+                EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
+                if (__selectEventCounterVersion(pEventCounterContext, strtok(NULL, " ")))
+                {
+                    __getEventCount(pEventCounterContext, EventID);
+                    __selectEventCounterVersion(pEventCounterContext, NULL);
+                }
             }
             else if (strcmp(Token, "inrange") == 0)
             {
-                // Get the event ID1 and ID2, call the function to get Count
+                // Get the event ID1, ID2 and the optional version, call the function to get Count
+                EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
+                EventID2 = (int)strtol(strtok(NULL, " "), NULL, 10);
+                if (__selectEventCounterVersion(pEventCounterContext, strtok(NULL, " ")))
+                {
+                    __getTotalCountInRange(pEventCounterContext, EventID, EventID2);
+                    __selectEventCounterVersion(pEventCounterContext, NULL);
+                }
+            }
+            else if (strcmp(Token, "quantile") == 0)
+            {
+                // Get the percent of the total count and call the function
+                __getEventQuantile(pEventCounterContext, strtod(strtok(NULL, " "), NULL));
+            }
+            else if (strcmp(Token, "selectcount") == 0)
+            {
+                // Get the unit of the total count and call the function
+                __selectEventCount(pEventCounterContext, strtoll(strtok(NULL, " "), NULL, 10));
+            }
+            else if (strcmp(Token, "sample") == 0)
+            {
+                // Get the number of samples, the optional ID range and the sorted flag, call the function
+                SampleCount = (UINT)strtoul(strtok(NULL, " "), NULL, 10);
+                EventID = INT_MIN;
+                EventID2 = INT_MAX;
+                Token = strtok(NULL, " ");
+                if (Token && strcmp(Token, "-sorted") != 0)
+                {
+                    EventID = (int)strtol(Token, NULL, 10);
+                    Token = strtok(NULL, " ");
+                    EventID2 = Token ? (int)strtol(Token, NULL, 10) : EventID;
+                    Token = strtok(NULL, " ");
+                }
+                __sampleEvents(pEventCounterContext, SampleCount, EventID, EventID2, (Token && strcmp(Token, "-sorted") == 0));
+            }
+            else if (strcmp(Token, "rank") == 0)
+            {
+                // Get the event ID and print the number of events up to it
                 EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
-                __getTotalCountInRange(pEventCounterContext, EventID, (int)strtol(strtok(NULL, " "), NULL, 10));
+                if (pEventCounterContext->pRbTreeContext->stRbTreeFnTbl.getRankRbTreeNode)
+                {
+                    printf("%llu\n", __getEventRank(pEventCounterContext, EventID));
+                }
+                else
+                {
+                    printf("Rank queries need the default tree, not -topdown, -skiplist, -art or -persistent\n");
+                }
+            }
+            else if (strcmp(Token, "countdistinct") == 0)
+            {
+                // Get the event ID range and call the function
+                EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
+                EventID2 = (int)strtol(strtok(NULL, " "), NULL, 10);
+                __countDistinctEvents(pEventCounterContext, EventID, EventID2);
+            }
+            else if (strcmp(Token, "kth") == 0)
+            {
+                // Get the rank of the event and call the function
+                __selectEventRank(pEventCounterContext, strtoull(strtok(NULL, " "), NULL, 10));
+            }
+            else if (strcmp(Token, "deleterange") == 0)
+            {
+                // Get the event ID range and call the function 
+                EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
+                EventID2 = (int)strtol(strtok(NULL, " "), NULL, 10);
+                __deleteEventRange(pEventCounterContext, EventID, EventID2);
+                __replicateEventCounterUpdate(pEventCounterContext, REPLICA_OP_DELETE_RANGE, EventID, EventID2, 0);
+                __commitEventCounterVersion(pEventCounterContext);
+            }
+            else if (strcmp(Token, "increaserange") == 0)
+            {
+                // Get the event ID range, increment value and call the function 
+                EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
+                EventID2 = (int)strtol(strtok(NULL, " "), NULL, 10);
+                CountValue = (int)strtol(strtok(NULL, " "), NULL, 10);
+                __increaseEventRange(pEventCounterContext, EventID, EventID2, CountValue);
+                __replicateEventCounterUpdate(pEventCounterContext, REPLICA_OP_INCREASE_RANGE, EventID, EventID2, CountValue);
+                __commitEventCounterVersion(pEventCounterContext);
+            }
+            else if (strcmp(Token, "freeze") == 0)
+            {
+                // Get the event ID range and move its events to the cold store
+                EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
+                __freezeEventRange(pEventCounterContext, EventID, (int)strtol(strtok(NULL, " "), NULL, 10));
             }
             else if (strcmp(Token, "next") == 0)
             {
-                // Get the event ID and call the function
-                __getNextEvent(pEventCounterContext, (int)strtol(strtok(NULL, " "), NULL, 10));
+                // Get the event ID and the optional version, call the function
+                EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
+                if (__selectEventCounterVersion(pEventCounterContext, strtok(NULL, " ")))
+                {
+                    __getNextEvent(pEventCounterContext, EventID);
+                    __selectEventCounterVersion(pEventCounterContext, NULL);
+                }
             }
             else if (strcmp(Token, "previous") == 0)
             {
-                // Get the event ID and call the function
-                __getPrevEvent(pEventCounterContext, (int)strtol(strtok(NULL, " "), NULL, 10));
+                // Get the event ID and the optional version, call the function
+                EventID = (int)strtol(strtok(NULL, " "), NULL, 10);
+                if (__selectEventCounterVersion(pEventCounterContext, strtok(NULL, " ")))
+                {
+                    __getPrevEvent(pEventCounterContext, EventID);
+                    __selectEventCounterVersion(pEventCounterContext, NULL);
+                }
+            }
+            else if (strcmp(Token, "stats") == 0)
+            {
+                // Print the statistics of the tree
+                pEventCounterContext->pRbTreeContext->stRbTreeFnTbl.printRbTreeStats(pEventCounterContext->pRbTreeContext);
+                pEventCounterContext->pColdStoreContext->stColdStoreFnTbl.printColdStoreStats(pEventCounterContext->pColdStoreContext);
+                if (pEventCounterContext->pCountMinContext)
+                {
+                    pEventCounterContext->pCountMinContext->stCountMinFnTbl.printCountMinStats(pEventCounterContext->pCountMinContext);
+                }
+                if (pEventCounterContext->pWriteCombineContext && pEventCounterContext->NamespaceIndex == 0)
+                {
+                    pEventCounterContext->pWriteCombineContext->stWriteCombineFnTbl.printWriteCombineStats(pEventCounterContext->pWriteCombineContext);
+                }
+                if (pEventCounterContext->pTimerWheelContext)
+                {
+                    pEventCounterContext->pTimerWheelContext->stTimerWheelFnTbl.printTimerWheelStats(pEventCounterContext->pTimerWheelContext);
+                }
+            }
+            else if (strcmp(Token, "memstats") == 0)
+            {
+                // Print the memory taken by each namespace
+                __printEventCounterMemStats(pEventCounterContext);
+            }
+            else if (strcmp(Token, "pagestats") == 0)
+            {
+                // Print the memory on huge pages and the dTLB misses
+                __printEventCounterPageStats(pEventCounterContext);
+            }
+            else if (strcmp(Token, "numastats") == 0)
+            {
+                // Print the namespaces, commands and pool pages of each NUMA node
+                __printEventCounterNumaStats(pEventCounterContext);
+            }
+            else if (strcmp(Token, "replstats") == 0)
+            {
+                // Print how far the followers got, or how far behind the leader this follower is
+                if (pEventCounterContext->pReplicaContext)
+                {
+                    pEventCounterContext->pReplicaContext->stReplicaFnTbl.printReplicaStats(pEventCounterContext->pReplicaContext);
+                }
+                else
+                {
+                    printf("replica none, start with -leader <port> or -follow <host:port>\n");
+                }
+            }
+            else if (strcmp(Token, "replwait") == 0)
+            {
+                // Wait till the leader has quit and this follower has applied all it sent
+                if (pEventCounterContext->pReplicaContext && pEventCounterContext->pReplicaContext->bFollower)
+                {
+                    pEventCounterContext->pReplicaContext->stReplicaFnTbl.waitReplicaLeader(pEventCounterContext->pReplicaContext);
+                    printf("replica leader quit, applied %llu\n", pEventCounterContext->pReplicaContext->AppliedSequence);
+                }
+                else
+                {
+                    printf("replwait needs -follow <host:port>\n");
+                }
+            }
+            else if (strcmp(Token, "dump") == 0)
+            {
+                // Get the optional ID range and format, all the events in text by default. The format is a flag
+                // since a name right after the command is a namespace
+                EventID = INT_MIN;
+                EventID2 = INT_MAX;
+                Token = strtok(NULL, " ");
+                if (Token && strcmp(Token, "-binary") != 0)
+                {
+                    EventID = (int)strtol(Token, NULL, 10);
+                    Token = strtok(NULL, " ");
+                    EventID2 = Token ? (int)strtol(Token, NULL, 10) : EventID;
+                    Token = strtok(NULL, " ");
+                }
+                __dumpEventCounterEvents(pEventCounterContext, EventID, EventID2, (Token && strcmp(Token, "-binary") == 0) ? DUMP_FORMAT_BINARY : DUMP_FORMAT_TEXT);
+            }
+            else if (strcmp(Token, "snapshot") == 0)
+            {
+                // Get the path and start writing the events to it in the background
+                __takeEventCounterSnapshot(pEventCounterContext, strtok(NULL, " "));
             }
             else if (strcmp(Token, "quit") == 0)
             {
-                // End the program
+                // End the program, a running snapshot is finished first and the loader is stopped. A leader
+                // sends the rest of the log to its followers before it goes
+                pEventCounterContext->pSnapshotContext->stSnapshotFnTbl.waitSnapshot(pEventCounterContext->pSnapshotContext);
+                __unlockEventCounterLoad(pEventCounterContext);
+                if (pEventCounterContext->pStreamLoaderContext)
+                {
+                    pEventCounterContext->pStreamLoaderContext->stStreamLoaderFnTbl.stopStreamLoader(pEventCounterContext->pStreamLoaderContext);
+                }
+                if (pEventCounterContext->pReplicaContext)
+                {
+                    pEventCounterContext->pReplicaContext->stReplicaFnTbl.stopReplica(pEventCounterContext->pReplicaContext);
+                }
                 break;
             }
             else
             {
                 // User entered an invalid command
-                printf("Only the following commands are supported :\n\tincrease <ID> <Value>\n\treduce <ID> <Value>\n\tcount <ID>\n\tinrange <ID1> <ID2>\n\tnext <ID>\n\tprevious <ID>\n");
+                printf("Only the following commands are supported :\n\tincrease <ID> <Value>\n\treduce <ID> <Value>\n\tcount <ID> [Version]\n\tinrange <ID1> <ID2> [Version]\n\tquantile <Percent>\n\tselectcount <K>\n\trank <ID>\n\tcountdistinct <ID1> <ID2>\n\tkth <K>\n\tsample <N> [ID1 ID2] [-sorted]\n\tdeleterange <ID1> <ID2> (O(log n), plus O(k) for the k removed events with -hashindex)\n\tincreaserange <ID1> <ID2> <Value>\n\tfreeze <ID1> <ID2>\n\tnext <ID> [Version]\n\tprevious <ID> [Version]\n\tdump [ID1 ID2] [-binary]\n\tsnapshot <Path>\n\tstats\n\tmemstats\n\tnumastats\n\tpagestats\n\treplstats\n\treplwait\nA <Namespace> name can be given right after the command, the input file is in namespace default\n");
+            }
+
+            if (pEventCounterContext->NamespaceIndex != 0)
+            {
+                __selectEventCounterNamespace(pEventCounterContext, NULL);
             }
+            __unlockEventCounterLoad(pEventCounterContext);
 
         } while (TRUE);
 
@@ -151,17 +497,38 @@ BOOLEAN __parseInputFile(PEVENT_COUNTER_CONTEXT pEventCounterContext)
     // Read the number of ID's from the first line of the file 
     fscanf(pEventCounterContext->InputFileHandle, "%u", &pEventCounterContext->NumEvents);
 
+    // With -cold the whole file goes to the cold store, the tree starts out empty
+    if (pEventCounterContext->EventCounterArgs.ColdSegmentSize)
+    {
+        return __parseColdInputFile(pEventCounterContext);
+    }
+
     // Initialize the Red Black Tree Array List 
     pRbTreeContext->stRbTreeFnTbl.initializeRbTreeNodeArrayList(pRbTreeContext, pEventCounterContext->NumEvents);
 
+    // In streaming mode the rest of the file is loaded in the background, chunks are joined to the tree as they come in.
+    // A leader loads the whole file first, loaded chunks are not updates its followers would get
+    if (pEventCounterContext->EventCounterArgs.bStreamLoad && !pEventCounterContext->EventCounterArgs.bReplicaLeader &&
+        pRbTreeContext->stRbTreeFnTbl.appendRbTreeNodeArrayList)
+    {
+        pEventCounterContext->pStreamLoaderContext = createStreamLoaderContext(pRbTreeContext, pEventCounterContext->InputFileHandle, pEventCounterContext->NumEvents,
+            pEventCounterContext->EventCounterArgs.StreamChunkEvents);
+        if (pEventCounterContext->pStreamLoaderContext->stStreamLoaderFnTbl.startStreamLoader(pEventCounterContext->pStreamLoaderContext))
+        {
+            return TRUE;
+        }
+        destroyStreamLoaderContext(&pEventCounterContext->pStreamLoaderContext);
+    }
+
     // Read remaining events with their counts and insert them in the red black tree 
     while (Count++ < pEventCounterContext->NumEvents)
     {
         // Read the line and get the Event ID and count 
         fscanf(pEventCounterContext->InputFileHandle, "%u %u", &EventID, &EventCount);
 
-        // Insert this to the tail of the Red Black Tree Array List
+        // Insert this to the tail of the Red Black Tree Array List, the TTL of the event starts now
         pRbTreeContext->stRbTreeFnTbl.insertRbTreeNodeArrayList(pRbTreeContext, EventID, EventCount, Count - 1);
+        __touchEventCounterTtl(pEventCounterContext, (INT)EventID);
     }
 
     // Now build the Red Black Tree 
@@ -170,27 +537,267 @@ BOOLEAN __parseInputFile(PEVENT_COUNTER_CONTEXT pEventCounterContext)
     return TRUE;
 }
 
+// __parseColdInputFile()
+// This function reads the events of the input file into the cold store, in segments of the -cold size.
+// Events are read as records of 8 bytes and never take a tree node until they are written to
+BOOLEAN __parseColdInputFile(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+    PRADIX_SORT_RECORD  pRecordList         = NULL;
+    UINT                NumRecords          = pEventCounterContext->NumEvents;
+    UINT                EventID             = 0;
+    UINT                EventCount          = 0;
+    UINT                Index               = 0;
+    BOOLEAN             bSorted             = TRUE;
+
+    // Empty tree for the events thawed later
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTreeNodeArrayList(pRbTreeContext, 0);
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTree(pRbTreeContext);
+
+    pRecordList = (PRADIX_SORT_RECORD)malloc(sizeof(RADIX_SORT_RECORD) * (NumRecords ? NumRecords : 1));
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        fscanf(pEventCounterContext->InputFileHandle, "%u %u", &EventID, &EventCount);
+        pRecordList[Index].ID       = (INT)EventID;
+        pRecordList[Index].Count    = (INT)EventCount;
+
+        if (Index && pRecordList[Index - 1].ID >= pRecordList[Index].ID)
+        {
+            bSorted = FALSE;
+        }
+    }
+
+    // Segments need the events strictly sorted by ID
+    if (!bSorted)
+    {
+        NumRecords = sortRadixSortRecords(pRecordList, NumRecords, 0);
+    }
+
+    pColdStoreContext->stColdStoreFnTbl.insertColdStoreRecords(pColdStoreContext, pRecordList, NumRecords);
+    free(pRecordList);
+
+    return TRUE;
+}
+
 // __parseEventCounterArgs()
-// This function gets the filename from the args and saves it to the event counter context
-BOOLEAN __parseEventCounterArgs(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *argv[])
+// This function gets the filename and the options from the args and saves them to the event counter context
+BOOLEAN __parseEventCounterArgs(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT argc, CHAR *argv[])
 {
     UINT    FilenameLength = 0;
     BOOLEAN bRetStatus = TRUE;
+    INT     ArgIndex = 0;
+    INT     FirstOptionIndex = 2;
 
     do
     {
-        // Get the Filename first
-        FilenameLength = strlen(argv[1]);
-        if (FilenameLength)
+        // A follower takes the address of its leader in place of the filename
+        if (strcmp(argv[1], "-follow") == 0)
         {
-            pEventCounterContext->EventCounterArgs.InputFilename = (CHAR*)malloc(sizeof(CHAR) * FilenameLength);
-            strcpy(pEventCounterContext->EventCounterArgs.InputFilename, argv[1]);
+            if (argc < 3)
+            {
+                printf("__parseEventCounterArgs: Leader address is missing\r\n");
+                bRetStatus = FALSE;
+                break;
+            }
+            pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress = argv[2];
+            FirstOptionIndex = 3;
         }
         else
         {
-            printf("__parseEventCounterArgs: Illegal Filename\r\n");
+            // Get the Filename first
+            FilenameLength = strlen(argv[1]);
+            if (FilenameLength)
+            {
+                pEventCounterContext->EventCounterArgs.InputFilename = (CHAR*)malloc(sizeof(CHAR) * (FilenameLength + 1));
+                strcpy(pEventCounterContext->EventCounterArgs.InputFilename, argv[1]);
+            }
+            else
+            {
+                printf("__parseEventCounterArgs: Illegal Filename\r\n");
+                bRetStatus = FALSE;
+                break;
+            }
+        }
+
+        // Now the options, all of them are off by default
+        for (ArgIndex = FirstOptionIndex; ArgIndex < argc; ArgIndex++)
+        {
+            if (strcmp(argv[ArgIndex], "-hashindex") == 0)
+            {
+                pEventCounterContext->EventCounterArgs.RbTreeArgs.bHashIndex = TRUE;
+            }
+            else if (strcmp(argv[ArgIndex], "-hotcache") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.RbTreeArgs.HotCacheSize = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-topdown") == 0)
+            {
+                pEventCounterContext->EventCounterArgs.RbTreeArgs.bTopDown = TRUE;
+            }
+            else if (strcmp(argv[ArgIndex], "-skiplist") == 0)
+            {
+                pEventCounterContext->EventCounterArgs.RbTreeArgs.bSkipList = TRUE;
+            }
+            else if (strcmp(argv[ArgIndex], "-art") == 0)
+            {
+                pEventCounterContext->EventCounterArgs.RbTreeArgs.bArt = TRUE;
+            }
+            else if (strcmp(argv[ArgIndex], "-batch") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.BatchSize = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+                if (pEventCounterContext->EventCounterArgs.BatchSize > RB_TREE_MAX_BATCH_SIZE)
+                {
+                    pEventCounterContext->EventCounterArgs.BatchSize = RB_TREE_MAX_BATCH_SIZE;
+                }
+            }
+            else if (strcmp(argv[ArgIndex], "-streamload") == 0)
+            {
+                pEventCounterContext->EventCounterArgs.bStreamLoad = TRUE;
+            }
+            else if (strcmp(argv[ArgIndex], "-streamchunk") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.StreamChunkEvents = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-persistent") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.RbTreeArgs.NumVersions = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-cold") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.ColdSegmentSize = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-numa") == 0)
+            {
+                pEventCounterContext->EventCounterArgs.bNuma = TRUE;
+            }
+            else if (strcmp(argv[ArgIndex], "-hugepages") == 0)
+            {
+                pEventCounterContext->EventCounterArgs.bHugePages = TRUE;
+            }
+            else if (strcmp(argv[ArgIndex], "-perf") == 0)
+            {
+                pEventCounterContext->EventCounterArgs.bPerf = TRUE;
+            }
+            else if (strcmp(argv[ArgIndex], "-leader") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.bReplicaLeader   = TRUE;
+                pEventCounterContext->EventCounterArgs.ReplicaPort      = (INT)strtol(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-followers") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.ReplicaFollowers = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-admit") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.AdmitThreshold = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-sketchwidth") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.SketchWidth = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-combine") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.CombineEntries = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-combinems") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.CombineAgeMs = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-ryw") == 0)
+            {
+                pEventCounterContext->EventCounterArgs.bReadYourWrites = TRUE;
+            }
+            else if (strcmp(argv[ArgIndex], "-ttl") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.TtlMs = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-ttlbatch") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.TtlBatch = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-ttlstep") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.TtlStepMs = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+            }
+            else if (strcmp(argv[ArgIndex], "-seed") == 0 && ArgIndex + 1 < argc)
+            {
+                pEventCounterContext->EventCounterArgs.RandomSeed = strtoull(argv[++ArgIndex], NULL, 10);
+            }
+            else
+            {
+                printf("__parseEventCounterArgs: Illegal Option %s\r\n", argv[ArgIndex]);
+                bRetStatus = FALSE;
+                break;
+            }
+        }
+
+        // Skip list is a tree of its own
+        if (bRetStatus && pEventCounterContext->EventCounterArgs.RbTreeArgs.bSkipList &&
+            (pEventCounterContext->EventCounterArgs.RbTreeArgs.bTopDown || pEventCounterContext->EventCounterArgs.RbTreeArgs.NumVersions))
+        {
+            printf("__parseEventCounterArgs: -skiplist doesnt work with -topdown or -persistent\r\n");
+            bRetStatus = FALSE;
+        }
+
+        // So is the radix tree
+        if (bRetStatus && pEventCounterContext->EventCounterArgs.RbTreeArgs.bArt &&
+            (pEventCounterContext->EventCounterArgs.RbTreeArgs.bTopDown || pEventCounterContext->EventCounterArgs.RbTreeArgs.NumVersions ||
+             pEventCounterContext->EventCounterArgs.RbTreeArgs.bSkipList))
+        {
+            printf("__parseEventCounterArgs: -art doesnt work with -topdown, -skiplist or -persistent\r\n");
+            bRetStatus = FALSE;
+        }
+
+        // Cold store keeps no versions
+        if (bRetStatus && pEventCounterContext->EventCounterArgs.ColdSegmentSize && pEventCounterContext->EventCounterArgs.RbTreeArgs.NumVersions)
+        {
+            printf("__parseEventCounterArgs: -cold doesnt work with -persistent\r\n");
+            bRetStatus = FALSE;
+        }
+
+        // Sketch keeps no versions and isnt replicated, followers would see only the events let in the tree
+        if (bRetStatus && pEventCounterContext->EventCounterArgs.AdmitThreshold &&
+            (pEventCounterContext->EventCounterArgs.RbTreeArgs.NumVersions || pEventCounterContext->EventCounterArgs.bReplicaLeader ||
+             pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress))
+        {
+            printf("__parseEventCounterArgs: -admit doesnt work with -persistent, -leader or -follow\r\n");
+            bRetStatus = FALSE;
+        }
+
+        // Flushes dont wait for the loader, and followers take no increases
+        if (bRetStatus && pEventCounterContext->EventCounterArgs.CombineEntries &&
+            (pEventCounterContext->EventCounterArgs.bStreamLoad || pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress))
+        {
+            printf("__parseEventCounterArgs: -combine doesnt work with -streamload or -follow\r\n");
+            bRetStatus = FALSE;
+        }
+
+        // Expiries are not versioned, the loader doesnt touch the events it loads and followers get the deletes of the leader
+        if (bRetStatus && pEventCounterContext->EventCounterArgs.TtlMs &&
+            (pEventCounterContext->EventCounterArgs.RbTreeArgs.NumVersions || pEventCounterContext->EventCounterArgs.bStreamLoad ||
+             pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress))
+        {
+            printf("__parseEventCounterArgs: -ttl doesnt work with -persistent, -streamload or -follow\r\n");
+            bRetStatus = FALSE;
+        }
+        if (pEventCounterContext->EventCounterArgs.TtlBatch == 0)
+        {
+            pEventCounterContext->EventCounterArgs.TtlBatch = EVENT_COUNTER_DEFAULT_TTL_BATCH;
+        }
+
+        // Followers dont take followers of their own
+        if (bRetStatus && pEventCounterContext->EventCounterArgs.bReplicaLeader && pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress)
+        {
+            printf("__parseEventCounterArgs: -leader doesnt work with -follow\r\n");
+            bRetStatus = FALSE;
+        }
+
+        // Only a leader waits for followers
+        if (bRetStatus && pEventCounterContext->EventCounterArgs.ReplicaFollowers && !pEventCounterContext->EventCounterArgs.bReplicaLeader)
+        {
+            printf("__parseEventCounterArgs: -followers needs -leader\r\n");
             bRetStatus = FALSE;
-            break;
         }
     } while (FALSE);
 
@@ -203,9 +810,9 @@ PEVENT_COUNTER_CONTEXT __createEventCounterContext()
 {
     PEVENT_COUNTER_CONTEXT  pEventCounterContext = NULL;
 
-    // Allocate memory for the context 
+    // Allocate memory for the context, tree is created once the args are parsed
     pEventCounterContext = (PEVENT_COUNTER_CONTEXT)malloc(sizeof(EVENT_COUNTER_CONTEXT));
-    pEventCounterContext->pRbTreeContext = createRbTreeContext();
+    memset(pEventCounterContext, 0, sizeof(EVENT_COUNTER_CONTEXT));
 
     return pEventCounterContext;
 }
@@ -214,8 +821,73 @@ PEVENT_COUNTER_CONTEXT __createEventCounterContext()
 // This function deallocates and frees up the event counter context
 VOID __destroyEventCounterContext(PEVENT_COUNTER_CONTEXT *ppEventCounterContext)
 {
-    // Destroy Rb Tree Context first 
-    destroyRbTreeContext(&(*ppEventCounterContext)->pRbTreeContext);
+    UINT    Index = 0;
+
+    // Loader, replica and snapshot use the tree, destroy them before the tree
+    if ((*ppEventCounterContext)->pReplicaContext)
+    {
+        destroyReplicaContext(&(*ppEventCounterContext)->pReplicaContext);
+    }
+    free((*ppEventCounterContext)->pBootstrapRecordList);
+
+    if ((*ppEventCounterContext)->pStreamLoaderContext)
+    {
+        destroyStreamLoaderContext(&(*ppEventCounterContext)->pStreamLoaderContext);
+    }
+
+    if ((*ppEventCounterContext)->pSnapshotContext)
+    {
+        destroySnapshotContext(&(*ppEventCounterContext)->pSnapshotContext);
+    }
+
+    if ((*ppEventCounterContext)->pDumpContext)
+    {
+        destroyDumpContext(&(*ppEventCounterContext)->pDumpContext);
+    }
+
+    if ((*ppEventCounterContext)->pWriteCombineContext)
+    {
+        destroyWriteCombineContext(&(*ppEventCounterContext)->pWriteCombineContext);
+    }
+
+    // Destroy the trees and cold stores of all the namespaces, the default one is the first
+    for (Index = 0; Index < (*ppEventCounterContext)->NumNamespaces; Index++)
+    {
+        destroyColdStoreContext(&(*ppEventCounterContext)->pNamespaceList[Index].pColdStoreContext);
+        destroyCountMinContext(&(*ppEventCounterContext)->pNamespaceList[Index].pCountMinContext);
+        destroyTimerWheelContext(&(*ppEventCounterContext)->pNamespaceList[Index].pTimerWheelContext);
+        destroyRbTreeContext(&(*ppEventCounterContext)->pNamespaceList[Index].pRbTreeContext);
+        free((*ppEventCounterContext)->pNamespaceList[Index].pName);
+    }
+    free((*ppEventCounterContext)->pNamespaceList);
+    (*ppEventCounterContext)->pRbTreeContext     = NULL;
+    (*ppEventCounterContext)->pColdStoreContext  = NULL;
+    (*ppEventCounterContext)->pCountMinContext   = NULL;
+    (*ppEventCounterContext)->pTimerWheelContext = NULL;
+    free((*ppEventCounterContext)->pExpiredIDList);
+
+    // Pools go after all the trees that share them
+    for (Index = 0; Index < (*ppEventCounterContext)->NumNodePools; Index++)
+    {
+        destroyNodePoolContext(&(*ppEventCounterContext)->ppNodePoolContextList[Index]);
+    }
+    free((*ppEventCounterContext)->ppNodePoolContextList);
+
+    if ((*ppEventCounterContext)->pNumaPolicyContext)
+    {
+        destroyNumaPolicyContext(&(*ppEventCounterContext)->pNumaPolicyContext);
+    }
+
+    // Huge pages go after the trees and pools that were on them
+    if ((*ppEventCounterContext)->pHugePageContext)
+    {
+        destroyHugePageContext(&(*ppEventCounterContext)->pHugePageContext);
+    }
+
+    if ((*ppEventCounterContext)->pPerfCounterContext)
+    {
+        destroyPerfCounterContext(&(*ppEventCounterContext)->pPerfCounterContext);
+    }
 
     // Now free the Event Counter Context 
     if (*ppEventCounterContext)
@@ -227,55 +899,160 @@ VOID __destroyEventCounterContext(PEVENT_COUNTER_CONTEXT *ppEventCounterContext)
 
 // __increaseEventCount()
 // This function increasea the count of the event ID by IncrementValue. If event with ID is not present, insert it. 
-// Also prints the count of event after the addition.
-VOID __increaseEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT IncrementValue)
+// Also prints the count of event after the addition, and returns it.
+INT __increaseEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT IncrementValue)
+{
+    INT     Count = __applyEventIncrease(pEventCounterContext, ID, IncrementValue);
+
+    printf("%d\n", Count);
+    return Count;
+}
+
+// __applyEventIncrease()
+// This function adds IncrementValue to the count of the event ID, inserting it if its not present, and returns
+// the count after the addition without printing it
+INT __applyEventIncrease(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT IncrementValue)
 {
     PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
     PRB_TREE_NODE       pRbTreeNode     = NULL;
 
-    // Prints the count, insert function takes care of adding count if event exists
-    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pEventCounterContext->pRbTreeContext, ID, IncrementValue);
+    // A frozen event is written in the tree, and its TTL starts again
+    __thawEventRange(pEventCounterContext, ID, ID);
+    __touchEventCounterTtl(pEventCounterContext, ID);
 
-    if (pRbTreeNode)
+    // Events not in the tree yet are counted in the sketch till they reach the admission threshold, resident
+    // ones have stale counters there and go straight back in the tree
+    if (pEventCounterContext->pCountMinContext && IncrementValue > 0)
     {
-        printf("%d\n", pRbTreeNode->Count);
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+        if ((pRbTreeNode == NULL || pRbTreeNode->ID != ID) &&
+            !pEventCounterContext->pCountMinContext->stCountMinFnTbl.isCountMinResident(pEventCounterContext->pCountMinContext, ID))
+        {
+            return __admitEventCount(pEventCounterContext, ID, IncrementValue);
+        }
     }
+
+    // Insert function takes care of adding count if event exists
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pEventCounterContext->pRbTreeContext, ID, IncrementValue);
+
+    return pRbTreeNode ? pRbTreeNode->Count : 0;
 }
 
 // __reduceEventCount()
 // This function decrease the count of event count by Decrement Value. If the event count becomes less than or equal 
 // to 0, removes the event from the counter. Also prints the count of the event after the deletion, or 0 if the event 
-// is removed or not present.
-VOID __reduceEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT DecrementValue)
+// is removed or not present, and returns it.
+INT __reduceEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT DecrementValue)
 {
     PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
     PRB_TREE_NODE       pRbTreeNode     = NULL;
 
+    // A frozen event is written in the tree
+    __thawEventRange(pEventCounterContext, ID, ID);
+
     // First get the event from the red black tree to be deleted 
     pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
 
     if (pRbTreeNode == NULL || pRbTreeNode->ID != ID)
     {
-        // Event doesnt exist!
+        // Event doesnt exist! Only increases let events in, the estimate of an event still in the sketch
+        // is just a bound on its count so its dropped and the event reads 0 from now on
+        __retireAdmitEvent(pEventCounterContext, ID);
         printf("0\n");
+        return 0;
     }
-    else
+
+    // Get the new value of the count
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.updateRbTreeNodeCount(pRbTreeContext, pRbTreeNode, -DecrementValue);
+
+    // Delete the event from the tree of the new count <= 0 
+    if (pRbTreeNode->Count <= 0)
     {
-        // Get the new value of the count
-        pRbTreeNode->Count -= DecrementValue;
-        
-        // Delete the event from the tree of the new count <= 0 
-        if (pRbTreeNode->Count <= 0)
-        {
-            pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode(pRbTreeContext, pRbTreeNode);
-            printf("0\n");
-        }
-        else
+        pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode(pRbTreeContext, pRbTreeNode);
+        __retireAdmitEvent(pEventCounterContext, ID);
+        printf("0\n");
+        return 0;
+    }
+
+    // Print the new count
+    printf("%d\n", pRbTreeNode->Count);
+    return pRbTreeNode->Count;
+}
+
+// __admitEventCount()
+// This function adds the increase of an event that is not in the tree to the sketch. Once the estimate of the
+// event reaches the admission threshold it goes in the tree with that count, so events seen a few times never
+// take a node. Returns the count of the event, its estimate while its in the sketch
+INT __admitEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT IncrementValue)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOUNT_MIN_CONTEXT  pCountMinContext    = pEventCounterContext->pCountMinContext;
+    PRB_TREE_NODE       pRbTreeNode         = NULL;
+    LONGLONG            Estimate            = 0;
+
+    Estimate = (LONGLONG)__getAdmitEstimate(pEventCounterContext, ID) + IncrementValue;
+    if (Estimate < pEventCounterContext->EventCounterArgs.AdmitThreshold)
+    {
+        return (INT)pCountMinContext->stCountMinFnTbl.updateCountMinSketch(pCountMinContext, ID, (UINT)IncrementValue);
+    }
+
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pRbTreeContext, ID, Estimate > INT_MAX ? INT_MAX : (INT)Estimate);
+    pCountMinContext->NumPromotions++;
+
+    return pRbTreeNode ? pRbTreeNode->Count : 0;
+}
+
+// __getAdmitEstimate()
+// This function returns the estimate of an event that is not in the tree. The sketch is never below the count,
+// and an event below the threshold at its last increase has a count under it, so the estimate is capped there
+UINT __getAdmitEstimate(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
+{
+    UINT    Estimate = pEventCounterContext->pCountMinContext->stCountMinFnTbl.getCountMinEstimate(pEventCounterContext->pCountMinContext, ID);
+
+    return Estimate < pEventCounterContext->EventCounterArgs.AdmitThreshold ? Estimate : pEventCounterContext->EventCounterArgs.AdmitThreshold - 1;
+}
+
+// __retireAdmitEvent()
+// This function is called when an event leaves the tree or is reduced out of the sketch. If the sketch has an
+// estimate for the ID it is marked resident, so the event reads 0 instead of coming back with that estimate
+VOID __retireAdmitEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
+{
+    PCOUNT_MIN_CONTEXT  pCountMinContext    = pEventCounterContext->pCountMinContext;
+
+    if (pCountMinContext && pCountMinContext->stCountMinFnTbl.getCountMinEstimate(pCountMinContext, ID))
+    {
+        pCountMinContext->stCountMinFnTbl.markCountMinResident(pCountMinContext, ID);
+    }
+}
+
+// __setEventCount()
+// This function sets the count of the event to what the leader has, inserting the event if its not present
+// and removing it if the count is 0. Prints nothing, followers apply updates in the background
+VOID __setEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, INT Count)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
+    PRB_TREE_NODE       pRbTreeNode     = NULL;
+
+    // A frozen event is written in the tree
+    __thawEventRange(pEventCounterContext, ID, ID);
+
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+
+    if (pRbTreeNode && pRbTreeNode->ID == ID)
+    {
+        if (Count <= 0)
+        {
+            pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode(pRbTreeContext, pRbTreeNode);
+        }
+        else if (Count != pRbTreeNode->Count)
         {
-            // Print the new count
-            printf("%d\n", pRbTreeNode->Count);
+            pRbTreeContext->stRbTreeFnTbl.updateRbTreeNodeCount(pRbTreeContext, pRbTreeNode, Count - pRbTreeNode->Count);
         }
     }
+    else if (Count > 0)
+    {
+        pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pRbTreeContext, ID, Count);
+    }
 }
 
 // __getEventCount()
@@ -287,16 +1064,52 @@ VOID __getEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
 
     // Prints the count
     pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+    __printEventCount(pEventCounterContext, ID, pRbTreeNode);
+}
 
-    if (pRbTreeNode && pRbTreeNode->ID == ID)
+// __printEventCount()
+// This function prints the count of the event given the node found for its ID
+VOID __printEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, PRB_TREE_NODE pRbTreeNode)
+{
+    LONGLONG    Count = __readEventCount(pEventCounterContext, ID, pRbTreeNode);
+
+    if (Count == 0)
     {
-        printf("%d\n", pRbTreeNode->Count);
+        // Event not found, no number to format
+        printf("0\n");
     }
     else
     {
-        // Event not found in the Red Black Tree
-        printf("0\n");
+        printf("%lld\n", Count);
+    }
+}
+
+// __readEventCount()
+// This function returns the count of the event given the node found for its ID, an event not in the
+// tree may be frozen in the cold store
+LONGLONG __readEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, PRB_TREE_NODE pRbTreeNode)
+{
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+    RADIX_SORT_RECORD   ColdRecord          = { 0 };
+
+    if (pRbTreeNode && pRbTreeNode->ID == ID)
+    {
+        return pRbTreeNode->Count;
+    }
+    else if (pColdStoreContext->NumSegments &&
+             pColdStoreContext->stColdStoreFnTbl.getCeilColdStoreRecord(pColdStoreContext, ID, &ColdRecord) && ColdRecord.ID == ID)
+    {
+        return ColdRecord.Count;
+    }
+    else if (pEventCounterContext->pCountMinContext &&
+             !pEventCounterContext->pCountMinContext->stCountMinFnTbl.isCountMinResident(pEventCounterContext->pCountMinContext, ID))
+    {
+        // Event not let in the tree yet, its estimate is never below its count
+        return __getAdmitEstimate(pEventCounterContext, ID);
     }
+
+    // Event not found in the Red Black Tree
+    return 0;
 }
 
 // __getTotalCountInRange()
@@ -310,7 +1123,7 @@ VOID __getTotalCountInRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1
     // First search for the Event ID with the given ID1
     pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID1);
 
-    if (pRbTreeNode->ID < ID1)
+    if (pRbTreeNode && pRbTreeNode->ID < ID1)
     {
         pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
     }
@@ -326,81 +1139,1580 @@ VOID __getTotalCountInRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1
         }
     }
 
+    // Add the frozen events in the range
+    TotalCount += (INT)pEventCounterContext->pColdStoreContext->stColdStoreFnTbl.getColdStoreRangeCount(pEventCounterContext->pColdStoreContext, ID1, ID2);
+
     // Print the total Count 
     printf("%d\n", TotalCount);
 }
 
-// __getNextEvent()
-// This function prints the ID and the count of the event with the lowest ID that is greater that theID.
-// Prints "0 0", if there is no next ID.
-VOID __getNextEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
+// __selectEventCount()
+// This function prints the ID and the count of the event holding the unit CountIndex (from 1) of the total count
+// with the events laid out in ID order, 0 0 if there is no such unit. The tree answers it in one walk down, with
+// frozen events the ID is searched
+VOID __selectEventCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, LONGLONG CountIndex)
 {
-    PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
-    PRB_TREE_NODE       pRbTreeNode     = NULL;
-
-    // First search for the Event ID with the given ID
-    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+    PRB_TREE_NODE       pRbTreeNode         = NULL;
 
-    if (pRbTreeNode)
+    if (pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNode == NULL)
     {
-        // Get the event with next ID
-        if (pRbTreeNode->ID <= ID)
-        {
-            pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
-        }
+        printf("Weighted select needs the default tree, not -topdown, -skiplist, -art or -persistent\n");
+        return;
+    }
 
+    if (pColdStoreContext->NumEvents == 0)
+    {
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNode(pRbTreeContext, CountIndex);
         if (pRbTreeNode)
         {
-            // Print the ID and the count
             printf("%d %d\n", pRbTreeNode->ID, pRbTreeNode->Count);
         }
         else
         {
-            // No event with greater ID
             printf("0 0\n");
         }
+        return;
+    }
+
+    if (CountIndex < 1 || CountIndex > __getEventPrefixCount(pEventCounterContext, INT_MAX))
+    {
+        printf("0 0\n");
+        return;
+    }
+
+    __printEventCountIndex(pEventCounterContext, CountIndex);
+}
+
+// __getEventPrefixCount()
+// This function returns the total count of the events with IDs up to ID inclusively in the tree and the cold store
+LONGLONG __getEventPrefixCount(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+
+    return pRbTreeContext->stRbTreeFnTbl.getPrefixCountRbTreeNode(pRbTreeContext, ID) +
+           pColdStoreContext->stColdStoreFnTbl.getColdStoreRangeCount(pColdStoreContext, INT_MIN, ID);
+}
+
+// __printEventCountIndex()
+// This function prints the ID and the count of the event holding the unit CountIndex of the total count, which
+// must be between 1 and the total. The smallest ID whose count up to it in the tree and the cold store reaches
+// CountIndex is binary searched, the count up to an ID only grows with the ID
+VOID __printEventCountIndex(PEVENT_COUNTER_CONTEXT pEventCounterContext, LONGLONG CountIndex)
+{
+    LONGLONG    LowID   = INT_MIN;
+    LONGLONG    HighID  = INT_MAX;
+    LONGLONG    MidID   = 0;
+
+    while (LowID < HighID)
+    {
+        MidID = LowID + (HighID - LowID) / 2;
+        if (__getEventPrefixCount(pEventCounterContext, (INT)MidID) >= CountIndex)
+        {
+            HighID = MidID;
+        }
+        else
+        {
+            LowID = MidID + 1;
+        }
+    }
+
+    printf("%d ", (INT)LowID);
+    __getEventCount(pEventCounterContext, (INT)LowID);
+}
+
+// __getEventQuantile()
+// This function prints the ID and the count of the event at Percent of the total count, the event holding
+// the unit Percent * Total / 100 rounded up (at least the first one)
+VOID __getEventQuantile(PEVENT_COUNTER_CONTEXT pEventCounterContext, double Percent)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    LONGLONG            TotalCount          = 0;
+    LONGLONG            CountIndex          = 0;
+
+    if (!(Percent >= 0 && Percent <= 100))
+    {
+        printf("Quantile must be a percent between 0 and 100\n");
+        return;
+    }
+
+    if (pRbTreeContext->stRbTreeFnTbl.getPrefixCountRbTreeNode == NULL)
+    {
+        printf("Weighted select needs the default tree, not -topdown, -skiplist, -art or -persistent\n");
+        return;
+    }
+
+    TotalCount = __getEventPrefixCount(pEventCounterContext, INT_MAX);
+
+    CountIndex = (LONGLONG)ceil(Percent * (double)TotalCount / 100);
+    if (CountIndex < 1)
+    {
+        CountIndex = 1;
+    }
+
+    __selectEventCount(pEventCounterContext, CountIndex);
+}
+
+// __sampleEvents()
+// This function prints the ID and the count of NumSamples events drawn with replacement in proportion to their
+// counts among the events with IDs between ID1 and ID2, 0 0 if the range has no count. Every draw is a random unit
+// of the count in the range selected in one walk down the tree. Sorted draws are selected all together in one
+// traversal and printed in ID order. With frozen events every draw searches its ID
+VOID __sampleEvents(PEVENT_COUNTER_CONTEXT pEventCounterContext, UINT NumSamples, INT ID1, INT ID2, BOOLEAN bSorted)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PRB_TREE_NODE       *ppRbTreeNodeList   = NULL;
+    LONGLONG            *pCountIndexList    = NULL;
+    LONGLONG            BaseCount           = 0;
+    LONGLONG            RangeCount          = 0;
+    UINT                Index               = 0;
+
+    if (pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNodeBatch == NULL)
+    {
+        printf("Weighted select needs the default tree, not -topdown, -skiplist, -art or -persistent\n");
+        return;
+    }
+
+    if (ID1 <= ID2)
+    {
+        BaseCount = ID1 > INT_MIN ? __getEventPrefixCount(pEventCounterContext, ID1 - 1) : 0;
+        RangeCount = __getEventPrefixCount(pEventCounterContext, ID2) - BaseCount;
+    }
+
+    if (RangeCount <= 0)
+    {
+        printf("0 0\n");
+        return;
+    }
+
+    pCountIndexList = (LONGLONG*)malloc(sizeof(LONGLONG) * NumSamples);
+    ppRbTreeNodeList = (PRB_TREE_NODE*)malloc(sizeof(PRB_TREE_NODE) * NumSamples);
+    if (NumSamples && (pCountIndexList == NULL || ppRbTreeNodeList == NULL))
+    {
+        printf("__sampleEvents: Unable to allocate %u samples\n", NumSamples);
+        free(pCountIndexList);
+        free(ppRbTreeNodeList);
+        return;
+    }
+
+    for (Index = 0; Index < NumSamples; Index++)
+    {
+        pCountIndexList[Index] = BaseCount + 1 + (LONGLONG)(__getEventCounterRandom(pEventCounterContext) % (ULONGLONG)RangeCount);
+    }
+
+    if (bSorted)
+    {
+        qsort(pCountIndexList, NumSamples, sizeof(LONGLONG), __compareEventCountIndex);
+    }
+
+    if (pEventCounterContext->pColdStoreContext->NumEvents)
+    {
+        for (Index = 0; Index < NumSamples; Index++)
+        {
+            __printEventCountIndex(pEventCounterContext, pCountIndexList[Index]);
+        }
     }
     else
     {
-        // shouldnt happen in this project, leaving a print to catch this 
-        printf("__getNextEvent: Event with %d not found", ID);
+        if (bSorted)
+        {
+            pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNodeBatch(pRbTreeContext, pCountIndexList, NumSamples, ppRbTreeNodeList);
+        }
+        else
+        {
+            for (Index = 0; Index < NumSamples; Index++)
+            {
+                ppRbTreeNodeList[Index] = pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNode(pRbTreeContext, pCountIndexList[Index]);
+            }
+        }
+
+        for (Index = 0; Index < NumSamples; Index++)
+        {
+            printf("%d %d\n", ppRbTreeNodeList[Index]->ID, ppRbTreeNodeList[Index]->Count);
+        }
     }
+
+    free(pCountIndexList);
+    free(ppRbTreeNodeList);
 }
 
-// __getPrevEvent()
-// This function prints the ID and the count of the event with the greatest key that is less that theID.
-// Prints "0 0", if there is no previous ID.
-VOID __getPrevEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
+// __compareEventCountIndex()
+// This function orders count indexes for qsort
+INT __compareEventCountIndex(const VOID *pFirst, const VOID *pSecond)
 {
-    PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
-    PRB_TREE_NODE       pRbTreeNode     = NULL;
+    LONGLONG    First   = *(const LONGLONG*)pFirst;
+    LONGLONG    Second  = *(const LONGLONG*)pSecond;
 
-    // First search for the Event ID with the given ID
-    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+    return (First > Second) - (First < Second);
+}
 
-    if (pRbTreeNode)
+// __getEventCounterRandom()
+// This function returns the next 64 bit random number of the splitmix64 generator, seeded with -seed
+// (with the time by default) so that samples can be drawn again
+ULONGLONG __getEventCounterRandom(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    ULONGLONG   Random = (pEventCounterContext->RandomState += 0x9E3779B97F4A7C15ULL);
+
+    Random = (Random ^ (Random >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    Random = (Random ^ (Random >> 27)) * 0x94D049BB133111EBULL;
+    return Random ^ (Random >> 31);
+}
+
+// __getEventRank()
+// This function returns the number of events with IDs up to ID inclusively, the tree and the cold store
+// count them without walking the events
+ULONGLONG __getEventRank(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+
+    return pRbTreeContext->stRbTreeFnTbl.getRankRbTreeNode(pRbTreeContext, ID) +
+           pColdStoreContext->stColdStoreFnTbl.getColdStoreRangeEvents(pColdStoreContext, INT_MIN, ID);
+}
+
+// __countDistinctEvents()
+// This function prints the number of events with IDs between ID1 and ID2 inclusively
+VOID __countDistinctEvents(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2)
+{
+    ULONGLONG   NumEvents = 0;
+
+    if (pEventCounterContext->pRbTreeContext->stRbTreeFnTbl.getRankRbTreeNode == NULL)
+    {
+        printf("Rank queries need the default tree, not -topdown, -skiplist, -art or -persistent\n");
+        return;
+    }
+
+    if (ID1 <= ID2)
     {
-        // Get the event with previous ID
-        if (pRbTreeNode->ID >= ID)
+        NumEvents = __getEventRank(pEventCounterContext, ID2);
+        if (ID1 > INT_MIN)
         {
-            pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getPrevIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+            NumEvents -= __getEventRank(pEventCounterContext, ID1 - 1);
         }
+    }
+
+    printf("%llu\n", NumEvents);
+}
+
+// __selectEventRank()
+// This function prints the ID and the count of the event at Rank (from 1) in ID order, 0 0 if there is no
+// such event. The tree answers it in one walk down, with frozen events it looks for the smallest ID whose
+// rank in the tree and the cold store reaches Rank
+VOID __selectEventRank(PEVENT_COUNTER_CONTEXT pEventCounterContext, ULONGLONG Rank)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+    PRB_TREE_NODE       pRbTreeNode         = NULL;
+    LONGLONG            LowID               = INT_MIN;
+    LONGLONG            HighID              = INT_MAX;
+    LONGLONG            MidID               = 0;
+
+    if (pRbTreeContext->stRbTreeFnTbl.selectRankRbTreeNode == NULL)
+    {
+        printf("Rank queries need the default tree, not -topdown, -skiplist, -art or -persistent\n");
+        return;
+    }
 
+    if (pColdStoreContext->NumEvents == 0)
+    {
+        pRbTreeNode = Rank <= UINT_MAX ? pRbTreeContext->stRbTreeFnTbl.selectRankRbTreeNode(pRbTreeContext, (UINT)Rank) : NULL;
         if (pRbTreeNode)
         {
-            // Print the ID and the count
             printf("%d %d\n", pRbTreeNode->ID, pRbTreeNode->Count);
         }
         else
         {
-            // No event with lesser ID
             printf("0 0\n");
         }
+        return;
     }
-    else
+
+    if (Rank < 1 || Rank > __getEventRank(pEventCounterContext, INT_MAX))
+    {
+        printf("0 0\n");
+        return;
+    }
+
+    // Binary search the ID, the rank only grows with the ID
+    while (LowID < HighID)
+    {
+        MidID = LowID + (HighID - LowID) / 2;
+        if (__getEventRank(pEventCounterContext, (INT)MidID) >= Rank)
+        {
+            HighID = MidID;
+        }
+        else
+        {
+            LowID = MidID + 1;
+        }
+    }
+
+    printf("%d ", (INT)LowID);
+    __getEventCount(pEventCounterContext, (INT)LowID);
+}
+
+// __deleteEventRange()
+// This function removes all the events with IDs between ID1 and ID2 inclusively
+VOID __deleteEventRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
+    PRB_TREE_NODE       pRbTreeNode     = NULL;
+    INT                 ID              = 0;
+
+    // Frozen events in the range are thawed and deleted with the rest
+    __thawEventRange(pEventCounterContext, ID1, ID2);
+
+    // With -admit the events leaving the tree are retired one by one first
+    if (pEventCounterContext->pCountMinContext)
+    {
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID1);
+        while (pRbTreeNode && pRbTreeNode->ID <= ID2)
+        {
+            if (pRbTreeNode->ID >= ID1)
+            {
+                __retireAdmitEvent(pEventCounterContext, pRbTreeNode->ID);
+            }
+            pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+        }
+    }
+
+    // Tree cuts the whole range out at once if it can
+    if (pRbTreeContext->stRbTreeFnTbl.deleteRangeRbTreeNode)
+    {
+        pRbTreeContext->stRbTreeFnTbl.deleteRangeRbTreeNode(pRbTreeContext, ID1, ID2);
+        return;
+    }
+
+    // Otherwise delete the events in the range one by one, smallest ID first. Delete can move
+    // events between nodes, so search again for the deleted ID to get the closest event left
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID1);
+    while (pRbTreeNode && pRbTreeNode->ID <= ID2)
+    {
+        if (pRbTreeNode->ID < ID1)
+        {
+            pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+            continue;
+        }
+
+        ID = pRbTreeNode->ID;
+        pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode(pRbTreeContext, pRbTreeNode);
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+    }
+}
+
+// __increaseEventRange()
+// This function adds the value to the count of all the events with IDs between ID1 and ID2 inclusively.
+// Only existing events are increased, and the value has to be positive so that no event drops to 0
+VOID __increaseEventRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2, INT IncrementValue)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
+    PRB_TREE_NODE       pRbTreeNode     = NULL;
+
+    if (IncrementValue <= 0)
+    {
+        printf("__increaseEventRange: Value has to be positive\n");
+        return;
+    }
+
+    // Frozen events in the range are written in the tree
+    __thawEventRange(pEventCounterContext, ID1, ID2);
+
+    // Tree tags whole subtrees if it can
+    if (pRbTreeContext->stRbTreeFnTbl.increaseRangeRbTreeNode)
     {
-        // shouldnt happen in this project, leaving a print to catch this 
-        printf("__getPrevEvent: Event with %d not found", ID);
+        pRbTreeContext->stRbTreeFnTbl.increaseRangeRbTreeNode(pRbTreeContext, ID1, ID2, IncrementValue);
+        return;
     }
+
+    // Otherwise walk the events in the range
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID1);
+    if (pRbTreeNode && pRbTreeNode->ID < ID1)
+    {
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+    }
+
+    while (pRbTreeNode && pRbTreeNode->ID <= ID2)
+    {
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.updateRbTreeNodeCount(pRbTreeContext, pRbTreeNode, IncrementValue);
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+    }
+}
+
+// __getNextEvent()
+// This function prints the ID and the count of the event with the lowest ID that is greater that theID.
+// Prints "0 0", if there is no next ID.
+VOID __getNextEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
+    PRB_TREE_NODE       pRbTreeNode     = NULL;
+
+    // First search for the Event ID with the given ID
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+    __printNextEvent(pEventCounterContext, ID, pRbTreeNode);
 }
 
+// __printNextEvent()
+// This function prints the event next to the ID given the node found for the ID. The tree may be
+// empty when all the events are frozen, the next event is the closer one of the tree and the cold store
+VOID __printNextEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, PRB_TREE_NODE pRbTreeNode)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+    RADIX_SORT_RECORD   ColdRecord          = { 0 };
+    BOOLEAN             bColdRecord         = FALSE;
+
+    // Get the event with next ID
+    if (pRbTreeNode && pRbTreeNode->ID <= ID)
+    {
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+    }
+
+    bColdRecord = ID < INT_MAX && pColdStoreContext->stColdStoreFnTbl.getCeilColdStoreRecord(pColdStoreContext, ID + 1, &ColdRecord);
+
+    if (bColdRecord && (pRbTreeNode == NULL || ColdRecord.ID < pRbTreeNode->ID))
+    {
+        // Print the ID and the count of the frozen event
+        printf("%d %d\n", ColdRecord.ID, ColdRecord.Count);
+    }
+    else if (pRbTreeNode)
+    {
+        // Print the ID and the count
+        printf("%d %d\n", pRbTreeNode->ID, pRbTreeNode->Count);
+    }
+    else
+    {
+        // No event with greater ID
+        printf("0 0\n");
+    }
+}
+
+// __getPrevEvent()
+// This function prints the ID and the count of the event with the greatest key that is less that theID.
+// Prints "0 0", if there is no previous ID.
+VOID __getPrevEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
+    PRB_TREE_NODE       pRbTreeNode     = NULL;
+
+    // First search for the Event ID with the given ID
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+    __printPrevEvent(pEventCounterContext, ID, pRbTreeNode);
+}
+
+// __printPrevEvent()
+// This function prints the event previous to the ID given the node found for the ID, the closer one
+// of the tree and the cold store
+VOID __printPrevEvent(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID, PRB_TREE_NODE pRbTreeNode)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+    RADIX_SORT_RECORD   ColdRecord          = { 0 };
+    BOOLEAN             bColdRecord         = FALSE;
+
+    // Get the event with previous ID
+    if (pRbTreeNode && pRbTreeNode->ID >= ID)
+    {
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getPrevIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+    }
+
+    bColdRecord = ID > INT_MIN && pColdStoreContext->stColdStoreFnTbl.getFloorColdStoreRecord(pColdStoreContext, ID - 1, &ColdRecord);
+
+    if (bColdRecord && (pRbTreeNode == NULL || ColdRecord.ID > pRbTreeNode->ID))
+    {
+        // Print the ID and the count of the frozen event
+        printf("%d %d\n", ColdRecord.ID, ColdRecord.Count);
+    }
+    else if (pRbTreeNode)
+    {
+        // Print the ID and the count
+        printf("%d %d\n", pRbTreeNode->ID, pRbTreeNode->Count);
+    }
+    else
+    {
+        // No event with lesser ID
+        printf("0 0\n");
+    }
+}
+
+// __freezeEventRange()
+// This function moves all the events with IDs between ID1 and ID2 inclusively from the tree to the cold store.
+// Segments overlapping the range are thawed first, so that the whole range is frozen together
+VOID __freezeEventRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+    PRB_TREE_NODE       pRbTreeNode         = NULL;
+    PRADIX_SORT_RECORD  pRecordList         = NULL;
+    UINT                NumRecords          = 0;
+    UINT                MaxRecords          = 0;
+
+    // Old versions would lose the events moved out of the tree
+    if (pRbTreeContext->stRbTreeFnTbl.commitRbTreeVersion)
+    {
+        printf("__freezeEventRange: Events cant be frozen with -persistent\n");
+        return;
+    }
+
+    if (ID1 > ID2)
+    {
+        return;
+    }
+
+    __thawEventRange(pEventCounterContext, ID1, ID2);
+
+    // Collect the events of the range in ID order
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID1);
+    if (pRbTreeNode && pRbTreeNode->ID < ID1)
+    {
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+    }
+
+    while (pRbTreeNode && pRbTreeNode->ID <= ID2)
+    {
+        if (NumRecords == MaxRecords)
+        {
+            MaxRecords  = MaxRecords ? MaxRecords * 2 : 1024;
+            pRecordList = (PRADIX_SORT_RECORD)realloc(pRecordList, sizeof(RADIX_SORT_RECORD) * MaxRecords);
+        }
+        pRecordList[NumRecords].ID      = pRbTreeNode->ID;
+        pRecordList[NumRecords].Count   = pRbTreeNode->Count;
+        NumRecords++;
+
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+    }
+
+    if (NumRecords)
+    {
+        __deleteEventRange(pEventCounterContext, ID1, ID2);
+        pColdStoreContext->stColdStoreFnTbl.insertColdStoreRecords(pColdStoreContext, pRecordList, NumRecords);
+    }
+
+    free(pRecordList);
+}
+
+// __thawEventRange()
+// This function moves the frozen segments overlapping ID1 to ID2 back into the tree, called before any write
+// to the range. Whole segments are thawed, so the tree never has an ID inside the range of a segment
+VOID __thawEventRange(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pColdStoreContext;
+    PRADIX_SORT_RECORD  pRecordList         = NULL;
+    UINT                NumRecords          = 0;
+    UINT                Index               = 0;
+
+    if (pColdStoreContext->NumSegments == 0)
+    {
+        return;
+    }
+
+    NumRecords = pColdStoreContext->stColdStoreFnTbl.thawColdStoreSegments(pColdStoreContext, ID1, ID2, &pRecordList);
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pRbTreeContext, pRecordList[Index].ID, pRecordList[Index].Count);
+    }
+
+    free(pRecordList);
+}
+
+// __queueEventCounterBatch()
+// This function queues count, next, previous and increase commands in batch mode. Reads and increases 
+// are not mixed in a batch, so all the lookups of a batch see the same tree. The queue is run when it
+// is full or when a command of another kind comes in. Returns FALSE if the command cant be queued
+BOOLEAN __queueEventCounterBatch(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *Token)
+{
+    PEVENT_COUNTER_BATCH        pEventCounterBatch  = &pEventCounterContext->EventCounterBatch;
+    EVENT_COUNTER_BATCH_COMMAND BatchCommand        = BATCH_COMMAND_COUNT;
+    UINT                        Index               = 0;
+    INT                         ID                  = 0;
+    INT                         Value               = 0;
+    CHAR                        *VersionToken       = NULL;
+
+    if (strcmp(Token, "count") == 0)
+    {
+        BatchCommand = BATCH_COMMAND_COUNT;
+    }
+    else if (strcmp(Token, "next") == 0)
+    {
+        BatchCommand = BATCH_COMMAND_NEXT;
+    }
+    else if (strcmp(Token, "previous") == 0)
+    {
+        BatchCommand = BATCH_COMMAND_PREVIOUS;
+    }
+    else if (strcmp(Token, "increase") == 0)
+    {
+        BatchCommand = BATCH_COMMAND_INCREASE;
+    }
+    else
+    {
+        // Not a batch command, run whatever is queued before it
+        __flushEventCounterBatch(pEventCounterContext);
+        return FALSE;
+    }
+
+    ID = (int)strtol(strtok(NULL, " "), NULL, 10);
+    if (BatchCommand == BATCH_COMMAND_INCREASE)
+    {
+        Value = (int)strtol(strtok(NULL, " "), NULL, 10);
+    }
+    else if ((VersionToken = strtok(NULL, " ")) != NULL)
+    {
+        // Reads of an old version are not queued, they run on their own after the queued ones
+        __flushEventCounterBatch(pEventCounterContext);
+        if (__selectEventCounterVersion(pEventCounterContext, VersionToken))
+        {
+            if (BatchCommand == BATCH_COMMAND_COUNT)
+            {
+                __getEventCount(pEventCounterContext, ID);
+            }
+            else if (BatchCommand == BATCH_COMMAND_NEXT)
+            {
+                __getNextEvent(pEventCounterContext, ID);
+            }
+            else
+            {
+                __getPrevEvent(pEventCounterContext, ID);
+            }
+            __selectEventCounterVersion(pEventCounterContext, NULL);
+        }
+        return TRUE;
+    }
+
+    // Dont let an increase and a read share the batch
+    if (pEventCounterBatch->NumCommands && 
+        ((pEventCounterBatch->CommandList[0] == BATCH_COMMAND_INCREASE) != (BatchCommand == BATCH_COMMAND_INCREASE)))
+    {
+        __flushEventCounterBatch(pEventCounterContext);
+    }
+
+    // A queued increase keeps its event from expiring before the batch runs
+    if (BatchCommand == BATCH_COMMAND_INCREASE)
+    {
+        __touchEventCounterTtl(pEventCounterContext, ID);
+    }
+
+    Index = pEventCounterBatch->NumCommands++;
+    pEventCounterBatch->CommandList[Index] = BatchCommand;
+    pEventCounterBatch->IDList[Index] = ID;
+    pEventCounterBatch->ValueList[Index] = Value;
+
+    if (pEventCounterBatch->NumCommands >= pEventCounterContext->EventCounterArgs.BatchSize)
+    {
+        __flushEventCounterBatch(pEventCounterContext);
+    }
+
+    return TRUE;
+}
+
+// __flushEventCounterBatch()
+// This function looks up all the queued IDs together and then runs the commands in order
+VOID __flushEventCounterBatch(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PRB_TREE_CONTEXT        pRbTreeContext      = pEventCounterContext->pRbTreeContext;
+    PEVENT_COUNTER_BATCH    pEventCounterBatch  = &pEventCounterContext->EventCounterBatch;
+    PRB_TREE_NODE           pRbTreeNode         = NULL;
+    UINT                    Index               = 0;
+
+    if (pEventCounterBatch->NumCommands == 0)
+    {
+        return;
+    }
+
+    pRbTreeContext->stRbTreeFnTbl.findRbTreeNodeBatch(pRbTreeContext, pEventCounterBatch->IDList, 
+        pEventCounterBatch->NumCommands, pEventCounterBatch->pRbTreeNodeList);
+
+    for (Index = 0; Index < pEventCounterBatch->NumCommands; Index++)
+    {
+        pRbTreeNode = pEventCounterBatch->pRbTreeNodeList[Index];
+
+        switch (pEventCounterBatch->CommandList[Index])
+        {
+        case BATCH_COMMAND_COUNT:
+            __printEventCount(pEventCounterContext, pEventCounterBatch->IDList[Index], pRbTreeNode);
+            break;
+        case BATCH_COMMAND_NEXT:
+            __printNextEvent(pEventCounterContext, pEventCounterBatch->IDList[Index], pRbTreeNode);
+            break;
+        case BATCH_COMMAND_PREVIOUS:
+            __printPrevEvent(pEventCounterContext, pEventCounterBatch->IDList[Index], pRbTreeNode);
+            break;
+        case BATCH_COMMAND_INCREASE:
+            // Existing events are updated in place, new ones still need a structural insert.
+            // Nodes found for other IDs stay valid since inserts dont move events between nodes,
+            // but not when versions are kept, as a change copies the nodes shared with old versions
+            if (pRbTreeNode && pRbTreeNode->ID == pEventCounterBatch->IDList[Index] &&
+                pRbTreeContext->stRbTreeFnTbl.commitRbTreeVersion == NULL)
+            {
+                pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.updateRbTreeNodeCount(pRbTreeContext, pRbTreeNode, pEventCounterBatch->ValueList[Index]);
+                printf("%d\n", pRbTreeNode->Count);
+                __replicateEventCounterUpdate(pEventCounterContext, REPLICA_OP_SET, pRbTreeNode->ID, pRbTreeNode->ID, pRbTreeNode->Count);
+            }
+            else
+            {
+                __replicateEventCounterUpdate(pEventCounterContext, REPLICA_OP_SET, pEventCounterBatch->IDList[Index], pEventCounterBatch->IDList[Index],
+                    __increaseEventCount(pEventCounterContext, pEventCounterBatch->IDList[Index], pEventCounterBatch->ValueList[Index]));
+            }
+            __commitEventCounterVersion(pEventCounterContext);
+            break;
+        }
+    }
+
+    pEventCounterBatch->NumCommands = 0;
+}
+
+// __combineEventCounterCommand()
+// This function adds an increase to the write combining buffer, the command prints the count the event will have
+// (what the tree has plus the pending delta) and the delta goes in the tree with the other deltas of the ID when
+// the buffer is flushed. Any other command flushes the buffer first, except reads that dont need the pending
+// deltas. Without -ryw reads see the tree as it is till a flush, with it they see all the increases before them
+// (a count only if its ID has a pending delta). A full buffer or one with a delta older than -combinems is
+// flushed too. Returns TRUE if the command was taken by the buffer
+BOOLEAN __combineEventCounterCommand(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *CommandString)
+{
+    PWRITE_COMBINE_CONTEXT  pWriteCombineContext    = pEventCounterContext->pWriteCombineContext;
+    PRB_TREE_CONTEXT        pRbTreeContext          = pEventCounterContext->pRbTreeContext;
+    CHAR                    CommandCopy[100];
+    CHAR                    *Token                  = NULL;
+    CHAR                    *IDToken                = NULL;
+    INT                     ID                      = 0;
+    INT                     PendingDelta            = 0;
+    BOOLEAN                 bTaken                  = FALSE;
+    BOOLEAN                 bFlush                  = TRUE;
+
+    // Tokenize a copy, the command string is tokenized again to run the command
+    strncpy(CommandCopy, CommandString, sizeof(CommandCopy) - 1);
+    CommandCopy[sizeof(CommandCopy) - 1] = '\0';
+
+    Token = strtok(CommandCopy, " ");
+    if (Token && strcmp(Token, "increase") == 0)
+    {
+        ID = (int)strtol(strtok(NULL, " "), NULL, 10);
+        bTaken = TRUE;
+        __touchEventCounterTtl(pEventCounterContext, ID);
+        bFlush = pWriteCombineContext->stWriteCombineFnTbl.addWriteCombineDelta(pWriteCombineContext, ID, (int)strtol(strtok(NULL, " "), NULL, 10), &PendingDelta);
+
+        // Reads queued before the increase print first, the tree is only read here
+        __flushEventCounterBatch(pEventCounterContext);
+        printf("%lld\n", __readEventCount(pEventCounterContext, ID, pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID)) + PendingDelta);
+    }
+    else if (Token && (strcmp(Token, "count") == 0 || strcmp(Token, "next") == 0 || strcmp(Token, "previous") == 0 ||
+             strcmp(Token, "inrange") == 0 || strcmp(Token, "rank") == 0 || strcmp(Token, "countdistinct") == 0 ||
+             strcmp(Token, "kth") == 0 || strcmp(Token, "selectcount") == 0 || strcmp(Token, "quantile") == 0 ||
+             strcmp(Token, "sample") == 0 || strcmp(Token, "dump") == 0 || strcmp(Token, "stats") == 0 ||
+             strcmp(Token, "memstats") == 0 || strcmp(Token, "numastats") == 0 || strcmp(Token, "pagestats") == 0 ||
+             strcmp(Token, "replstats") == 0))
+    {
+        bFlush = pEventCounterContext->EventCounterArgs.bReadYourWrites && pWriteCombineContext->NumEntries;
+        if (bFlush && strcmp(Token, "count") == 0 && (IDToken = strtok(NULL, " ")) != NULL)
+        {
+            bFlush = pWriteCombineContext->stWriteCombineFnTbl.findWriteCombineDelta(pWriteCombineContext, (int)strtol(IDToken, NULL, 10));
+        }
+    }
+
+    if (!bFlush && pEventCounterContext->EventCounterArgs.CombineAgeMs &&
+        pWriteCombineContext->stWriteCombineFnTbl.getWriteCombineAgeMs(pWriteCombineContext) >= pEventCounterContext->EventCounterArgs.CombineAgeMs)
+    {
+        bFlush = TRUE;
+    }
+
+    if (bFlush)
+    {
+        __flushEventCounterCombine(pEventCounterContext);
+    }
+
+    return bTaken;
+}
+
+// __flushEventCounterCombine()
+// This function takes the pending deltas out of the write combining buffer and adds them to the tree in ID order,
+// one update per ID however many increases it had. Followers get the new counts and the flush is one version
+VOID __flushEventCounterCombine(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PWRITE_COMBINE_CONTEXT  pWriteCombineContext    = pEventCounterContext->pWriteCombineContext;
+    PRADIX_SORT_RECORD      pRecordList             = NULL;
+    UINT                    NumRecords              = 0;
+    UINT                    Index                   = 0;
+
+    if (pWriteCombineContext == NULL || pWriteCombineContext->NumEntries == 0)
+    {
+        return;
+    }
+
+    // Queued reads came in before the pending increases
+    __flushEventCounterBatch(pEventCounterContext);
+
+    NumRecords = pWriteCombineContext->stWriteCombineFnTbl.drainWriteCombineBuffer(pWriteCombineContext, &pRecordList);
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        __replicateEventCounterUpdate(pEventCounterContext, REPLICA_OP_SET, pRecordList[Index].ID, pRecordList[Index].ID,
+            __applyEventIncrease(pEventCounterContext, pRecordList[Index].ID, pRecordList[Index].Count));
+    }
+
+    __commitEventCounterVersion(pEventCounterContext);
+}
+
+// __touchEventCounterTtl()
+// This function starts the TTL of the event again on the timer wheel of the namespace, with -ttl
+VOID __touchEventCounterTtl(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID)
+{
+    PTIMER_WHEEL_CONTEXT    pTimerWheelContext = pEventCounterContext->pTimerWheelContext;
+
+    if (pTimerWheelContext)
+    {
+        pTimerWheelContext->stTimerWheelFnTbl.touchTimerWheelEntry(pTimerWheelContext, ID);
+    }
+}
+
+// __expireEventCounterEvents()
+// This function deletes the events that were not increased for the -ttl time from the trees of all the namespaces.
+// At most -ttlbatch events go before a command, the wheels pick up where they stopped before the next one. An
+// expired ID whose event is not in the tree (reduced to 0, frozen or still in the sketch) is just dropped.
+// Followers get the deletes like any other update. With -ttlstep the wheels run on a clock that every command
+// moves on by the step, instead of on the monotonic clock
+VOID __expireEventCounterEvents(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PTIMER_WHEEL_CONTEXT    pTimerWheelContext  = NULL;
+    PRB_TREE_CONTEXT        pRbTreeContext      = NULL;
+    PRB_TREE_NODE           pRbTreeNode         = NULL;
+    INT                     *pIDList            = pEventCounterContext->pExpiredIDList;
+    UINT                    NamespaceIndex      = pEventCounterContext->NamespaceIndex;
+    UINT                    MaxIDs              = pEventCounterContext->EventCounterArgs.TtlBatch;
+    UINT                    NumIDs              = 0;
+    UINT                    Index               = 0;
+    UINT                    IDIndex             = 0;
+
+    if (pIDList == NULL)
+    {
+        return;
+    }
+
+    pEventCounterContext->TtlClockMs += pEventCounterContext->EventCounterArgs.TtlStepMs;
+
+    for (Index = 0; Index < pEventCounterContext->NumNamespaces && MaxIDs; Index++)
+    {
+        pTimerWheelContext = pEventCounterContext->pNamespaceList[Index].pTimerWheelContext;
+        NumIDs = pTimerWheelContext->stTimerWheelFnTbl.expireTimerWheelEntries(pTimerWheelContext, pIDList, MaxIDs);
+        if (NumIDs == 0)
+        {
+            continue;
+        }
+        MaxIDs -= NumIDs;
+
+        __switchEventCounterNamespace(pEventCounterContext, Index);
+        pRbTreeContext = pEventCounterContext->pRbTreeContext;
+
+        for (IDIndex = 0; IDIndex < NumIDs; IDIndex++)
+        {
+            pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, pIDList[IDIndex]);
+            if (pRbTreeNode && pRbTreeNode->ID == pIDList[IDIndex])
+            {
+                pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode(pRbTreeContext, pRbTreeNode);
+                __retireAdmitEvent(pEventCounterContext, pIDList[IDIndex]);
+                __replicateEventCounterUpdate(pEventCounterContext, REPLICA_OP_SET, pIDList[IDIndex], pIDList[IDIndex], 0);
+            }
+        }
+    }
+
+    __switchEventCounterNamespace(pEventCounterContext, NamespaceIndex);
+}
+
+// __selectEventCounterVersion()
+// This function points the reads that follow at the version in the token, or back at the current tree
+// when there is no token. Prints why and returns FALSE if the version cant be read
+BOOLEAN __selectEventCounterVersion(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *VersionToken)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
+    UINT                Version         = RB_TREE_CURRENT_VERSION;
+
+    if (VersionToken)
+    {
+        Version = (UINT)strtoul(VersionToken, NULL, 10);
+    }
+
+    if (pRbTreeContext->stRbTreeFnTbl.selectRbTreeVersion == NULL)
+    {
+        if (VersionToken)
+        {
+            printf("__selectEventCounterVersion: Versions are kept only with -persistent\n");
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    if (!pRbTreeContext->stRbTreeFnTbl.selectRbTreeVersion(pRbTreeContext, Version))
+    {
+        printf("__selectEventCounterVersion: Version %u is not kept\n", Version);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// __commitEventCounterVersion()
+// This function makes the tree after an update command the next version, if versions are kept
+VOID __commitEventCounterVersion(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pEventCounterContext->pRbTreeContext;
+
+    if (pRbTreeContext->stRbTreeFnTbl.commitRbTreeVersion)
+    {
+        pRbTreeContext->stRbTreeFnTbl.commitRbTreeVersion(pRbTreeContext);
+    }
+}
+
+// __takeEventCounterSnapshot()
+// This function starts a snapshot of the events to the file at pPath. Progress and completion are
+// printed on stderr as they come in, the command itself prints only if the snapshot cant be started
+VOID __takeEventCounterSnapshot(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *pPath)
+{
+    PSNAPSHOT_CONTEXT   pSnapshotContext = pEventCounterContext->pSnapshotContext;
+
+    if (pPath == NULL)
+    {
+        printf("__takeEventCounterSnapshot: Path is missing\n");
+        return;
+    }
+
+    if (pSnapshotContext->bRunning)
+    {
+        printf("__takeEventCounterSnapshot: Snapshot to %s is still running\n", pSnapshotContext->pPath);
+        return;
+    }
+
+    // Snapshot is of the namespace the command runs on
+    pSnapshotContext->pRbTreeContext    = pEventCounterContext->pRbTreeContext;
+    pSnapshotContext->pColdStoreContext = pEventCounterContext->pColdStoreContext;
+
+    if (!pSnapshotContext->stSnapshotFnTbl.takeSnapshot(pSnapshotContext, pPath))
+    {
+        printf("__takeEventCounterSnapshot: Unable to start snapshot to %s\n", pPath);
+    }
+}
+
+// __dumpEventCounterEvents()
+// This function writes the events of the namespace the command runs on with IDs between ID1 and ID2 to
+// standard output. Output printed so far goes out first, the dump writes around the stdio buffer
+VOID __dumpEventCounterEvents(PEVENT_COUNTER_CONTEXT pEventCounterContext, INT ID1, INT ID2, DUMP_FORMAT Format)
+{
+    PDUMP_CONTEXT   pDumpContext = pEventCounterContext->pDumpContext;
+
+    fflush(stdout);
+
+    if (!pDumpContext->stDumpFnTbl.dumpEvents(pDumpContext, pEventCounterContext->pRbTreeContext, pEventCounterContext->pColdStoreContext, ID1, ID2, Format))
+    {
+        printf("__dumpEventCounterEvents: Unable to write the events\n");
+    }
+}
+
+// __lockEventCounterLoad()
+// This function takes the tree from the loader for the command, once the events the command needs are loaded.
+// Commands on IDs need the chunks up to the largest ID they take, next needs one event past its ID and
+// the rest of the commands wait for the whole file. Does nothing once the file is loaded without the loader.
+// With replication it also keeps the replica thread off the trees till the command is done
+VOID __lockEventCounterLoad(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *CommandString)
+{
+    PSTREAM_LOADER_CONTEXT  pStreamLoaderContext    = pEventCounterContext->pStreamLoaderContext;
+    CHAR                    CommandCopy[100];
+    CHAR                    *Token                  = NULL;
+    CHAR                    *IDToken                = NULL;
+    LONGLONG                ID                      = LLONG_MAX;
+
+    // Leader and followers load no file in the background, there is no order to keep with the loader
+    if (pEventCounterContext->pReplicaContext)
+    {
+        pEventCounterContext->pReplicaContext->stReplicaFnTbl.lockReplica(pEventCounterContext->pReplicaContext);
+    }
+
+    if (pStreamLoaderContext == NULL)
+    {
+        return;
+    }
+
+    // Tokenize a copy, the command string is tokenized again to run the command
+    strncpy(CommandCopy, CommandString, sizeof(CommandCopy) - 1);
+    CommandCopy[sizeof(CommandCopy) - 1] = '\0';
+
+    // Other namespaces dont need the file, the default one named out waits for all of it
+    if ((IDToken = __getEventCounterNamespaceToken(CommandCopy)) != NULL)
+    {
+        pStreamLoaderContext->stStreamLoaderFnTbl.lockStreamLoader(pStreamLoaderContext,
+            strcmp(IDToken, EVENT_COUNTER_DEFAULT_NAMESPACE) == 0 ? LLONG_MAX : LLONG_MIN);
+        return;
+    }
+
+    strncpy(CommandCopy, CommandString, sizeof(CommandCopy) - 1);
+    CommandCopy[sizeof(CommandCopy) - 1] = '\0';
+
+    Token = strtok(CommandCopy, " ");
+    if (Token == NULL || strcmp(Token, "quit") == 0)
+    {
+        ID = LLONG_MIN;
+    }
+    else if (strcmp(Token, "increase") == 0 || strcmp(Token, "reduce") == 0 || strcmp(Token, "count") == 0 ||
+             strcmp(Token, "next") == 0 || strcmp(Token, "previous") == 0 || strcmp(Token, "rank") == 0)
+    {
+        IDToken = strtok(NULL, " ");
+    }
+    else if (strcmp(Token, "inrange") == 0 || strcmp(Token, "deleterange") == 0 || strcmp(Token, "increaserange") == 0 ||
+             strcmp(Token, "dump") == 0 || strcmp(Token, "countdistinct") == 0)
+    {
+        strtok(NULL, " ");
+        IDToken = strtok(NULL, " ");
+    }
+
+    if (IDToken)
+    {
+        ID = strtol(IDToken, NULL, 10);
+        if (strcmp(Token, "next") == 0)
+        {
+            ID++;
+        }
+    }
+
+    pStreamLoaderContext->stStreamLoaderFnTbl.lockStreamLoader(pStreamLoaderContext, ID);
+}
+
+// __unlockEventCounterLoad()
+// This function gives the tree back to the loader and the replica thread after the command
+VOID __unlockEventCounterLoad(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    if (pEventCounterContext->pStreamLoaderContext)
+    {
+        pEventCounterContext->pStreamLoaderContext->stStreamLoaderFnTbl.unlockStreamLoader(pEventCounterContext->pStreamLoaderContext);
+    }
+
+    if (pEventCounterContext->pReplicaContext)
+    {
+        pEventCounterContext->pReplicaContext->stReplicaFnTbl.unlockReplica(pEventCounterContext->pReplicaContext);
+    }
+}
+
+// __getEventCounterNamespaceToken()
+// This function gets the namespace name in the tokenized copy of a command, or NULL if there is none.
+// A name starts with a letter or an underscore, so it cant be taken for an ID. A snapshot with a
+// single argument has just the path
+CHAR* __getEventCounterNamespaceToken(CHAR *CommandCopy)
+{
+    CHAR    *Token      = strtok(CommandCopy, " ");
+    CHAR    *NameToken  = strtok(NULL, " ");
+
+    if (Token == NULL || NameToken == NULL)
+    {
+        return NULL;
+    }
+
+    if (!((NameToken[0] >= 'a' && NameToken[0] <= 'z') || (NameToken[0] >= 'A' && NameToken[0] <= 'Z') || NameToken[0] == '_'))
+    {
+        return NULL;
+    }
+
+    if (strcmp(Token, "snapshot") == 0 && strtok(NULL, " ") == NULL)
+    {
+        return NULL;
+    }
+
+    return NameToken;
+}
+
+// __selectEventCounterNamespace()
+// This function points the tree and the cold store at the namespace named in the command and drops the name from
+// the command, so that the command is parsed as usual. A new name creates an empty namespace. Without a command
+// it goes back to the default namespace. Commands queued in batch mode are run before leaving the default one.
+// Most commands have an ID right after the command, the command is only tokenized when a name may be there
+VOID __selectEventCounterNamespace(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *CommandString)
+{
+    CHAR    CommandCopy[100];
+    CHAR    *NameToken      = NULL;
+    CHAR    *pArg           = CommandString ? strchr(CommandString, ' ') : NULL;
+    UINT    NamespaceIndex  = 0;
+    size_t  NameOffset      = 0;
+    size_t  NameLength      = 0;
+
+    while (pArg && *pArg == ' ')
+    {
+        pArg++;
+    }
+
+    if (pArg && ((*pArg >= 'a' && *pArg <= 'z') || (*pArg >= 'A' && *pArg <= 'Z') || *pArg == '_'))
+    {
+        strncpy(CommandCopy, CommandString, sizeof(CommandCopy) - 1);
+        CommandCopy[sizeof(CommandCopy) - 1] = '\0';
+
+        NameToken = __getEventCounterNamespaceToken(CommandCopy);
+        if (NameToken)
+        {
+            NamespaceIndex  = __findEventCounterNamespace(pEventCounterContext, NameToken);
+            NameOffset      = NameToken - CommandCopy;
+            NameLength      = strlen(NameToken);
+            memmove(&CommandString[NameOffset], &CommandString[NameOffset + NameLength], strlen(&CommandString[NameOffset + NameLength]) + 1);
+        }
+    }
+
+    // Queued commands and combined increases of the default namespace run before the thread moves away
+    if (NamespaceIndex != pEventCounterContext->NamespaceIndex)
+    {
+        if (pEventCounterContext->NamespaceIndex == 0)
+        {
+            __flushEventCounterBatch(pEventCounterContext);
+            __flushEventCounterCombine(pEventCounterContext);
+        }
+        __switchEventCounterNamespace(pEventCounterContext, NamespaceIndex);
+    }
+
+    // Commands are served on the node of the namespace, the thread moves only when the node changes. The
+    // commands are counted for numastats only
+    if (CommandString && pEventCounterContext->pNumaPolicyContext)
+    {
+        pEventCounterContext->pNamespaceList[NamespaceIndex].NumCommands++;
+        pEventCounterContext->pNumaPolicyContext->stNumaPolicyFnTbl.bindNumaPolicyThread(pEventCounterContext->pNumaPolicyContext,
+            pEventCounterContext->pNamespaceList[NamespaceIndex].NumaNode);
+    }
+}
+
+// __switchEventCounterNamespace()
+// This function points the tree and the cold store at the namespace
+VOID __switchEventCounterNamespace(PEVENT_COUNTER_CONTEXT pEventCounterContext, UINT NamespaceIndex)
+{
+    pEventCounterContext->NamespaceIndex     = NamespaceIndex;
+    pEventCounterContext->pRbTreeContext     = pEventCounterContext->pNamespaceList[NamespaceIndex].pRbTreeContext;
+    pEventCounterContext->pColdStoreContext  = pEventCounterContext->pNamespaceList[NamespaceIndex].pColdStoreContext;
+    pEventCounterContext->pCountMinContext   = pEventCounterContext->pNamespaceList[NamespaceIndex].pCountMinContext;
+    pEventCounterContext->pTimerWheelContext = pEventCounterContext->pNamespaceList[NamespaceIndex].pTimerWheelContext;
+}
+
+// __findEventCounterNamespace()
+// This function gets the index of the namespace with the name, creating it with an empty tree if its not there.
+// Namespaces are few, a linear search is enough. New namespaces go round the NUMA nodes, the tree is created
+// on its node with the pool of the node
+UINT __findEventCounterNamespace(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *pName)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = NULL;
+    UINT                Index           = 0;
+    UINT                NumaNode        = pEventCounterContext->NumNamespaces % pEventCounterContext->NumNodePools;
+
+    for (Index = 0; Index < pEventCounterContext->NumNamespaces; Index++)
+    {
+        if (strcmp(pEventCounterContext->pNamespaceList[Index].pName, pName) == 0)
+        {
+            return Index;
+        }
+    }
+
+    if (pEventCounterContext->pNumaPolicyContext)
+    {
+        pEventCounterContext->pNumaPolicyContext->stNumaPolicyFnTbl.bindNumaPolicyThread(pEventCounterContext->pNumaPolicyContext, NumaNode);
+    }
+
+    pEventCounterContext->EventCounterArgs.RbTreeArgs.pNodePoolContext = pEventCounterContext->ppNodePoolContextList[NumaNode];
+    pRbTreeContext = createRbTreeContext(&pEventCounterContext->EventCounterArgs.RbTreeArgs);
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTreeNodeArrayList(pRbTreeContext, 0);
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTree(pRbTreeContext);
+
+    return __addEventCounterNamespace(pEventCounterContext, pName, pRbTreeContext, createColdStoreContext(pEventCounterContext->EventCounterArgs.ColdSegmentSize));
+}
+
+// __addEventCounterNamespace()
+// This function adds a namespace for the tree and the cold store, returns its index
+UINT __addEventCounterNamespace(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *pName, PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext)
+{
+    PEVENT_COUNTER_NAMESPACE    pNamespace = NULL;
+
+    // Grow the namespace list by doubling
+    if (pEventCounterContext->NumNamespaces == pEventCounterContext->MaxNamespaces)
+    {
+        pEventCounterContext->MaxNamespaces = pEventCounterContext->MaxNamespaces ? pEventCounterContext->MaxNamespaces * 2 : EVENT_COUNTER_MIN_NAMESPACES;
+        pEventCounterContext->pNamespaceList = (PEVENT_COUNTER_NAMESPACE)realloc(pEventCounterContext->pNamespaceList,
+            sizeof(EVENT_COUNTER_NAMESPACE) * pEventCounterContext->MaxNamespaces);
+    }
+
+    pNamespace = &pEventCounterContext->pNamespaceList[pEventCounterContext->NumNamespaces];
+    pNamespace->pName               = (CHAR*)malloc(strlen(pName) + 1);
+    strcpy(pNamespace->pName, pName);
+    pNamespace->pRbTreeContext      = pRbTreeContext;
+    pNamespace->pColdStoreContext   = pColdStoreContext;
+    pNamespace->pCountMinContext    = pEventCounterContext->EventCounterArgs.AdmitThreshold ?
+        createCountMinContext(pEventCounterContext->EventCounterArgs.SketchWidth) : NULL;
+    pNamespace->pTimerWheelContext  = pEventCounterContext->EventCounterArgs.TtlMs ?
+        createTimerWheelContext(pEventCounterContext->EventCounterArgs.TtlMs,
+            pEventCounterContext->EventCounterArgs.TtlStepMs ? &pEventCounterContext->TtlClockMs : NULL) : NULL;
+    pNamespace->NumaNode            = pEventCounterContext->NumNamespaces % pEventCounterContext->NumNodePools;
+    pNamespace->NumCommands         = 0;
+
+    // New namespaces of a leader are in the snapshots of the followers that come later
+    if (pEventCounterContext->pReplicaContext && !pEventCounterContext->pReplicaContext->bFollower)
+    {
+        pEventCounterContext->pReplicaContext->stReplicaFnTbl.addReplicaNamespace(pEventCounterContext->pReplicaContext, pName, pRbTreeContext, pColdStoreContext);
+    }
+
+    return pEventCounterContext->NumNamespaces++;
+}
+
+// __printEventCounterMemStats()
+// This function prints the memory taken by each namespace, its events are counted by walking the tree. Nodes are
+// counted at the node size whether they come from the array list of the loaded file or the shared pool (skip list
+// nodes at the size of their links, inner nodes of the radix tree count as index), the last
+// line has what the pool and the array lists hold in all, used or free
+VOID __printEventCounterMemStats(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PNODE_POOL_CONTEXT          pNodePoolContext    = pEventCounterContext->ppNodePoolContextList[0];
+    PEVENT_COUNTER_NAMESPACE    pNamespace          = NULL;
+    PRB_TREE_CONTEXT            pRbTreeContext      = NULL;
+    PRB_TREE_NODE               pRbTreeNode         = NULL;
+    ULONGLONG                   NumEvents           = 0;
+    ULONGLONG                   NodeBytes           = 0;
+    ULONGLONG                   IndexBytes          = 0;
+    ULONGLONG                   ArrayListBytes      = 0;
+    ULONGLONG                   PoolBytes           = 0;
+    UINT                        Index               = 0;
+
+    for (Index = 0; Index < pEventCounterContext->NumNamespaces; Index++)
+    {
+        pNamespace      = &pEventCounterContext->pNamespaceList[Index];
+        pRbTreeContext  = pNamespace->pRbTreeContext;
+
+        NumEvents   = 0;
+        NodeBytes   = 0;
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, INT_MIN);
+        while (pRbTreeNode)
+        {
+            NumEvents++;
+            NodeBytes += pRbTreeContext->pSkipListContext ?
+                offsetof(SKIP_LIST_NODE, NextList) + sizeof(size_t) * ((PSKIP_LIST_NODE)pRbTreeNode)->Height : pNodePoolContext->NodeSize;
+            pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+        }
+
+        IndexBytes = 0;
+        if (pRbTreeContext->pHashIndexContext)
+        {
+            IndexBytes += (ULONGLONG)pRbTreeContext->pHashIndexContext->Capacity * sizeof(HASH_INDEX_ENTRY);
+        }
+        if (pRbTreeContext->pHotCacheTable)
+        {
+            IndexBytes += ((ULONGLONG)1 << (32 - pRbTreeContext->HotCacheShift)) * sizeof(RB_TREE_HOT_CACHE_ENTRY);
+        }
+        if (pRbTreeContext->pArtTreeContext)
+        {
+            IndexBytes += pRbTreeContext->pArtTreeContext->NodeBytes;
+        }
+
+        ArrayListBytes += pRbTreeContext->pSkipListContext ? pRbTreeContext->pSkipListContext->ArrayListBytes :
+            (ULONGLONG)pRbTreeContext->ArrayListLength * pNodePoolContext->NodeSize;
+
+        printf("memstats %s events %llu nodebytes %llu indexbytes %llu coldevents %llu coldbytes %llu\n", pNamespace->pName,
+            NumEvents, NodeBytes, IndexBytes, pNamespace->pColdStoreContext->NumEvents,
+            pNamespace->pColdStoreContext->stColdStoreFnTbl.getColdStoreBytes(pNamespace->pColdStoreContext));
+    }
+
+    for (Index = 0; Index < pEventCounterContext->NumNodePools; Index++)
+    {
+        pNodePoolContext    = pEventCounterContext->ppNodePoolContextList[Index];
+        PoolBytes           += pNodePoolContext->stNodePoolFnTbl.getNodePoolBytes(pNodePoolContext);
+    }
+
+    printf("memstats pool bytes %llu arraylist bytes %llu\n", PoolBytes, ArrayListBytes);
+}
+
+// __createEventCounterNodePools()
+// This function creates a node pool for every NUMA node with -numa, or the one pool. With -numa the thread
+// is bound to the first node before the input file is loaded, so the default namespace is built there
+VOID __createEventCounterNodePools(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PNUMA_POLICY_CONTEXT    pNumaPolicyContext  = NULL;
+    UINT                    Index               = 0;
+
+    if (pEventCounterContext->EventCounterArgs.bNuma)
+    {
+        pEventCounterContext->pNumaPolicyContext = createNumaPolicyContext();
+        if (pEventCounterContext->pNumaPolicyContext == NULL)
+        {
+            printf("__createEventCounterNodePools: No NUMA nodes found, -numa is ignored\r\n");
+        }
+    }
+    pNumaPolicyContext = pEventCounterContext->pNumaPolicyContext;
+
+    pEventCounterContext->NumNodePools          = pNumaPolicyContext ? pNumaPolicyContext->NumNodes : 1;
+    pEventCounterContext->ppNodePoolContextList = (PNODE_POOL_CONTEXT*)malloc(sizeof(PNODE_POOL_CONTEXT) * pEventCounterContext->NumNodePools);
+
+    for (Index = 0; Index < pEventCounterContext->NumNodePools; Index++)
+    {
+        pEventCounterContext->ppNodePoolContextList[Index] = createRbTreeNodePoolContext(&pEventCounterContext->EventCounterArgs.RbTreeArgs);
+        pEventCounterContext->ppNodePoolContextList[Index]->pNumaPolicyContext  = pNumaPolicyContext;
+        pEventCounterContext->ppNodePoolContextList[Index]->NumaNode            = Index;
+    }
+
+    if (pNumaPolicyContext)
+    {
+        pNumaPolicyContext->stNumaPolicyFnTbl.bindNumaPolicyThread(pNumaPolicyContext, 0);
+    }
+
+    pEventCounterContext->EventCounterArgs.RbTreeArgs.pNodePoolContext = pEventCounterContext->ppNodePoolContextList[0];
+}
+
+// __printEventCounterNumaStats()
+// This function prints for each NUMA node the namespaces on it with the commands they served, how many times the
+// thread moved to the node and how many pages of the pool of the node are really on it
+VOID __printEventCounterNumaStats(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PNUMA_POLICY_CONTEXT    pNumaPolicyContext  = pEventCounterContext->pNumaPolicyContext;
+    PNODE_POOL_CONTEXT      pNodePoolContext    = NULL;
+    ULONGLONG               NumCommands         = 0;
+    ULONGLONG               NumPages            = 0;
+    ULONGLONG               NumNodePages        = 0;
+    UINT                    NumNamespaces       = 0;
+    UINT                    Node                = 0;
+    UINT                    Index               = 0;
+
+    if (pNumaPolicyContext == NULL)
+    {
+        printf("__printEventCounterNumaStats: NUMA placement is off, run with -numa\n");
+        return;
+    }
+
+    for (Node = 0; Node < pNumaPolicyContext->NumNodes; Node++)
+    {
+        NumCommands     = 0;
+        NumNamespaces   = 0;
+        for (Index = 0; Index < pEventCounterContext->NumNamespaces; Index++)
+        {
+            if (pEventCounterContext->pNamespaceList[Index].NumaNode == Node)
+            {
+                NumCommands += pEventCounterContext->pNamespaceList[Index].NumCommands;
+                NumNamespaces++;
+            }
+        }
+
+        pNodePoolContext    = pEventCounterContext->ppNodePoolContextList[Node];
+        NumPages            = 0;
+        NumNodePages        = pNodePoolContext->stNodePoolFnTbl.getNodePoolNumaPages(pNodePoolContext, &NumPages);
+
+        printf("numastats node %u cpus %u binds %llu namespaces %u commands %llu poolbytes %llu poolpages %llu onnode %llu\n",
+            pNumaPolicyContext->NodeList[Node].NodeID, pNumaPolicyContext->NodeList[Node].NumCpus, pNumaPolicyContext->NodeList[Node].NumBinds,
+            NumNamespaces, NumCommands, pNodePoolContext->stNodePoolFnTbl.getNodePoolBytes(pNodePoolContext), NumPages, NumNodePages);
+    }
+
+    for (Index = 0; Index < pEventCounterContext->NumNamespaces; Index++)
+    {
+        printf("numastats namespace %s node %u commands %llu\n", pEventCounterContext->pNamespaceList[Index].pName,
+            pNumaPolicyContext->NodeList[pEventCounterContext->pNamespaceList[Index].NumaNode].NodeID,
+            pEventCounterContext->pNamespaceList[Index].NumCommands);
+    }
+}
+
+// __printEventCounterPageStats()
+// This function prints how much node memory is on huge pages and the dTLB miss rate of the commands so far,
+// dTLB counters are not there in most VMs
+VOID __printEventCounterPageStats(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PPERF_COUNTER_CONTEXT   pPerfCounterContext = pEventCounterContext->pPerfCounterContext;
+    ULONGLONG               NumLoads            = 0;
+    ULONGLONG               NumLoadMisses       = 0;
+
+    if (pEventCounterContext->pHugePageContext)
+    {
+        pEventCounterContext->pHugePageContext->stHugePageFnTbl.printHugePageStats(pEventCounterContext->pHugePageContext);
+    }
+    else
+    {
+        printf("hugepages off, run with -hugepages\n");
+    }
+
+    if (!pPerfCounterContext)
+    {
+        printf("dtlb counters off, run with -hugepages or -perf\n");
+        return;
+    }
+
+    pPerfCounterContext->stPerfCounterFnTbl.readPerfCounters(pPerfCounterContext);
+    if (pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterValue(pPerfCounterContext, PERF_COUNTER_DTLB_LOADS, &NumLoads) &&
+        pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterValue(pPerfCounterContext, PERF_COUNTER_DTLB_LOAD_MISSES, &NumLoadMisses))
+    {
+        printf("dtlb loads %llu misses %llu missrate %.4f%%\n", NumLoads, NumLoadMisses, NumLoads ? 100.0 * NumLoadMisses / NumLoads : 0.0);
+    }
+    else
+    {
+        printf("dtlb counters not available\n");
+    }
+}
+
+// __startEventCounterReplica()
+// This function starts the replication asked for in the args. A leader listens for followers and logs the updates
+// from now on, a follower connects to its leader and waits till the snapshot from the leader is applied.
+// Returns FALSE if the replication cant be started
+BOOLEAN __startEventCounterReplica(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PREPLICA_CONTEXT    pReplicaContext = NULL;
+    UINT                Index           = 0;
+
+    if (pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress)
+    {
+        pReplicaContext = createReplicaFollowerContext(pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress,
+            __applyEventCounterReplicaRecords, pEventCounterContext);
+        pEventCounterContext->pReplicaContext = pReplicaContext;
+
+        if (!pReplicaContext->stReplicaFnTbl.startReplica(pReplicaContext) || !pReplicaContext->stReplicaFnTbl.waitReplicaBootstrap(pReplicaContext))
+        {
+            printf("__startEventCounterReplica: No snapshot from the leader at %s\n", pEventCounterContext->EventCounterArgs.pReplicaLeaderAddress);
+            return FALSE;
+        }
+    }
+    else if (pEventCounterContext->EventCounterArgs.bReplicaLeader)
+    {
+        pReplicaContext = createReplicaLeaderContext(pEventCounterContext->EventCounterArgs.ReplicaPort);
+        pEventCounterContext->pReplicaContext = pReplicaContext;
+
+        // Namespaces added later are registered as they come
+        for (Index = 0; Index < pEventCounterContext->NumNamespaces; Index++)
+        {
+            pReplicaContext->stReplicaFnTbl.addReplicaNamespace(pReplicaContext, pEventCounterContext->pNamespaceList[Index].pName,
+                pEventCounterContext->pNamespaceList[Index].pRbTreeContext, pEventCounterContext->pNamespaceList[Index].pColdStoreContext);
+        }
+
+        if (!pReplicaContext->stReplicaFnTbl.startReplica(pReplicaContext))
+        {
+            return FALSE;
+        }
+
+        // Followers that have to see every command are bootstrapped before the first one
+        if (pEventCounterContext->EventCounterArgs.ReplicaFollowers &&
+            !pReplicaContext->stReplicaFnTbl.waitReplicaFollowers(pReplicaContext, pEventCounterContext->EventCounterArgs.ReplicaFollowers))
+        {
+            printf("__startEventCounterReplica: %u followers didnt come in %d seconds\n", pEventCounterContext->EventCounterArgs.ReplicaFollowers,
+                REPLICA_WAIT_FOLLOWERS_SECONDS);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+// __replicateEventCounterUpdate()
+// This function logs what an update did to the namespace it ran on, if this is a leader
+VOID __replicateEventCounterUpdate(PEVENT_COUNTER_CONTEXT pEventCounterContext, REPLICA_OP Op, INT ID1, INT ID2, INT Value)
+{
+    PREPLICA_CONTEXT    pReplicaContext = pEventCounterContext->pReplicaContext;
+
+    if (pReplicaContext && !pReplicaContext->bFollower)
+    {
+        pReplicaContext->stReplicaFnTbl.appendReplicaRecord(pReplicaContext, pEventCounterContext->pNamespaceList[pEventCounterContext->NamespaceIndex].pName,
+            Op, ID1, ID2, Value);
+    }
+}
+
+// __isEventCounterReplicaUpdate()
+// This function tells if the command is an update that a follower has to turn down
+BOOLEAN __isEventCounterReplicaUpdate(PEVENT_COUNTER_CONTEXT pEventCounterContext, CHAR *Token)
+{
+    if (pEventCounterContext->pReplicaContext == NULL || !pEventCounterContext->pReplicaContext->bFollower || Token == NULL)
+    {
+        return FALSE;
+    }
+
+    return (strcmp(Token, "increase") == 0 || strcmp(Token, "reduce") == 0 || strcmp(Token, "deleterange") == 0 ||
+            strcmp(Token, "increaserange") == 0);
+}
+
+// __applyEventCounterReplicaRecords()
+// This function applies a batch of records from the leader on the follower thread, the command loop is locked out.
+// Every update commits a version like it did on the leader. Events of the snapshot for the default namespace are
+// gathered and built into its tree at once when the snapshot is over, the other namespaces take them one by one
+VOID __applyEventCounterReplicaRecords(VOID *pApplyContext, PREPLICA_RECORD pRecordList, UINT NumRecords)
+{
+    PEVENT_COUNTER_CONTEXT  pEventCounterContext    = (PEVENT_COUNTER_CONTEXT)pApplyContext;
+    PREPLICA_RECORD         pRecord                 = NULL;
+    UINT                    CommandNamespaceIndex   = pEventCounterContext->NamespaceIndex;
+    UINT                    NamespaceIndex          = 0;
+    UINT                    Index                   = 0;
+
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        pRecord = &pRecordList[Index];
+        pRecord->Namespace[REPLICA_MAX_NAME_LENGTH - 1] = '\0';
+
+        if (pRecord->Op == REPLICA_OP_BOOTSTRAP_DONE)
+        {
+            __buildEventCounterBootstrap(pEventCounterContext);
+            continue;
+        }
+
+        NamespaceIndex = __findEventCounterNamespace(pEventCounterContext, pRecord->Namespace);
+        if (pRecord->Op == REPLICA_OP_BOOTSTRAP_EVENT && NamespaceIndex == 0)
+        {
+            // Grow the list by doubling
+            if (pEventCounterContext->NumBootstrapRecords == pEventCounterContext->MaxBootstrapRecords)
+            {
+                pEventCounterContext->MaxBootstrapRecords = pEventCounterContext->MaxBootstrapRecords ? pEventCounterContext->MaxBootstrapRecords * 2 : REPLICA_MAX_BATCH_RECORDS;
+                pEventCounterContext->pBootstrapRecordList = (PRADIX_SORT_RECORD)realloc(pEventCounterContext->pBootstrapRecordList,
+                    sizeof(RADIX_SORT_RECORD) * pEventCounterContext->MaxBootstrapRecords);
+            }
+            pEventCounterContext->pBootstrapRecordList[pEventCounterContext->NumBootstrapRecords].ID       = pRecord->ID1;
+            pEventCounterContext->pBootstrapRecordList[pEventCounterContext->NumBootstrapRecords].Count    = pRecord->Value;
+            pEventCounterContext->NumBootstrapRecords++;
+            continue;
+        }
+
+        __switchEventCounterNamespace(pEventCounterContext, NamespaceIndex);
+
+        switch (pRecord->Op)
+        {
+        case REPLICA_OP_BOOTSTRAP_EVENT:
+            pEventCounterContext->pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pEventCounterContext->pRbTreeContext, pRecord->ID1, pRecord->Value);
+            break;
+        case REPLICA_OP_SET:
+            __setEventCount(pEventCounterContext, pRecord->ID1, pRecord->Value);
+            __commitEventCounterVersion(pEventCounterContext);
+            break;
+        case REPLICA_OP_DELETE_RANGE:
+            __deleteEventRange(pEventCounterContext, pRecord->ID1, pRecord->ID2);
+            __commitEventCounterVersion(pEventCounterContext);
+            break;
+        case REPLICA_OP_INCREASE_RANGE:
+            // Leader turned down a value that isnt positive but still took a version for it
+            if (pRecord->Value > 0)
+            {
+                __increaseEventRange(pEventCounterContext, pRecord->ID1, pRecord->ID2, pRecord->Value);
+            }
+            __commitEventCounterVersion(pEventCounterContext);
+            break;
+        }
+    }
+
+    __switchEventCounterNamespace(pEventCounterContext, CommandNamespaceIndex);
+}
+
+// __buildEventCounterBootstrap()
+// This function builds the tree of the default namespace from the events of the snapshot like from an input file,
+// or puts them in the cold store with -cold
+VOID __buildEventCounterBootstrap(PEVENT_COUNTER_CONTEXT pEventCounterContext)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pEventCounterContext->pNamespaceList[0].pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pEventCounterContext->pNamespaceList[0].pColdStoreContext;
+    PRADIX_SORT_RECORD  pRecordList         = pEventCounterContext->pBootstrapRecordList;
+    UINT                NumRecords          = pEventCounterContext->NumBootstrapRecords;
+    UINT                Index               = 0;
+
+    pEventCounterContext->NumEvents = NumRecords;
+
+    if (pEventCounterContext->EventCounterArgs.ColdSegmentSize)
+    {
+        pRbTreeContext->stRbTreeFnTbl.initializeRbTreeNodeArrayList(pRbTreeContext, 0);
+        pRbTreeContext->stRbTreeFnTbl.initializeRbTree(pRbTreeContext);
+        pColdStoreContext->stColdStoreFnTbl.insertColdStoreRecords(pColdStoreContext, pRecordList, NumRecords);
+    }
+    else
+    {
+        pRbTreeContext->stRbTreeFnTbl.initializeRbTreeNodeArrayList(pRbTreeContext, NumRecords);
+        for (Index = 0; Index < NumRecords; Index++)
+        {
+            pRbTreeContext->stRbTreeFnTbl.insertRbTreeNodeArrayList(pRbTreeContext, pRecordList[Index].ID, pRecordList[Index].Count, Index);
+        }
+        pRbTreeContext->stRbTreeFnTbl.initializeRbTree(pRbTreeContext);
+    }
+
+    free(pEventCounterContext->pBootstrapRecordList);
+    pEventCounterContext->pBootstrapRecordList  = NULL;
+    pEventCounterContext->NumBootstrapRecords   = 0;
+    pEventCounterContext->MaxBootstrapRecords   = 0;
+}
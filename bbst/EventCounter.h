@@ -7,20 +7,116 @@
 
 #include "Types.h"
 #include "RbTree.h"
+#include "Snapshot.h"
+#include "StreamLoader.h"
+#include "ColdStore.h"
+#include "NumaPolicy.h"
+#include "HugePage.h"
+#include "PerfCounter.h"
+#include "Replica.h"
+#include "Dump.h"
+#include "CountMin.h"
+#include "WriteCombine.h"
+#include "TimerWheel.h"
 
 //Args Declaration for event counter
 typedef struct _EVENT_COUNTER_ARGS
 {
-    char*   InputFilename;
+    char*           InputFilename;
+    RB_TREE_ARGS    RbTreeArgs;
+    UINT            BatchSize;
+    BOOLEAN         bStreamLoad;
+    UINT            StreamChunkEvents;
+    UINT            ColdSegmentSize;
+    BOOLEAN         bNuma;
+    BOOLEAN         bHugePages;
+    BOOLEAN         bPerf;
+    BOOLEAN         bReplicaLeader;
+    INT             ReplicaPort;
+    UINT            ReplicaFollowers;
+    CHAR            *pReplicaLeaderAddress;
+    ULONGLONG       RandomSeed;
+    UINT            AdmitThreshold;
+    UINT            SketchWidth;
+    UINT            CombineEntries;
+    UINT            CombineAgeMs;
+    BOOLEAN         bReadYourWrites;
+    UINT            TtlMs;
+    UINT            TtlBatch;
+    UINT            TtlStepMs;
 }EVENT_COUNTER_ARGS, *PEVENT_COUNTER_ARGS;
 
+// Commands that can be queued in batch mode
+typedef enum _EVENT_COUNTER_BATCH_COMMAND
+{
+    BATCH_COMMAND_COUNT,
+    BATCH_COMMAND_NEXT,
+    BATCH_COMMAND_PREVIOUS,
+    BATCH_COMMAND_INCREASE
+}EVENT_COUNTER_BATCH_COMMAND;
+
+// Queue of commands whose tree lookups are done together in batch mode
+typedef struct _EVENT_COUNTER_BATCH
+{
+    UINT                        NumCommands;
+    EVENT_COUNTER_BATCH_COMMAND CommandList[RB_TREE_MAX_BATCH_SIZE];
+    INT                         IDList[RB_TREE_MAX_BATCH_SIZE];
+    INT                         ValueList[RB_TREE_MAX_BATCH_SIZE];
+    PRB_TREE_NODE               pRbTreeNodeList[RB_TREE_MAX_BATCH_SIZE];
+}EVENT_COUNTER_BATCH, *PEVENT_COUNTER_BATCH;
+
+// Definitions
+#define EVENT_COUNTER_DEFAULT_NAMESPACE     "default"
+#define EVENT_COUNTER_MIN_NAMESPACES        8
+#define EVENT_COUNTER_DEFAULT_TTL_BATCH     256
+
+// Named counter with its own tree, cold store, sketch (with -admit) and timer wheel (with -ttl), the trees of all
+// the namespaces on a NUMA node share one node pool (there is one node without -numa)
+typedef struct _EVENT_COUNTER_NAMESPACE
+{
+    CHAR                    *pName;
+    PRB_TREE_CONTEXT        pRbTreeContext;
+    PCOLD_STORE_CONTEXT     pColdStoreContext;
+    PCOUNT_MIN_CONTEXT      pCountMinContext;
+    PTIMER_WHEEL_CONTEXT    pTimerWheelContext;
+    UINT                    NumaNode;
+    ULONGLONG               NumCommands;
+}EVENT_COUNTER_NAMESPACE, *PEVENT_COUNTER_NAMESPACE;
+
 // Context Declaration for event counter 
+// Tree, cold store, sketch and timer wheel pointers are the ones of the namespace the current command runs on. A
+// follower gathers the events of the default namespace from the bootstrap in BootstrapRecordList to build its tree.
+// IDs expired by the timer wheels before a command are taken out of the trees from ExpiredIDList
 typedef struct _EVENT_COUNTER_CONTEXT
 {
-    EVENT_COUNTER_ARGS  EventCounterArgs;
-    FILE                *InputFileHandle;
-    UINT                NumEvents;
-    RB_TREE_CONTEXT     *pRbTreeContext;
+    EVENT_COUNTER_ARGS       EventCounterArgs;
+    FILE                     *InputFileHandle;
+    UINT                     NumEvents;
+    RB_TREE_CONTEXT          *pRbTreeContext;
+    PSNAPSHOT_CONTEXT        pSnapshotContext;
+    PDUMP_CONTEXT            pDumpContext;
+    PSTREAM_LOADER_CONTEXT   pStreamLoaderContext;
+    PCOLD_STORE_CONTEXT      pColdStoreContext;
+    PCOUNT_MIN_CONTEXT       pCountMinContext;
+    PNUMA_POLICY_CONTEXT     pNumaPolicyContext;
+    PNODE_POOL_CONTEXT       *ppNodePoolContextList;
+    UINT                     NumNodePools;
+    PHUGE_PAGE_CONTEXT       pHugePageContext;
+    PPERF_COUNTER_CONTEXT    pPerfCounterContext;
+    PEVENT_COUNTER_NAMESPACE pNamespaceList;
+    UINT                     NumNamespaces;
+    UINT                     MaxNamespaces;
+    UINT                     NamespaceIndex;
+    EVENT_COUNTER_BATCH      EventCounterBatch;
+    PREPLICA_CONTEXT         pReplicaContext;
+    PRADIX_SORT_RECORD       pBootstrapRecordList;
+    UINT                     NumBootstrapRecords;
+    UINT                     MaxBootstrapRecords;
+    ULONGLONG                RandomState;
+    PWRITE_COMBINE_CONTEXT   pWriteCombineContext;
+    PTIMER_WHEEL_CONTEXT     pTimerWheelContext;
+    INT                      *pExpiredIDList;
+    ULONGLONG                TtlClockMs;
 }EVENT_COUNTER_CONTEXT, *PEVENT_COUNTER_CONTEXT;
 
 #endif
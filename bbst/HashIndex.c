@@ -0,0 +1,198 @@
+//
+// This file implements the functions for the
+// open addressing hash index
+//
+
+#include "HashIndex.h"
+
+// Local Function Declarations
+VOID    __insertHashIndexEntry(struct _HASH_INDEX_CONTEXT *pHashIndexContext, INT ID, VOID *pValue);
+VOID    __deleteHashIndexEntry(struct _HASH_INDEX_CONTEXT *pHashIndexContext, INT ID);
+VOID*   __findHashIndexEntry(struct _HASH_INDEX_CONTEXT *pHashIndexContext, INT ID);
+VOID    __allocateHashIndexTable(PHASH_INDEX_CONTEXT pHashIndexContext, UINT Capacity);
+VOID    __growHashIndexTable(PHASH_INDEX_CONTEXT pHashIndexContext);
+UINT    __getHashIndexSlot(PHASH_INDEX_CONTEXT pHashIndexContext, INT ID);
+
+
+// createHashIndexContext()
+// This function allocates memory for the context and initilize the table and function pointers
+// Capacity is rounded up to a power of 2 so that the slot can be computed with a shift
+PHASH_INDEX_CONTEXT createHashIndexContext(UINT Capacity)
+{
+    PHASH_INDEX_CONTEXT pHashIndexContext = NULL;
+
+    // Allocate memory for the Hash Index
+    pHashIndexContext = (PHASH_INDEX_CONTEXT)malloc(sizeof(HASH_INDEX_CONTEXT));
+
+    // Initialize the table
+    __allocateHashIndexTable(pHashIndexContext, Capacity);
+
+    // Initilize the function table
+    pHashIndexContext->stHashIndexFnTbl.insertHashIndexEntry    = __insertHashIndexEntry;
+    pHashIndexContext->stHashIndexFnTbl.deleteHashIndexEntry    = __deleteHashIndexEntry;
+    pHashIndexContext->stHashIndexFnTbl.findHashIndexEntry      = __findHashIndexEntry;
+
+    return pHashIndexContext;
+}
+
+// destroyHashIndexContext()
+// This function deallocates and frees up the context
+VOID destroyHashIndexContext(PHASH_INDEX_CONTEXT *ppHashIndexContext)
+{
+    if (*ppHashIndexContext)
+    {
+        free((*ppHashIndexContext)->pHashIndexEntryTable);
+        free(*ppHashIndexContext);
+        *ppHashIndexContext = NULL;
+    }
+}
+
+// __allocateHashIndexTable()
+// This function allocates an empty table with at least Capacity slots
+VOID __allocateHashIndexTable(PHASH_INDEX_CONTEXT pHashIndexContext, UINT Capacity)
+{
+    UINT    Log2Capacity = 0;
+
+    // Round up the capacity to a power of 2
+    if (Capacity < HASH_INDEX_MIN_CAPACITY)
+    {
+        Capacity = HASH_INDEX_MIN_CAPACITY;
+    }
+    while ((1U << Log2Capacity) < Capacity)
+    {
+        Log2Capacity++;
+    }
+
+    pHashIndexContext->Capacity             = 1U << Log2Capacity;
+    pHashIndexContext->HashShift            = 32 - Log2Capacity;
+    pHashIndexContext->NumEntries           = 0;
+    pHashIndexContext->pHashIndexEntryTable = (PHASH_INDEX_ENTRY)calloc(pHashIndexContext->Capacity, sizeof(HASH_INDEX_ENTRY));
+}
+
+// __getHashIndexSlot()
+// This function returns the home slot of the ID using fibonacci hashing
+UINT __getHashIndexSlot(PHASH_INDEX_CONTEXT pHashIndexContext, INT ID)
+{
+    return ((UINT)ID * 2654435769U) >> pHashIndexContext->HashShift;
+}
+
+// __growHashIndexTable()
+// This function doubles the table and reinserts all the entries
+VOID __growHashIndexTable(PHASH_INDEX_CONTEXT pHashIndexContext)
+{
+    PHASH_INDEX_ENTRY   pOldHashIndexEntryTable = pHashIndexContext->pHashIndexEntryTable;
+    UINT                OldCapacity             = pHashIndexContext->Capacity;
+    UINT                Index                   = 0;
+
+    __allocateHashIndexTable(pHashIndexContext, OldCapacity * 2);
+
+    for (Index = 0; Index < OldCapacity; Index++)
+    {
+        if (pOldHashIndexEntryTable[Index].pValue)
+        {
+            __insertHashIndexEntry(pHashIndexContext, pOldHashIndexEntryTable[Index].ID, pOldHashIndexEntryTable[Index].pValue);
+        }
+    }
+
+    free(pOldHashIndexEntryTable);
+}
+
+// __insertHashIndexEntry()
+// This function maps the ID to pValue, replacing the old value if the ID is already present
+VOID __insertHashIndexEntry(struct _HASH_INDEX_CONTEXT *pHashIndexContext, INT ID, VOID *pValue)
+{
+    PHASH_INDEX_ENTRY   pHashIndexEntryTable    = NULL;
+    UINT                Mask                    = 0;
+    UINT                Slot                    = 0;
+
+    // Keep the load factor low so that probe sequences stay short
+    if ((pHashIndexContext->NumEntries + 1) * 100 > pHashIndexContext->Capacity * HASH_INDEX_MAX_LOAD_PERCENT)
+    {
+        __growHashIndexTable(pHashIndexContext);
+    }
+
+    pHashIndexEntryTable    = pHashIndexContext->pHashIndexEntryTable;
+    Mask                    = pHashIndexContext->Capacity - 1;
+    Slot                    = __getHashIndexSlot(pHashIndexContext, ID);
+
+    // Probe till we find the ID or a free slot
+    while (pHashIndexEntryTable[Slot].pValue != NULL)
+    {
+        if (pHashIndexEntryTable[Slot].ID == ID)
+        {
+            pHashIndexEntryTable[Slot].pValue = pValue;
+            return;
+        }
+        Slot = (Slot + 1) & Mask;
+    }
+
+    pHashIndexEntryTable[Slot].ID       = ID;
+    pHashIndexEntryTable[Slot].pValue   = pValue;
+    pHashIndexContext->NumEntries++;
+}
+
+// __findHashIndexEntry()
+// This function returns the value mapped to the ID, or NULL if the ID is not present
+VOID* __findHashIndexEntry(struct _HASH_INDEX_CONTEXT *pHashIndexContext, INT ID)
+{
+    PHASH_INDEX_ENTRY   pHashIndexEntryTable    = pHashIndexContext->pHashIndexEntryTable;
+    UINT                Mask                    = pHashIndexContext->Capacity - 1;
+    UINT                Slot                    = __getHashIndexSlot(pHashIndexContext, ID);
+
+    while (pHashIndexEntryTable[Slot].pValue != NULL)
+    {
+        if (pHashIndexEntryTable[Slot].ID == ID)
+        {
+            return pHashIndexEntryTable[Slot].pValue;
+        }
+        Slot = (Slot + 1) & Mask;
+    }
+
+    return NULL;
+}
+
+// __deleteHashIndexEntry()
+// This function removes the ID from the table. Uses backward shift deletion so that no
+// tombstones are left behind and lookups never probe longer than needed
+VOID __deleteHashIndexEntry(struct _HASH_INDEX_CONTEXT *pHashIndexContext, INT ID)
+{
+    PHASH_INDEX_ENTRY   pHashIndexEntryTable    = pHashIndexContext->pHashIndexEntryTable;
+    UINT                Mask                    = pHashIndexContext->Capacity - 1;
+    UINT                Slot                    = __getHashIndexSlot(pHashIndexContext, ID);
+    UINT                NextSlot                = 0;
+    UINT                HomeSlot                = 0;
+
+    // First find the slot with the ID
+    while (pHashIndexEntryTable[Slot].pValue != NULL && pHashIndexEntryTable[Slot].ID != ID)
+    {
+        Slot = (Slot + 1) & Mask;
+    }
+
+    if (pHashIndexEntryTable[Slot].pValue == NULL)
+    {
+        // ID not present, nothing to be done
+        return;
+    }
+
+    // Shift back the entries of the probe sequence that can move into the hole
+    NextSlot = Slot;
+    while (TRUE)
+    {
+        NextSlot = (NextSlot + 1) & Mask;
+        if (pHashIndexEntryTable[NextSlot].pValue == NULL)
+        {
+            break;
+        }
+
+        // Entry can move only if its home slot is not cyclically in (Slot, NextSlot]
+        HomeSlot = __getHashIndexSlot(pHashIndexContext, pHashIndexEntryTable[NextSlot].ID);
+        if (((NextSlot - HomeSlot) & Mask) >= ((NextSlot - Slot) & Mask))
+        {
+            pHashIndexEntryTable[Slot] = pHashIndexEntryTable[NextSlot];
+            Slot = NextSlot;
+        }
+    }
+
+    pHashIndexEntryTable[Slot].pValue = NULL;
+    pHashIndexContext->NumEntries--;
+}
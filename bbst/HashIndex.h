@@ -0,0 +1,41 @@
+//
+// This file contains all the header definitions for
+// the open addressing Hash Index from event ID to tree node
+//
+
+#ifndef _HASH_INDEX_H_
+#define _HASH_INDEX_H_
+
+#include "Types.h"
+
+// Definitions
+#define HASH_INDEX_MIN_CAPACITY     1024
+#define HASH_INDEX_MAX_LOAD_PERCENT 70
+
+typedef struct _HASH_INDEX_ENTRY
+{
+    INT     ID;
+    VOID    *pValue;
+}HASH_INDEX_ENTRY, *PHASH_INDEX_ENTRY;
+
+// Hash Index Context Definition
+// Linear probing table, a slot is free when pValue is NULL
+typedef struct _HASH_INDEX_CONTEXT
+{
+    PHASH_INDEX_ENTRY   pHashIndexEntryTable;
+    UINT                Capacity;
+    UINT                NumEntries;
+    UINT                HashShift;
+    struct _HASH_INDEX_FN_TBL
+    {
+        VOID(*insertHashIndexEntry)(struct _HASH_INDEX_CONTEXT *pHashIndexContext, INT ID, VOID *pValue);
+        VOID(*deleteHashIndexEntry)(struct _HASH_INDEX_CONTEXT *pHashIndexContext, INT ID);
+        VOID*(*findHashIndexEntry)(struct _HASH_INDEX_CONTEXT *pHashIndexContext, INT ID);
+    }stHashIndexFnTbl;
+}HASH_INDEX_CONTEXT, *PHASH_INDEX_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside HashIndex.c
+PHASH_INDEX_CONTEXT createHashIndexContext(UINT Capacity);
+VOID                destroyHashIndexContext(PHASH_INDEX_CONTEXT *ppHashIndexContext);
+#endif
@@ -0,0 +1,264 @@
+//
+// This file implements the allocations on 2 MiB pages. Tree walks jump between nodes all over
+// the node memory, on 4 KiB pages most of those jumps are TLB misses as well as cache misses
+//
+
+#if !defined(_MSC_VER)
+#define _GNU_SOURCE
+#include <sys/mman.h>
+#endif
+#include "HugePage.h"
+
+// Local Function Declarations
+VOID*       __allocateHugePageMemory(struct _HUGE_PAGE_CONTEXT *pHugePageContext, size_t Size);
+VOID        __freeHugePageMemory(struct _HUGE_PAGE_CONTEXT *pHugePageContext, VOID *pMemory);
+ULONGLONG   __getHugePageTransparentBytes(struct _HUGE_PAGE_CONTEXT *pHugePageContext);
+VOID        __printHugePageStats(struct _HUGE_PAGE_CONTEXT *pHugePageContext);
+VOID*       __mapHugePageRegion(size_t Length, PHUGE_PAGE_REGION pRegion);
+VOID        __addHugePageRegion(PHUGE_PAGE_CONTEXT pHugePageContext, PHUGE_PAGE_REGION pRegion);
+VOID        __removeHugePageRegion(PHUGE_PAGE_CONTEXT pHugePageContext, VOID *pStart);
+
+
+// createHugePageContext()
+// This function allocates memory for the context and initilize the function pointers
+PHUGE_PAGE_CONTEXT createHugePageContext()
+{
+    PHUGE_PAGE_CONTEXT  pHugePageContext = NULL;
+
+    pHugePageContext = (PHUGE_PAGE_CONTEXT)malloc(sizeof(HUGE_PAGE_CONTEXT));
+    memset(pHugePageContext, 0, sizeof(HUGE_PAGE_CONTEXT));
+
+    // Initilize the function table
+    pHugePageContext->stHugePageFnTbl.allocateHugePageMemory        = __allocateHugePageMemory;
+    pHugePageContext->stHugePageFnTbl.freeHugePageMemory            = __freeHugePageMemory;
+    pHugePageContext->stHugePageFnTbl.getHugePageTransparentBytes   = __getHugePageTransparentBytes;
+    pHugePageContext->stHugePageFnTbl.printHugePageStats            = __printHugePageStats;
+
+    return pHugePageContext;
+}
+
+// destroyHugePageContext()
+// This function frees up the context, the memory allocated from it must be freed before
+VOID destroyHugePageContext(PHUGE_PAGE_CONTEXT *ppHugePageContext)
+{
+    if (*ppHugePageContext)
+    {
+        free((*ppHugePageContext)->pRegionList);
+        free(*ppHugePageContext);
+        *ppHugePageContext = NULL;
+    }
+}
+
+// __mapHugePageRegion()
+// This function maps the length, a multiple of the huge page size. Reserved huge pages are tried first, then
+// a 2 MiB aligned mapping is madvised so that the kernel can back it with transparent huge pages
+VOID* __mapHugePageRegion(size_t Length, PHUGE_PAGE_REGION pRegion)
+{
+#if !defined(_MSC_VER)
+    UCHAR   *pMapping   = NULL;
+    UCHAR   *pStart     = NULL;
+
+    pMapping = (UCHAR*)mmap(NULL, Length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (pMapping != MAP_FAILED)
+    {
+        pRegion->pStart = pMapping;
+        pRegion->Length = Length;
+        pRegion->Kind   = HUGE_PAGE_KIND_HUGETLB;
+        return pMapping;
+    }
+
+    // Map a huge page more and cut the ends, so that the region starts on a huge page
+    pMapping = (UCHAR*)mmap(NULL, Length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pMapping == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    pStart = (UCHAR*)(((size_t)pMapping + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+    if (pStart > pMapping)
+    {
+        munmap(pMapping, pStart - pMapping);
+    }
+    if (pStart + Length < pMapping + Length + HUGE_PAGE_SIZE)
+    {
+        munmap(pStart + Length, (pMapping + Length + HUGE_PAGE_SIZE) - (pStart + Length));
+    }
+
+    madvise(pStart, Length, MADV_HUGEPAGE);
+
+    pRegion->pStart = pStart;
+    pRegion->Length = Length;
+    pRegion->Kind   = HUGE_PAGE_KIND_TRANSPARENT;
+    return pStart;
+#else
+    return NULL;
+#endif
+}
+
+// __allocateHugePageMemory()
+// This function allocates the size on huge pages if it takes at least one, the memory is not initialized
+VOID* __allocateHugePageMemory(struct _HUGE_PAGE_CONTEXT *pHugePageContext, size_t Size)
+{
+    HUGE_PAGE_REGION    Region;
+    UCHAR               *pStart     = NULL;
+    size_t              Length      = (Size + HUGE_PAGE_HEADER_SIZE + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+    if (Size + HUGE_PAGE_HEADER_SIZE >= HUGE_PAGE_SIZE)
+    {
+        pStart = (UCHAR*)__mapHugePageRegion(Length, &Region);
+    }
+
+    if (pStart)
+    {
+        __addHugePageRegion(pHugePageContext, &Region);
+        if (Region.Kind == HUGE_PAGE_KIND_HUGETLB)
+        {
+            pHugePageContext->NumHugeTlbBytes += Length;
+        }
+        else
+        {
+            pHugePageContext->NumTransparentBytes += Length;
+        }
+    }
+    else
+    {
+        // Small or no mapping, still goes behind a header so that free can tell
+        pStart = (UCHAR*)malloc(Size + HUGE_PAGE_HEADER_SIZE);
+        if (pStart == NULL)
+        {
+            return NULL;
+        }
+
+        Region.pStart   = pStart;
+        Region.Length   = Size + HUGE_PAGE_HEADER_SIZE;
+        Region.Kind     = HUGE_PAGE_KIND_MALLOC;
+        pHugePageContext->NumMallocBytes += Region.Length;
+    }
+
+    *(PHUGE_PAGE_REGION)pStart = Region;
+    return pStart + HUGE_PAGE_HEADER_SIZE;
+}
+
+// __freeHugePageMemory()
+// This function frees the memory allocated by __allocateHugePageMemory
+VOID __freeHugePageMemory(struct _HUGE_PAGE_CONTEXT *pHugePageContext, VOID *pMemory)
+{
+    HUGE_PAGE_REGION    Region;
+
+    if (pMemory == NULL)
+    {
+        return;
+    }
+
+    Region = *(PHUGE_PAGE_REGION)((UCHAR*)pMemory - HUGE_PAGE_HEADER_SIZE);
+
+    switch (Region.Kind)
+    {
+    case HUGE_PAGE_KIND_MALLOC:
+        pHugePageContext->NumMallocBytes -= Region.Length;
+        free(Region.pStart);
+        break;
+    default:
+#if !defined(_MSC_VER)
+        if (Region.Kind == HUGE_PAGE_KIND_HUGETLB)
+        {
+            pHugePageContext->NumHugeTlbBytes -= Region.Length;
+        }
+        else
+        {
+            pHugePageContext->NumTransparentBytes -= Region.Length;
+        }
+        __removeHugePageRegion(pHugePageContext, Region.pStart);
+        munmap(Region.pStart, Region.Length);
+#endif
+        break;
+    }
+}
+
+// __addHugePageRegion()
+// This function adds the region to the list, the list grows by doubling
+VOID __addHugePageRegion(PHUGE_PAGE_CONTEXT pHugePageContext, PHUGE_PAGE_REGION pRegion)
+{
+    if (pHugePageContext->NumRegions == pHugePageContext->MaxRegions)
+    {
+        pHugePageContext->MaxRegions = pHugePageContext->MaxRegions ? pHugePageContext->MaxRegions * 2 : HUGE_PAGE_MIN_REGIONS;
+        pHugePageContext->pRegionList = (PHUGE_PAGE_REGION)realloc(pHugePageContext->pRegionList, sizeof(HUGE_PAGE_REGION) * pHugePageContext->MaxRegions);
+    }
+
+    pHugePageContext->pRegionList[pHugePageContext->NumRegions++] = *pRegion;
+}
+
+// __removeHugePageRegion()
+// This function takes the region out of the list, the last region takes its place
+VOID __removeHugePageRegion(PHUGE_PAGE_CONTEXT pHugePageContext, VOID *pStart)
+{
+    UINT    Index = 0;
+
+    for (Index = 0; Index < pHugePageContext->NumRegions; Index++)
+    {
+        if (pHugePageContext->pRegionList[Index].pStart == pStart)
+        {
+            pHugePageContext->pRegionList[Index] = pHugePageContext->pRegionList[--pHugePageContext->NumRegions];
+            return;
+        }
+    }
+}
+
+// __getHugePageTransparentBytes()
+// This function gets how much of the madvised regions the kernel really backs with huge pages, from the
+// AnonHugePages of the mappings in /proc/self/smaps that fall in a region
+ULONGLONG __getHugePageTransparentBytes(struct _HUGE_PAGE_CONTEXT *pHugePageContext)
+{
+    ULONGLONG   NumBytes        = 0;
+#if !defined(_MSC_VER)
+    FILE        *pFile          = NULL;
+    CHAR        Line[256];
+    ULONGLONG   MappingStart    = 0;
+    ULONGLONG   MappingEnd      = 0;
+    ULONGLONG   NumKBytes       = 0;
+    ULONGLONG   RegionStart     = 0;
+    BOOLEAN     bInRegion       = FALSE;
+    UINT        Index           = 0;
+
+    pFile = fopen("/proc/self/smaps", "r");
+    if (pFile == NULL)
+    {
+        return 0;
+    }
+
+    while (fgets(Line, sizeof(Line), pFile))
+    {
+        // Every mapping starts with its address range, the fields of the mapping follow
+        if (sscanf(Line, "%llx-%llx ", &MappingStart, &MappingEnd) == 2)
+        {
+            bInRegion = FALSE;
+            for (Index = 0; Index < pHugePageContext->NumRegions; Index++)
+            {
+                RegionStart = (ULONGLONG)(size_t)pHugePageContext->pRegionList[Index].pStart;
+                if (pHugePageContext->pRegionList[Index].Kind == HUGE_PAGE_KIND_TRANSPARENT &&
+                    MappingStart < RegionStart + pHugePageContext->pRegionList[Index].Length && RegionStart < MappingEnd)
+                {
+                    bInRegion = TRUE;
+                    break;
+                }
+            }
+        }
+        else if (bInRegion && sscanf(Line, "AnonHugePages: %llu kB", &NumKBytes) == 1)
+        {
+            NumBytes += NumKBytes * 1024;
+        }
+    }
+
+    fclose(pFile);
+#endif
+    return NumBytes;
+}
+
+// __printHugePageStats()
+// This function prints the memory on reserved huge pages, the memory madvised for transparent huge pages with
+// how much of it is really on huge pages, and what was too small for a huge page
+VOID __printHugePageStats(struct _HUGE_PAGE_CONTEXT *pHugePageContext)
+{
+    printf("hugepages hugetlb bytes %llu transparent bytes %llu onhugepages %llu small bytes %llu\n", pHugePageContext->NumHugeTlbBytes,
+        pHugePageContext->NumTransparentBytes, __getHugePageTransparentBytes(pHugePageContext), pHugePageContext->NumMallocBytes);
+}
@@ -0,0 +1,58 @@
+//
+// This file contains all the header definitions for
+// the allocations of the node memory on 2 MiB pages
+//
+
+#ifndef _HUGE_PAGE_H_
+#define _HUGE_PAGE_H_
+
+#include "Types.h"
+
+// Definitions
+#define HUGE_PAGE_SIZE          ((size_t)1 << 21)
+#define HUGE_PAGE_HEADER_SIZE   64
+#define HUGE_PAGE_MIN_REGIONS   16
+
+// How the memory of a region was mapped
+typedef enum _HUGE_PAGE_KIND
+{
+    HUGE_PAGE_KIND_HUGETLB,
+    HUGE_PAGE_KIND_TRANSPARENT,
+    HUGE_PAGE_KIND_MALLOC
+}HUGE_PAGE_KIND;
+
+// Mapping of an allocation, a copy is kept in the header in front of the memory. Header is
+// HUGE_PAGE_HEADER_SIZE so that the memory stays cache line aligned
+typedef struct _HUGE_PAGE_REGION
+{
+    VOID            *pStart;
+    size_t          Length;
+    HUGE_PAGE_KIND  Kind;
+}HUGE_PAGE_REGION, *PHUGE_PAGE_REGION;
+
+// Huge Page Context Definition
+// Allocations of a huge page or more are mapped with MAP_HUGETLB from the reserved pool, or if there are none
+// left are mapped 2 MiB aligned and madvised for transparent huge pages. Smaller ones come from malloc.
+// Regions are kept in a list so that the huge pages the kernel really gave can be looked up in smaps
+typedef struct _HUGE_PAGE_CONTEXT
+{
+    PHUGE_PAGE_REGION   pRegionList;
+    UINT                NumRegions;
+    UINT                MaxRegions;
+    ULONGLONG           NumHugeTlbBytes;
+    ULONGLONG           NumTransparentBytes;
+    ULONGLONG           NumMallocBytes;
+    struct _HUGE_PAGE_FN_TBL
+    {
+        VOID*(*allocateHugePageMemory)(struct _HUGE_PAGE_CONTEXT *pHugePageContext, size_t Size);
+        VOID(*freeHugePageMemory)(struct _HUGE_PAGE_CONTEXT *pHugePageContext, VOID *pMemory);
+        ULONGLONG(*getHugePageTransparentBytes)(struct _HUGE_PAGE_CONTEXT *pHugePageContext);
+        VOID(*printHugePageStats)(struct _HUGE_PAGE_CONTEXT *pHugePageContext);
+    }stHugePageFnTbl;
+}HUGE_PAGE_CONTEXT, *PHUGE_PAGE_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside HugePage.c
+PHUGE_PAGE_CONTEXT  createHugePageContext();
+VOID                destroyHugePageContext(PHUGE_PAGE_CONTEXT *ppHugePageContext);
+#endif
@@ -0,0 +1,221 @@
+//
+// This file implements the functions for the
+// node pool
+//
+
+#include "NodePool.h"
+
+// Local Function Declarations
+VOID*       __allocateNodePoolNode(struct _NODE_POOL_CONTEXT *pNodePoolContext);
+VOID        __freeNodePoolNode(struct _NODE_POOL_CONTEXT *pNodePoolContext, VOID *pNode);
+VOID        __freeNodePoolNodeSubtree(struct _NODE_POOL_CONTEXT *pNodePoolContext, VOID *pRootNode);
+ULONGLONG   __getNodePoolBytes(struct _NODE_POOL_CONTEXT *pNodePoolContext);
+ULONGLONG   __getNodePoolNumaPages(struct _NODE_POOL_CONTEXT *pNodePoolContext, ULONGLONG *pNumPages);
+VOID        __pushNodePoolNode(PNODE_POOL_CONTEXT pNodePoolContext, VOID *pNode);
+VOID**      __getNodePoolChild(VOID *pNode, UINT ChildOffset);
+size_t      __getNodePoolChunkSize(PNODE_POOL_CONTEXT pNodePoolContext);
+
+
+// createNodePoolContext()
+// This function allocates memory for the context and initilize the variables and function pointers
+// The child offsets tell the pool where the subtree links are in the node
+PNODE_POOL_CONTEXT createNodePoolContext(UINT NodeSize, UINT LeftChildOffset, UINT RightChildOffset)
+{
+    PNODE_POOL_CONTEXT  pNodePoolContext = NULL;
+
+    // Allocate memory for the Node Pool
+    pNodePoolContext = (PNODE_POOL_CONTEXT)malloc(sizeof(NODE_POOL_CONTEXT));
+    memset(pNodePoolContext, 0, sizeof(NODE_POOL_CONTEXT));
+
+    // Keep the nodes pointer aligned
+    pNodePoolContext->NodeSize          = (NodeSize + sizeof(VOID*) - 1) & ~(UINT)(sizeof(VOID*) - 1);
+    pNodePoolContext->LeftChildOffset   = LeftChildOffset;
+    pNodePoolContext->RightChildOffset  = RightChildOffset;
+
+    // Initilize the function table
+    pNodePoolContext->stNodePoolFnTbl.allocateNode          = __allocateNodePoolNode;
+    pNodePoolContext->stNodePoolFnTbl.freeNode              = __freeNodePoolNode;
+    pNodePoolContext->stNodePoolFnTbl.freeNodeSubtree       = __freeNodePoolNodeSubtree;
+    pNodePoolContext->stNodePoolFnTbl.getNodePoolBytes      = __getNodePoolBytes;
+    pNodePoolContext->stNodePoolFnTbl.getNodePoolNumaPages  = __getNodePoolNumaPages;
+
+    return pNodePoolContext;
+}
+
+// destroyNodePoolContext()
+// This function frees up all the chunks and the context. Nodes that were not carved out of the
+// chunks (like the array list of the tree) may be on the free stack, they are left alone
+VOID destroyNodePoolContext(PNODE_POOL_CONTEXT *ppNodePoolContext)
+{
+    VOID    *pChunk     = NULL;
+    VOID    *pNextChunk = NULL;
+
+    if (*ppNodePoolContext)
+    {
+        pChunk = (*ppNodePoolContext)->pChunkList;
+        while (pChunk)
+        {
+            pNextChunk = *(VOID**)pChunk;
+            if ((*ppNodePoolContext)->pHugePageContext)
+            {
+                (*ppNodePoolContext)->pHugePageContext->stHugePageFnTbl.freeHugePageMemory((*ppNodePoolContext)->pHugePageContext, pChunk);
+            }
+            else
+            {
+                free(pChunk);
+            }
+            pChunk = pNextChunk;
+        }
+
+        free(*ppNodePoolContext);
+        *ppNodePoolContext = NULL;
+    }
+}
+
+// __getNodePoolChunkSize()
+// This function gets the size of a chunk, a chunk on huge pages fills a huge page with its header
+size_t __getNodePoolChunkSize(PNODE_POOL_CONTEXT pNodePoolContext)
+{
+    if (pNodePoolContext->pHugePageContext)
+    {
+        return HUGE_PAGE_SIZE - HUGE_PAGE_HEADER_SIZE;
+    }
+
+    return sizeof(VOID*) + (size_t)pNodePoolContext->NodeSize * NODE_POOL_CHUNK_NODES;
+}
+
+// __getNodePoolChild()
+// This function returns the address of the child link at the offset in the node
+VOID** __getNodePoolChild(VOID *pNode, UINT ChildOffset)
+{
+    return (VOID**)((UCHAR*)pNode + ChildOffset);
+}
+
+// __pushNodePoolNode()
+// This function pushes the node on the free stack, its child links are left as they are
+VOID __pushNodePoolNode(PNODE_POOL_CONTEXT pNodePoolContext, VOID *pNode)
+{
+    *(VOID**)pNode = pNodePoolContext->pFreeNodeList;
+    pNodePoolContext->pFreeNodeList = pNode;
+}
+
+// __allocateNodePoolNode()
+// This function returns a node from the free stack, or carves a new one out of the current chunk.
+// If the node was the root of a freed subtree its children go on the free stack now.
+// Contents of the node are not initialized
+VOID* __allocateNodePoolNode(struct _NODE_POOL_CONTEXT *pNodePoolContext)
+{
+    VOID    *pNode  = NULL;
+    VOID    *pChild = NULL;
+    VOID    *pChunk = NULL;
+
+    if (pNodePoolContext->pFreeNodeList)
+    {
+        pNode = pNodePoolContext->pFreeNodeList;
+        pNodePoolContext->pFreeNodeList = *(VOID**)pNode;
+
+        pChild = *__getNodePoolChild(pNode, pNodePoolContext->LeftChildOffset);
+        if (pChild)
+        {
+            __pushNodePoolNode(pNodePoolContext, pChild);
+        }
+
+        pChild = *__getNodePoolChild(pNode, pNodePoolContext->RightChildOffset);
+        if (pChild)
+        {
+            __pushNodePoolNode(pNodePoolContext, pChild);
+        }
+
+        return pNode;
+    }
+
+    if (pNodePoolContext->NumChunkNodesLeft == 0)
+    {
+        // Get a new chunk, first pointer sized slot links the chunks for destroy
+        if (pNodePoolContext->pHugePageContext)
+        {
+            pChunk = pNodePoolContext->pHugePageContext->stHugePageFnTbl.allocateHugePageMemory(pNodePoolContext->pHugePageContext, __getNodePoolChunkSize(pNodePoolContext));
+        }
+        else
+        {
+            pChunk = malloc(__getNodePoolChunkSize(pNodePoolContext));
+        }
+        *(VOID**)pChunk = pNodePoolContext->pChunkList;
+        pNodePoolContext->pChunkList        = pChunk;
+        pNodePoolContext->pNextChunkNode    = (UCHAR*)pChunk + sizeof(VOID*);
+        pNodePoolContext->NumChunkNodesLeft = (UINT)((__getNodePoolChunkSize(pNodePoolContext) - sizeof(VOID*)) / pNodePoolContext->NodeSize);
+
+        // Chunk memory may have been freed by a tree on another node, move it before the nodes are used
+        if (pNodePoolContext->pNumaPolicyContext)
+        {
+            pNodePoolContext->pNumaPolicyContext->stNumaPolicyFnTbl.bindNumaPolicyMemory(pNodePoolContext->pNumaPolicyContext, 
+                pChunk, __getNodePoolChunkSize(pNodePoolContext), pNodePoolContext->NumaNode);
+        }
+    }
+
+    pNode = pNodePoolContext->pNextChunkNode;
+    pNodePoolContext->pNextChunkNode += pNodePoolContext->NodeSize;
+    pNodePoolContext->NumChunkNodesLeft--;
+
+    return pNode;
+}
+
+// __freeNodePoolNode()
+// This function gives a single node back to the pool
+VOID __freeNodePoolNode(struct _NODE_POOL_CONTEXT *pNodePoolContext, VOID *pNode)
+{
+    // Cut the children so that they are not freed along with the node
+    *__getNodePoolChild(pNode, pNodePoolContext->LeftChildOffset) = NULL;
+    *__getNodePoolChild(pNode, pNodePoolContext->RightChildOffset) = NULL;
+
+    __pushNodePoolNode(pNodePoolContext, pNode);
+}
+
+// __freeNodePoolNodeSubtree()
+// This function gives the whole subtree under the root back to the pool in O(1)
+VOID __freeNodePoolNodeSubtree(struct _NODE_POOL_CONTEXT *pNodePoolContext, VOID *pRootNode)
+{
+    if (pRootNode)
+    {
+        __pushNodePoolNode(pNodePoolContext, pRootNode);
+    }
+}
+
+// __getNodePoolBytes()
+// This function gets the memory taken by the chunks of the pool, in use or not
+ULONGLONG __getNodePoolBytes(struct _NODE_POOL_CONTEXT *pNodePoolContext)
+{
+    VOID        *pChunk     = pNodePoolContext->pChunkList;
+    ULONGLONG   NumBytes    = 0;
+
+    while (pChunk)
+    {
+        NumBytes    += __getNodePoolChunkSize(pNodePoolContext);
+        pChunk      = *(VOID**)pChunk;
+    }
+
+    return NumBytes;
+}
+
+// __getNodePoolNumaPages()
+// This function gets how many pages of the chunks are on the node of the pool, the pages that are in
+// memory at all are added to pNumPages
+ULONGLONG __getNodePoolNumaPages(struct _NODE_POOL_CONTEXT *pNodePoolContext, ULONGLONG *pNumPages)
+{
+    VOID        *pChunk         = pNodePoolContext->pChunkList;
+    ULONGLONG   NumNodePages    = 0;
+
+    if (pNodePoolContext->pNumaPolicyContext == NULL)
+    {
+        return 0;
+    }
+
+    while (pChunk)
+    {
+        NumNodePages += pNodePoolContext->pNumaPolicyContext->stNumaPolicyFnTbl.getNumaPolicyNodePages(pNodePoolContext->pNumaPolicyContext,
+            pChunk, __getNodePoolChunkSize(pNodePoolContext), pNodePoolContext->NumaNode, pNumPages);
+        pChunk = *(VOID**)pChunk;
+    }
+
+    return NumNodePages;
+}
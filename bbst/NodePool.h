@@ -0,0 +1,48 @@
+//
+// This file contains all the header definitions for
+// the Node Pool that hands out fixed size tree nodes
+//
+
+#ifndef _NODE_POOL_H_
+#define _NODE_POOL_H_
+
+#include "Types.h"
+#include "NumaPolicy.h"
+#include "HugePage.h"
+
+// Definitions
+#define NODE_POOL_CHUNK_NODES   4096
+
+// Node Pool Context Definition
+// Nodes are carved out of chunks and freed nodes are kept on a stack for reuse. A whole subtree
+// is freed by pushing just its root, its children are pushed when the root is handed out again,
+// so freeing a subtree costs O(1) no matter its size. The stack is linked through the first
+// pointer of the free nodes, so the child pointers must come after it in the node.
+// With a numa policy every new chunk is bound to NumaNode. With a huge page context a chunk is one huge page
+typedef struct _NODE_POOL_CONTEXT
+{
+    UINT                    NodeSize;
+    UINT                    LeftChildOffset;
+    UINT                    RightChildOffset;
+    VOID                    *pFreeNodeList;
+    VOID                    *pChunkList;
+    UCHAR                   *pNextChunkNode;
+    UINT                    NumChunkNodesLeft;
+    PNUMA_POLICY_CONTEXT    pNumaPolicyContext;
+    UINT                    NumaNode;
+    PHUGE_PAGE_CONTEXT      pHugePageContext;
+    struct _NODE_POOL_FN_TBL
+    {
+        VOID*(*allocateNode)(struct _NODE_POOL_CONTEXT *pNodePoolContext);
+        VOID(*freeNode)(struct _NODE_POOL_CONTEXT *pNodePoolContext, VOID *pNode);
+        VOID(*freeNodeSubtree)(struct _NODE_POOL_CONTEXT *pNodePoolContext, VOID *pRootNode);
+        ULONGLONG(*getNodePoolBytes)(struct _NODE_POOL_CONTEXT *pNodePoolContext);
+        ULONGLONG(*getNodePoolNumaPages)(struct _NODE_POOL_CONTEXT *pNodePoolContext, ULONGLONG *pNumPages);
+    }stNodePoolFnTbl;
+}NODE_POOL_CONTEXT, *PNODE_POOL_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside NodePool.c
+PNODE_POOL_CONTEXT  createNodePoolContext(UINT NodeSize, UINT LeftChildOffset, UINT RightChildOffset);
+VOID                destroyNodePoolContext(PNODE_POOL_CONTEXT *ppNodePoolContext);
+#endif
@@ -0,0 +1,288 @@
+//
+// This file implements the placement on NUMA nodes. The nodes and their CPUs are read from sysfs and
+// the memory policy calls are made straight through syscall, so there is no libnuma to link
+//
+
+#if !defined(_MSC_VER)
+#define _GNU_SOURCE
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+#include "NumaPolicy.h"
+
+// Memory policy values from the kernel uapi mempolicy.h
+#define NUMA_POLICY_MPOL_PREFERRED  1
+#define NUMA_POLICY_MPOL_MF_MOVE    (1 << 1)
+#define NUMA_POLICY_QUERY_PAGES     256
+
+// Local Function Declarations
+BOOLEAN     __bindNumaPolicyThread(struct _NUMA_POLICY_CONTEXT *pNumaPolicyContext, UINT Node);
+VOID        __bindNumaPolicyMemory(struct _NUMA_POLICY_CONTEXT *pNumaPolicyContext, VOID *pMemory, size_t Size, UINT Node);
+ULONGLONG   __getNumaPolicyNodePages(struct _NUMA_POLICY_CONTEXT *pNumaPolicyContext, VOID *pMemory, size_t Size, UINT Node, ULONGLONG *pNumPages);
+UINT        __parseNumaPolicyList(CHAR *pList, ULONGLONG *pMask, UINT MaxBits);
+BOOLEAN     __readNumaPolicyList(CHAR *pPath, ULONGLONG *pMask, UINT MaxBits, UINT *pNumBits);
+BOOLEAN     __getNumaPolicyPageRange(VOID *pMemory, size_t Size, UCHAR **ppStart, size_t *pLength);
+
+
+// createNumaPolicyContext()
+// This function reads the online nodes and their CPUs, allocates memory for the context and initilize the
+// function pointers. Returns NULL if there are no nodes to bind to
+PNUMA_POLICY_CONTEXT createNumaPolicyContext()
+{
+    PNUMA_POLICY_CONTEXT    pNumaPolicyContext  = NULL;
+    PNUMA_POLICY_NODE       pNumaPolicyNode     = NULL;
+    ULONGLONG               NodeMask            = 0;
+    CHAR                    Path[64];
+    UINT                    NodeID              = 0;
+
+    if (!__readNumaPolicyList("/sys/devices/system/node/online", &NodeMask, NUMA_POLICY_MAX_NODES, NULL))
+    {
+        return NULL;
+    }
+
+    pNumaPolicyContext = (PNUMA_POLICY_CONTEXT)malloc(sizeof(NUMA_POLICY_CONTEXT));
+    memset(pNumaPolicyContext, 0, sizeof(NUMA_POLICY_CONTEXT));
+    pNumaPolicyContext->CurrentNode = -1;
+
+    // Nodes without CPUs (memory only) cant run the serving thread, they are left out
+    for (NodeID = 0; NodeID < NUMA_POLICY_MAX_NODES; NodeID++)
+    {
+        if (!(NodeMask & (1ULL << NodeID)))
+        {
+            continue;
+        }
+
+        pNumaPolicyNode = &pNumaPolicyContext->NodeList[pNumaPolicyContext->NumNodes];
+        snprintf(Path, sizeof(Path), "/sys/devices/system/node/node%u/cpulist", NodeID);
+        if (__readNumaPolicyList(Path, pNumaPolicyNode->CpuMask, NUMA_POLICY_MAX_CPUS, &pNumaPolicyNode->NumCpus) && pNumaPolicyNode->NumCpus)
+        {
+            pNumaPolicyNode->NodeID = NodeID;
+            pNumaPolicyContext->NumNodes++;
+        }
+        else
+        {
+            memset(pNumaPolicyNode, 0, sizeof(NUMA_POLICY_NODE));
+        }
+    }
+
+    if (pNumaPolicyContext->NumNodes == 0)
+    {
+        free(pNumaPolicyContext);
+        return NULL;
+    }
+
+    // Initilize the function table
+    pNumaPolicyContext->stNumaPolicyFnTbl.bindNumaPolicyThread      = __bindNumaPolicyThread;
+    pNumaPolicyContext->stNumaPolicyFnTbl.bindNumaPolicyMemory      = __bindNumaPolicyMemory;
+    pNumaPolicyContext->stNumaPolicyFnTbl.getNumaPolicyNodePages    = __getNumaPolicyNodePages;
+
+    return pNumaPolicyContext;
+}
+
+// destroyNumaPolicyContext()
+// This function frees up the context, the thread stays where it was bound last
+VOID destroyNumaPolicyContext(PNUMA_POLICY_CONTEXT *ppNumaPolicyContext)
+{
+    if (*ppNumaPolicyContext)
+    {
+        free(*ppNumaPolicyContext);
+        *ppNumaPolicyContext = NULL;
+    }
+}
+
+// __readNumaPolicyList()
+// This function reads a sysfs list file like "0-3,8" into the mask, the number of entries goes to pNumBits
+BOOLEAN __readNumaPolicyList(CHAR *pPath, ULONGLONG *pMask, UINT MaxBits, UINT *pNumBits)
+{
+#if !defined(_MSC_VER)
+    FILE    *pFile  = NULL;
+    CHAR    List[4096];
+    UINT    NumBits = 0;
+
+    pFile = fopen(pPath, "r");
+    if (pFile == NULL)
+    {
+        return FALSE;
+    }
+
+    if (fgets(List, sizeof(List), pFile) == NULL)
+    {
+        fclose(pFile);
+        return FALSE;
+    }
+    fclose(pFile);
+
+    NumBits = __parseNumaPolicyList(List, pMask, MaxBits);
+    if (pNumBits)
+    {
+        *pNumBits = NumBits;
+    }
+
+    return (NumBits > 0);
+#else
+    return FALSE;
+#endif
+}
+
+// __parseNumaPolicyList()
+// This function sets the bits of the ranges in the list, entries past MaxBits are dropped. Returns the number of bits set
+UINT __parseNumaPolicyList(CHAR *pList, ULONGLONG *pMask, UINT MaxBits)
+{
+    CHAR    *pNext      = pList;
+    UINT    First       = 0;
+    UINT    Last        = 0;
+    UINT    Bit         = 0;
+    UINT    NumBits     = 0;
+
+    while (*pNext >= '0' && *pNext <= '9')
+    {
+        First = Last = (UINT)strtoul(pNext, &pNext, 10);
+        if (*pNext == '-')
+        {
+            Last = (UINT)strtoul(pNext + 1, &pNext, 10);
+        }
+
+        for (Bit = First; Bit <= Last && Bit < MaxBits; Bit++)
+        {
+            pMask[Bit / 64] |= (1ULL << (Bit % 64));
+            NumBits++;
+        }
+
+        if (*pNext != ',')
+        {
+            break;
+        }
+        pNext++;
+    }
+
+    return NumBits;
+}
+
+// __getNumaPolicyPageRange()
+// This function gets the whole pages inside the memory, a page shared with other allocations is left out
+BOOLEAN __getNumaPolicyPageRange(VOID *pMemory, size_t Size, UCHAR **ppStart, size_t *pLength)
+{
+#if !defined(_MSC_VER)
+    size_t  PageSize    = (size_t)sysconf(_SC_PAGESIZE);
+    size_t  Start       = ((size_t)pMemory + PageSize - 1) & ~(PageSize - 1);
+    size_t  End         = ((size_t)pMemory + Size) & ~(PageSize - 1);
+
+    if (End <= Start)
+    {
+        return FALSE;
+    }
+
+    *ppStart = (UCHAR*)Start;
+    *pLength = End - Start;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+// __bindNumaPolicyThread()
+// This function moves the calling thread to the CPUs of the node and makes the node its preferred memory,
+// nothing is done if the thread is there already
+BOOLEAN __bindNumaPolicyThread(struct _NUMA_POLICY_CONTEXT *pNumaPolicyContext, UINT Node)
+{
+#if !defined(_MSC_VER)
+    PNUMA_POLICY_NODE   pNumaPolicyNode = &pNumaPolicyContext->NodeList[Node];
+    cpu_set_t           CpuSet;
+    ULONGLONG           NodeMask        = 1ULL << pNumaPolicyNode->NodeID;
+    UINT                Cpu             = 0;
+
+    if (pNumaPolicyContext->CurrentNode == (INT)Node)
+    {
+        return TRUE;
+    }
+
+    CPU_ZERO(&CpuSet);
+    for (Cpu = 0; Cpu < NUMA_POLICY_MAX_CPUS && Cpu < CPU_SETSIZE; Cpu++)
+    {
+        if (pNumaPolicyNode->CpuMask[Cpu / 64] & (1ULL << (Cpu % 64)))
+        {
+            CPU_SET(Cpu, &CpuSet);
+        }
+    }
+
+    if (sched_setaffinity(0, sizeof(CpuSet), &CpuSet) != 0)
+    {
+        return FALSE;
+    }
+
+    // Preferred and not strict, so allocations go to other nodes rather than fail when the node is full
+    syscall(SYS_set_mempolicy, NUMA_POLICY_MPOL_PREFERRED, &NodeMask, (unsigned long)NUMA_POLICY_MAX_NODES + 1);
+
+    pNumaPolicyContext->CurrentNode = (INT)Node;
+    pNumaPolicyNode->NumBinds++;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+// __bindNumaPolicyMemory()
+// This function makes the node the preferred memory of the whole pages of the range and moves the pages
+// that are already on other nodes
+VOID __bindNumaPolicyMemory(struct _NUMA_POLICY_CONTEXT *pNumaPolicyContext, VOID *pMemory, size_t Size, UINT Node)
+{
+#if !defined(_MSC_VER)
+    ULONGLONG   NodeMask    = 1ULL << pNumaPolicyContext->NodeList[Node].NodeID;
+    UCHAR       *pStart     = NULL;
+    size_t      Length      = 0;
+
+    if (__getNumaPolicyPageRange(pMemory, Size, &pStart, &Length))
+    {
+        syscall(SYS_mbind, pStart, Length, NUMA_POLICY_MPOL_PREFERRED, &NodeMask, (unsigned long)NUMA_POLICY_MAX_NODES + 1, NUMA_POLICY_MPOL_MF_MOVE);
+    }
+#endif
+}
+
+// __getNumaPolicyNodePages()
+// This function gets how many of the whole pages of the range are on the node, pages not touched yet are not
+// counted. The number of pages that are in memory is added to pNumPages
+ULONGLONG __getNumaPolicyNodePages(struct _NUMA_POLICY_CONTEXT *pNumaPolicyContext, VOID *pMemory, size_t Size, UINT Node, ULONGLONG *pNumPages)
+{
+    ULONGLONG   NumNodePages    = 0;
+#if !defined(_MSC_VER)
+    VOID        *pPageList[NUMA_POLICY_QUERY_PAGES];
+    INT         StatusList[NUMA_POLICY_QUERY_PAGES];
+    size_t      PageSize        = (size_t)sysconf(_SC_PAGESIZE);
+    UCHAR       *pStart         = NULL;
+    size_t      Length          = 0;
+    size_t      Offset          = 0;
+    UINT        NumQueryPages   = 0;
+    UINT        Index           = 0;
+
+    if (!__getNumaPolicyPageRange(pMemory, Size, &pStart, &Length))
+    {
+        return 0;
+    }
+
+    // Without a node list move_pages just reports the node of every page
+    for (Offset = 0; Offset < Length; Offset += (size_t)NumQueryPages * PageSize)
+    {
+        NumQueryPages = 0;
+        while (NumQueryPages < NUMA_POLICY_QUERY_PAGES && Offset + (size_t)NumQueryPages * PageSize < Length)
+        {
+            pPageList[NumQueryPages] = pStart + Offset + (size_t)NumQueryPages * PageSize;
+            NumQueryPages++;
+        }
+
+        if (syscall(SYS_move_pages, 0, (unsigned long)NumQueryPages, pPageList, NULL, StatusList, 0) != 0)
+        {
+            break;
+        }
+
+        for (Index = 0; Index < NumQueryPages; Index++)
+        {
+            if (StatusList[Index] >= 0)
+            {
+                (*pNumPages)++;
+                NumNodePages += (StatusList[Index] == (INT)pNumaPolicyContext->NodeList[Node].NodeID);
+            }
+        }
+    }
+#endif
+    return NumNodePages;
+}
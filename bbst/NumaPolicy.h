@@ -0,0 +1,45 @@
+//
+// This file contains all the header definitions for
+// the placement of the trees and the serving thread on NUMA nodes
+//
+
+#ifndef _NUMA_POLICY_H_
+#define _NUMA_POLICY_H_
+
+#include "Types.h"
+
+// Definitions
+#define NUMA_POLICY_MAX_NODES       64
+#define NUMA_POLICY_MAX_CPUS        1024
+#define NUMA_POLICY_CPU_MASK_WORDS  (NUMA_POLICY_MAX_CPUS / 64)
+
+// Online node with the CPUs that are local to it
+typedef struct _NUMA_POLICY_NODE
+{
+    UINT        NodeID;
+    UINT        NumCpus;
+    ULONGLONG   CpuMask[NUMA_POLICY_CPU_MASK_WORDS];
+    ULONGLONG   NumBinds;
+}NUMA_POLICY_NODE, *PNUMA_POLICY_NODE;
+
+// Numa Policy Context Definition
+// Nodes are indexed 0 to NumNodes - 1 in the order of their IDs. The calling thread is bound to one node at a
+// time, its CPUs and its memory policy both move with it, so memory it touches first comes from that node
+typedef struct _NUMA_POLICY_CONTEXT
+{
+    UINT                NumNodes;
+    INT                 CurrentNode;
+    NUMA_POLICY_NODE    NodeList[NUMA_POLICY_MAX_NODES];
+    struct _NUMA_POLICY_FN_TBL
+    {
+        BOOLEAN(*bindNumaPolicyThread)(struct _NUMA_POLICY_CONTEXT *pNumaPolicyContext, UINT Node);
+        VOID(*bindNumaPolicyMemory)(struct _NUMA_POLICY_CONTEXT *pNumaPolicyContext, VOID *pMemory, size_t Size, UINT Node);
+        ULONGLONG(*getNumaPolicyNodePages)(struct _NUMA_POLICY_CONTEXT *pNumaPolicyContext, VOID *pMemory, size_t Size, UINT Node, ULONGLONG *pNumPages);
+    }stNumaPolicyFnTbl;
+}NUMA_POLICY_CONTEXT, *PNUMA_POLICY_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside NumaPolicy.c
+PNUMA_POLICY_CONTEXT    createNumaPolicyContext();
+VOID                    destroyNumaPolicyContext(PNUMA_POLICY_CONTEXT *ppNumaPolicyContext);
+#endif
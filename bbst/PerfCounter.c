@@ -0,0 +1,221 @@
+//
+// This file implements the hardware performance counters. Counters are opened through the
+// perf_event_open syscall, there is no library to link
+//
+
+#if !defined(_MSC_VER)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "PerfCounter.h"
+
+// Local Function Declarations
+BOOLEAN __addPerfCounter(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext, PERF_COUNTER_EVENT Event);
+VOID    __startPerfCounters(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext);
+VOID    __stopPerfCounters(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext);
+VOID    __readPerfCounters(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext);
+BOOLEAN __getPerfCounterValue(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext, PERF_COUNTER_EVENT Event, ULONGLONG *pValue);
+CHAR*   __getPerfCounterName(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext, PERF_COUNTER_EVENT Event);
+
+
+// createPerfCounterContext()
+// This function allocates memory for the context and initilize the function pointers, no counter is open yet
+PPERF_COUNTER_CONTEXT createPerfCounterContext()
+{
+    PPERF_COUNTER_CONTEXT   pPerfCounterContext = NULL;
+
+    pPerfCounterContext = (PPERF_COUNTER_CONTEXT)malloc(sizeof(PERF_COUNTER_CONTEXT));
+    memset(pPerfCounterContext, 0, sizeof(PERF_COUNTER_CONTEXT));
+
+    // Initilize the function table
+    pPerfCounterContext->stPerfCounterFnTbl.addPerfCounter      = __addPerfCounter;
+    pPerfCounterContext->stPerfCounterFnTbl.startPerfCounters   = __startPerfCounters;
+    pPerfCounterContext->stPerfCounterFnTbl.stopPerfCounters    = __stopPerfCounters;
+    pPerfCounterContext->stPerfCounterFnTbl.readPerfCounters    = __readPerfCounters;
+    pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterValue = __getPerfCounterValue;
+    pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterName  = __getPerfCounterName;
+
+    return pPerfCounterContext;
+}
+
+// destroyPerfCounterContext()
+// This function closes the counters and frees up the context
+VOID destroyPerfCounterContext(PPERF_COUNTER_CONTEXT *ppPerfCounterContext)
+{
+    UINT    Index = 0;
+
+    if (*ppPerfCounterContext)
+    {
+#if !defined(_MSC_VER)
+        for (Index = 0; Index < (*ppPerfCounterContext)->NumCounters; Index++)
+        {
+            close((*ppPerfCounterContext)->CounterList[Index].Fd);
+        }
+#endif
+        free(*ppPerfCounterContext);
+        *ppPerfCounterContext = NULL;
+    }
+}
+
+// __getPerfCounterName()
+// This function gets the name the perf tool uses for the event
+CHAR* __getPerfCounterName(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext, PERF_COUNTER_EVENT Event)
+{
+    // Names are the same for every context
+    (VOID)pPerfCounterContext;
+
+    switch (Event)
+    {
+    case PERF_COUNTER_CYCLES:           return "cycles";
+    case PERF_COUNTER_INSTRUCTIONS:     return "instructions";
+    case PERF_COUNTER_CACHE_MISSES:     return "cache-misses";
+    case PERF_COUNTER_BRANCH_MISSES:    return "branch-misses";
+    case PERF_COUNTER_DTLB_LOADS:       return "dTLB-loads";
+    case PERF_COUNTER_DTLB_LOAD_MISSES: return "dTLB-load-misses";
+    default:                            return "unknown";
+    }
+}
+
+// __addPerfCounter()
+// This function opens a counter for the event, disabled till the counters are started. Returns FALSE if
+// the event cant be counted here (no PMU in a VM, perf_event_paranoid, not Linux)
+BOOLEAN __addPerfCounter(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext, PERF_COUNTER_EVENT Event)
+{
+#if !defined(_MSC_VER)
+    struct perf_event_attr  PerfEventAttr;
+    INT                     Fd = -1;
+
+    if (pPerfCounterContext->NumCounters == PERF_COUNTER_MAX_EVENTS)
+    {
+        return FALSE;
+    }
+
+    memset(&PerfEventAttr, 0, sizeof(PerfEventAttr));
+    PerfEventAttr.size              = sizeof(PerfEventAttr);
+    PerfEventAttr.disabled          = 1;
+    PerfEventAttr.exclude_kernel    = 1;
+    PerfEventAttr.exclude_hv        = 1;
+    PerfEventAttr.read_format       = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (Event)
+    {
+    case PERF_COUNTER_CYCLES:
+        PerfEventAttr.type      = PERF_TYPE_HARDWARE;
+        PerfEventAttr.config    = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_COUNTER_INSTRUCTIONS:
+        PerfEventAttr.type      = PERF_TYPE_HARDWARE;
+        PerfEventAttr.config    = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_COUNTER_CACHE_MISSES:
+        PerfEventAttr.type      = PERF_TYPE_HARDWARE;
+        PerfEventAttr.config    = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PERF_COUNTER_BRANCH_MISSES:
+        PerfEventAttr.type      = PERF_TYPE_HARDWARE;
+        PerfEventAttr.config    = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    case PERF_COUNTER_DTLB_LOADS:
+        PerfEventAttr.type      = PERF_TYPE_HW_CACHE;
+        PerfEventAttr.config    = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16);
+        break;
+    case PERF_COUNTER_DTLB_LOAD_MISSES:
+        PerfEventAttr.type      = PERF_TYPE_HW_CACHE;
+        PerfEventAttr.config    = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    default:
+        return FALSE;
+    }
+
+    // This thread on any CPU
+    Fd = (INT)syscall(SYS_perf_event_open, &PerfEventAttr, 0, -1, -1, 0);
+    if (Fd < 0)
+    {
+        return FALSE;
+    }
+
+    pPerfCounterContext->CounterList[pPerfCounterContext->NumCounters].Event    = Event;
+    pPerfCounterContext->CounterList[pPerfCounterContext->NumCounters].Fd       = Fd;
+    pPerfCounterContext->CounterList[pPerfCounterContext->NumCounters].Value    = 0;
+    pPerfCounterContext->NumCounters++;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+// __startPerfCounters()
+// This function zeroes the counters and starts them
+VOID __startPerfCounters(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext)
+{
+#if !defined(_MSC_VER)
+    UINT    Index = 0;
+
+    for (Index = 0; Index < pPerfCounterContext->NumCounters; Index++)
+    {
+        pPerfCounterContext->CounterList[Index].Value = 0;
+        ioctl(pPerfCounterContext->CounterList[Index].Fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(pPerfCounterContext->CounterList[Index].Fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+// __stopPerfCounters()
+// This function stops the counters and reads their final values
+VOID __stopPerfCounters(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext)
+{
+#if !defined(_MSC_VER)
+    UINT    Index = 0;
+
+    for (Index = 0; Index < pPerfCounterContext->NumCounters; Index++)
+    {
+        ioctl(pPerfCounterContext->CounterList[Index].Fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+#endif
+
+    __readPerfCounters(pPerfCounterContext);
+}
+
+// __readPerfCounters()
+// This function reads the counters, running or not. A multiplexed count is scaled by the time it was enabled
+// over the time it really ran
+VOID __readPerfCounters(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext)
+{
+#if !defined(_MSC_VER)
+    ULONGLONG   ReadValueList[3];
+    UINT        Index = 0;
+
+    for (Index = 0; Index < pPerfCounterContext->NumCounters; Index++)
+    {
+        if (read(pPerfCounterContext->CounterList[Index].Fd, ReadValueList, sizeof(ReadValueList)) != sizeof(ReadValueList))
+        {
+            continue;
+        }
+
+        if (ReadValueList[2] && ReadValueList[2] < ReadValueList[1])
+        {
+            ReadValueList[0] = (ULONGLONG)((double)ReadValueList[0] * ReadValueList[1] / ReadValueList[2]);
+        }
+        pPerfCounterContext->CounterList[Index].Value = ReadValueList[0];
+    }
+#endif
+}
+
+// __getPerfCounterValue()
+// This function gets the value of the event at the last read, FALSE if the event has no counter
+BOOLEAN __getPerfCounterValue(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext, PERF_COUNTER_EVENT Event, ULONGLONG *pValue)
+{
+    UINT    Index = 0;
+
+    for (Index = 0; Index < pPerfCounterContext->NumCounters; Index++)
+    {
+        if (pPerfCounterContext->CounterList[Index].Event == Event)
+        {
+            *pValue = pPerfCounterContext->CounterList[Index].Value;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
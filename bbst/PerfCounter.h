@@ -0,0 +1,54 @@
+//
+// This file contains all the header definitions for
+// the hardware performance counters of the calling thread
+//
+
+#ifndef _PERF_COUNTER_H_
+#define _PERF_COUNTER_H_
+
+#include "Types.h"
+
+// Events that can be counted
+typedef enum _PERF_COUNTER_EVENT
+{
+    PERF_COUNTER_CYCLES,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_CACHE_MISSES,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_DTLB_LOADS,
+    PERF_COUNTER_DTLB_LOAD_MISSES,
+    PERF_COUNTER_MAX_EVENTS
+}PERF_COUNTER_EVENT;
+
+// Open counter of an event, Value is the count at the last read
+typedef struct _PERF_COUNTER
+{
+    PERF_COUNTER_EVENT  Event;
+    INT                 Fd;
+    ULONGLONG           Value;
+}PERF_COUNTER, *PPERF_COUNTER;
+
+// Perf Counter Context Definition
+// Counters are opened with perf_event_open for the calling thread, user mode only. An event the kernel or
+// the hardware doesnt have is not added, so the caller checks what addPerfCounter returns. When there are
+// more events than hardware counters the kernel multiplexes them, reads are scaled up to the whole time
+typedef struct _PERF_COUNTER_CONTEXT
+{
+    UINT            NumCounters;
+    PERF_COUNTER    CounterList[PERF_COUNTER_MAX_EVENTS];
+    struct _PERF_COUNTER_FN_TBL
+    {
+        BOOLEAN(*addPerfCounter)(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext, PERF_COUNTER_EVENT Event);
+        VOID(*startPerfCounters)(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext);
+        VOID(*stopPerfCounters)(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext);
+        VOID(*readPerfCounters)(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext);
+        BOOLEAN(*getPerfCounterValue)(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext, PERF_COUNTER_EVENT Event, ULONGLONG *pValue);
+        CHAR*(*getPerfCounterName)(struct _PERF_COUNTER_CONTEXT *pPerfCounterContext, PERF_COUNTER_EVENT Event);
+    }stPerfCounterFnTbl;
+}PERF_COUNTER_CONTEXT, *PPERF_COUNTER_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside PerfCounter.c
+PPERF_COUNTER_CONTEXT   createPerfCounterContext();
+VOID                    destroyPerfCounterContext(PPERF_COUNTER_CONTEXT *ppPerfCounterContext);
+#endif
@@ -0,0 +1,227 @@
+//
+// This file implements the LSD radix sort of the input events by ID. Every pass sorts on
+// one digit of the ID, threads count the digits of their slice and then scatter the slice
+// to the offsets worked out from all the counts. Sort is stable, so events with the same
+// ID end up next to each other and are merged in one pass at the end
+//
+
+#include "RadixSort.h"
+
+// Local Function Declarations
+UINT    __getRadixSortDigit(INT ID, UINT Shift);
+VOID*   __countRadixSortDigits(VOID *pArg);
+VOID*   __scatterRadixSortRecords(VOID *pArg);
+VOID    __runRadixSortThreads(PRADIX_SORT_THREAD_ARGS pThreadArgsList, UINT NumThreads, VOID*(*pThreadFn)(VOID *pArg));
+UINT    __getRadixSortNumCpus();
+UINT    __mergeRadixSortRecords(PRADIX_SORT_RECORD pRecordList, UINT NumRecords);
+
+
+// sortRadixSortRecords()
+// This function sorts the records by ID and merges the records with the same ID by adding up their counts.
+// NumThreads of 0 uses a thread per CPU. Returns the number of records left after the merge
+UINT sortRadixSortRecords(PRADIX_SORT_RECORD pRecordList, UINT NumRecords, UINT NumThreads)
+{
+    PRADIX_SORT_THREAD_ARGS pThreadArgsList = NULL;
+    PRADIX_SORT_RECORD      pSrcRecordList  = pRecordList;
+    PRADIX_SORT_RECORD      pDstRecordList  = NULL;
+    PRADIX_SORT_RECORD      pTempRecordList = NULL;
+    UINT                    Shift           = 0;
+    UINT                    Thread          = 0;
+    UINT                    Bucket          = 0;
+    UINT                    Offset          = 0;
+    UINT                    BucketCount     = 0;
+    BOOLEAN                 bSkipPass       = FALSE;
+
+    if (NumRecords < 2)
+    {
+        return NumRecords;
+    }
+
+    // Threads are not worth it for small slices
+    if (NumThreads == 0)
+    {
+        NumThreads = __getRadixSortNumCpus();
+    }
+    if (NumThreads > RADIX_SORT_MAX_THREADS)
+    {
+        NumThreads = RADIX_SORT_MAX_THREADS;
+    }
+    if (NumThreads > NumRecords / RADIX_SORT_MIN_THREAD_RECORDS)
+    {
+        NumThreads = NumRecords / RADIX_SORT_MIN_THREAD_RECORDS;
+    }
+    if (NumThreads == 0)
+    {
+        NumThreads = 1;
+    }
+
+    pDstRecordList  = (PRADIX_SORT_RECORD)malloc(sizeof(RADIX_SORT_RECORD) * NumRecords);
+    pThreadArgsList = (PRADIX_SORT_THREAD_ARGS)malloc(sizeof(RADIX_SORT_THREAD_ARGS) * NumThreads);
+
+    for (Thread = 0; Thread < NumThreads; Thread++)
+    {
+        pThreadArgsList[Thread].StartIndex  = (UINT)(((ULONGLONG)NumRecords * Thread) / NumThreads);
+        pThreadArgsList[Thread].EndIndex    = (UINT)(((ULONGLONG)NumRecords * (Thread + 1)) / NumThreads);
+    }
+
+    for (Shift = 0; Shift < 32; Shift += RADIX_SORT_DIGIT_BITS)
+    {
+        for (Thread = 0; Thread < NumThreads; Thread++)
+        {
+            pThreadArgsList[Thread].pSrcRecordList  = pSrcRecordList;
+            pThreadArgsList[Thread].pDstRecordList  = pDstRecordList;
+            pThreadArgsList[Thread].Shift           = Shift;
+        }
+
+        __runRadixSortThreads(pThreadArgsList, NumThreads, __countRadixSortDigits);
+
+        // Turn the counts into offsets, records of lower threads go first within a digit to keep the sort stable.
+        // A pass where all the records have the same digit would not move anything, skip it
+        Offset      = 0;
+        bSkipPass   = FALSE;
+        for (Bucket = 0; Bucket < RADIX_SORT_NUM_BUCKETS && !bSkipPass; Bucket++)
+        {
+            BucketCount = 0;
+            for (Thread = 0; Thread < NumThreads; Thread++)
+            {
+                BucketCount += pThreadArgsList[Thread].BucketList[Bucket];
+                pThreadArgsList[Thread].BucketList[Bucket] = Offset + BucketCount - pThreadArgsList[Thread].BucketList[Bucket];
+            }
+            Offset += BucketCount;
+            bSkipPass = (BucketCount == NumRecords);
+        }
+
+        if (bSkipPass)
+        {
+            continue;
+        }
+
+        __runRadixSortThreads(pThreadArgsList, NumThreads, __scatterRadixSortRecords);
+
+        pTempRecordList = pSrcRecordList;
+        pSrcRecordList  = pDstRecordList;
+        pDstRecordList  = pTempRecordList;
+    }
+
+    // Sorted records may have ended up in the scratch list
+    if (pSrcRecordList != pRecordList)
+    {
+        memcpy(pRecordList, pSrcRecordList, sizeof(RADIX_SORT_RECORD) * NumRecords);
+        pDstRecordList = pSrcRecordList;
+    }
+
+    free(pDstRecordList);
+    free(pThreadArgsList);
+
+    return __mergeRadixSortRecords(pRecordList, NumRecords);
+}
+
+// __getRadixSortDigit()
+// This function returns the digit of the ID at Shift. Sign bit is flipped so that negative IDs sort first
+UINT __getRadixSortDigit(INT ID, UINT Shift)
+{
+    return (((UINT)ID ^ 0x80000000U) >> Shift) & (RADIX_SORT_NUM_BUCKETS - 1);
+}
+
+// __countRadixSortDigits()
+// This is the thread function counting the records of the slice for each digit
+VOID* __countRadixSortDigits(VOID *pArg)
+{
+    PRADIX_SORT_THREAD_ARGS pThreadArgs = (PRADIX_SORT_THREAD_ARGS)pArg;
+    UINT                    Index       = 0;
+
+    memset(pThreadArgs->BucketList, 0, sizeof(pThreadArgs->BucketList));
+    for (Index = pThreadArgs->StartIndex; Index < pThreadArgs->EndIndex; Index++)
+    {
+        pThreadArgs->BucketList[__getRadixSortDigit(pThreadArgs->pSrcRecordList[Index].ID, pThreadArgs->Shift)]++;
+    }
+
+    return NULL;
+}
+
+// __scatterRadixSortRecords()
+// This is the thread function moving the records of the slice to the offsets of their digits
+VOID* __scatterRadixSortRecords(VOID *pArg)
+{
+    PRADIX_SORT_THREAD_ARGS pThreadArgs = (PRADIX_SORT_THREAD_ARGS)pArg;
+    UINT                    Index       = 0;
+
+    for (Index = pThreadArgs->StartIndex; Index < pThreadArgs->EndIndex; Index++)
+    {
+        pThreadArgs->pDstRecordList[pThreadArgs->BucketList[__getRadixSortDigit(pThreadArgs->pSrcRecordList[Index].ID, pThreadArgs->Shift)]++] =
+            pThreadArgs->pSrcRecordList[Index];
+    }
+
+    return NULL;
+}
+
+// __runRadixSortThreads()
+// This function runs the thread function for every slice and waits for all of them. The calling thread
+// takes the last slice. Without threads the slices are done one after the other
+VOID __runRadixSortThreads(PRADIX_SORT_THREAD_ARGS pThreadArgsList, UINT NumThreads, VOID*(*pThreadFn)(VOID *pArg))
+{
+    UINT        Thread = 0;
+#if !defined(_MSC_VER)
+    pthread_t   ThreadList[RADIX_SORT_MAX_THREADS];
+    BOOLEAN     bStartedList[RADIX_SORT_MAX_THREADS] = { 0 };
+
+    for (Thread = 0; Thread + 1 < NumThreads; Thread++)
+    {
+        bStartedList[Thread] = (pthread_create(&ThreadList[Thread], NULL, pThreadFn, &pThreadArgsList[Thread]) == 0);
+        if (!bStartedList[Thread])
+        {
+            pThreadFn(&pThreadArgsList[Thread]);
+        }
+    }
+    pThreadFn(&pThreadArgsList[NumThreads - 1]);
+
+    for (Thread = 0; Thread + 1 < NumThreads; Thread++)
+    {
+        if (bStartedList[Thread])
+        {
+            pthread_join(ThreadList[Thread], NULL);
+        }
+    }
+#else
+    for (Thread = 0; Thread < NumThreads; Thread++)
+    {
+        pThreadFn(&pThreadArgsList[Thread]);
+    }
+#endif
+}
+
+// __getRadixSortNumCpus()
+// This function returns the number of CPUs online
+UINT __getRadixSortNumCpus()
+{
+#if !defined(_MSC_VER)
+    LONGLONG    NumCpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return NumCpus > 0 ? (UINT)NumCpus : 1;
+#else
+    return 1;
+#endif
+}
+
+// __mergeRadixSortRecords()
+// This function merges the records with the same ID of a sorted list into the first of them, adding up
+// the counts. Returns the number of records left
+UINT __mergeRadixSortRecords(PRADIX_SORT_RECORD pRecordList, UINT NumRecords)
+{
+    UINT    Index       = 0;
+    UINT    NumMerged   = 1;
+
+    for (Index = 1; Index < NumRecords; Index++)
+    {
+        if (pRecordList[Index].ID == pRecordList[NumMerged - 1].ID)
+        {
+            pRecordList[NumMerged - 1].Count += pRecordList[Index].Count;
+        }
+        else
+        {
+            pRecordList[NumMerged++] = pRecordList[Index];
+        }
+    }
+
+    return NumMerged;
+}
@@ -0,0 +1,39 @@
+//
+// This file contains all the header definitions for
+// the multi threaded LSD radix sort of the input events by ID
+//
+
+#ifndef _RADIX_SORT_H_
+#define _RADIX_SORT_H_
+
+#include "Types.h"
+
+// Definitions
+#define RADIX_SORT_DIGIT_BITS           8
+#define RADIX_SORT_NUM_BUCKETS          (1 << RADIX_SORT_DIGIT_BITS)
+#define RADIX_SORT_MAX_THREADS          16
+#define RADIX_SORT_MIN_THREAD_RECORDS   (1 << 16)
+
+// Event read from the input file
+typedef struct _RADIX_SORT_RECORD
+{
+    INT     ID;
+    INT     Count;
+}RADIX_SORT_RECORD, *PRADIX_SORT_RECORD;
+
+// Slice of the records sorted by one thread. BucketList holds the number of records of the slice
+// for each digit, and then where the records with each digit go in the destination list
+typedef struct _RADIX_SORT_THREAD_ARGS
+{
+    PRADIX_SORT_RECORD  pSrcRecordList;
+    PRADIX_SORT_RECORD  pDstRecordList;
+    UINT                StartIndex;
+    UINT                EndIndex;
+    UINT                Shift;
+    UINT                BucketList[RADIX_SORT_NUM_BUCKETS];
+}RADIX_SORT_THREAD_ARGS, *PRADIX_SORT_THREAD_ARGS;
+
+// Funtion Prototypes
+// Following functions can be accessed outside RadixSort.c
+UINT    sortRadixSortRecords(PRADIX_SORT_RECORD pRecordList, UINT NumRecords, UINT NumThreads);
+#endif
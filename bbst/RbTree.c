@@ -8,21 +8,50 @@
 // Local Function Declarations
 PRB_TREE_NODE   __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count);
 VOID            __deleteRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
-PRB_TREE_NODE   __buildRbTreeNode(INT ID, INT Count);
+BOOLEAN         __insertFixupRbTreeNode(PRB_TREE_NODE *ppRootRbTreeNode, PRB_TREE_NODE pRbTreeNode);
 PRB_TREE_NODE   __findRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID);
-VOID            __freeRbTreeNode(PRB_TREE_NODE *ppRbTreeNode);
+VOID            __findRbTreeNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, INT *pIDList, UINT NumIDs, PRB_TREE_NODE *ppRbTreeNodeList);
+VOID            __freeRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE *ppRbTreeNode);
+VOID            __deleteRangeRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID1, INT ID2);
+VOID            __splitRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, UINT BlackHeight, INT ID, PRB_TREE_SPLIT pRbTreeSplit);
+PRB_TREE_NODE   __joinRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pLeftRbTreeNode, UINT LeftBlackHeight, PRB_TREE_NODE pMidRbTreeNode, PRB_TREE_NODE pRightRbTreeNode, UINT RightBlackHeight, UINT *pBlackHeight);
+PRB_TREE_NODE   __detachRbTreeNode(PRB_TREE_NODE pRbTreeNode, UINT BlackHeight, UINT *pBlackHeight);
+UINT            __getBlackHeightRbTreeNode(PRB_TREE_NODE pRbTreeNode);
+VOID            __dropRbTreeNodeList(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+VOID            __increaseRangeRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID1, INT ID2, INT Count);
+VOID            __increaseRangeRbTreeNodeList(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT ID1, INT ID2, INT Count, LONGLONG LowerBound, LONGLONG UpperBound);
+VOID            __addLazyRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count);
+VOID            __pushLazyRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+VOID            __pushLazyRbTreeNodePath(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
 VOID            __deleteDegree1RbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, PRB_TREE_NODE pChildRbTreeNode);
 PRB_TREE_NODE   __getNextIDRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
 PRB_TREE_NODE   __getPrevIDRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
 VOID            __initializeRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Length);
 VOID            __insertRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count, UINT Index);
 VOID            __initializeRbTree(struct _RB_TREE_CONTEXT *pRbTreeContext);
+VOID            __appendRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT StartIndex, UINT EndIndex);
 PRB_TREE_NODE   __sortedArrayToRbTree(PRB_TREE_CONTEXT pRbTreeContext, INT StartIndex, INT EndIndex, UINT Height);
+VOID            __rotateLeftRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+VOID            __rotateRightRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+VOID            __replaceRbTreeNodeChild(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pParentRbTreeNode, PRB_TREE_NODE pOldRbTreeNode, PRB_TREE_NODE pNewRbTreeNode);
+PRB_TREE_NODE   __findHotCacheRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID);
+VOID            __printRbTreeStats(struct _RB_TREE_CONTEXT *pRbTreeContext);
+PRB_TREE_NODE   __updateRbTreeNodeCount(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count);
+VOID            __updateSumRbTreeNode(PRB_TREE_NODE pRbTreeNode);
+VOID            __addSumRbTreeNodePath(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, LONGLONG Count, INT Size);
+VOID            __enableSumRbTree(PRB_TREE_CONTEXT pRbTreeContext);
+VOID            __buildSumRbTreeNodeList(PRB_TREE_NODE pRbTreeNode);
+LONGLONG        __getPrefixCountRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID);
+PRB_TREE_NODE   __selectCountRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, LONGLONG CountIndex);
+VOID            __selectCountRbTreeNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, LONGLONG *pCountIndexList, UINT NumIndexes, PRB_TREE_NODE *ppRbTreeNodeList);
+VOID            __selectCountRbTreeSubtree(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, LONGLONG *pCountIndexList, UINT NumIndexes, LONGLONG Offset, PRB_TREE_NODE *ppRbTreeNodeList);
+UINT            __getRankRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID);
+PRB_TREE_NODE   __selectRankRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Rank);
 
 
 // createRbTreeContext()
 // This function allocates memory for the context and initilize the variables and function pointers
-PRB_TREE_CONTEXT createRbTreeContext()
+PRB_TREE_CONTEXT createRbTreeContext(PRB_TREE_ARGS pRbTreeArgs)
 {
     PRB_TREE_CONTEXT    pRbTreeContext = NULL;
 
@@ -30,17 +59,96 @@ PRB_TREE_CONTEXT createRbTreeContext()
     pRbTreeContext = (PRB_TREE_CONTEXT)malloc(sizeof(RB_TREE_CONTEXT));
 
     // Initialize the variables
+    memset(pRbTreeContext, 0, sizeof(RB_TREE_CONTEXT));
+    pRbTreeContext->RbTreeArgs      = *pRbTreeArgs;
     pRbTreeContext->pRootRbTreeNode = NULL;
 
+    // Versions share nodes, which needs the parent pointer free nodes of the top down variant. Shared nodes
+    // are copied before a change, so pointers kept in the hash index or the hot cache would go stale
+    if (pRbTreeContext->RbTreeArgs.NumVersions)
+    {
+        pRbTreeContext->RbTreeArgs.bTopDown     = TRUE;
+        pRbTreeContext->RbTreeArgs.bHashIndex   = FALSE;
+        pRbTreeContext->RbTreeArgs.HotCacheSize = 0;
+    }
+
+    // Skip list nodes are read and changed by many threads without a lock, the hash index and the hot cache
+    // are not safe for that. Versions take the top down variant instead
+    if (pRbTreeContext->RbTreeArgs.bSkipList)
+    {
+        pRbTreeContext->RbTreeArgs.bSkipList    = (pRbTreeContext->RbTreeArgs.NumVersions == 0);
+        pRbTreeContext->RbTreeArgs.bHashIndex   = FALSE;
+        pRbTreeContext->RbTreeArgs.HotCacheSize = 0;
+    }
+
+    // Radix tree finds an event in 4 steps on its own, the hash index and the hot cache would only add upkeep
+    if (pRbTreeContext->RbTreeArgs.bArt)
+    {
+        pRbTreeContext->RbTreeArgs.bArt         = (pRbTreeContext->RbTreeArgs.NumVersions == 0 && !pRbTreeContext->RbTreeArgs.bSkipList);
+        pRbTreeContext->RbTreeArgs.bHashIndex   = FALSE;
+        pRbTreeContext->RbTreeArgs.HotCacheSize = 0;
+    }
+
+    // Hash index is optional, point lookups fall back to the tree when its not there
+    if (pRbTreeContext->RbTreeArgs.bHashIndex)
+    {
+        pRbTreeContext->pHashIndexContext = createHashIndexContext(HASH_INDEX_MIN_CAPACITY);
+    }
+
+    // Hot cache is a direct mapped table of node pointers, size is rounded up to a power of 2
+    if (pRbTreeContext->RbTreeArgs.HotCacheSize)
+    {
+        pRbTreeContext->HotCacheShift = 32;
+        while ((1U << (32 - pRbTreeContext->HotCacheShift)) < pRbTreeContext->RbTreeArgs.HotCacheSize)
+        {
+            pRbTreeContext->HotCacheShift--;
+        }
+        pRbTreeContext->pHotCacheTable = (PRB_TREE_HOT_CACHE_ENTRY)calloc((size_t)1 << (32 - pRbTreeContext->HotCacheShift), sizeof(RB_TREE_HOT_CACHE_ENTRY));
+    }
+
     // Initilize the function table
     pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode              = __insertRbTreeNode;
     pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode              = __deleteRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.deleteRangeRbTreeNode         = __deleteRangeRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.increaseRangeRbTreeNode       = __increaseRangeRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.updateRbTreeNodeCount         = __updateRbTreeNodeCount;
+    pRbTreeContext->stRbTreeFnTbl.commitRbTreeVersion           = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectRbTreeVersion           = NULL;
     pRbTreeContext->stRbTreeFnTbl.findRbTreeNode                = __findRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.findRbTreeNodeBatch           = __findRbTreeNodeBatch;
     pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode           = __getNextIDRbTreeNode;
     pRbTreeContext->stRbTreeFnTbl.getPrevIDRbTreeNode           = __getPrevIDRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.getPrefixCountRbTreeNode      = __getPrefixCountRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNode         = __selectCountRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNodeBatch    = __selectCountRbTreeNodeBatch;
+    pRbTreeContext->stRbTreeFnTbl.getRankRbTreeNode             = __getRankRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.selectRankRbTreeNode          = __selectRankRbTreeNode;
     pRbTreeContext->stRbTreeFnTbl.initializeRbTreeNodeArrayList = __initializeRbTreeNodeArrayList;
     pRbTreeContext->stRbTreeFnTbl.insertRbTreeNodeArrayList     = __insertRbTreeNodeArrayList;
     pRbTreeContext->stRbTreeFnTbl.initializeRbTree              = __initializeRbTree;
+    pRbTreeContext->stRbTreeFnTbl.appendRbTreeNodeArrayList     = __appendRbTreeNodeArrayList;
+    pRbTreeContext->stRbTreeFnTbl.printRbTreeStats              = __printRbTreeStats;
+
+    // Top down variant, the skip list and the radix tree replace the tree functions, hash index and hot cache are shared
+    if (pRbTreeContext->RbTreeArgs.bSkipList)
+    {
+        initializeSkipListFnTbl(pRbTreeContext);
+    }
+    else if (pRbTreeContext->RbTreeArgs.bArt)
+    {
+        initializeArtTreeFnTbl(pRbTreeContext);
+    }
+    else if (pRbTreeContext->RbTreeArgs.bTopDown)
+    {
+        initializeTdRbTreeFnTbl(pRbTreeContext);
+    }
+
+    // Node pool is shared with the other trees if one is given
+    pRbTreeContext->pNodePoolContext = pRbTreeContext->RbTreeArgs.pNodePoolContext;
+    if (pRbTreeContext->pNodePoolContext == NULL)
+    {
+        pRbTreeContext->pNodePoolContext = createRbTreeNodePoolContext(&pRbTreeContext->RbTreeArgs);
+    }
     
     return pRbTreeContext;
 }
@@ -51,12 +159,30 @@ VOID destroyRbTreeContext(PRB_TREE_CONTEXT *ppRbTreeContext)
 {
     if ((*ppRbTreeContext)->pRbTreeNodeArrayList)
     {
-        free((*ppRbTreeContext)->pRbTreeNodeArrayList);
+        __freeRbTreeArrayList(*ppRbTreeContext, (*ppRbTreeContext)->pRbTreeNodeArrayList);
         (*ppRbTreeContext)->pRbTreeNodeArrayList = NULL;
     }
 
     (*ppRbTreeContext)->pRootRbTreeNode = NULL;
 
+    destroyTdRbTree(*ppRbTreeContext);
+    destroySkipList(*ppRbTreeContext);
+    destroyArtTree(*ppRbTreeContext);
+
+    // A shared pool is destroyed by its owner after all the trees
+    if ((*ppRbTreeContext)->RbTreeArgs.pNodePoolContext == NULL)
+    {
+        destroyNodePoolContext(&(*ppRbTreeContext)->pNodePoolContext);
+    }
+
+    destroyHashIndexContext(&(*ppRbTreeContext)->pHashIndexContext);
+
+    if ((*ppRbTreeContext)->pHotCacheTable)
+    {
+        free((*ppRbTreeContext)->pHotCacheTable);
+        (*ppRbTreeContext)->pHotCacheTable = NULL;
+    }
+
     if (*ppRbTreeContext)
     {
         free(*ppRbTreeContext);
@@ -64,17 +190,69 @@ VOID destroyRbTreeContext(PRB_TREE_CONTEXT *ppRbTreeContext)
     }
 }
 
+// createRbTreeNodePoolContext()
+// This function creates a node pool for the nodes of the tree variant the args select, so that it
+// can be shared by trees created with the same args. Persistent trees always use the top down nodes
+PNODE_POOL_CONTEXT createRbTreeNodePoolContext(PRB_TREE_ARGS pRbTreeArgs)
+{
+    PNODE_POOL_CONTEXT  pNodePoolContext = NULL;
+
+    if (pRbTreeArgs->bTopDown || pRbTreeArgs->NumVersions)
+    {
+        pNodePoolContext = createNodePoolContext(sizeof(TD_RB_TREE_NODE), offsetof(TD_RB_TREE_NODE, pChild[TD_RB_TREE_LEFT]), offsetof(TD_RB_TREE_NODE, pChild[TD_RB_TREE_RIGHT]));
+    }
+    else
+    {
+        pNodePoolContext = createNodePoolContext(sizeof(RB_TREE_NODE), offsetof(RB_TREE_NODE, pLeftChild), offsetof(RB_TREE_NODE, pRightChild));
+    }
+
+    pNodePoolContext->pHugePageContext = pRbTreeArgs->pHugePageContext;
+    return pNodePoolContext;
+}
+
+// __allocateRbTreeArrayList()
+// This function allocates the memory of an array list, on huge pages if the tree has a huge page context
+VOID* __allocateRbTreeArrayList(PRB_TREE_CONTEXT pRbTreeContext, size_t Size)
+{
+    PHUGE_PAGE_CONTEXT  pHugePageContext = pRbTreeContext->RbTreeArgs.pHugePageContext;
+
+    if (pHugePageContext)
+    {
+        return pHugePageContext->stHugePageFnTbl.allocateHugePageMemory(pHugePageContext, Size);
+    }
+
+    return malloc(Size);
+}
+
+// __freeRbTreeArrayList()
+// This function frees the memory of an array list
+VOID __freeRbTreeArrayList(PRB_TREE_CONTEXT pRbTreeContext, VOID *pArrayList)
+{
+    PHUGE_PAGE_CONTEXT  pHugePageContext = pRbTreeContext->RbTreeArgs.pHugePageContext;
+
+    if (pHugePageContext)
+    {
+        pHugePageContext->stHugePageFnTbl.freeHugePageMemory(pHugePageContext, pArrayList);
+        return;
+    }
+
+    free(pArrayList);
+}
+
 // __buildRbTreeNode()
 // This function allocates and initializes the Rb Tree Node from ID and Count
-PRB_TREE_NODE __buildRbTreeNode(INT ID, INT Count)
+PRB_TREE_NODE __buildRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID, INT Count)
 {
     PRB_TREE_NODE   pRbTreeNode = NULL;
 
     // Build a temp node to be inserted in the Red Black Tree 
-    pRbTreeNode = (PRB_TREE_NODE)malloc(sizeof(RB_TREE_NODE));
+    pRbTreeNode = (PRB_TREE_NODE)pRbTreeContext->pNodePoolContext->stNodePoolFnTbl.allocateNode(pRbTreeContext->pNodePoolContext);
     pRbTreeNode->Count          = Count;
     pRbTreeNode->ID             = ID;
     pRbTreeNode->Color          = RED;
+    pRbTreeNode->Lazy           = 0;
+    pRbTreeNode->Size           = 1;
+    pRbTreeNode->Sum            = Count;
     pRbTreeNode->pLeftChild     = NULL;
     pRbTreeNode->pRightChild    = NULL;
     pRbTreeNode->pParent        = NULL;
@@ -89,17 +267,19 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
 {
     PRB_TREE_NODE   pNewRbTreeNode          = NULL;
     PRB_TREE_NODE   pTempRbTreeNode         = NULL;
-    PRB_TREE_NODE   pParentRbTreeNode       = NULL;
-    PRB_TREE_NODE   pGrandParentRbTreeNode  = NULL;
-    PRB_TREE_NODE   pUncleRbTreeNode        = NULL;
-    BOOLEAN         IsTempNodeLeftChild     = FALSE;
-    BOOLEAN         IsParentNodeLeftChild   = FALSE;
+
+    // Existing events are found through the hot cache or the hash index without walking down the tree
+    pTempRbTreeNode = __findFastPathRbTreeNode(pRbTreeContext, ID);
+    if (pTempRbTreeNode)
+    {
+        return __updateRbTreeNodeCount(pRbTreeContext, pTempRbTreeNode, Count);
+    }
 
     // First check if the node already exists or not
     if (pRbTreeContext->pRootRbTreeNode == NULL)
     {
         // Node doesnt exist! Build a node and add it to the root of the tree and return
-        pRbTreeContext->pRootRbTreeNode = __buildRbTreeNode(ID, Count);
+        pRbTreeContext->pRootRbTreeNode = __buildRbTreeNode(pRbTreeContext, ID, Count);
         pNewRbTreeNode = pRbTreeContext->pRootRbTreeNode;
     }
     else
@@ -108,12 +288,15 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
         pTempRbTreeNode = pRbTreeContext->pRootRbTreeNode;
         while (pTempRbTreeNode != NULL)
         {
+            // Pending deltas go down ahead of the walk, the path may get rotated below
+            __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
+
             if (ID == pTempRbTreeNode->ID)
             {
                 // Node already exists! 
                 // Add the Count to the existing Count of the Node and return 
-                pTempRbTreeNode->Count += Count;
-                return pTempRbTreeNode;
+                __updateHotCacheRbTreeNode(pRbTreeContext, ID, pTempRbTreeNode);
+                return __updateRbTreeNodeCount(pRbTreeContext, pTempRbTreeNode, Count);
             }
             else if (ID < pTempRbTreeNode->ID)
             {
@@ -124,7 +307,7 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
                 else
                 {
                     // Hit a leaf, Node doesnt exist! Build one and add it to the tree 
-                    pNewRbTreeNode = __buildRbTreeNode(ID, Count);
+                    pNewRbTreeNode = __buildRbTreeNode(pRbTreeContext, ID, Count);
                     pTempRbTreeNode->pLeftChild = pNewRbTreeNode;
                     pNewRbTreeNode->pParent = pTempRbTreeNode;
                     break;
@@ -139,7 +322,7 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
                 else
                 {
                     // Hit a leaf, Node doesnt exist! Build one and add it to the tree 
-                    pNewRbTreeNode = __buildRbTreeNode(ID, Count);
+                    pNewRbTreeNode = __buildRbTreeNode(pRbTreeContext, ID, Count);
                     pTempRbTreeNode->pRightChild = pNewRbTreeNode;
                     pNewRbTreeNode->pParent = pTempRbTreeNode;
                     break;
@@ -148,7 +331,35 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
         }
     }
 
+    // Keep the hash index in sync with the new node
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.insertHashIndexEntry(pRbTreeContext->pHashIndexContext, ID, pNewRbTreeNode);
+    }
+    __updateHotCacheRbTreeNode(pRbTreeContext, ID, pNewRbTreeNode);
+
+    // Every subtree on the path has the new event now
+    __addSumRbTreeNodePath(pRbTreeContext, pNewRbTreeNode->pParent, Count, 1);
+
     // Now time to restore to red black property for the tree!
+    __insertFixupRbTreeNode(&pRbTreeContext->pRootRbTreeNode, pNewRbTreeNode);
+
+    return pNewRbTreeNode;
+}
+
+// __insertFixupRbTreeNode()
+// This function restores the red black property after the red node pRbTreeNode was linked in the tree
+// with the given root. Returns TRUE if the black height of the tree went up by one, which happens
+// when the red is pushed up all the way to the root
+BOOLEAN __insertFixupRbTreeNode(PRB_TREE_NODE *ppRootRbTreeNode, PRB_TREE_NODE pRbTreeNode)
+{
+    PRB_TREE_NODE   pTempRbTreeNode         = NULL;
+    PRB_TREE_NODE   pParentRbTreeNode       = NULL;
+    PRB_TREE_NODE   pGrandParentRbTreeNode  = NULL;
+    PRB_TREE_NODE   pUncleRbTreeNode        = NULL;
+    BOOLEAN         IsTempNodeLeftChild     = FALSE;
+    BOOLEAN         IsParentNodeLeftChild   = FALSE;
+    BOOLEAN         bBlackHeightGrew        = FALSE;
 
     // Get the relationship between p, pp and gp and color of d
     // p - node to be added
@@ -160,16 +371,17 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
     //   Y - relationship between pp and gp (grandparent)
     //   z - color of node d (uncle)
 
-    // pNewRbTreeNode is the new node added
+    // pRbTreeNode is the new red node
     // Using pTempRbTreeNode for recursion
-    pTempRbTreeNode = pNewRbTreeNode;
+    pTempRbTreeNode = pRbTreeNode;
 
     do
     {
         // Case I : Node Inserted is Root or we have back traversed the tree till root, make it black and done
-        if (pTempRbTreeNode == pRbTreeContext->pRootRbTreeNode)
+        if (pTempRbTreeNode == *ppRootRbTreeNode)
         {
-            pRbTreeContext->pRootRbTreeNode->Color = BLACK;
+            bBlackHeightGrew = (pTempRbTreeNode->Color == RED);
+            pTempRbTreeNode->Color = BLACK;
             break;
         }
 
@@ -195,7 +407,6 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
             pGrandParentRbTreeNode->Color = RED;
             pUncleRbTreeNode->Color = BLACK;
 
-            pNewRbTreeNode = pTempRbTreeNode;
             pTempRbTreeNode = pGrandParentRbTreeNode;
             continue;
         }
@@ -224,7 +435,7 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
             else
             {
                 // Grandparent was the root 
-                pRbTreeContext->pRootRbTreeNode = pParentRbTreeNode;
+                *ppRootRbTreeNode = pParentRbTreeNode;
             }
 
             pGrandParentRbTreeNode->pLeftChild = pParentRbTreeNode->pRightChild;
@@ -233,6 +444,8 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
             pGrandParentRbTreeNode->pParent = pParentRbTreeNode;
             if (pGrandParentRbTreeNode->pLeftChild) pGrandParentRbTreeNode->pLeftChild->pParent = pGrandParentRbTreeNode;
 
+            __updateSumRbTreeNode(pGrandParentRbTreeNode);
+            __updateSumRbTreeNode(pParentRbTreeNode);
             break;
         }
 
@@ -258,7 +471,7 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
             else
             {
                 // Grandparent was the root 
-                pRbTreeContext->pRootRbTreeNode = pTempRbTreeNode;
+                *ppRootRbTreeNode = pTempRbTreeNode;
             }
 
             pParentRbTreeNode->pRightChild = pTempRbTreeNode->pLeftChild;
@@ -274,6 +487,9 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
             if (pParentRbTreeNode->pRightChild) pParentRbTreeNode->pRightChild->pParent = pParentRbTreeNode;
             if (pGrandParentRbTreeNode->pLeftChild) pGrandParentRbTreeNode->pLeftChild->pParent = pGrandParentRbTreeNode;
 
+            __updateSumRbTreeNode(pParentRbTreeNode);
+            __updateSumRbTreeNode(pGrandParentRbTreeNode);
+            __updateSumRbTreeNode(pTempRbTreeNode);
             break;
         }
 
@@ -299,7 +515,7 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
             else
             {
                 // Grandparent was the root 
-                pRbTreeContext->pRootRbTreeNode = pParentRbTreeNode;
+                *ppRootRbTreeNode = pParentRbTreeNode;
             }
 
             pGrandParentRbTreeNode->pRightChild = pParentRbTreeNode->pLeftChild;
@@ -308,6 +524,8 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
             pGrandParentRbTreeNode->pParent = pParentRbTreeNode;
             if (pGrandParentRbTreeNode->pRightChild) pGrandParentRbTreeNode->pRightChild->pParent = pGrandParentRbTreeNode;
 
+            __updateSumRbTreeNode(pGrandParentRbTreeNode);
+            __updateSumRbTreeNode(pParentRbTreeNode);
             break;
         }
 
@@ -333,7 +551,7 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
             else
             {
                 // Grandparent was the root 
-                pRbTreeContext->pRootRbTreeNode = pTempRbTreeNode;
+                *ppRootRbTreeNode = pTempRbTreeNode;
             }
 
             pParentRbTreeNode->pLeftChild = pTempRbTreeNode->pRightChild;
@@ -346,20 +564,23 @@ PRB_TREE_NODE __insertRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID
             pParentRbTreeNode->pParent = pTempRbTreeNode;
             pGrandParentRbTreeNode->pParent = pTempRbTreeNode;
 
-            if (pParentRbTreeNode->pRightChild) pParentRbTreeNode->pRightChild->pParent = pParentRbTreeNode;
-            if (pGrandParentRbTreeNode->pLeftChild) pGrandParentRbTreeNode->pLeftChild->pParent = pGrandParentRbTreeNode;
+            if (pParentRbTreeNode->pLeftChild) pParentRbTreeNode->pLeftChild->pParent = pParentRbTreeNode;
+            if (pGrandParentRbTreeNode->pRightChild) pGrandParentRbTreeNode->pRightChild->pParent = pGrandParentRbTreeNode;
 
+            __updateSumRbTreeNode(pParentRbTreeNode);
+            __updateSumRbTreeNode(pGrandParentRbTreeNode);
+            __updateSumRbTreeNode(pTempRbTreeNode);
             break;
         }
 
         // Phew !! 
         // Should never reach here, leave a print to catch the error 
-        printf("__insertRbTreeNode: Restoring Red Black Property, Illegal scenario, Exit!\r\n");
-        return NULL;
+        printf("__insertFixupRbTreeNode: Restoring Red Black Property, Illegal scenario, Exit!\r\n");
+        break;
 
     } while (TRUE);
 
-    return pNewRbTreeNode;;
+    return bBlackHeightGrew;
 }
 
 // __findRbTreeNode()
@@ -370,14 +591,28 @@ PRB_TREE_NODE __findRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID)
 {
     PRB_TREE_NODE    pTempRbTreeNode = NULL;
 
+    // Exact matches are answered by the hot cache or the hash index, the tree is walked only for the closest ID
+    pTempRbTreeNode = __findFastPathRbTreeNode(pRbTreeContext, ID);
+    if (pTempRbTreeNode)
+    {
+        return pTempRbTreeNode;
+    }
+
     if (pRbTreeContext->pRootRbTreeNode)
     {
         // Verifying that the root of the tree exists, now recurse!
         pTempRbTreeNode = pRbTreeContext->pRootRbTreeNode;
         while (TRUE)
         {
+            // Fold the pending deltas into the nodes on the way down
+            if (pTempRbTreeNode->Lazy)
+            {
+                __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
+            }
+
             if (ID == pTempRbTreeNode->ID)
             {
+                __updateHotCacheRbTreeNode(pRbTreeContext, ID, pTempRbTreeNode);
                 break;
             }
             else if (ID < pTempRbTreeNode->ID)
@@ -408,6 +643,97 @@ PRB_TREE_NODE __findRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID)
     return pTempRbTreeNode;
 }
 
+// __findFastPathRbTreeNode()
+// This function looks up the exact ID in the hot cache and then in the hash index
+// Returns NULL if the ID is not found there, the caller has to walk the tree then
+PRB_TREE_NODE __findFastPathRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID)
+{
+    PRB_TREE_NODE   pTempRbTreeNode = NULL;
+
+    // Hot events are answered by the hot cache
+    pTempRbTreeNode = __findHotCacheRbTreeNode(pRbTreeContext, ID);
+    if (pTempRbTreeNode == NULL && pRbTreeContext->pHashIndexContext)
+    {
+        pTempRbTreeNode = (PRB_TREE_NODE)pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.findHashIndexEntry(pRbTreeContext->pHashIndexContext, ID);
+        if (pTempRbTreeNode)
+        {
+            __updateHotCacheRbTreeNode(pRbTreeContext, ID, pTempRbTreeNode);
+        }
+    }
+
+    // Count of the node is not final while an ancestor has a pending delta, bring the deltas down
+    // the parents to it. The top down nodes have no parents but never get pending deltas
+    if (pTempRbTreeNode && pRbTreeContext->NumLazyTags)
+    {
+        __pushLazyRbTreeNodePath(pRbTreeContext, pTempRbTreeNode);
+    }
+
+    return pTempRbTreeNode;
+}
+
+// __findRbTreeNodeBatch()
+// This function does __findRbTreeNode for a list of IDs. The walks are interleaved in groups of
+// RB_TREE_MAX_BATCH_SIZE, every round moves each pending walk one level down and prefetches the
+// child it will read in the next round, so the cache misses of the different walks overlap
+VOID __findRbTreeNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, INT *pIDList, UINT NumIDs, PRB_TREE_NODE *ppRbTreeNodeList)
+{
+    UINT            PendingList[RB_TREE_MAX_BATCH_SIZE];
+    UINT            NumPending      = 0;
+    UINT            GroupStart      = 0;
+    UINT            Index           = 0;
+    UINT            Lane            = 0;
+    INT             ID              = 0;
+    PRB_TREE_NODE   pTempRbTreeNode = NULL;
+    PRB_TREE_NODE   pNextRbTreeNode = NULL;
+
+    for (GroupStart = 0; GroupStart < NumIDs; GroupStart += RB_TREE_MAX_BATCH_SIZE)
+    {
+        // Exact matches on the fast path are done right away, rest of the walks start at the root
+        for (Index = GroupStart; Index < NumIDs && Index < GroupStart + RB_TREE_MAX_BATCH_SIZE; Index++)
+        {
+            ppRbTreeNodeList[Index] = __findFastPathRbTreeNode(pRbTreeContext, pIDList[Index]);
+            if (ppRbTreeNodeList[Index] == NULL && pRbTreeContext->pRootRbTreeNode)
+            {
+                ppRbTreeNodeList[Index] = pRbTreeContext->pRootRbTreeNode;
+                PendingList[NumPending++] = Index;
+            }
+        }
+
+        // Round robin between the pending walks till all of them are done
+        while (NumPending)
+        {
+            for (Lane = 0; Lane < NumPending; )
+            {
+                Index = PendingList[Lane];
+                ID = pIDList[Index];
+                pTempRbTreeNode = ppRbTreeNodeList[Index];
+                __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
+
+                if (ID == pTempRbTreeNode->ID)
+                {
+                    __updateHotCacheRbTreeNode(pRbTreeContext, ID, pTempRbTreeNode);
+                    pNextRbTreeNode = NULL;
+                }
+                else
+                {
+                    pNextRbTreeNode = (ID < pTempRbTreeNode->ID) ? pTempRbTreeNode->pLeftChild : pTempRbTreeNode->pRightChild;
+                }
+
+                if (pNextRbTreeNode == NULL)
+                {
+                    // Walk is done, the node is either the ID or the closest one. Move the last pending walk in its lane
+                    PendingList[Lane] = PendingList[--NumPending];
+                    continue;
+                }
+
+                PREFETCH(pNextRbTreeNode);
+                ppRbTreeNodeList[Index] = pNextRbTreeNode;
+                Lane++;
+            }
+        }
+    }
+}
+
 // __deleteRbTreeNode()
 // This function deletes the Rb Tree node in the Red black Tree. It assumes that the node is already present in the 
 // tree. It checks if the node to be removed was degree 0/1/2 and then adjusts the pointers to call delete 
@@ -415,17 +741,31 @@ PRB_TREE_NODE __findRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID)
 VOID __deleteRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
 {
     PRB_TREE_NODE   pMaxSubTreeRbTreeNode   = NULL;
+    PRB_TREE_NODE   pTempRbTreeNode         = NULL;
     RB_TREE_NODE    TempRbTreeNode          = { 0 };
 
+    // Drop the event from the hash index and the hot cache first, node may get a different ID below
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.deleteHashIndexEntry(pRbTreeContext->pHashIndexContext, pRbTreeNode->ID);
+    }
+    __updateHotCacheRbTreeNode(pRbTreeContext, pRbTreeNode->ID, NULL);
+
+    // Node was found by walking down, so its ancestors have no pending delta. Push its own
+    // before the children move
+    __pushLazyRbTreeNode(pRbTreeContext, pRbTreeNode);
+
     // Check if its a degree 0/1/2 node
     if (pRbTreeNode->pLeftChild && pRbTreeNode->pRightChild)
     {
         // Degree 2 Node
         // Convert this to a degree 0 or degree 1 node by replacing with the largest node in the left subtree 
         pMaxSubTreeRbTreeNode = pRbTreeNode->pLeftChild;
+        __pushLazyRbTreeNode(pRbTreeContext, pMaxSubTreeRbTreeNode);
         while (pMaxSubTreeRbTreeNode->pRightChild != NULL)
         {
             pMaxSubTreeRbTreeNode = pMaxSubTreeRbTreeNode->pRightChild;
+            __pushLazyRbTreeNode(pRbTreeContext, pMaxSubTreeRbTreeNode);
         }
         
         // Exchange the nodes and preserve the color
@@ -436,9 +776,25 @@ VOID __deleteRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE p
         pRbTreeNode->ID                 = TempRbTreeNode.ID;
         pRbTreeNode->Count              = TempRbTreeNode.Count;
 
+        // Subtrees between the two nodes have the count of the deleted event in place of the exchanged one now
+        for (pTempRbTreeNode = pMaxSubTreeRbTreeNode->pParent; pRbTreeContext->bSubtreeSums && pTempRbTreeNode != pRbTreeNode; pTempRbTreeNode = pTempRbTreeNode->pParent)
+        {
+            pTempRbTreeNode->Sum += (LONGLONG)pMaxSubTreeRbTreeNode->Count - pRbTreeNode->Count;
+        }
+
+        // The exchanged event now lives in this node
+        if (pRbTreeContext->pHashIndexContext)
+        {
+            pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.insertHashIndexEntry(pRbTreeContext->pHashIndexContext, pRbTreeNode->ID, pRbTreeNode);
+        }
+        __updateHotCacheRbTreeNode(pRbTreeContext, pRbTreeNode->ID, pRbTreeNode);
+
         // Now check whether this is a Degree 0 or Degree 1 node
         pRbTreeNode = pMaxSubTreeRbTreeNode;
     }
+
+    // Take the event out of the subtrees above the node before it is unlinked, rebalancing keeps the rest
+    __addSumRbTreeNodePath(pRbTreeContext, pRbTreeNode->pParent, -(LONGLONG)pRbTreeNode->Count, -1);
     
     // Degree 2 nodes after exchange will also enter here
     if (pRbTreeNode->pLeftChild && !pRbTreeNode->pRightChild)
@@ -499,459 +855,607 @@ VOID __deleteRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE p
 }
 
 // __freeRbTreeNode()
-// This function frees up the memory for a Red Black Tree Node
-VOID __freeRbTreeNode(PRB_TREE_NODE *ppRbTreeNode)
+// This function gives a Red Black Tree Node back to the node pool
+VOID __freeRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE *ppRbTreeNode)
 {
     // Make the pointers NULL and free up the Tree Node pointer 
     if (*ppRbTreeNode)
     {
-        (*ppRbTreeNode)->pLeftChild     = NULL;
-        (*ppRbTreeNode)->pRightChild    = NULL;
         (*ppRbTreeNode)->pParent        = NULL;
 
-        // Dont free the memory it will be done while clearing the Array List
+        // Nodes of the Array List go to the pool as well, the list itself is freed with the context
+        pRbTreeContext->pNodePoolContext->stNodePoolFnTbl.freeNode(pRbTreeContext->pNodePoolContext, *ppRbTreeNode);
         *ppRbTreeNode = NULL;
     }
 }
 
 // __deleteDegree1RbTreeNode()
 // This function implements all the scenarios and rebalances the red black tree preserving the properties.
+// The node has already been unlinked from its parent and replaced by pChildRbTreeNode (y), which can be NULL
 VOID __deleteDegree1RbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, PRB_TREE_NODE pChildRbTreeNode)
 {
-    PRB_TREE_NODE   pTempRbTreeNode                         = NULL;
-    PRB_TREE_NODE   pSiblingRbTreeNode                      = NULL;
-    PRB_TREE_NODE   pParentRbTreeNode                       = NULL;
-    PRB_TREE_NODE   pSiblingRedChildRbTreeNode              = NULL;
-    PRB_TREE_NODE   pSiblingRightChildRbTreeNode            = NULL;
-    PRB_TREE_NODE   pSiblingRightChildRedChildRbTreeNode    = NULL;
-    PRB_TREE_NODE   pSiblingLeftChildRedChildRbTreeNode     = NULL;
-    PRB_TREE_NODE   pSiblingLeftChildRbTreeNode             = NULL;
-    BOOLEAN         IsTempNodeLeftChild                     = FALSE;
-    UINT            NumSiblingRedChildren                   = 0;
-    UINT            NumSiblingRightChildRedChildren         = 0;
-    UINT            NumSiblingLeftChildRedChildren          = 0;
-    
+    PRB_TREE_NODE   pTempRbTreeNode         = NULL;
+    PRB_TREE_NODE   pSiblingRbTreeNode      = NULL;
+    PRB_TREE_NODE   pParentRbTreeNode       = NULL;
+    BOOLEAN         IsTempNodeLeftChild     = FALSE;
+
+    pParentRbTreeNode = pRbTreeNode->pParent;
+
+    // Removed node was the root, its child is the new root 
+    if (pParentRbTreeNode == NULL)
+    {
+        pRbTreeContext->pRootRbTreeNode = pChildRbTreeNode;
+    }
+
     // if removed node is red, free up the node and done! 
     // else define y or pChildRbTreeNode to be root of the deficient subtree and 
     // py to be the parent of y
     if (pRbTreeNode->Color == RED)
     {
-        __freeRbTreeNode(&pRbTreeNode);
+        __freeRbTreeNode(pRbTreeContext, &pRbTreeNode);
+        return;
     }
-    else
+
+    // Decide which side of py the deficient subtree hangs on, y can be NULL when a black leaf was removed
+    // in which case the sibling is the only child left with py
+    if (pChildRbTreeNode)
     {
-        // Special case when y is NULL 
-        if (pChildRbTreeNode == NULL)
-        {
-            pParentRbTreeNode = pRbTreeNode->pParent;
+        IsTempNodeLeftChild = (pParentRbTreeNode && pParentRbTreeNode->pLeftChild == pChildRbTreeNode) ? TRUE : FALSE;
+    }
+    else if (pParentRbTreeNode)
+    {
+        IsTempNodeLeftChild = (pParentRbTreeNode->pLeftChild == NULL) ? TRUE : FALSE;
+    }
 
-            if (pParentRbTreeNode == NULL)
+    __freeRbTreeNode(pRbTreeContext, &pRbTreeNode);
+
+    // Simple case handled first
+    // removed node is black, but y is red, color this node black and done!
+    // Complex Case, Both the node removed and Child (y) were black, y can be NULL as well
+    pTempRbTreeNode = pChildRbTreeNode;
+    while ((pTempRbTreeNode == NULL || pTempRbTreeNode->Color == BLACK) && pParentRbTreeNode != NULL)
+    {
+        // Notation Xcn where 
+        // X is the relationship between Temp and Parent - IsTempNodeLeftChild 
+        // c defines the color of Sibling v
+        // n is the num of red children of sibling
+        pSiblingRbTreeNode = IsTempNodeLeftChild ? pParentRbTreeNode->pRightChild : pParentRbTreeNode->pLeftChild;
+
+        // Rr/Lr, Sibling is red
+        // Rotate at py so that the deficient subtree gets a black sibling, then fall into the black sibling cases
+        if (pSiblingRbTreeNode->Color == RED)
+        {
+            pSiblingRbTreeNode->Color = BLACK;
+            pParentRbTreeNode->Color = RED;
+            if (IsTempNodeLeftChild)
+            {
+                __rotateLeftRbTreeNode(pRbTreeContext, pParentRbTreeNode);
+                pSiblingRbTreeNode = pParentRbTreeNode->pRightChild;
+            }
+            else
             {
-                // Looks like removed node was the root and the only node
-                // Nothing to be done 
-                pRbTreeContext->pRootRbTreeNode = NULL;
-                return;
+                __rotateRightRbTreeNode(pRbTreeContext, pParentRbTreeNode);
+                pSiblingRbTreeNode = pParentRbTreeNode->pLeftChild;
             }
         }
 
-        __freeRbTreeNode(&pRbTreeNode);
-
-        // Simple case handled first
-        // removed node is black, but y is red
-        if (pChildRbTreeNode && pChildRbTreeNode->Color == RED)
+        // Rb0/Lb0
+        if ((pSiblingRbTreeNode->pLeftChild == NULL || pSiblingRbTreeNode->pLeftChild->Color == BLACK) &&
+            (pSiblingRbTreeNode->pRightChild == NULL || pSiblingRbTreeNode->pRightChild->Color == BLACK))
         {
-            // Color this node black and done! 
-            pChildRbTreeNode->Color = BLACK;
+            // Change the Color of Sibling to red and now Parent is the new root of deficient sub tree 
+            // If the parent was red, coloring it black after the loop is done
+            pSiblingRbTreeNode->Color = RED;
+            pTempRbTreeNode = pParentRbTreeNode;
+            pParentRbTreeNode = pTempRbTreeNode->pParent;
+            if (pParentRbTreeNode)
+            {
+                IsTempNodeLeftChild = (pParentRbTreeNode->pLeftChild == pTempRbTreeNode) ? TRUE : FALSE;
+            }
+            continue;
+        }
 
-            if (pChildRbTreeNode->pParent == NULL)
+        if (!IsTempNodeLeftChild)
+        {
+            // Rb1 case 2 Sibling's right child is red and left child is black
+            // Convert it to Rb1 case 1 by rotating at the sibling first, this makes it an LR rotation
+            if (pSiblingRbTreeNode->pLeftChild == NULL || pSiblingRbTreeNode->pLeftChild->Color == BLACK)
             {
-                pRbTreeContext->pRootRbTreeNode = pChildRbTreeNode;
+                pSiblingRbTreeNode->pRightChild->Color = BLACK;
+                pSiblingRbTreeNode->Color = RED;
+                __rotateLeftRbTreeNode(pRbTreeContext, pSiblingRbTreeNode);
+                pSiblingRbTreeNode = pParentRbTreeNode->pLeftChild;
             }
+
+            // Rb1 case 1 Sibling's left child is Red or Rb2, this will lead to an LL rotation
+            pSiblingRbTreeNode->Color = pParentRbTreeNode->Color;
+            pParentRbTreeNode->Color = BLACK;
+            pSiblingRbTreeNode->pLeftChild->Color = BLACK;
+            __rotateRightRbTreeNode(pRbTreeContext, pParentRbTreeNode);
         }
         else
         {
-            // Complex Case, Both the node removed and Child (y) were black
-            // Child can be NULL as well
-            pTempRbTreeNode = pChildRbTreeNode;
-            do
+            // Lb1 case 2 Sibling's left child is red and right child is black
+            // Convert it to Lb1 case 1 by rotating at the sibling first, this makes it an RL rotation
+            if (pSiblingRbTreeNode->pRightChild == NULL || pSiblingRbTreeNode->pRightChild->Color == BLACK)
             {
-                // if y is the root, then the entire tree is deficient, so done
-                if (pTempRbTreeNode && pTempRbTreeNode->pParent == NULL)
-                {
-                    pRbTreeContext->pRootRbTreeNode = pTempRbTreeNode;
-                    break;
-                }
-
-                // Storing some values to decide case 
-                if (pTempRbTreeNode)
-                {
-                    pParentRbTreeNode = pTempRbTreeNode->pParent;
-                    pSiblingRbTreeNode = (pTempRbTreeNode->pParent->pLeftChild == pTempRbTreeNode) ? pTempRbTreeNode->pRightChild : pTempRbTreeNode->pLeftChild;;
-                    IsTempNodeLeftChild = (pTempRbTreeNode->pParent->pLeftChild == pTempRbTreeNode) ? TRUE : FALSE;
-                }
-                else
-                {
-                    // This would be a case where black leaf is being removed
-                    // Assuming this would happen only in the first iteration
-                    // pParentRbTreeNode is already defined
-                    // 
-                    if (pParentRbTreeNode->pLeftChild != NULL)
-                    {
-                        pSiblingRbTreeNode = pParentRbTreeNode->pLeftChild;
-                        IsTempNodeLeftChild = FALSE;
-                    }
-                    else if (pParentRbTreeNode->pRightChild != NULL)
-                    {
-                        pSiblingRbTreeNode = pParentRbTreeNode->pRightChild;
-                        IsTempNodeLeftChild = TRUE;
-                    }
-                    else
-                    {
-                        // No Sibling! 
-                        // Is this possible ? Need to check! 
-                    }
-                }
-                
-                // Assuming the sibling always exists
-                if (pSiblingRbTreeNode->pLeftChild && pSiblingRbTreeNode->pLeftChild->Color == RED &&
-                    pSiblingRbTreeNode->pRightChild && pSiblingRbTreeNode->pRightChild->Color == RED)
-                {
-                    NumSiblingRedChildren = 2;
-                }
-                else if ((pSiblingRbTreeNode->pLeftChild && pSiblingRbTreeNode->pLeftChild->Color == RED) ||
-                    (pSiblingRbTreeNode->pRightChild && pSiblingRbTreeNode->pRightChild->Color == RED))
-                {
-                    NumSiblingRedChildren = 1;
-                }
-                else
-                {
-                    NumSiblingRedChildren = 0;
-                }
-                
-                // Notation Xcn where 
-                // X is the relationship between Temp and Parent - IsTempNodeLeftChild 
-                // c defines the color of Sibling
-                // n is the num of red children of sibling - NumSiblingRedChildren
+                pSiblingRbTreeNode->pLeftChild->Color = BLACK;
+                pSiblingRbTreeNode->Color = RED;
+                __rotateRightRbTreeNode(pRbTreeContext, pSiblingRbTreeNode);
+                pSiblingRbTreeNode = pParentRbTreeNode->pRightChild;
+            }
 
-                // Lets begin !!! 
+            // Lb1 case 1 Sibling's right child is Red or Lb2, this will lead to an RR rotation
+            pSiblingRbTreeNode->Color = pParentRbTreeNode->Color;
+            pParentRbTreeNode->Color = BLACK;
+            pSiblingRbTreeNode->pRightChild->Color = BLACK;
+            __rotateLeftRbTreeNode(pRbTreeContext, pParentRbTreeNode);
+        }
 
-                // Rb0/Lb0 and Parent is BLACK
-                if (pSiblingRbTreeNode->Color == BLACK && NumSiblingRedChildren == 0 && pParentRbTreeNode->Color == BLACK)
-                {
-                    // Change the Color of Sibling to red and now Parent is the new root of deficient sub tree 
-                    pSiblingRbTreeNode->Color = RED;
-                    pTempRbTreeNode = pParentRbTreeNode;
+        // Subtree is no longer deficient, done!
+        pTempRbTreeNode = pRbTreeContext->pRootRbTreeNode;
+        break;
+    }
 
-                    continue;
-                }
+    // Either y is red or y is the root, color it black and done! 
+    if (pTempRbTreeNode)
+    {
+        pTempRbTreeNode->Color = BLACK;
+    }
+}
 
-                // Rb0/Lb0 and Parent is RED
-                if (pSiblingRbTreeNode->Color == BLACK && NumSiblingRedChildren == 0 && pParentRbTreeNode->Color == RED)
-                {
-                    // Flip the colors of Sibling and parent, and done! 
-                    pSiblingRbTreeNode->Color = RED;
-                    pParentRbTreeNode->Color = BLACK;
+// __rotateLeftRbTreeNode()
+// This function rotates the subtree rooted at the node to the left, the right child of the node takes its place
+VOID __rotateLeftRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    PRB_TREE_NODE   pRightRbTreeNode = pRbTreeNode->pRightChild;
 
-                    break;
-                }
+    // Subtrees below the two nodes change, so their pending deltas have to go down first
+    __pushLazyRbTreeNode(pRbTreeContext, pRbTreeNode);
+    __pushLazyRbTreeNode(pRbTreeContext, pRightRbTreeNode);
 
-                // Rb1 case 1 Sibling's left child is Red
-                if (!IsTempNodeLeftChild && pSiblingRbTreeNode->Color == BLACK && NumSiblingRedChildren == 1 && 
-                    pSiblingRbTreeNode->pLeftChild && pSiblingRbTreeNode->pLeftChild->Color == RED)
-                {
-                    // This will lead to an LL rotation
-                    pSiblingRbTreeNode->pLeftChild->Color = BLACK;
+    pRbTreeNode->pRightChild = pRightRbTreeNode->pLeftChild;
+    if (pRbTreeNode->pRightChild) pRbTreeNode->pRightChild->pParent = pRbTreeNode;
 
-                    pParentRbTreeNode->pLeftChild = pSiblingRbTreeNode->pRightChild;
-                    pSiblingRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pSiblingRbTreeNode->pRightChild = pParentRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingRbTreeNode;
-                    if (pParentRbTreeNode->pLeftChild) pParentRbTreeNode->pLeftChild->pParent = pParentRbTreeNode;
+    __replaceRbTreeNodeChild(pRbTreeContext, pRbTreeNode->pParent, pRbTreeNode, pRightRbTreeNode);
 
-                    if (pSiblingRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingRbTreeNode;
-                    }
+    pRightRbTreeNode->pLeftChild = pRbTreeNode;
+    pRbTreeNode->pParent = pRightRbTreeNode;
 
-                    break;
-                }
+    __updateSumRbTreeNode(pRbTreeNode);
+    __updateSumRbTreeNode(pRightRbTreeNode);
+}
 
-                // Lb1 case 1 Sibling's Right child is Red
-                if (IsTempNodeLeftChild && pSiblingRbTreeNode->Color == BLACK && NumSiblingRedChildren == 1 && 
-                    pSiblingRbTreeNode->pRightChild && pSiblingRbTreeNode->pRightChild->Color == RED)
-                {
-                    // This will lead to an RR rotation
-                    pSiblingRbTreeNode->pRightChild->Color = BLACK;
+// __rotateRightRbTreeNode()
+// This function rotates the subtree rooted at the node to the right, the left child of the node takes its place
+VOID __rotateRightRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    PRB_TREE_NODE   pLeftRbTreeNode = pRbTreeNode->pLeftChild;
 
-                    pParentRbTreeNode->pRightChild = pSiblingRbTreeNode->pLeftChild;
-                    pSiblingRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pSiblingRbTreeNode->pLeftChild = pParentRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingRbTreeNode;
-                    if (pParentRbTreeNode->pRightChild) pParentRbTreeNode->pRightChild->pParent = pParentRbTreeNode;
+    // Subtrees below the two nodes change, so their pending deltas have to go down first
+    __pushLazyRbTreeNode(pRbTreeContext, pRbTreeNode);
+    __pushLazyRbTreeNode(pRbTreeContext, pLeftRbTreeNode);
 
-                    if (pSiblingRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingRbTreeNode;
-                    }
+    pRbTreeNode->pLeftChild = pLeftRbTreeNode->pRightChild;
+    if (pRbTreeNode->pLeftChild) pRbTreeNode->pLeftChild->pParent = pRbTreeNode;
 
-                    break;
-                }
+    __replaceRbTreeNodeChild(pRbTreeContext, pRbTreeNode->pParent, pRbTreeNode, pLeftRbTreeNode);
 
-                // Rb1 case 2 Sibling's right child is red or Rb2
-                if ((!IsTempNodeLeftChild && pSiblingRbTreeNode->Color == BLACK && NumSiblingRedChildren == 1 && 
-                    pSiblingRbTreeNode->pRightChild && pSiblingRbTreeNode->pRightChild->Color == RED) ||
-                     (!IsTempNodeLeftChild && pSiblingRbTreeNode->Color == BLACK && NumSiblingRedChildren == 2))
-                {
-                    // This will lead to a LR Rotation
-                    pSiblingRbTreeNode->pRightChild->Color = pParentRbTreeNode->Color;
-                    pParentRbTreeNode->Color = BLACK;
-
-                    pSiblingRedChildRbTreeNode = pSiblingRbTreeNode->pRightChild;
-                    pSiblingRedChildRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pSiblingRbTreeNode->pRightChild = pSiblingRedChildRbTreeNode->pLeftChild;
-                    pParentRbTreeNode->pLeftChild = pSiblingRedChildRbTreeNode->pRightChild;
-                    pSiblingRedChildRbTreeNode->pLeftChild = pSiblingRbTreeNode;
-                    pSiblingRedChildRbTreeNode->pRightChild = pParentRbTreeNode;
-                    if (pSiblingRbTreeNode->pRightChild) pSiblingRbTreeNode->pRightChild->pParent = pSiblingRbTreeNode;
-                    if (pParentRbTreeNode->pLeftChild) pParentRbTreeNode->pLeftChild->pParent = pParentRbTreeNode;
-                    pSiblingRbTreeNode->pParent = pSiblingRedChildRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingRedChildRbTreeNode;
-
-                    if (pSiblingRedChildRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingRedChildRbTreeNode;
-                    }
-                    
-                    break;
-                }
+    pLeftRbTreeNode->pRightChild = pRbTreeNode;
+    pRbTreeNode->pParent = pLeftRbTreeNode;
 
-                // Lb1 case 2 Sibling's left child is red or Lb2
-                if ((IsTempNodeLeftChild && pSiblingRbTreeNode->Color == BLACK && NumSiblingRedChildren == 1 && 
-                    pSiblingRbTreeNode->pLeftChild && pSiblingRbTreeNode->pLeftChild->Color == RED) ||
-                    (IsTempNodeLeftChild && pSiblingRbTreeNode->Color ==BLACK && NumSiblingRedChildren == 2))
-                {
-                    // This will lead to a RL Rotation
-                    if (pSiblingRbTreeNode->pLeftChild) pSiblingRbTreeNode->pLeftChild->Color = pParentRbTreeNode->Color;
-                    pParentRbTreeNode->Color = BLACK;
-
-                    pSiblingRedChildRbTreeNode = pSiblingRbTreeNode->pLeftChild;
-                    pSiblingRedChildRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pSiblingRbTreeNode->pLeftChild = pSiblingRedChildRbTreeNode->pRightChild;
-                    pParentRbTreeNode->pRightChild = pSiblingRedChildRbTreeNode->pLeftChild;
-                    pSiblingRedChildRbTreeNode->pRightChild = pSiblingRbTreeNode;
-                    pSiblingRedChildRbTreeNode->pLeftChild = pParentRbTreeNode;
-                    if (pSiblingRbTreeNode->pLeftChild) pSiblingRbTreeNode->pLeftChild->pParent = pSiblingRbTreeNode;
-                    if (pParentRbTreeNode->pRightChild) pParentRbTreeNode->pRightChild->pParent = pParentRbTreeNode;
-                    pSiblingRbTreeNode->pParent = pSiblingRedChildRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingRedChildRbTreeNode;
-
-                    if (pSiblingRedChildRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingRedChildRbTreeNode;
-                    }
+    __updateSumRbTreeNode(pRbTreeNode);
+    __updateSumRbTreeNode(pLeftRbTreeNode);
+}
 
-                    break;
-                }
+// __replaceRbTreeNodeChild()
+// This function makes pNewRbTreeNode take the place of pOldRbTreeNode under the parent, or at the root
+// of the tree if the parent is NULL
+VOID __replaceRbTreeNodeChild(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pParentRbTreeNode, PRB_TREE_NODE pOldRbTreeNode, PRB_TREE_NODE pNewRbTreeNode)
+{
+    if (pParentRbTreeNode == NULL)
+    {
+        pRbTreeContext->pRootRbTreeNode = pNewRbTreeNode;
+    }
+    else if (pParentRbTreeNode->pLeftChild == pOldRbTreeNode)
+    {
+        pParentRbTreeNode->pLeftChild = pNewRbTreeNode;
+    }
+    else
+    {
+        pParentRbTreeNode->pRightChild = pNewRbTreeNode;
+    }
 
-                // Now if the color of the Sibling is red, then define it as 
-                // Rrn where n is the number of red children of v's right child
-                // Lrn where n is the number of red children of v's left child
-                if (!IsTempNodeLeftChild)
-                {
-                    if (pSiblingRbTreeNode->pRightChild)
-                    {
-                        if (pSiblingRbTreeNode->pRightChild->pLeftChild && pSiblingRbTreeNode->pRightChild->pLeftChild->Color == RED &&
-                            pSiblingRbTreeNode->pRightChild->pRightChild && pSiblingRbTreeNode->pRightChild->pRightChild->Color == RED)
-                        {
-                            NumSiblingRightChildRedChildren = 2;
-                        }
-                        else if ((pSiblingRbTreeNode->pRightChild->pLeftChild && pSiblingRbTreeNode->pRightChild->pLeftChild->Color == RED) ||
-                            (pSiblingRbTreeNode->pRightChild->pRightChild && pSiblingRbTreeNode->pRightChild->pRightChild->Color == RED))
-                        {
-                            NumSiblingRightChildRedChildren = 1;
-                        }
-                        else
-                        {
-                            NumSiblingRightChildRedChildren = 0;
-                        }
-                    }
-                }
-                else
-                {
-                    if (pSiblingRbTreeNode->pLeftChild)
-                    {
-                        if (pSiblingRbTreeNode->pLeftChild->pLeftChild && pSiblingRbTreeNode->pLeftChild->pLeftChild->Color == RED &&
-                            pSiblingRbTreeNode->pLeftChild->pRightChild && pSiblingRbTreeNode->pLeftChild->pRightChild->Color == RED)
-                        {
-                            NumSiblingLeftChildRedChildren = 2;
-                        }
-                        else if ((pSiblingRbTreeNode->pLeftChild->pLeftChild && pSiblingRbTreeNode->pLeftChild->pLeftChild->Color == RED) ||
-                            (pSiblingRbTreeNode->pLeftChild->pRightChild && pSiblingRbTreeNode->pLeftChild->pRightChild->Color == RED))
-                        {
-                            NumSiblingLeftChildRedChildren = 1;
-                        }
-                        else
-                        {
-                            NumSiblingLeftChildRedChildren = 0;
-                        }
-                    }
-                }
+    if (pNewRbTreeNode)
+    {
+        pNewRbTreeNode->pParent = pParentRbTreeNode;
+    }
+}
 
-                // Rr0 
-                if (!IsTempNodeLeftChild && pSiblingRbTreeNode->Color == RED && NumSiblingRightChildRedChildren == 0)
-                {
-                    // This will lead to a LL rotation
-                    pSiblingRbTreeNode->Color = BLACK;
-                    if (pSiblingRbTreeNode->pRightChild) pSiblingRbTreeNode->pRightChild->Color = RED;
+// __deleteRangeRbTreeNode()
+// This function deletes all the events with ID1 <= ID <= ID2. The tree is split at ID1 and at ID2,
+// the middle tree is given back to the node pool in one go and the outer trees are joined again,
+// so the tree work is O(log n) no matter how many events are removed. The hot cache is dropped by
+// moving to a new generation. With the hash index the removed events still have to leave it one
+// by one, which makes it O(k) in the k removed events
+VOID __deleteRangeRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID1, INT ID2)
+{
+    RB_TREE_SPLIT   LeftRbTreeSplit     = { 0 };
+    RB_TREE_SPLIT   RightRbTreeSplit    = { 0 };
+    RB_TREE_SPLIT   MinRbTreeSplit      = { 0 };
+    PRB_TREE_NODE   pTempRbTreeNode     = NULL;
+    UINT            BlackHeight         = 0;
 
-                    pSiblingRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pParentRbTreeNode->pLeftChild = pSiblingRbTreeNode->pRightChild;
-                    pSiblingRbTreeNode->pRightChild = pParentRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingRbTreeNode;
-                    if (pParentRbTreeNode->pLeftChild) pParentRbTreeNode->pLeftChild->pParent = pParentRbTreeNode;
+    if (pRbTreeContext->pRootRbTreeNode == NULL || ID1 > ID2)
+    {
+        return;
+    }
 
-                    if (pSiblingRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingRbTreeNode;
-                    }
+    // Cut out the events in the range
+    __splitRbTreeNode(pRbTreeContext, pRbTreeContext->pRootRbTreeNode, __getBlackHeightRbTreeNode(pRbTreeContext->pRootRbTreeNode), ID1, &LeftRbTreeSplit);
+    __splitRbTreeNode(pRbTreeContext, LeftRbTreeSplit.pRightRbTreeNode, LeftRbTreeSplit.RightBlackHeight, ID2, &RightRbTreeSplit);
 
-                    break;
-                }
+    // Drop them from the hash index. Without it the middle tree is not walked, so pending deltas in it
+    // stay in NumLazyTags. That only makes the fast path push down the path of a hit for nothing, the
+    // count is right again once the tree is empty
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        __dropRbTreeNodeList(pRbTreeContext, LeftRbTreeSplit.pMidRbTreeNode);
+        __dropRbTreeNodeList(pRbTreeContext, RightRbTreeSplit.pLeftRbTreeNode);
+        __dropRbTreeNodeList(pRbTreeContext, RightRbTreeSplit.pMidRbTreeNode);
+    }
 
-                // Lr0 
-                if (IsTempNodeLeftChild && pSiblingRbTreeNode->Color == RED && NumSiblingLeftChildRedChildren == 0)
-                {
-                    // This will lead to a RR rotation
-                    pSiblingRbTreeNode->Color = BLACK;
-                    if (pSiblingRbTreeNode->pLeftChild) pSiblingRbTreeNode->pLeftChild->Color = RED;
-
-                    pSiblingRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pParentRbTreeNode->pRightChild = pSiblingRbTreeNode->pLeftChild;
-                    pSiblingRbTreeNode->pLeftChild = pParentRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingRbTreeNode;
-                    if (pParentRbTreeNode->pRightChild) pParentRbTreeNode->pRightChild->pParent = pParentRbTreeNode;
-
-                    if (pSiblingRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingRbTreeNode;
-                    }
-                    
-                    break;
-                }
+    // Slots of the old generation miss from now on, when the generation wraps the old slots are cleared
+    if (pRbTreeContext->pHotCacheTable && ++pRbTreeContext->HotCacheGeneration == 0)
+    {
+        memset(pRbTreeContext->pHotCacheTable, 0, sizeof(RB_TREE_HOT_CACHE_ENTRY) << (32 - pRbTreeContext->HotCacheShift));
+    }
 
-                // Rr1 case 1 Sibling's right child's left child is red  
-                if (!IsTempNodeLeftChild && pSiblingRbTreeNode->Color == RED && NumSiblingRightChildRedChildren == 1 && 
-                    pSiblingRbTreeNode->pRightChild && pSiblingRbTreeNode->pRightChild->pLeftChild && pSiblingRbTreeNode->pRightChild->pLeftChild->Color == RED)
-                {
-                    // This will lead to a LR rotation 
-                    pSiblingRbTreeNode->pRightChild->pLeftChild->Color = BLACK;
-
-                    pSiblingRightChildRbTreeNode = pSiblingRbTreeNode->pRightChild;
-                    pSiblingRightChildRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pSiblingRbTreeNode->pRightChild = pSiblingRightChildRbTreeNode->pLeftChild;
-                    pParentRbTreeNode->pLeftChild = pSiblingRightChildRbTreeNode->pRightChild;
-                    pSiblingRightChildRbTreeNode->pLeftChild = pSiblingRbTreeNode;
-                    pSiblingRightChildRbTreeNode->pRightChild = pParentRbTreeNode;
-                    if (pSiblingRbTreeNode->pRightChild) pSiblingRbTreeNode->pRightChild->pParent = pSiblingRbTreeNode;
-                    if (pParentRbTreeNode->pLeftChild) pParentRbTreeNode->pLeftChild->pParent = pParentRbTreeNode;
-                    pSiblingRbTreeNode->pParent = pSiblingRightChildRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingRightChildRbTreeNode;
-
-                    if (pSiblingRightChildRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingRightChildRbTreeNode;
-                    }
-                    
-                    break;
-                }
+    // Give them back to the node pool, the middle tree goes back as a whole
+    __freeRbTreeNode(pRbTreeContext, &LeftRbTreeSplit.pMidRbTreeNode);
+    __freeRbTreeNode(pRbTreeContext, &RightRbTreeSplit.pMidRbTreeNode);
+    pRbTreeContext->pNodePoolContext->stNodePoolFnTbl.freeNodeSubtree(pRbTreeContext->pNodePoolContext, RightRbTreeSplit.pLeftRbTreeNode);
 
-                // Lr1 case 1 Sibling's left child's right child is red  
-                if (IsTempNodeLeftChild && pSiblingRbTreeNode->Color == RED && NumSiblingLeftChildRedChildren == 1 && 
-                    pSiblingRbTreeNode->pLeftChild && pSiblingRbTreeNode->pLeftChild->pRightChild && pSiblingRbTreeNode->pLeftChild->pRightChild->Color == RED)
-                {
-                    // This will lead to a LR rotation 
-                    pSiblingRbTreeNode->pLeftChild->pRightChild->Color = BLACK;
-
-                    pSiblingLeftChildRbTreeNode = pSiblingRbTreeNode->pLeftChild;
-                    pSiblingLeftChildRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pSiblingRbTreeNode->pLeftChild = pSiblingLeftChildRbTreeNode->pRightChild;
-                    pParentRbTreeNode->pRightChild = pSiblingLeftChildRbTreeNode->pLeftChild;
-                    pSiblingLeftChildRbTreeNode->pRightChild = pSiblingRbTreeNode;
-                    pSiblingLeftChildRbTreeNode->pLeftChild = pParentRbTreeNode;
-                    if (pSiblingRbTreeNode->pLeftChild) pSiblingRbTreeNode->pLeftChild->pParent = pSiblingRbTreeNode;
-                    if (pParentRbTreeNode->pRightChild) pParentRbTreeNode->pRightChild->pParent = pParentRbTreeNode;
-                    pSiblingRbTreeNode->pParent = pSiblingLeftChildRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingLeftChildRbTreeNode;
-
-                    if (pSiblingLeftChildRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingLeftChildRbTreeNode;
-                    }
-                    
-                    break;
-                }
+    // Join the outer trees, the smallest event of the right tree is split off to join them
+    if (LeftRbTreeSplit.pLeftRbTreeNode == NULL)
+    {
+        pRbTreeContext->pRootRbTreeNode = RightRbTreeSplit.pRightRbTreeNode;
+    }
+    else if (RightRbTreeSplit.pRightRbTreeNode == NULL)
+    {
+        pRbTreeContext->pRootRbTreeNode = LeftRbTreeSplit.pLeftRbTreeNode;
+    }
+    else
+    {
+        pTempRbTreeNode = RightRbTreeSplit.pRightRbTreeNode;
+        while (pTempRbTreeNode->pLeftChild != NULL)
+        {
+            pTempRbTreeNode = pTempRbTreeNode->pLeftChild;
+        }
 
-                // Rr1 case 2 Sibling's right child's right child is red or Rr2
-                if ((!IsTempNodeLeftChild && pSiblingRbTreeNode->Color == RED && NumSiblingRightChildRedChildren == 1 && 
-                    pSiblingRbTreeNode->pRightChild && pSiblingRbTreeNode->pRightChild->pRightChild && pSiblingRbTreeNode->pRightChild->pRightChild->Color == RED) ||
-                    (!IsTempNodeLeftChild && pSiblingRbTreeNode->Color == RED && NumSiblingRightChildRedChildren == 2))
-                {
-                    pSiblingRbTreeNode->pRightChild->pRightChild->Color = BLACK;
-                    
-                    pSiblingRightChildRbTreeNode = pSiblingRbTreeNode->pRightChild;
-                    pSiblingRightChildRedChildRbTreeNode = pSiblingRbTreeNode->pRightChild->pRightChild;
-                    pSiblingRightChildRedChildRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pSiblingRightChildRbTreeNode->pRightChild = pSiblingRightChildRedChildRbTreeNode->pLeftChild;
-                    pParentRbTreeNode->pLeftChild = pSiblingRightChildRedChildRbTreeNode->pRightChild;
-                    pSiblingRightChildRedChildRbTreeNode->pLeftChild = pSiblingRbTreeNode;
-                    pSiblingRightChildRedChildRbTreeNode->pRightChild = pParentRbTreeNode;
-                    if (pSiblingRightChildRbTreeNode->pRightChild) pSiblingRightChildRbTreeNode->pRightChild->pParent = pSiblingRightChildRbTreeNode;
-                    if (pParentRbTreeNode->pLeftChild) pParentRbTreeNode->pLeftChild->pParent = pParentRbTreeNode;
-                    pSiblingRbTreeNode->pParent = pSiblingRightChildRedChildRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingRightChildRedChildRbTreeNode;
-
-                    if (pSiblingRightChildRedChildRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingRightChildRedChildRbTreeNode;
-                    }
-                    
-                    break;
-                }
+        __splitRbTreeNode(pRbTreeContext, RightRbTreeSplit.pRightRbTreeNode, RightRbTreeSplit.RightBlackHeight, pTempRbTreeNode->ID, &MinRbTreeSplit);
+        pRbTreeContext->pRootRbTreeNode = __joinRbTreeNode(pRbTreeContext, LeftRbTreeSplit.pLeftRbTreeNode, LeftRbTreeSplit.LeftBlackHeight,
+            MinRbTreeSplit.pMidRbTreeNode, MinRbTreeSplit.pRightRbTreeNode, MinRbTreeSplit.RightBlackHeight, &BlackHeight);
+    }
 
-                // Lr1 case 2 Sibling's left child's left child is red or Lr2
-                if ((IsTempNodeLeftChild && pSiblingRbTreeNode->Color == RED && NumSiblingLeftChildRedChildren == 1 && 
-                    pSiblingRbTreeNode->pLeftChild && pSiblingRbTreeNode->pLeftChild->pLeftChild && pSiblingRbTreeNode->pLeftChild->pLeftChild->Color == RED) ||
-                    (IsTempNodeLeftChild && pSiblingRbTreeNode->Color == RED && NumSiblingLeftChildRedChildren == 2))
-                {
-                    pSiblingRbTreeNode->pLeftChild->pLeftChild->Color = BLACK;
-
-                    pSiblingLeftChildRbTreeNode = pSiblingRbTreeNode->pLeftChild;
-                    pSiblingLeftChildRedChildRbTreeNode = pSiblingRbTreeNode->pLeftChild->pLeftChild;
-                    pSiblingLeftChildRedChildRbTreeNode->pParent = pParentRbTreeNode->pParent;
-                    pSiblingLeftChildRbTreeNode->pRightChild = pSiblingLeftChildRedChildRbTreeNode->pRightChild;
-                    pParentRbTreeNode->pRightChild = pSiblingLeftChildRedChildRbTreeNode->pLeftChild;
-                    pSiblingLeftChildRedChildRbTreeNode->pRightChild = pSiblingRbTreeNode;
-                    pSiblingLeftChildRedChildRbTreeNode->pLeftChild = pParentRbTreeNode;
-                    if (pSiblingLeftChildRbTreeNode->pLeftChild) pSiblingLeftChildRbTreeNode->pLeftChild->pParent = pSiblingLeftChildRbTreeNode;
-                    if (pParentRbTreeNode->pRightChild) pParentRbTreeNode->pRightChild->pParent = pParentRbTreeNode;
-                    pSiblingRbTreeNode->pParent = pSiblingLeftChildRedChildRbTreeNode;
-                    pParentRbTreeNode->pParent = pSiblingLeftChildRedChildRbTreeNode;
-
-                    if (pSiblingLeftChildRedChildRbTreeNode->pParent == NULL)
-                    {
-                        pRbTreeContext->pRootRbTreeNode = pSiblingLeftChildRedChildRbTreeNode;
-                    }
+    if (pRbTreeContext->pRootRbTreeNode == NULL)
+    {
+        pRbTreeContext->NumLazyTags = 0;
+    }
+}
 
-                    break;
-                }
+// __increaseRangeRbTreeNode()
+// This function adds Count to all the events with ID1 <= ID <= ID2 in O(log n). Subtrees that are
+// fully in the range just get a pending delta, which walks push down to the children later
+VOID __increaseRangeRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID1, INT ID2, INT Count)
+{
+    if (ID1 > ID2 || Count == 0)
+    {
+        return;
+    }
+
+    __increaseRangeRbTreeNodeList(pRbTreeContext, pRbTreeContext->pRootRbTreeNode, ID1, ID2, Count, (LONGLONG)INT_MIN - 1, (LONGLONG)INT_MAX + 1);
+}
+
+// __increaseRangeRbTreeNodeList()
+// This is the recursive function for the range increase. All the IDs under the node are known to be
+// strictly between LowerBound and UpperBound, which come from the ancestors
+VOID __increaseRangeRbTreeNodeList(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT ID1, INT ID2, INT Count, LONGLONG LowerBound, LONGLONG UpperBound)
+{
+    if (pRbTreeNode == NULL)
+    {
+        return;
+    }
+
+    // Whole subtree is in the range, tag it and done
+    if (ID1 <= LowerBound + 1 && UpperBound - 1 <= ID2)
+    {
+        pRbTreeNode->Count += Count;
+        pRbTreeNode->Sum += (LONGLONG)Count * pRbTreeNode->Size;
+        __addLazyRbTreeNode(pRbTreeContext, pRbTreeNode, Count);
+        return;
+    }
+
+    if (ID1 <= pRbTreeNode->ID && pRbTreeNode->ID <= ID2)
+    {
+        pRbTreeNode->Count += Count;
+    }
+
+    if (ID1 < pRbTreeNode->ID)
+    {
+        __increaseRangeRbTreeNodeList(pRbTreeContext, pRbTreeNode->pLeftChild, ID1, ID2, Count, LowerBound, pRbTreeNode->ID);
+    }
+    if (ID2 > pRbTreeNode->ID)
+    {
+        __increaseRangeRbTreeNodeList(pRbTreeContext, pRbTreeNode->pRightChild, ID1, ID2, Count, pRbTreeNode->ID, UpperBound);
+    }
+
+    __updateSumRbTreeNode(pRbTreeNode);
+}
 
-                // Phew !! 
-                // Should never reach here, leave a print to catch the error 
-                printf("__deleteDegree1RbTreeNode: Restoring Red Black Property, Illegal scenario, Exit!\r\n");
+// __addLazyRbTreeNode()
+// This function adds Count to the pending delta of the node, keeping the number of tagged nodes
+VOID __addLazyRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count)
+{
+    if (pRbTreeNode->pLeftChild == NULL && pRbTreeNode->pRightChild == NULL)
+    {
+        // Nothing below a leaf to pass the delta to
+        return;
+    }
+
+    if (pRbTreeNode->Lazy == 0)
+    {
+        pRbTreeContext->NumLazyTags++;
+    }
+
+    pRbTreeNode->Lazy += Count;
+
+    if (pRbTreeNode->Lazy == 0)
+    {
+        pRbTreeContext->NumLazyTags--;
+    }
+}
+
+// __pushLazyRbTreeNode()
+// This function moves the pending delta of the node into its children
+VOID __pushLazyRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    if (pRbTreeNode->Lazy == 0)
+    {
+        return;
+    }
+
+    if (pRbTreeNode->pLeftChild)
+    {
+        pRbTreeNode->pLeftChild->Count += pRbTreeNode->Lazy;
+        pRbTreeNode->pLeftChild->Sum += (LONGLONG)pRbTreeNode->Lazy * pRbTreeNode->pLeftChild->Size;
+        __addLazyRbTreeNode(pRbTreeContext, pRbTreeNode->pLeftChild, pRbTreeNode->Lazy);
+    }
+    if (pRbTreeNode->pRightChild)
+    {
+        pRbTreeNode->pRightChild->Count += pRbTreeNode->Lazy;
+        pRbTreeNode->pRightChild->Sum += (LONGLONG)pRbTreeNode->Lazy * pRbTreeNode->pRightChild->Size;
+        __addLazyRbTreeNode(pRbTreeContext, pRbTreeNode->pRightChild, pRbTreeNode->Lazy);
+    }
+
+    pRbTreeNode->Lazy = 0;
+    pRbTreeContext->NumLazyTags--;
+}
 
-            } while (TRUE);
+// __pushLazyRbTreeNodePath()
+// This function moves the pending deltas of all the ancestors of the node down to the node, the
+// ancestors are pushed from the root down so every delta reaches the node
+VOID __pushLazyRbTreeNodePath(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    if (pRbTreeNode->pParent)
+    {
+        __pushLazyRbTreeNodePath(pRbTreeContext, pRbTreeNode->pParent);
+        __pushLazyRbTreeNode(pRbTreeContext, pRbTreeNode->pParent);
+    }
+}
+
+// __dropRbTreeNodeList()
+// This function removes the IDs of all the nodes in the subtree from the hash index and drops
+// their pending deltas from the count
+VOID __dropRbTreeNodeList(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    if (pRbTreeNode)
+    {
+        if (pRbTreeContext->pHashIndexContext)
+        {
+            pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.deleteHashIndexEntry(pRbTreeContext->pHashIndexContext, pRbTreeNode->ID);
+        }
+        if (pRbTreeNode->Lazy)
+        {
+            pRbTreeContext->NumLazyTags--;
+        }
+        __dropRbTreeNodeList(pRbTreeContext, pRbTreeNode->pLeftChild);
+        __dropRbTreeNodeList(pRbTreeContext, pRbTreeNode->pRightChild);
+    }
+}
+
+// __getBlackHeightRbTreeNode()
+// This function returns the number of black nodes on a path from the node down to a leaf
+UINT __getBlackHeightRbTreeNode(PRB_TREE_NODE pRbTreeNode)
+{
+    UINT    BlackHeight = 0;
+
+    while (pRbTreeNode != NULL)
+    {
+        if (pRbTreeNode->Color == BLACK)
+        {
+            BlackHeight++;
         }
+        pRbTreeNode = pRbTreeNode->pLeftChild;
     }
+
+    return BlackHeight;
+}
+
+// __detachRbTreeNode()
+// This function cuts the subtree off its parent and makes it a tree of its own. A red root is
+// colored black, BlackHeight is that of the subtree before and the new one is returned
+PRB_TREE_NODE __detachRbTreeNode(PRB_TREE_NODE pRbTreeNode, UINT BlackHeight, UINT *pBlackHeight)
+{
+    *pBlackHeight = BlackHeight;
+
+    if (pRbTreeNode)
+    {
+        pRbTreeNode->pParent = NULL;
+        if (pRbTreeNode->Color == RED)
+        {
+            pRbTreeNode->Color = BLACK;
+            (*pBlackHeight)++;
+        }
+    }
+
+    return pRbTreeNode;
+}
+
+// __splitRbTreeNode()
+// This function splits the tree under pRbTreeNode (black root, BlackHeight black nodes down to a leaf)
+// into the tree of IDs less than ID, the node with ID and the tree of IDs greater than ID.
+// Walking down, the subtrees hanging off the path are joined to the two sides on the way back up. The
+// joins cost the difference of the black heights, which adds up to O(log n) for the whole split
+VOID __splitRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, UINT BlackHeight, INT ID, PRB_TREE_SPLIT pRbTreeSplit)
+{
+    PRB_TREE_NODE   pLeftRbTreeNode     = NULL;
+    PRB_TREE_NODE   pRightRbTreeNode    = NULL;
+    UINT            LeftBlackHeight     = 0;
+    UINT            RightBlackHeight    = 0;
+
+    if (pRbTreeNode == NULL)
+    {
+        memset(pRbTreeSplit, 0, sizeof(RB_TREE_SPLIT));
+        return;
+    }
+
+    // Root is black, so its children have one black node less. Its pending delta stays with the children
+    __pushLazyRbTreeNode(pRbTreeContext, pRbTreeNode);
+    pLeftRbTreeNode = __detachRbTreeNode(pRbTreeNode->pLeftChild, BlackHeight - 1, &LeftBlackHeight);
+    pRightRbTreeNode = __detachRbTreeNode(pRbTreeNode->pRightChild, BlackHeight - 1, &RightBlackHeight);
+
+    if (ID == pRbTreeNode->ID)
+    {
+        pRbTreeSplit->pLeftRbTreeNode   = pLeftRbTreeNode;
+        pRbTreeSplit->LeftBlackHeight   = LeftBlackHeight;
+        pRbTreeSplit->pMidRbTreeNode    = pRbTreeNode;
+        pRbTreeSplit->pRightRbTreeNode  = pRightRbTreeNode;
+        pRbTreeSplit->RightBlackHeight  = RightBlackHeight;
+
+        pRbTreeNode->pLeftChild     = NULL;
+        pRbTreeNode->pRightChild    = NULL;
+        pRbTreeNode->pParent        = NULL;
+        __updateSumRbTreeNode(pRbTreeNode);
+    }
+    else if (ID < pRbTreeNode->ID)
+    {
+        // Node and its right subtree go to the right side
+        __splitRbTreeNode(pRbTreeContext, pLeftRbTreeNode, LeftBlackHeight, ID, pRbTreeSplit);
+        pRbTreeSplit->pRightRbTreeNode = __joinRbTreeNode(pRbTreeContext, pRbTreeSplit->pRightRbTreeNode, pRbTreeSplit->RightBlackHeight,
+            pRbTreeNode, pRightRbTreeNode, RightBlackHeight, &pRbTreeSplit->RightBlackHeight);
+    }
+    else
+    {
+        // Node and its left subtree go to the left side
+        __splitRbTreeNode(pRbTreeContext, pRightRbTreeNode, RightBlackHeight, ID, pRbTreeSplit);
+        pRbTreeSplit->pLeftRbTreeNode = __joinRbTreeNode(pRbTreeContext, pLeftRbTreeNode, LeftBlackHeight,
+            pRbTreeNode, pRbTreeSplit->pLeftRbTreeNode, pRbTreeSplit->LeftBlackHeight, &pRbTreeSplit->LeftBlackHeight);
+    }
+}
+
+// __joinRbTreeNode()
+// This function joins the trees with black roots pLeftRbTreeNode and pRightRbTreeNode using pMidRbTreeNode,
+// all IDs in the left tree must be less than the ID of the middle node and all in the right tree greater.
+// The middle node is linked in red down the spine of the taller tree where the black heights match, and
+// then fixed up like an insert. Returns the new root and its black height in pBlackHeight
+PRB_TREE_NODE __joinRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pLeftRbTreeNode, UINT LeftBlackHeight, PRB_TREE_NODE pMidRbTreeNode, PRB_TREE_NODE pRightRbTreeNode, UINT RightBlackHeight, UINT *pBlackHeight)
+{
+    PRB_TREE_NODE   pRootRbTreeNode     = NULL;
+    PRB_TREE_NODE   pParentRbTreeNode   = NULL;
+    PRB_TREE_NODE   pTempRbTreeNode     = NULL;
+    UINT            BlackHeight         = 0;
+
+    pMidRbTreeNode->Color   = RED;
+    pMidRbTreeNode->Lazy    = 0;
+    pMidRbTreeNode->pParent = NULL;
+
+    if (LeftBlackHeight == RightBlackHeight)
+    {
+        // Same height, middle node is the new root
+        pMidRbTreeNode->pLeftChild  = pLeftRbTreeNode;
+        pMidRbTreeNode->pRightChild = pRightRbTreeNode;
+        if (pLeftRbTreeNode) pLeftRbTreeNode->pParent = pMidRbTreeNode;
+        if (pRightRbTreeNode) pRightRbTreeNode->pParent = pMidRbTreeNode;
+
+        pMidRbTreeNode->Color = BLACK;
+        __updateSumRbTreeNode(pMidRbTreeNode);
+        *pBlackHeight = LeftBlackHeight + 1;
+        return pMidRbTreeNode;
+    }
+
+    if (LeftBlackHeight > RightBlackHeight)
+    {
+        // Walk down the right spine of the left tree to a black node with the height of the right tree
+        pRootRbTreeNode = pLeftRbTreeNode;
+        pTempRbTreeNode = pLeftRbTreeNode;
+        BlackHeight = LeftBlackHeight;
+        while (pTempRbTreeNode != NULL && (pTempRbTreeNode->Color == RED || BlackHeight != RightBlackHeight))
+        {
+            if (pTempRbTreeNode->Color == BLACK)
+            {
+                BlackHeight--;
+            }
+            __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
+            pParentRbTreeNode = pTempRbTreeNode;
+            pTempRbTreeNode = pTempRbTreeNode->pRightChild;
+        }
+
+        pMidRbTreeNode->pLeftChild  = pTempRbTreeNode;
+        pMidRbTreeNode->pRightChild = pRightRbTreeNode;
+        pParentRbTreeNode->pRightChild = pMidRbTreeNode;
+        *pBlackHeight = LeftBlackHeight;
+    }
+    else
+    {
+        // Walk down the left spine of the right tree to a black node with the height of the left tree
+        pRootRbTreeNode = pRightRbTreeNode;
+        pTempRbTreeNode = pRightRbTreeNode;
+        BlackHeight = RightBlackHeight;
+        while (pTempRbTreeNode != NULL && (pTempRbTreeNode->Color == RED || BlackHeight != LeftBlackHeight))
+        {
+            if (pTempRbTreeNode->Color == BLACK)
+            {
+                BlackHeight--;
+            }
+            __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
+            pParentRbTreeNode = pTempRbTreeNode;
+            pTempRbTreeNode = pTempRbTreeNode->pLeftChild;
+        }
+
+        pMidRbTreeNode->pLeftChild  = pLeftRbTreeNode;
+        pMidRbTreeNode->pRightChild = pTempRbTreeNode;
+        pParentRbTreeNode->pLeftChild = pMidRbTreeNode;
+        *pBlackHeight = RightBlackHeight;
+    }
+
+    pMidRbTreeNode->pParent = pParentRbTreeNode;
+    if (pMidRbTreeNode->pLeftChild) pMidRbTreeNode->pLeftChild->pParent = pMidRbTreeNode;
+    if (pMidRbTreeNode->pRightChild) pMidRbTreeNode->pRightChild->pParent = pMidRbTreeNode;
+
+    // Spine above the middle node got the shorter tree and the middle node
+    for (pTempRbTreeNode = pMidRbTreeNode; pTempRbTreeNode != NULL; pTempRbTreeNode = pTempRbTreeNode->pParent)
+    {
+        __updateSumRbTreeNode(pTempRbTreeNode);
+    }
+
+    // Middle node was added red, restore the red black property like an insert
+    if (__insertFixupRbTreeNode(&pRootRbTreeNode, pMidRbTreeNode))
+    {
+        (*pBlackHeight)++;
+    }
+
+    return pRootRbTreeNode;
 }
 
 // __getNextIDRbTreeNode()
@@ -965,9 +1469,12 @@ PRB_TREE_NODE __getNextIDRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB
     // or if the right subtree is empty than the parent 
     if (pRbTreeNode->pRightChild != NULL)
     {
+        // Ancestors were walked to get here, fold the pending deltas of the subtree on the way down
+        __pushLazyRbTreeNode(pRbTreeContext, pRbTreeNode);
         pTempRbTreeNode = pRbTreeNode->pRightChild;
         while (pTempRbTreeNode->pLeftChild != NULL)
         {
+            __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
             pTempRbTreeNode = pTempRbTreeNode->pLeftChild;
         }
 
@@ -1005,9 +1512,12 @@ PRB_TREE_NODE __getPrevIDRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB
     // or if the left subtree is empty than the parent 
     if (pRbTreeNode->pLeftChild != NULL)
     {
+        // Ancestors were walked to get here, fold the pending deltas of the subtree on the way down
+        __pushLazyRbTreeNode(pRbTreeContext, pRbTreeNode);
         pTempRbTreeNode = pRbTreeNode->pLeftChild;
         while (pTempRbTreeNode->pRightChild != NULL)
         {
+            __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
             pTempRbTreeNode = pTempRbTreeNode->pRightChild;
         }
 
@@ -1038,36 +1548,121 @@ PRB_TREE_NODE __getPrevIDRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB
 // This function allocates memory for the array list
 VOID __initializeRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Length)
 {
-    pRbTreeContext->pRbTreeNodeArrayList    = (PRB_TREE_NODE)malloc(sizeof(RB_TREE_NODE) * Length);
+    pRbTreeContext->pRbTreeNodeArrayList    = (PRB_TREE_NODE)__allocateRbTreeArrayList(pRbTreeContext, sizeof(RB_TREE_NODE) * Length);
     pRbTreeContext->NumNodesRbTree          = Length;
+    pRbTreeContext->ArrayListLength         = Length;
+
+    // Size the hash index up front for all the events, avoids growing it while loading
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        destroyHashIndexContext(&pRbTreeContext->pHashIndexContext);
+        pRbTreeContext->pHashIndexContext = createHashIndexContext(Length * 2);
+    }
 }
 
 // __insertRbTreeNodeArrayList()
 // This funcion builds the RbTree Node and adds it to the end of the list
 VOID __insertRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count, UINT Index)
 {
-    PRB_TREE_NODE   pRbTreeNode = NULL;
-
-    // First build the Red Black Tree Node and color it black
-    pRbTreeNode = __buildRbTreeNode(ID, Count);
-    pRbTreeNode->Color = BLACK;
+    PRB_TREE_NODE   pRbTreeNode = &pRbTreeContext->pRbTreeNodeArrayList[Index];
 
-    // Add it to the List 
-    memcpy(&pRbTreeContext->pRbTreeNodeArrayList[Index], pRbTreeNode, sizeof(RB_TREE_NODE));
+    // Build the Red Black Tree Node in place in the List and color it black
+    pRbTreeNode->ID             = ID;
+    pRbTreeNode->Count          = Count;
+    pRbTreeNode->Color          = BLACK;
+    pRbTreeNode->Lazy           = 0;
+    pRbTreeNode->Size           = 1;
+    pRbTreeNode->Sum            = Count;
+    pRbTreeNode->pLeftChild     = NULL;
+    pRbTreeNode->pRightChild    = NULL;
+    pRbTreeNode->pParent        = NULL;
 
-    // Free up the memory
-    free(pRbTreeNode);
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.insertHashIndexEntry(pRbTreeContext->pHashIndexContext, ID, pRbTreeNode);
+    }
 }
 
 // __initializeRbTree()
 // This function builds the Rb Tree from the Array list in O(n) time
 VOID __initializeRbTree(struct _RB_TREE_CONTEXT *pRbTreeContext)
 {
+    // Build needs the events strictly sorted by ID
+    __sortRbTreeNodeArrayList(pRbTreeContext);
+
     // Get the height of the RB Tree 
     pRbTreeContext->RbTreeHeight = (UINT)(log(pRbTreeContext->NumNodesRbTree) / log(2));
 
     // call the sorted array to rb tree function to build the RB Tree recursively 
     pRbTreeContext->pRootRbTreeNode = __sortedArrayToRbTree(pRbTreeContext, 0, pRbTreeContext->NumNodesRbTree - 1, 0);
+
+    // With a single event the root is also the last level, keep it black
+    if (pRbTreeContext->pRootRbTreeNode)
+    {
+        pRbTreeContext->pRootRbTreeNode->Color = BLACK;
+    }
+}
+
+// __sortRbTreeNodeArrayList()
+// This function sorts the array list by ID if the input file was not strictly sorted, events with the same ID
+// are merged into one by adding up their counts. Nodes are filled again, which also points the hash index at
+// the new positions
+VOID __sortRbTreeNodeArrayList(PRB_TREE_CONTEXT pRbTreeContext)
+{
+    PRB_TREE_NODE       pRbTreeNodeArrayList    = pRbTreeContext->pRbTreeNodeArrayList;
+    PRADIX_SORT_RECORD  pRecordList             = NULL;
+    UINT                NumRecords              = pRbTreeContext->NumNodesRbTree;
+    UINT                Index                   = 0;
+
+    for (Index = 1; Index < NumRecords; Index++)
+    {
+        if (pRbTreeNodeArrayList[Index - 1].ID >= pRbTreeNodeArrayList[Index].ID)
+        {
+            break;
+        }
+    }
+
+    if (Index >= NumRecords)
+    {
+        return;
+    }
+
+    pRecordList = (PRADIX_SORT_RECORD)malloc(sizeof(RADIX_SORT_RECORD) * NumRecords);
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        pRecordList[Index].ID       = pRbTreeNodeArrayList[Index].ID;
+        pRecordList[Index].Count    = pRbTreeNodeArrayList[Index].Count;
+    }
+
+    NumRecords = sortRadixSortRecords(pRecordList, NumRecords, 0);
+
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        __insertRbTreeNodeArrayList(pRbTreeContext, pRecordList[Index].ID, pRecordList[Index].Count, Index);
+    }
+    pRbTreeContext->NumNodesRbTree = NumRecords;
+
+    free(pRecordList);
+}
+
+// __appendRbTreeNodeArrayList()
+// This function builds the nodes from StartIndex to EndIndex of the array list into a tree and joins it to the
+// right of the tree, so a sorted input can be loaded in chunks. IDs of the chunk have to be greater than all
+// the IDs in the tree. First node of the chunk is the middle node of the join, the rest is built like the whole tree
+VOID __appendRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT StartIndex, UINT EndIndex)
+{
+    PRB_TREE_NODE   pChunkRbTreeNode    = NULL;
+    UINT            BlackHeight         = 0;
+
+    if (StartIndex < EndIndex)
+    {
+        pRbTreeContext->RbTreeHeight = (UINT)(log(EndIndex - StartIndex) / log(2));
+        pChunkRbTreeNode = __sortedArrayToRbTree(pRbTreeContext, StartIndex + 1, EndIndex, 0);
+        pChunkRbTreeNode->Color = BLACK;
+    }
+
+    pRbTreeContext->pRootRbTreeNode = __joinRbTreeNode(pRbTreeContext, pRbTreeContext->pRootRbTreeNode, __getBlackHeightRbTreeNode(pRbTreeContext->pRootRbTreeNode),
+        &pRbTreeContext->pRbTreeNodeArrayList[StartIndex], pChunkRbTreeNode, __getBlackHeightRbTreeNode(pChunkRbTreeNode), &BlackHeight);
 }
 
 // __sortedArrayToRbTree()
@@ -1096,6 +1691,7 @@ PRB_TREE_NODE __sortedArrayToRbTree(PRB_TREE_CONTEXT pRbTreeContext, INT StartIn
         // Update the parent pointers if need to
         if (pRbTreeNode->pLeftChild) pRbTreeNode->pLeftChild->pParent = pRbTreeNode;
         if (pRbTreeNode->pRightChild) pRbTreeNode->pRightChild->pParent = pRbTreeNode;
+        __updateSumRbTreeNode(pRbTreeNode);
 
         // Color the nodes in the last level Red to maintain the Red Black Tree Property
         if (Height == pRbTreeContext->RbTreeHeight)
@@ -1107,7 +1703,340 @@ PRB_TREE_NODE __sortedArrayToRbTree(PRB_TREE_CONTEXT pRbTreeContext, INT StartIn
     }
 }
 
+// __findHotCacheRbTreeNode()
+// This function looks up the ID in the hot cache, returns NULL on a miss or if the cache is disabled
+PRB_TREE_NODE __findHotCacheRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID)
+{
+    PRB_TREE_HOT_CACHE_ENTRY    pHotCacheEntry = NULL;
+
+    if (pRbTreeContext->pHotCacheTable == NULL)
+    {
+        return NULL;
+    }
+
+    pHotCacheEntry = &pRbTreeContext->pHotCacheTable[((UINT)ID * 2654435769U) >> pRbTreeContext->HotCacheShift];
+    if (pHotCacheEntry->pRbTreeNode && pHotCacheEntry->ID == ID && pHotCacheEntry->Generation == pRbTreeContext->HotCacheGeneration)
+    {
+        pRbTreeContext->HotCacheHits++;
+        return pHotCacheEntry->pRbTreeNode;
+    }
+
+    pRbTreeContext->HotCacheMisses++;
+    return NULL;
+}
+
+// __updateHotCacheRbTreeNode()
+// This function points the slot of the ID to the node, the previous occupant of the slot is evicted.
+// A NULL node invalidates the slot if it holds the ID, used when the event leaves the node
+VOID __updateHotCacheRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID, PRB_TREE_NODE pRbTreeNode)
+{
+    PRB_TREE_HOT_CACHE_ENTRY    pHotCacheEntry = NULL;
+
+    if (pRbTreeContext->pHotCacheTable == NULL)
+    {
+        return;
+    }
+
+    pHotCacheEntry = &pRbTreeContext->pHotCacheTable[((UINT)ID * 2654435769U) >> pRbTreeContext->HotCacheShift];
+    if (pRbTreeNode)
+    {
+        pHotCacheEntry->ID          = ID;
+        pHotCacheEntry->Generation  = pRbTreeContext->HotCacheGeneration;
+        pHotCacheEntry->pRbTreeNode = pRbTreeNode;
+    }
+    else if (pHotCacheEntry->ID == ID)
+    {
+        pHotCacheEntry->pRbTreeNode = NULL;
+    }
+}
+
+// __updateRbTreeNodeCount()
+// This function adds Count to the Count of an existing node and returns the node. The subtree sums up
+// to the root change with it, the node may have been found without walking down so go up the parents
+PRB_TREE_NODE __updateRbTreeNodeCount(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count)
+{
+    pRbTreeNode->Count += Count;
+    __addSumRbTreeNodePath(pRbTreeContext, pRbTreeNode, Count, 0);
+
+    return pRbTreeNode;
+}
+
+// __updateSumRbTreeNode()
+// This function sets the size and the sum of the subtree from the node and its children, after the
+// children of the node changed. Pending delta of the node is not in its children yet
+VOID __updateSumRbTreeNode(PRB_TREE_NODE pRbTreeNode)
+{
+    UINT        Size    = 0;
+    LONGLONG    Sum     = 0;
+
+    if (pRbTreeNode->pLeftChild)
+    {
+        Size    += pRbTreeNode->pLeftChild->Size;
+        Sum     += pRbTreeNode->pLeftChild->Sum;
+    }
+    if (pRbTreeNode->pRightChild)
+    {
+        Size    += pRbTreeNode->pRightChild->Size;
+        Sum     += pRbTreeNode->pRightChild->Sum;
+    }
+
+    pRbTreeNode->Size   = Size + 1;
+    pRbTreeNode->Sum    = Sum + (LONGLONG)pRbTreeNode->Lazy * Size + pRbTreeNode->Count;
+}
+
+// __addSumRbTreeNodePath()
+// This function adds Count and Size to the subtree of the node and of all its ancestors. This is the
+// O(log n) part of keeping the sums, so it is skipped till a query has needed them
+VOID __addSumRbTreeNodePath(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, LONGLONG Count, INT Size)
+{
+    if (!pRbTreeContext->bSubtreeSums)
+    {
+        return;
+    }
+
+    while (pRbTreeNode != NULL)
+    {
+        pRbTreeNode->Size   += Size;
+        pRbTreeNode->Sum    += Count;
+        pRbTreeNode = pRbTreeNode->pParent;
+    }
+}
+
+// __enableSumRbTree()
+// This function makes the subtree sizes and sums right for the first query that needs them and keeps them
+// right from then on. Till then inserts, deletes and count updates dont walk up to the root for them,
+// rotations, splits, joins and builds still set them from the children as that costs nothing extra
+VOID __enableSumRbTree(PRB_TREE_CONTEXT pRbTreeContext)
+{
+    if (!pRbTreeContext->bSubtreeSums)
+    {
+        __buildSumRbTreeNodeList(pRbTreeContext->pRootRbTreeNode);
+        pRbTreeContext->bSubtreeSums = TRUE;
+    }
+}
+
+// __buildSumRbTreeNodeList()
+// This function sets the size and the sum of every subtree from the bottom up, O(n) once
+VOID __buildSumRbTreeNodeList(PRB_TREE_NODE pRbTreeNode)
+{
+    if (pRbTreeNode)
+    {
+        __buildSumRbTreeNodeList(pRbTreeNode->pLeftChild);
+        __buildSumRbTreeNodeList(pRbTreeNode->pRightChild);
+        __updateSumRbTreeNode(pRbTreeNode);
+    }
+}
+
+// __getPrefixCountRbTreeNode()
+// This function returns the total count of the events with IDs up to ID inclusively in one walk down,
+// adding the left subtree and the node every time the walk goes right
+LONGLONG __getPrefixCountRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID)
+{
+    PRB_TREE_NODE   pTempRbTreeNode = pRbTreeContext->pRootRbTreeNode;
+    LONGLONG        PrefixCount     = 0;
+
+    __enableSumRbTree(pRbTreeContext);
+
+    while (pTempRbTreeNode != NULL)
+    {
+        // Children sums are final once the pending delta is pushed
+        __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
+
+        if (ID < pTempRbTreeNode->ID)
+        {
+            pTempRbTreeNode = pTempRbTreeNode->pLeftChild;
+            continue;
+        }
+
+        PrefixCount += pTempRbTreeNode->Count + (pTempRbTreeNode->pLeftChild ? pTempRbTreeNode->pLeftChild->Sum : 0);
+        if (ID == pTempRbTreeNode->ID)
+        {
+            break;
+        }
+        pTempRbTreeNode = pTempRbTreeNode->pRightChild;
+    }
+
+    return PrefixCount;
+}
+
+// __selectCountRbTreeNode()
+// This function returns the node holding the unit CountIndex (from 1) of the count when the events are laid
+// out in ID order, which is the smallest ID whose prefix count reaches CountIndex. One walk down, going left
+// while the left subtree has the unit and taking off the left subtree and the node when going right.
+// Returns NULL if CountIndex is not between 1 and the total count
+PRB_TREE_NODE __selectCountRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, LONGLONG CountIndex)
+{
+    PRB_TREE_NODE   pTempRbTreeNode = pRbTreeContext->pRootRbTreeNode;
+    LONGLONG        LeftSum         = 0;
+
+    __enableSumRbTree(pRbTreeContext);
+
+    if (pTempRbTreeNode == NULL || CountIndex < 1 || CountIndex > pTempRbTreeNode->Sum)
+    {
+        return NULL;
+    }
+
+    while (pTempRbTreeNode != NULL)
+    {
+        __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
+
+        LeftSum = pTempRbTreeNode->pLeftChild ? pTempRbTreeNode->pLeftChild->Sum : 0;
+        if (CountIndex <= LeftSum)
+        {
+            pTempRbTreeNode = pTempRbTreeNode->pLeftChild;
+        }
+        else if (CountIndex <= LeftSum + pTempRbTreeNode->Count)
+        {
+            break;
+        }
+        else
+        {
+            CountIndex -= LeftSum + pTempRbTreeNode->Count;
+            pTempRbTreeNode = pTempRbTreeNode->pRightChild;
+        }
+    }
+
+    return pTempRbTreeNode;
+}
+
+// __selectCountRbTreeNodeBatch()
+// This function finds the nodes for a list of count indexes sorted in increasing order in one traversal, the
+// indexes are split between the subtrees at every node so the top of the tree is walked once for all of them.
+// Nodes of indexes not between 1 and the total count are NULL
+VOID __selectCountRbTreeNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, LONGLONG *pCountIndexList, UINT NumIndexes, PRB_TREE_NODE *ppRbTreeNodeList)
+{
+    __enableSumRbTree(pRbTreeContext);
+    __selectCountRbTreeSubtree(pRbTreeContext, pRbTreeContext->pRootRbTreeNode, pCountIndexList, NumIndexes, 0, ppRbTreeNodeList);
+}
+
+// __selectCountRbTreeSubtree()
+// This function finds the nodes for the sorted count indexes that fall in the subtree of the node, Offset is the
+// count of the events before the subtree. Indexes up to the left subtree sum go left, the ones on the node are
+// the node and the rest go right
+VOID __selectCountRbTreeSubtree(PRB_TREE_CONTEXT pRbTreeContext, PRB_TREE_NODE pRbTreeNode, LONGLONG *pCountIndexList, UINT NumIndexes, LONGLONG Offset, PRB_TREE_NODE *ppRbTreeNodeList)
+{
+    LONGLONG    LeftSum     = 0;
+    UINT        LeftIndex   = 0;
+    UINT        RightIndex  = 0;
+
+    if (pRbTreeNode == NULL)
+    {
+        memset(ppRbTreeNodeList, 0, sizeof(PRB_TREE_NODE) * NumIndexes);
+        return;
+    }
+
+    if (NumIndexes == 0)
+    {
+        return;
+    }
+
+    __pushLazyRbTreeNode(pRbTreeContext, pRbTreeNode);
+
+    LeftSum = pRbTreeNode->pLeftChild ? pRbTreeNode->pLeftChild->Sum : 0;
+    while (LeftIndex < NumIndexes && pCountIndexList[LeftIndex] - Offset <= LeftSum)
+    {
+        LeftIndex++;
+    }
+
+    RightIndex = LeftIndex;
+    while (RightIndex < NumIndexes && pCountIndexList[RightIndex] - Offset <= LeftSum + pRbTreeNode->Count)
+    {
+        ppRbTreeNodeList[RightIndex++] = pRbTreeNode;
+    }
 
+    // Indexes below 1 go all the way left and end up NULL
+    __selectCountRbTreeSubtree(pRbTreeContext, pRbTreeNode->pLeftChild, pCountIndexList, LeftIndex, Offset, ppRbTreeNodeList);
+    __selectCountRbTreeSubtree(pRbTreeContext, pRbTreeNode->pRightChild, pCountIndexList + RightIndex, NumIndexes - RightIndex,
+        Offset + LeftSum + pRbTreeNode->Count, ppRbTreeNodeList + RightIndex);
+}
 
+// __getRankRbTreeNode()
+// This function returns the number of events with IDs up to ID inclusively in one walk down, adding
+// the left subtree and the node every time the walk goes right. Sizes dont depend on pending deltas
+UINT __getRankRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID)
+{
+    PRB_TREE_NODE   pTempRbTreeNode = pRbTreeContext->pRootRbTreeNode;
+    UINT            Rank            = 0;
 
+    __enableSumRbTree(pRbTreeContext);
 
+    while (pTempRbTreeNode != NULL)
+    {
+        if (ID < pTempRbTreeNode->ID)
+        {
+            pTempRbTreeNode = pTempRbTreeNode->pLeftChild;
+            continue;
+        }
+
+        Rank += 1 + (pTempRbTreeNode->pLeftChild ? pTempRbTreeNode->pLeftChild->Size : 0);
+        if (ID == pTempRbTreeNode->ID)
+        {
+            break;
+        }
+        pTempRbTreeNode = pTempRbTreeNode->pRightChild;
+    }
+
+    return Rank;
+}
+
+// __selectRankRbTreeNode()
+// This function returns the node of the event at Rank (from 1) in ID order in one walk down, or NULL if
+// Rank is not between 1 and the number of events. Pending deltas are pushed on the way so the Count is final
+PRB_TREE_NODE __selectRankRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Rank)
+{
+    PRB_TREE_NODE   pTempRbTreeNode = pRbTreeContext->pRootRbTreeNode;
+    UINT            LeftSize        = 0;
+
+    __enableSumRbTree(pRbTreeContext);
+
+    if (pTempRbTreeNode == NULL || Rank < 1 || Rank > pTempRbTreeNode->Size)
+    {
+        return NULL;
+    }
+
+    while (pTempRbTreeNode != NULL)
+    {
+        __pushLazyRbTreeNode(pRbTreeContext, pTempRbTreeNode);
+
+        LeftSize = pTempRbTreeNode->pLeftChild ? pTempRbTreeNode->pLeftChild->Size : 0;
+        if (Rank <= LeftSize)
+        {
+            pTempRbTreeNode = pTempRbTreeNode->pLeftChild;
+        }
+        else if (Rank == LeftSize + 1)
+        {
+            break;
+        }
+        else
+        {
+            Rank -= LeftSize + 1;
+            pTempRbTreeNode = pTempRbTreeNode->pRightChild;
+        }
+    }
+
+    return pTempRbTreeNode;
+}
+
+// __printRbTreeStats()
+// This function prints the statistics of the optional lookup structures
+VOID __printRbTreeStats(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    ULONGLONG   NumLookups = pRbTreeContext->HotCacheHits + pRbTreeContext->HotCacheMisses;
+
+    if (pRbTreeContext->pHotCacheTable)
+    {
+        printf("hotcache hits %llu misses %llu hitrate %.2f%%\n", pRbTreeContext->HotCacheHits, pRbTreeContext->HotCacheMisses,
+            NumLookups ? (100.0 * pRbTreeContext->HotCacheHits) / NumLookups : 0.0);
+    }
+
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        printf("hashindex entries %u capacity %u\n", pRbTreeContext->pHashIndexContext->NumEntries, pRbTreeContext->pHashIndexContext->Capacity);
+    }
+
+    if (pRbTreeContext->NumTdRbTreeVersions)
+    {
+        printf("versions current %u oldest %u\n", pRbTreeContext->NumTdRbTreeVersions - 1,
+            pRbTreeContext->NumTdRbTreeVersions > pRbTreeContext->RbTreeArgs.NumVersions ? pRbTreeContext->NumTdRbTreeVersions - pRbTreeContext->RbTreeArgs.NumVersions : 0);
+    }
+}
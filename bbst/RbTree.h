@@ -7,40 +7,136 @@
 #define _RB_TREE_H_
 
 #include "Types.h"
+#include "HashIndex.h"
+#include "TdRbTree.h"
+#include "SkipList.h"
+#include "ArtTree.h"
+#include "NodePool.h"
+#include "HugePage.h"
+#include "RadixSort.h"
 
 // Definitions 
+#define RB_TREE_MAX_BATCH_SIZE  64
+#define RB_TREE_CURRENT_VERSION 0xFFFFFFFF
+
+// Lazy is a pending delta for all the nodes below this one, Count of the node itself already has it.
+// Size and Sum are the number of events and their total count in the subtree of the node, Sum has
+// the pending deltas below the node already while the Sum of its children doesnt have its Lazy yet.
+// They cost 16 bytes a node (56 instead of 40) and are only kept up to date once bSubtreeSums is set
 typedef struct _RB_TREE_NODE
 {
     INT    ID; 
     INT    Count;
     enum {RED, BLACK} Color;
+    INT    Lazy;
+    UINT   Size;
+    LONGLONG Sum;
     struct _RB_TREE_NODE *pLeftChild;
     struct _RB_TREE_NODE *pRightChild;
     struct _RB_TREE_NODE *pParent;
 }RB_TREE_NODE, *PRB_TREE_NODE;
 
+// Result of splitting a tree at an ID, trees of smaller and greater IDs with their black heights
+// and the node with the ID if it was in the tree
+typedef struct _RB_TREE_SPLIT
+{
+    PRB_TREE_NODE   pLeftRbTreeNode;
+    UINT            LeftBlackHeight;
+    PRB_TREE_NODE   pMidRbTreeNode;
+    PRB_TREE_NODE   pRightRbTreeNode;
+    UINT            RightBlackHeight;
+}RB_TREE_SPLIT, *PRB_TREE_SPLIT;
+
+// Hot cache slot, the ID is kept in the slot so that a miss doesnt touch the node. A slot is only
+// good while its Generation is the one of the tree, a range delete drops all the slots at once that way
+typedef struct _RB_TREE_HOT_CACHE_ENTRY
+{
+    INT             ID;
+    UINT            Generation;
+    PRB_TREE_NODE   pRbTreeNode;
+}RB_TREE_HOT_CACHE_ENTRY, *PRB_TREE_HOT_CACHE_ENTRY;
+
+// Args Declaration for Red Black Tree 
+// Trees created with the same node pool share it, a tree without one makes its own. With a huge page
+// context the array list and the chunks of the pool made here are on huge pages
+typedef struct _RB_TREE_ARGS
+{
+    BOOLEAN             bHashIndex;
+    UINT                HotCacheSize;
+    BOOLEAN             bTopDown;
+    BOOLEAN             bSkipList;
+    BOOLEAN             bArt;
+    UINT                NumVersions;
+    PNODE_POOL_CONTEXT  pNodePoolContext;
+    PHUGE_PAGE_CONTEXT  pHugePageContext;
+}RB_TREE_ARGS, *PRB_TREE_ARGS;
+
 // Red Black Tree Context Definition 
 typedef struct _RB_TREE_CONTEXT
 {
-    PRB_TREE_NODE       pRootRbTreeNode;
-    PRB_TREE_NODE       pRbTreeNodeArrayList;
-    UINT                NumNodesRbTree;
-    UINT                RbTreeHeight;
+    RB_TREE_ARGS                RbTreeArgs;
+    PRB_TREE_NODE               pRootRbTreeNode;
+    PRB_TREE_NODE               pRbTreeNodeArrayList;
+    UINT                        NumNodesRbTree;
+    UINT                        ArrayListLength;
+    UINT                        RbTreeHeight;
+    PHASH_INDEX_CONTEXT         pHashIndexContext;
+    PNODE_POOL_CONTEXT          pNodePoolContext;
+    UINT                        NumLazyTags;
+    BOOLEAN                     bSubtreeSums;
+    PRB_TREE_HOT_CACHE_ENTRY    pHotCacheTable;
+    UINT                        HotCacheShift;
+    UINT                        HotCacheGeneration;
+    ULONGLONG                   HotCacheHits;
+    ULONGLONG                   HotCacheMisses;
+    PTD_RB_TREE_NODE            pRootTdRbTreeNode;
+    PTD_RB_TREE_NODE            pTdRbTreeNodeArrayList;
+    PTD_RB_TREE_NODE            TdRbTreePathStack[TD_RB_TREE_MAX_HEIGHT];
+    UINT                        TdRbTreePathDepth;
+    PTD_RB_TREE_NODE            *pTdRbTreeVersionList;
+    UINT                        NumTdRbTreeVersions;
+    PTD_RB_TREE_NODE            pWorkRootTdRbTreeNode;
+    BOOLEAN                     bTdRbTreeVersionSelected;
+    PSKIP_LIST_CONTEXT          pSkipListContext;
+    PART_TREE_CONTEXT           pArtTreeContext;
     struct _RB_TREE_FN_TBL
     {
         VOID(*initializeRbTreeNodeArrayList)(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Length);
         VOID(*insertRbTreeNodeArrayList)(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count, UINT Index);
         VOID(*initializeRbTree)(struct _RB_TREE_CONTEXT *pRbTreeContext);
+        VOID(*appendRbTreeNodeArrayList)(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT StartIndex, UINT EndIndex);
         PRB_TREE_NODE(*insertRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count);
         VOID(*deleteRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+        VOID(*deleteRangeRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID1, INT ID2);
+        VOID(*increaseRangeRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID1, INT ID2, INT Count);
+        PRB_TREE_NODE(*updateRbTreeNodeCount) (struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count);
+        VOID(*commitRbTreeVersion) (struct _RB_TREE_CONTEXT *pRbTreeContext);
+        BOOLEAN(*selectRbTreeVersion) (struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Version);
         PRB_TREE_NODE(*findRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID);
+        VOID(*findRbTreeNodeBatch) (struct _RB_TREE_CONTEXT *pRbTreeContext, INT *pIDList, UINT NumIDs, PRB_TREE_NODE *ppRbTreeNodeList);
         PRB_TREE_NODE(*getNextIDRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
         PRB_TREE_NODE(*getPrevIDRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+        LONGLONG(*getPrefixCountRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID);
+        PRB_TREE_NODE(*selectCountRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, LONGLONG CountIndex);
+        VOID(*selectCountRbTreeNodeBatch) (struct _RB_TREE_CONTEXT *pRbTreeContext, LONGLONG *pCountIndexList, UINT NumIndexes, PRB_TREE_NODE *ppRbTreeNodeList);
+        UINT(*getRankRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID);
+        PRB_TREE_NODE(*selectRankRbTreeNode) (struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Rank);
+        VOID(*printRbTreeStats) (struct _RB_TREE_CONTEXT *pRbTreeContext);
     }stRbTreeFnTbl;
 }RB_TREE_CONTEXT, *PRB_TREE_CONTEXT;
 
 // Funtion Prototypes
 // Following functions can be accessed outside rb_tree.c
-PRB_TREE_CONTEXT    createRbTreeContext();
+PRB_TREE_CONTEXT    createRbTreeContext(PRB_TREE_ARGS pRbTreeArgs);
 VOID                destroyRbTreeContext(PRB_TREE_CONTEXT *ppRbTreeContext);
+PNODE_POOL_CONTEXT  createRbTreeNodePoolContext(PRB_TREE_ARGS pRbTreeArgs);
+
+// Following functions are shared with the top down variant in TdRbTree.c, the skip list in SkipList.c and the
+// radix tree in ArtTree.c
+PRB_TREE_NODE       __buildRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID, INT Count);
+VOID                __sortRbTreeNodeArrayList(PRB_TREE_CONTEXT pRbTreeContext);
+PRB_TREE_NODE       __findFastPathRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID);
+VOID                __updateHotCacheRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID, PRB_TREE_NODE pRbTreeNode);
+VOID*               __allocateRbTreeArrayList(PRB_TREE_CONTEXT pRbTreeContext, size_t Size);
+VOID                __freeRbTreeArrayList(PRB_TREE_CONTEXT pRbTreeContext, VOID *pArrayList);
 #endif 
@@ -0,0 +1,885 @@
+//
+// Main source file for the microbenchmark of the tree primitives. Every stRbTreeFnTbl primitive is run
+// on its own at the given tree sizes, with the IDs taken in order or at random, and timed along with
+// the hardware counters. Results can be saved as JSON and checked against a saved baseline
+//
+
+#include "RbTreeBench.h"
+
+// Local Function Declarations
+PRB_TREE_BENCH_CONTEXT  __createRbTreeBenchContext();
+VOID                    __destroyRbTreeBenchContext(PRB_TREE_BENCH_CONTEXT *ppRbTreeBenchContext);
+BOOLEAN                 __parseRbTreeBenchArgs(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, INT argc, CHAR *argv[]);
+VOID                    __fillRbTreeBenchIDList(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern);
+VOID                    __buildRbTreeBenchTree(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, BOOLEAN bSorted);
+VOID                    __beginRbTreeBenchRound(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext);
+VOID                    __endRbTreeBenchRound(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext);
+VOID                    __storeRbTreeBenchResult(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, CHAR *pName, UINT Size, RB_TREE_BENCH_PATTERN Pattern, ULONGLONG NumOps);
+VOID                    __runRbTreeBenchBuild(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern);
+VOID                    __runRbTreeBenchInsert(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern);
+VOID                    __runRbTreeBenchDelete(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern);
+VOID                    __runRbTreeBenchFind(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern);
+VOID                    __runRbTreeBenchNextPrev(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern);
+BOOLEAN                 __runRbTreeBenchThreads(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size);
+VOID*                   __runRbTreeBenchThread(VOID *pArgs);
+UINT                    __getRbTreeBenchThreadOp(PRB_TREE_BENCH_THREAD pRbTreeBenchThread, ULONGLONG *pRandom, INT *pID);
+BOOLEAN                 __checkRbTreeBenchThreads(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, PRB_TREE_BENCH_THREAD pThreadList, UINT NumThreads, UINT Size);
+BOOLEAN                 __saveRbTreeBenchResults(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, CHAR *pFilename);
+UINT                    __checkRbTreeBenchBaseline(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, CHAR *pFilename);
+CHAR*                   __getRbTreeBenchPatternName(RB_TREE_BENCH_PATTERN Pattern);
+
+// Main Function for the benchmark
+// Returns 1 if a result is slower than the baseline by more than the tolerance, or if a concurrent run left
+// the tree different from the serial replay of its ops
+INT main(INT argc, CHAR *argv[])
+{
+    PRB_TREE_BENCH_CONTEXT  pRbTreeBenchContext = NULL;
+    PERF_COUNTER_EVENT      Event               = PERF_COUNTER_CYCLES;
+    RB_TREE_BENCH_PATTERN   Pattern             = RB_TREE_BENCH_SEQUENTIAL;
+    INT                     RetStatus           = 0;
+    UINT                    SizeIndex           = 0;
+    UINT                    Size                = 0;
+
+    do
+    {
+        pRbTreeBenchContext = __createRbTreeBenchContext();
+
+        if (!__parseRbTreeBenchArgs(pRbTreeBenchContext, argc, argv))
+        {
+            printf("main : syntax -- bbst_bench [-sizes <n1,n2,..>] [-ops <count>] [-hashindex] [-hotcache <entries>] [-topdown] [-skiplist] [-art] [-hugepages] [-threads <n1,n2,..>] [-save <json>] [-baseline <json>] [-tolerance <percent>]\r\n");
+            RetStatus = -1;
+            break;
+        }
+
+        // Counters the hardware doesnt have are printed as -
+        pRbTreeBenchContext->pPerfCounterContext = createPerfCounterContext();
+        for (Event = PERF_COUNTER_CYCLES; Event <= PERF_COUNTER_BRANCH_MISSES; Event++)
+        {
+            pRbTreeBenchContext->pPerfCounterContext->stPerfCounterFnTbl.addPerfCounter(pRbTreeBenchContext->pPerfCounterContext, Event);
+        }
+
+        for (SizeIndex = 0; SizeIndex < pRbTreeBenchContext->RbTreeBenchArgs.NumSizes; SizeIndex++)
+        {
+            Size = pRbTreeBenchContext->RbTreeBenchArgs.SizeList[SizeIndex];
+            pRbTreeBenchContext->pIDList            = (INT*)malloc(sizeof(INT) * Size);
+            pRbTreeBenchContext->ppRbTreeNodeList   = (PRB_TREE_NODE*)malloc(sizeof(PRB_TREE_NODE) * Size);
+
+            for (Pattern = RB_TREE_BENCH_SEQUENTIAL; Pattern < RB_TREE_BENCH_MAX_PATTERNS; Pattern++)
+            {
+                __fillRbTreeBenchIDList(pRbTreeBenchContext, Size, Pattern);
+
+                __runRbTreeBenchBuild(pRbTreeBenchContext, Size, Pattern);
+
+                __buildRbTreeBenchTree(pRbTreeBenchContext, Size, TRUE);
+                __runRbTreeBenchInsert(pRbTreeBenchContext, Size, Pattern);
+                __runRbTreeBenchDelete(pRbTreeBenchContext, Size, Pattern);
+                __runRbTreeBenchFind(pRbTreeBenchContext, Size, Pattern);
+                __runRbTreeBenchNextPrev(pRbTreeBenchContext, Size, Pattern);
+                destroyRbTreeContext(&pRbTreeBenchContext->pRbTreeContext);
+            }
+
+            if (pRbTreeBenchContext->RbTreeBenchArgs.NumThreadCounts && !__runRbTreeBenchThreads(pRbTreeBenchContext, Size))
+            {
+                RetStatus = 1;
+            }
+
+            free(pRbTreeBenchContext->pIDList);
+            free(pRbTreeBenchContext->ppRbTreeNodeList);
+            pRbTreeBenchContext->pIDList            = NULL;
+            pRbTreeBenchContext->ppRbTreeNodeList   = NULL;
+        }
+
+        if (pRbTreeBenchContext->RbTreeBenchArgs.pSaveFilename &&
+            !__saveRbTreeBenchResults(pRbTreeBenchContext, pRbTreeBenchContext->RbTreeBenchArgs.pSaveFilename))
+        {
+            RetStatus = -1;
+            break;
+        }
+
+        if (pRbTreeBenchContext->RbTreeBenchArgs.pBaselineFilename &&
+            __checkRbTreeBenchBaseline(pRbTreeBenchContext, pRbTreeBenchContext->RbTreeBenchArgs.pBaselineFilename))
+        {
+            RetStatus = 1;
+            break;
+        }
+
+    } while (FALSE);
+
+    if (pRbTreeBenchContext)
+    {
+        __destroyRbTreeBenchContext(&pRbTreeBenchContext);
+    }
+
+    return RetStatus;
+}
+
+// __createRbTreeBenchContext()
+// This function allocates memory for the context with the default args
+PRB_TREE_BENCH_CONTEXT __createRbTreeBenchContext()
+{
+    PRB_TREE_BENCH_CONTEXT  pRbTreeBenchContext = NULL;
+
+    pRbTreeBenchContext = (PRB_TREE_BENCH_CONTEXT)malloc(sizeof(RB_TREE_BENCH_CONTEXT));
+    memset(pRbTreeBenchContext, 0, sizeof(RB_TREE_BENCH_CONTEXT));
+
+    pRbTreeBenchContext->RbTreeBenchArgs.SizeList[0]        = 1000;
+    pRbTreeBenchContext->RbTreeBenchArgs.SizeList[1]        = 100000;
+    pRbTreeBenchContext->RbTreeBenchArgs.SizeList[2]        = 1000000;
+    pRbTreeBenchContext->RbTreeBenchArgs.NumSizes           = 3;
+    pRbTreeBenchContext->RbTreeBenchArgs.NumOps             = RB_TREE_BENCH_DEFAULT_OPS;
+    pRbTreeBenchContext->RbTreeBenchArgs.TolerancePercent   = (FLOAT)RB_TREE_BENCH_DEFAULT_TOLERANCE;
+    pthread_mutex_init(&pRbTreeBenchContext->TreeMutex, NULL);
+
+    return pRbTreeBenchContext;
+}
+
+// __destroyRbTreeBenchContext()
+// This function frees up the benchmark context
+VOID __destroyRbTreeBenchContext(PRB_TREE_BENCH_CONTEXT *ppRbTreeBenchContext)
+{
+    if ((*ppRbTreeBenchContext)->pRbTreeContext)
+    {
+        destroyRbTreeContext(&(*ppRbTreeBenchContext)->pRbTreeContext);
+    }
+
+    if ((*ppRbTreeBenchContext)->pPerfCounterContext)
+    {
+        destroyPerfCounterContext(&(*ppRbTreeBenchContext)->pPerfCounterContext);
+    }
+
+    if ((*ppRbTreeBenchContext)->RbTreeBenchArgs.RbTreeArgs.pHugePageContext)
+    {
+        destroyHugePageContext(&(*ppRbTreeBenchContext)->RbTreeBenchArgs.RbTreeArgs.pHugePageContext);
+    }
+
+    pthread_mutex_destroy(&(*ppRbTreeBenchContext)->TreeMutex);
+    free((*ppRbTreeBenchContext)->pIDList);
+    free((*ppRbTreeBenchContext)->ppRbTreeNodeList);
+    free(*ppRbTreeBenchContext);
+    *ppRbTreeBenchContext = NULL;
+}
+
+// __parseRbTreeBenchArgs()
+// This function parses the options, the tree options are the ones of bbst
+BOOLEAN __parseRbTreeBenchArgs(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, INT argc, CHAR *argv[])
+{
+    PRB_TREE_BENCH_ARGS pRbTreeBenchArgs    = &pRbTreeBenchContext->RbTreeBenchArgs;
+    CHAR                *pNext              = NULL;
+    INT                 ArgIndex            = 0;
+
+    for (ArgIndex = 1; ArgIndex < argc; ArgIndex++)
+    {
+        if (strcmp(argv[ArgIndex], "-sizes") == 0 && ArgIndex + 1 < argc)
+        {
+            pRbTreeBenchArgs->NumSizes  = 0;
+            pNext                       = argv[++ArgIndex];
+            while (*pNext && pRbTreeBenchArgs->NumSizes < RB_TREE_BENCH_MAX_SIZES)
+            {
+                pRbTreeBenchArgs->SizeList[pRbTreeBenchArgs->NumSizes] = (UINT)strtoul(pNext, &pNext, 10);
+                if (pRbTreeBenchArgs->SizeList[pRbTreeBenchArgs->NumSizes] == 0)
+                {
+                    return FALSE;
+                }
+                pRbTreeBenchArgs->NumSizes++;
+
+                if (*pNext == ',')
+                {
+                    pNext++;
+                }
+                else if (*pNext)
+                {
+                    return FALSE;
+                }
+            }
+        }
+        else if (strcmp(argv[ArgIndex], "-threads") == 0 && ArgIndex + 1 < argc)
+        {
+            pRbTreeBenchArgs->NumThreadCounts   = 0;
+            pNext                               = argv[++ArgIndex];
+            while (*pNext && pRbTreeBenchArgs->NumThreadCounts < RB_TREE_BENCH_MAX_THREAD_COUNTS)
+            {
+                pRbTreeBenchArgs->ThreadCountList[pRbTreeBenchArgs->NumThreadCounts] = (UINT)strtoul(pNext, &pNext, 10);
+                if (pRbTreeBenchArgs->ThreadCountList[pRbTreeBenchArgs->NumThreadCounts] == 0 ||
+                    pRbTreeBenchArgs->ThreadCountList[pRbTreeBenchArgs->NumThreadCounts] > RB_TREE_BENCH_MAX_THREADS)
+                {
+                    return FALSE;
+                }
+                pRbTreeBenchArgs->NumThreadCounts++;
+
+                if (*pNext == ',')
+                {
+                    pNext++;
+                }
+                else if (*pNext)
+                {
+                    return FALSE;
+                }
+            }
+        }
+        else if (strcmp(argv[ArgIndex], "-ops") == 0 && ArgIndex + 1 < argc)
+        {
+            pRbTreeBenchArgs->NumOps = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+        }
+        else if (strcmp(argv[ArgIndex], "-hashindex") == 0)
+        {
+            pRbTreeBenchArgs->RbTreeArgs.bHashIndex = TRUE;
+        }
+        else if (strcmp(argv[ArgIndex], "-hotcache") == 0 && ArgIndex + 1 < argc)
+        {
+            pRbTreeBenchArgs->RbTreeArgs.HotCacheSize = (UINT)strtoul(argv[++ArgIndex], NULL, 10);
+        }
+        else if (strcmp(argv[ArgIndex], "-topdown") == 0)
+        {
+            pRbTreeBenchArgs->RbTreeArgs.bTopDown = TRUE;
+        }
+        else if (strcmp(argv[ArgIndex], "-skiplist") == 0)
+        {
+            pRbTreeBenchArgs->RbTreeArgs.bSkipList = TRUE;
+        }
+        else if (strcmp(argv[ArgIndex], "-art") == 0)
+        {
+            pRbTreeBenchArgs->RbTreeArgs.bArt = TRUE;
+        }
+        else if (strcmp(argv[ArgIndex], "-hugepages") == 0)
+        {
+            pRbTreeBenchArgs->RbTreeArgs.pHugePageContext = createHugePageContext();
+        }
+        else if (strcmp(argv[ArgIndex], "-save") == 0 && ArgIndex + 1 < argc)
+        {
+            pRbTreeBenchArgs->pSaveFilename = argv[++ArgIndex];
+        }
+        else if (strcmp(argv[ArgIndex], "-baseline") == 0 && ArgIndex + 1 < argc)
+        {
+            pRbTreeBenchArgs->pBaselineFilename = argv[++ArgIndex];
+        }
+        else if (strcmp(argv[ArgIndex], "-tolerance") == 0 && ArgIndex + 1 < argc)
+        {
+            pRbTreeBenchArgs->TolerancePercent = (FLOAT)strtod(argv[++ArgIndex], NULL);
+        }
+        else
+        {
+            printf("__parseRbTreeBenchArgs: Illegal Option %s\r\n", argv[ArgIndex]);
+            return FALSE;
+        }
+    }
+
+    return (pRbTreeBenchArgs->NumSizes > 0 && pRbTreeBenchArgs->NumOps > 0);
+}
+
+// __getRbTreeBenchPatternName()
+// This function gets the name of the pattern used in the output and the JSON
+CHAR* __getRbTreeBenchPatternName(RB_TREE_BENCH_PATTERN Pattern)
+{
+    return (Pattern == RB_TREE_BENCH_SEQUENTIAL) ? "sequential" : "random";
+}
+
+// __fillRbTreeBenchIDList()
+// This function fills the list with the tree IDs in the order of the pattern. Random order is a fixed
+// shuffle, so runs see the same order
+VOID __fillRbTreeBenchIDList(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern)
+{
+    ULONGLONG   Random  = 0x9E3779B97F4A7C15ULL;
+    UINT        Index   = 0;
+    UINT        Swap    = 0;
+    INT         ID      = 0;
+
+    for (Index = 0; Index < Size; Index++)
+    {
+        pRbTreeBenchContext->pIDList[Index] = (INT)(2 * Index);
+    }
+
+    if (Pattern == RB_TREE_BENCH_RANDOM)
+    {
+        for (Index = Size - 1; Index > 0; Index--)
+        {
+            // xorshift64
+            Random ^= Random << 13;
+            Random ^= Random >> 7;
+            Random ^= Random << 17;
+
+            Swap = (UINT)(Random % (Index + 1));
+            ID = pRbTreeBenchContext->pIDList[Index];
+            pRbTreeBenchContext->pIDList[Index] = pRbTreeBenchContext->pIDList[Swap];
+            pRbTreeBenchContext->pIDList[Swap] = ID;
+        }
+    }
+}
+
+// __buildRbTreeBenchTree()
+// This function builds a new tree with the IDs of the list, or with the even IDs in order
+VOID __buildRbTreeBenchTree(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, BOOLEAN bSorted)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = NULL;
+    UINT                Index           = 0;
+
+    if (pRbTreeBenchContext->pRbTreeContext)
+    {
+        destroyRbTreeContext(&pRbTreeBenchContext->pRbTreeContext);
+    }
+
+    pRbTreeContext = createRbTreeContext(&pRbTreeBenchContext->RbTreeBenchArgs.RbTreeArgs);
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTreeNodeArrayList(pRbTreeContext, Size);
+    for (Index = 0; Index < Size; Index++)
+    {
+        pRbTreeContext->stRbTreeFnTbl.insertRbTreeNodeArrayList(pRbTreeContext, bSorted ? (INT)(2 * Index) : pRbTreeBenchContext->pIDList[Index], 1, Index);
+    }
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTree(pRbTreeContext);
+
+    pRbTreeBenchContext->pRbTreeContext = pRbTreeContext;
+}
+
+// __beginRbTreeBenchRound()
+// This function starts the clock and the counters for a round
+VOID __beginRbTreeBenchRound(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext)
+{
+    pRbTreeBenchContext->pPerfCounterContext->stPerfCounterFnTbl.startPerfCounters(pRbTreeBenchContext->pPerfCounterContext);
+    clock_gettime(CLOCK_MONOTONIC, &pRbTreeBenchContext->RoundStartTime);
+}
+
+// __endRbTreeBenchRound()
+// This function stops the clock and the counters, the round adds to the benchmark
+VOID __endRbTreeBenchRound(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext)
+{
+    PPERF_COUNTER_CONTEXT   pPerfCounterContext = pRbTreeBenchContext->pPerfCounterContext;
+    struct timespec         EndTime;
+    ULONGLONG               Value               = 0;
+    PERF_COUNTER_EVENT      Event               = PERF_COUNTER_CYCLES;
+
+    clock_gettime(CLOCK_MONOTONIC, &EndTime);
+    pPerfCounterContext->stPerfCounterFnTbl.stopPerfCounters(pPerfCounterContext);
+
+    pRbTreeBenchContext->ElapsedNs += (ULONGLONG)((LONGLONG)(EndTime.tv_sec - pRbTreeBenchContext->RoundStartTime.tv_sec) * 1000000000LL +
+        (EndTime.tv_nsec - pRbTreeBenchContext->RoundStartTime.tv_nsec));
+
+    for (Event = PERF_COUNTER_CYCLES; Event < PERF_COUNTER_MAX_EVENTS; Event++)
+    {
+        if (pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterValue(pPerfCounterContext, Event, &Value))
+        {
+            pRbTreeBenchContext->CounterSumList[Event] += Value;
+        }
+    }
+}
+
+// __storeRbTreeBenchResult()
+// This function stores the rounds since the last result as the result of the benchmark and prints it
+VOID __storeRbTreeBenchResult(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, CHAR *pName, UINT Size, RB_TREE_BENCH_PATTERN Pattern, ULONGLONG NumOps)
+{
+    PPERF_COUNTER_CONTEXT   pPerfCounterContext = pRbTreeBenchContext->pPerfCounterContext;
+    PRB_TREE_BENCH_RESULT   pResult             = NULL;
+    PERF_COUNTER_EVENT      Event               = PERF_COUNTER_CYCLES;
+    ULONGLONG               Value               = 0;
+
+    if (pRbTreeBenchContext->NumResults < RB_TREE_BENCH_MAX_RESULTS)
+    {
+        pResult = &pRbTreeBenchContext->ResultList[pRbTreeBenchContext->NumResults++];
+        pResult->pName      = pName;
+        pResult->Size       = Size;
+        pResult->Pattern    = Pattern;
+        pResult->NumOps     = NumOps;
+        pResult->NsPerOp    = (double)pRbTreeBenchContext->ElapsedNs / NumOps;
+
+        printf("%-8s size %9u %-10s ns/op %9.1f", pName, Size, __getRbTreeBenchPatternName(Pattern), pResult->NsPerOp);
+        for (Event = PERF_COUNTER_CYCLES; Event < PERF_COUNTER_MAX_EVENTS; Event++)
+        {
+            // Value is only there to tell if the event has a counter
+            pResult->CounterPerOpList[Event] = -1;
+            if (pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterValue(pPerfCounterContext, Event, &Value))
+            {
+                pResult->CounterPerOpList[Event] = (double)pRbTreeBenchContext->CounterSumList[Event] / NumOps;
+            }
+
+            if (Event <= PERF_COUNTER_BRANCH_MISSES)
+            {
+                if (pResult->CounterPerOpList[Event] >= 0)
+                {
+                    printf(" %s %.2f", pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterName(pPerfCounterContext, Event), pResult->CounterPerOpList[Event]);
+                }
+                else
+                {
+                    printf(" %s -", pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterName(pPerfCounterContext, Event));
+                }
+            }
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    pRbTreeBenchContext->ElapsedNs = 0;
+    memset(pRbTreeBenchContext->CounterSumList, 0, sizeof(pRbTreeBenchContext->CounterSumList));
+}
+
+// __runRbTreeBenchBuild()
+// This function times the bulk build, array list and tree, from the IDs in the order of the pattern.
+// Random order goes through the sort at the start of the build. Trees are built till there are
+// enough events for the ops
+VOID __runRbTreeBenchBuild(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern)
+{
+    ULONGLONG   NumOps = 0;
+
+    do
+    {
+        __beginRbTreeBenchRound(pRbTreeBenchContext);
+        __buildRbTreeBenchTree(pRbTreeBenchContext, Size, (Pattern == RB_TREE_BENCH_SEQUENTIAL));
+        __endRbTreeBenchRound(pRbTreeBenchContext);
+
+        destroyRbTreeContext(&pRbTreeBenchContext->pRbTreeContext);
+        NumOps += Size;
+
+    } while (NumOps < pRbTreeBenchContext->RbTreeBenchArgs.NumOps);
+
+    __storeRbTreeBenchResult(pRbTreeBenchContext, "build", Size, Pattern, NumOps);
+}
+
+// __runRbTreeBenchInsert()
+// This function times inserting the odd IDs between the ones in the tree, in the order of the pattern. They
+// are deleted again after every round so that the tree stays around its size
+VOID __runRbTreeBenchInsert(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pRbTreeBenchContext->pRbTreeContext;
+    ULONGLONG           NumOps          = 0;
+    UINT                Index           = 0;
+
+    do
+    {
+        __beginRbTreeBenchRound(pRbTreeBenchContext);
+        for (Index = 0; Index < Size; Index++)
+        {
+            pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pRbTreeContext, pRbTreeBenchContext->pIDList[Index] + 1, 1);
+        }
+        __endRbTreeBenchRound(pRbTreeBenchContext);
+        NumOps += Size;
+
+        for (Index = 0; Index < Size; Index++)
+        {
+            pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode(pRbTreeContext,
+                pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, pRbTreeBenchContext->pIDList[Index] + 1));
+        }
+
+    } while (NumOps < pRbTreeBenchContext->RbTreeBenchArgs.NumOps);
+
+    __storeRbTreeBenchResult(pRbTreeBenchContext, "insert", Size, Pattern, NumOps);
+}
+
+// __runRbTreeBenchDelete()
+// This function times deleting the odd IDs inserted before every round. A delete may move another event into
+// the deleted node, node pointers dont stay valid across deletes, so every delete finds its node first and
+// the find is part of the delete time
+VOID __runRbTreeBenchDelete(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pRbTreeBenchContext->pRbTreeContext;
+    ULONGLONG           NumOps          = 0;
+    UINT                Index           = 0;
+
+    do
+    {
+        for (Index = 0; Index < Size; Index++)
+        {
+            pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pRbTreeContext, pRbTreeBenchContext->pIDList[Index] + 1, 1);
+        }
+
+        __beginRbTreeBenchRound(pRbTreeBenchContext);
+        for (Index = 0; Index < Size; Index++)
+        {
+            pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode(pRbTreeContext,
+                pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, pRbTreeBenchContext->pIDList[Index] + 1));
+        }
+        __endRbTreeBenchRound(pRbTreeBenchContext);
+        NumOps += Size;
+
+    } while (NumOps < pRbTreeBenchContext->RbTreeBenchArgs.NumOps);
+
+    __storeRbTreeBenchResult(pRbTreeBenchContext, "delete", Size, Pattern, NumOps);
+}
+
+// __runRbTreeBenchFind()
+// This function times finding the IDs of the tree in the order of the pattern
+VOID __runRbTreeBenchFind(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext  = pRbTreeBenchContext->pRbTreeContext;
+    ULONGLONG           NumOps          = 0;
+    UINT                Index           = 0;
+
+    __beginRbTreeBenchRound(pRbTreeBenchContext);
+    for (NumOps = 0; NumOps < pRbTreeBenchContext->RbTreeBenchArgs.NumOps; NumOps++)
+    {
+        pRbTreeBenchContext->Checksum += (ULONGLONG)(size_t)pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, pRbTreeBenchContext->pIDList[Index]);
+        if (++Index == Size)
+        {
+            Index = 0;
+        }
+    }
+    __endRbTreeBenchRound(pRbTreeBenchContext);
+
+    __storeRbTreeBenchResult(pRbTreeBenchContext, "find", Size, Pattern, NumOps);
+}
+
+// __runRbTreeBenchNextPrev()
+// This function times getting the next and the previous event of the nodes of the IDs, nodes are found
+// before the clock starts. Sequential order walks the tree in order, random order jumps all over it
+VOID __runRbTreeBenchNextPrev(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size, RB_TREE_BENCH_PATTERN Pattern)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pRbTreeBenchContext->pRbTreeContext;
+    PRB_TREE_NODE       *ppRbTreeNodeList   = pRbTreeBenchContext->ppRbTreeNodeList;
+    ULONGLONG           NumOps              = 0;
+    UINT                Index               = 0;
+
+    for (Index = 0; Index < Size; Index++)
+    {
+        ppRbTreeNodeList[Index] = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, pRbTreeBenchContext->pIDList[Index]);
+    }
+
+    Index = 0;
+    __beginRbTreeBenchRound(pRbTreeBenchContext);
+    for (NumOps = 0; NumOps < pRbTreeBenchContext->RbTreeBenchArgs.NumOps; NumOps++)
+    {
+        pRbTreeBenchContext->Checksum += (ULONGLONG)(size_t)pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, ppRbTreeNodeList[Index]);
+        if (++Index == Size)
+        {
+            Index = 0;
+        }
+    }
+    __endRbTreeBenchRound(pRbTreeBenchContext);
+    __storeRbTreeBenchResult(pRbTreeBenchContext, "next", Size, Pattern, NumOps);
+
+    Index = 0;
+    __beginRbTreeBenchRound(pRbTreeBenchContext);
+    for (NumOps = 0; NumOps < pRbTreeBenchContext->RbTreeBenchArgs.NumOps; NumOps++)
+    {
+        pRbTreeBenchContext->Checksum += (ULONGLONG)(size_t)pRbTreeContext->stRbTreeFnTbl.getPrevIDRbTreeNode(pRbTreeContext, ppRbTreeNodeList[Index]);
+        if (++Index == Size)
+        {
+            Index = 0;
+        }
+    }
+    __endRbTreeBenchRound(pRbTreeBenchContext);
+    __storeRbTreeBenchResult(pRbTreeBenchContext, "previous", Size, Pattern, NumOps);
+}
+
+// __runRbTreeBenchThreads()
+// This function times a write heavy mix run by many threads at once on the tree with the even IDs. Of every
+// 10 ops 8 increase a random ID (inserting the odd ones), 1 finds one and 1 deletes it if its odd. The tree
+// of the options runs under one mutex, the skip list without a lock. The ops are split evenly between the
+// threads, the time is wall clock from starting the first thread to the last one done. Each run is then
+// checked against a serial replay of the ops, returns FALSE if any run didnt match
+BOOLEAN __runRbTreeBenchThreads(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, UINT Size)
+{
+    PRB_TREE_BENCH_ARGS     pRbTreeBenchArgs                            = &pRbTreeBenchContext->RbTreeBenchArgs;
+    RB_TREE_BENCH_THREAD    ThreadList[RB_TREE_BENCH_MAX_THREADS];
+    pthread_t               ThreadIDList[RB_TREE_BENCH_MAX_THREADS];
+    struct timespec         StartTime;
+    struct timespec         EndTime;
+    BOOLEAN                 bSkipList                                   = pRbTreeBenchArgs->RbTreeArgs.bSkipList;
+    double                  ElapsedNs                                   = 0;
+    UINT                    Variant                                     = 0;
+    UINT                    CountIndex                                  = 0;
+    UINT                    NumThreads                                  = 0;
+    UINT                    Thread                                      = 0;
+    BOOLEAN                 bMatched                                    = TRUE;
+
+    for (Variant = 0; Variant < 2; Variant++)
+    {
+        pRbTreeBenchArgs->RbTreeArgs.bSkipList = (Variant == 1);
+
+        for (CountIndex = 0; CountIndex < pRbTreeBenchArgs->NumThreadCounts; CountIndex++)
+        {
+            NumThreads = pRbTreeBenchArgs->ThreadCountList[CountIndex];
+            __buildRbTreeBenchTree(pRbTreeBenchContext, Size, TRUE);
+
+            for (Thread = 0; Thread < NumThreads; Thread++)
+            {
+                ThreadList[Thread].pRbTreeBenchContext  = pRbTreeBenchContext;
+                ThreadList[Thread].pTreeMutex           = (Variant == 0) ? &pRbTreeBenchContext->TreeMutex : NULL;
+                ThreadList[Thread].Size                 = Size;
+                ThreadList[Thread].NumOps               = pRbTreeBenchArgs->NumOps / NumThreads;
+                ThreadList[Thread].Thread               = Thread;
+                ThreadList[Thread].NumThreads           = NumThreads;
+                ThreadList[Thread].RandomState          = 0x9E3779B97F4A7C15ULL * (Thread + 1);
+                ThreadList[Thread].Checksum             = 0;
+                ThreadList[Thread].NumMissed            = 0;
+            }
+
+            clock_gettime(CLOCK_MONOTONIC, &StartTime);
+            for (Thread = 0; Thread < NumThreads; Thread++)
+            {
+                pthread_create(&ThreadIDList[Thread], NULL, __runRbTreeBenchThread, &ThreadList[Thread]);
+            }
+            for (Thread = 0; Thread < NumThreads; Thread++)
+            {
+                pthread_join(ThreadIDList[Thread], NULL);
+                pRbTreeBenchContext->Checksum += ThreadList[Thread].Checksum;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &EndTime);
+
+            ElapsedNs = (double)(EndTime.tv_sec - StartTime.tv_sec) * 1e9 + (double)(EndTime.tv_nsec - StartTime.tv_nsec);
+            printf("%-8s size %9u threads %3u ns/op %9.1f mops/s %8.2f\n", (Variant == 0) ? "locked" : "lockfree", Size, NumThreads,
+                ElapsedNs / (ThreadList[0].NumOps * NumThreads), (ThreadList[0].NumOps * NumThreads) * 1e3 / ElapsedNs);
+            fflush(stdout);
+
+            if (!__checkRbTreeBenchThreads(pRbTreeBenchContext, ThreadList, NumThreads, Size))
+            {
+                bMatched = FALSE;
+            }
+
+            destroyRbTreeContext(&pRbTreeBenchContext->pRbTreeContext);
+        }
+    }
+
+    pRbTreeBenchArgs->RbTreeArgs.bSkipList = bSkipList;
+    return bMatched;
+}
+
+// __runRbTreeBenchThread()
+// This function runs the ops of one thread of the concurrent benchmark
+VOID* __runRbTreeBenchThread(VOID *pArgs)
+{
+    PRB_TREE_BENCH_THREAD   pRbTreeBenchThread  = (PRB_TREE_BENCH_THREAD)pArgs;
+    PRB_TREE_CONTEXT        pRbTreeContext      = pRbTreeBenchThread->pRbTreeBenchContext->pRbTreeContext;
+    PRB_TREE_NODE           pRbTreeNode         = NULL;
+    ULONGLONG               Random              = pRbTreeBenchThread->RandomState;
+    UINT                    Index               = 0;
+    UINT                    Op                  = 0;
+    INT                     ID                  = 0;
+
+    for (Index = 0; Index < pRbTreeBenchThread->NumOps; Index++)
+    {
+        Op = __getRbTreeBenchThreadOp(pRbTreeBenchThread, &Random, &ID);
+
+        if (pRbTreeBenchThread->pTreeMutex)
+        {
+            pthread_mutex_lock(pRbTreeBenchThread->pTreeMutex);
+        }
+
+        if (Op < 8)
+        {
+            pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pRbTreeContext, ID, 1);
+        }
+        else
+        {
+            pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+            if (Op == 9 && pRbTreeNode && pRbTreeNode->ID == ID && (ID & 1))
+            {
+                pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode(pRbTreeContext, pRbTreeNode);
+            }
+            else
+            {
+                pRbTreeBenchThread->Checksum += (ULONGLONG)(size_t)pRbTreeNode;
+            }
+
+            // Even IDs are never deleted, a find that misses one saw the tree half way through a change
+            if ((ID & 1) == 0 && (pRbTreeNode == NULL || pRbTreeNode->ID != ID))
+            {
+                pRbTreeBenchThread->NumMissed++;
+            }
+        }
+
+        if (pRbTreeBenchThread->pTreeMutex)
+        {
+            pthread_mutex_unlock(pRbTreeBenchThread->pTreeMutex);
+        }
+    }
+
+    if (pRbTreeContext->pSkipListContext)
+    {
+        releaseSkipListThread(pRbTreeContext);
+    }
+
+    return NULL;
+}
+
+// __getRbTreeBenchThreadOp()
+// This function draws the next op of the thread and its ID, returns the op (0 to 7 increase, 8 find, 9 delete).
+// Odd IDs are increased and deleted only by the thread that owns them, so the ops that change an ID run in
+// the order of one thread and the tree at the end doesnt depend on how the threads interleaved. Increases of
+// odd IDs of other threads go to the even ID below, which every thread increases
+UINT __getRbTreeBenchThreadOp(PRB_TREE_BENCH_THREAD pRbTreeBenchThread, ULONGLONG *pRandom, INT *pID)
+{
+    UINT    Op  = 0;
+    INT     ID  = 0;
+
+    // xorshift64
+    *pRandom ^= *pRandom << 13;
+    *pRandom ^= *pRandom >> 7;
+    *pRandom ^= *pRandom << 17;
+
+    ID = (INT)(*pRandom % (2ULL * pRbTreeBenchThread->Size));
+    Op = (UINT)((*pRandom >> 40) % 10);
+
+    if ((ID & 1) && (UINT)(ID >> 1) % pRbTreeBenchThread->NumThreads != pRbTreeBenchThread->Thread && Op != 8)
+    {
+        ID--;
+    }
+
+    *pID = ID;
+    return Op;
+}
+
+// __checkRbTreeBenchThreads()
+// This function replays the ops of every thread one after the other on an array of counts and compares the
+// tree the threads left with it, ID by ID. Prints the run and returns FALSE if they differ, or if a find of
+// a thread missed an even ID
+BOOLEAN __checkRbTreeBenchThreads(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, PRB_TREE_BENCH_THREAD pThreadList, UINT NumThreads, UINT Size)
+{
+    PRB_TREE_CONTEXT        pRbTreeContext  = pRbTreeBenchContext->pRbTreeContext;
+    PRB_TREE_NODE           pRbTreeNode     = NULL;
+    INT                     *pCountList     = NULL;
+    ULONGLONG               Random          = 0;
+    ULONGLONG               NumMissed       = 0;
+    UINT                    NumMismatches   = 0;
+    UINT                    Thread          = 0;
+    UINT                    Index           = 0;
+    UINT                    Op              = 0;
+    INT                     ID              = 0;
+
+    // Tree starts with the even IDs at count 1
+    pCountList = (INT*)calloc(2 * (size_t)Size, sizeof(INT));
+    for (ID = 0; ID < (INT)(2 * Size); ID += 2)
+    {
+        pCountList[ID] = 1;
+    }
+
+    for (Thread = 0; Thread < NumThreads; Thread++)
+    {
+        Random = pThreadList[Thread].RandomState;
+        for (Index = 0; Index < pThreadList[Thread].NumOps; Index++)
+        {
+            Op = __getRbTreeBenchThreadOp(&pThreadList[Thread], &Random, &ID);
+            if (Op < 8)
+            {
+                pCountList[ID]++;
+            }
+            else if (Op == 9 && (ID & 1))
+            {
+                pCountList[ID] = 0;
+            }
+        }
+        NumMissed += pThreadList[Thread].NumMissed;
+    }
+
+    for (ID = 0; ID < (INT)(2 * Size); ID++)
+    {
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, ID);
+        if ((pRbTreeNode && pRbTreeNode->ID == ID) ? pRbTreeNode->Count != pCountList[ID] : pCountList[ID] != 0)
+        {
+            NumMismatches++;
+        }
+    }
+    free(pCountList);
+
+    if (NumMismatches || NumMissed)
+    {
+        printf("%-8s size %9u threads %3u differs from the serial replay: %u IDs, %llu finds missed\n",
+            pRbTreeContext->pSkipListContext ? "lockfree" : "locked", Size, NumThreads, NumMismatches, NumMissed);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// __saveRbTreeBenchResults()
+// This function writes the results as JSON, one result a line so that the baseline check can read it back
+BOOLEAN __saveRbTreeBenchResults(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, CHAR *pFilename)
+{
+    PPERF_COUNTER_CONTEXT   pPerfCounterContext = pRbTreeBenchContext->pPerfCounterContext;
+    PRB_TREE_BENCH_RESULT   pResult             = NULL;
+    FILE                    *pFile              = NULL;
+    PERF_COUNTER_EVENT      Event               = PERF_COUNTER_CYCLES;
+    UINT                    Index               = 0;
+
+    pFile = fopen(pFilename, "w");
+    if (pFile == NULL)
+    {
+        printf("__saveRbTreeBenchResults: Unable to open %s\n", pFilename);
+        return FALSE;
+    }
+
+    fprintf(pFile, "{\n  \"results\": [\n");
+    for (Index = 0; Index < pRbTreeBenchContext->NumResults; Index++)
+    {
+        pResult = &pRbTreeBenchContext->ResultList[Index];
+        fprintf(pFile, "    {\"name\": \"%s\", \"size\": %u, \"pattern\": \"%s\", \"ns_per_op\": %.3f", pResult->pName, pResult->Size,
+            __getRbTreeBenchPatternName(pResult->Pattern), pResult->NsPerOp);
+
+        for (Event = PERF_COUNTER_CYCLES; Event <= PERF_COUNTER_BRANCH_MISSES; Event++)
+        {
+            if (pResult->CounterPerOpList[Event] >= 0)
+            {
+                fprintf(pFile, ", \"%s_per_op\": %.3f", pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterName(pPerfCounterContext, Event), pResult->CounterPerOpList[Event]);
+            }
+            else
+            {
+                fprintf(pFile, ", \"%s_per_op\": null", pPerfCounterContext->stPerfCounterFnTbl.getPerfCounterName(pPerfCounterContext, Event));
+            }
+        }
+        fprintf(pFile, "}%s\n", (Index + 1 < pRbTreeBenchContext->NumResults) ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+
+    fclose(pFile);
+    return TRUE;
+}
+
+// __checkRbTreeBenchBaseline()
+// This function compares the ns/op of every result with the same one in a JSON saved by -save, results
+// slower by more than the tolerance are printed. Returns the number of those regressions, or 1 if no result
+// could be compared
+UINT __checkRbTreeBenchBaseline(PRB_TREE_BENCH_CONTEXT pRbTreeBenchContext, CHAR *pFilename)
+{
+    PRB_TREE_BENCH_RESULT   pResult         = NULL;
+    FILE                    *pFile          = NULL;
+    CHAR                    Line[512];
+    CHAR                    Name[32];
+    CHAR                    PatternName[32];
+    UINT                    Size            = 0;
+    double                  BaselineNsPerOp = 0;
+    double                  ChangePercent   = 0;
+    UINT                    NumRegressions  = 0;
+    UINT                    NumCompared     = 0;
+    UINT                    Index           = 0;
+
+    pFile = fopen(pFilename, "r");
+    if (pFile == NULL)
+    {
+        printf("__checkRbTreeBenchBaseline: Unable to open %s\n", pFilename);
+        return 1;
+    }
+
+    while (fgets(Line, sizeof(Line), pFile))
+    {
+        if (sscanf(Line, " {\"name\": \"%31[^\"]\", \"size\": %u, \"pattern\": \"%31[^\"]\", \"ns_per_op\": %lf", Name, &Size, PatternName, &BaselineNsPerOp) != 4)
+        {
+            continue;
+        }
+
+        for (Index = 0; Index < pRbTreeBenchContext->NumResults; Index++)
+        {
+            pResult = &pRbTreeBenchContext->ResultList[Index];
+            if (strcmp(pResult->pName, Name) || pResult->Size != Size || strcmp(__getRbTreeBenchPatternName(pResult->Pattern), PatternName))
+            {
+                continue;
+            }
+
+            NumCompared++;
+            ChangePercent = BaselineNsPerOp > 0 ? 100.0 * (pResult->NsPerOp - BaselineNsPerOp) / BaselineNsPerOp : 0;
+            if (ChangePercent > pRbTreeBenchContext->RbTreeBenchArgs.TolerancePercent)
+            {
+                printf("regression %-8s size %9u %-10s ns/op %9.1f baseline %9.1f (%+.1f%%)\n", Name, Size, PatternName,
+                    pResult->NsPerOp, BaselineNsPerOp, ChangePercent);
+                NumRegressions++;
+            }
+            break;
+        }
+    }
+    fclose(pFile);
+
+    printf("baseline %s: %u results compared, %u regressions over %.1f%%\n", pFilename, NumCompared, NumRegressions,
+        pRbTreeBenchContext->RbTreeBenchArgs.TolerancePercent);
+
+    // A baseline of other sizes, options or an unreadable file checks nothing, fail like a missing file
+    if (NumCompared == 0)
+    {
+        printf("__checkRbTreeBenchBaseline: No results in %s match this run\n", pFilename);
+        return 1;
+    }
+
+    return NumRegressions;
+}
@@ -0,0 +1,89 @@
+//
+// Main header file for the microbenchmark of the tree primitives
+//
+
+#ifndef _RB_TREE_BENCH_H_
+#define _RB_TREE_BENCH_H_
+
+#include <time.h>
+#include "Types.h"
+#include "RbTree.h"
+#include "PerfCounter.h"
+
+// Definitions
+#define RB_TREE_BENCH_MAX_SIZES         16
+#define RB_TREE_BENCH_MAX_RESULTS       256
+#define RB_TREE_BENCH_DEFAULT_OPS       1000000
+#define RB_TREE_BENCH_DEFAULT_TOLERANCE 10.0
+#define RB_TREE_BENCH_MAX_THREAD_COUNTS 16
+#define RB_TREE_BENCH_MAX_THREADS       64
+
+// Order the IDs of a benchmark are taken in
+typedef enum _RB_TREE_BENCH_PATTERN
+{
+    RB_TREE_BENCH_SEQUENTIAL,
+    RB_TREE_BENCH_RANDOM,
+    RB_TREE_BENCH_MAX_PATTERNS
+}RB_TREE_BENCH_PATTERN;
+
+// Args Declaration for the benchmark
+typedef struct _RB_TREE_BENCH_ARGS
+{
+    RB_TREE_ARGS    RbTreeArgs;
+    UINT            SizeList[RB_TREE_BENCH_MAX_SIZES];
+    UINT            NumSizes;
+    UINT            ThreadCountList[RB_TREE_BENCH_MAX_THREAD_COUNTS];
+    UINT            NumThreadCounts;
+    UINT            NumOps;
+    CHAR            *pBaselineFilename;
+    CHAR            *pSaveFilename;
+    FLOAT           TolerancePercent;
+}RB_TREE_BENCH_ARGS, *PRB_TREE_BENCH_ARGS;
+
+// Result of one primitive at one tree size and pattern, a counter that is not available is -1 per op
+typedef struct _RB_TREE_BENCH_RESULT
+{
+    CHAR                    *pName;
+    UINT                    Size;
+    RB_TREE_BENCH_PATTERN   Pattern;
+    ULONGLONG               NumOps;
+    double                  NsPerOp;
+    double                  CounterPerOpList[PERF_COUNTER_MAX_EVENTS];
+}RB_TREE_BENCH_RESULT, *PRB_TREE_BENCH_RESULT;
+
+// Work of one thread of the concurrent benchmark, the mutex is NULL for the skip list. Thread is the index
+// of the thread, it owns the odd IDs whose half is Thread modulo NumThreads
+typedef struct _RB_TREE_BENCH_THREAD
+{
+    struct _RB_TREE_BENCH_CONTEXT   *pRbTreeBenchContext;
+    pthread_mutex_t                 *pTreeMutex;
+    UINT                            Size;
+    UINT                            NumOps;
+    UINT                            Thread;
+    UINT                            NumThreads;
+    ULONGLONG                       RandomState;
+    ULONGLONG                       Checksum;
+    ULONGLONG                       NumMissed;
+}RB_TREE_BENCH_THREAD, *PRB_TREE_BENCH_THREAD;
+
+// Context Declaration for the benchmark
+// Tree holds the even IDs 0 to 2 * (Size - 1), inserts add the odd ones in between. IDList has the
+// tree IDs in the order of the pattern. A benchmark can be timed in rounds, the time and the counters
+// of the rounds add up till the result is stored. Mutex locks the tree for the threads of the concurrent benchmark
+typedef struct _RB_TREE_BENCH_CONTEXT
+{
+    RB_TREE_BENCH_ARGS      RbTreeBenchArgs;
+    PRB_TREE_CONTEXT        pRbTreeContext;
+    PPERF_COUNTER_CONTEXT   pPerfCounterContext;
+    INT                     *pIDList;
+    PRB_TREE_NODE           *ppRbTreeNodeList;
+    RB_TREE_BENCH_RESULT    ResultList[RB_TREE_BENCH_MAX_RESULTS];
+    UINT                    NumResults;
+    struct timespec         RoundStartTime;
+    ULONGLONG               ElapsedNs;
+    ULONGLONG               CounterSumList[PERF_COUNTER_MAX_EVENTS];
+    ULONGLONG               Checksum;
+    pthread_mutex_t         TreeMutex;
+}RB_TREE_BENCH_CONTEXT, *PRB_TREE_BENCH_CONTEXT;
+
+#endif
@@ -0,0 +1,1176 @@
+//
+// This file implements the replication of the updates to read only followers over TCP. The leader logs
+// the effect of every update command, a new follower gets a snapshot from a forked child and then the
+// log from right after the snapshot. Followers serve the reads from their own copy
+//
+
+#if !defined(_MSC_VER)
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+#include "Replica.h"
+
+// Local Function Declarations
+BOOLEAN     __startReplica(struct _REPLICA_CONTEXT *pReplicaContext);
+VOID        __lockReplica(struct _REPLICA_CONTEXT *pReplicaContext);
+VOID        __unlockReplica(struct _REPLICA_CONTEXT *pReplicaContext);
+VOID        __appendReplicaRecord(struct _REPLICA_CONTEXT *pReplicaContext, CHAR *pNamespace, REPLICA_OP Op, INT ID1, INT ID2, INT Value);
+VOID        __addReplicaNamespace(struct _REPLICA_CONTEXT *pReplicaContext, CHAR *pName, PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext);
+BOOLEAN     __waitReplicaBootstrap(struct _REPLICA_CONTEXT *pReplicaContext);
+BOOLEAN     __waitReplicaFollowers(struct _REPLICA_CONTEXT *pReplicaContext, UINT NumFollowers);
+VOID        __waitReplicaLeader(struct _REPLICA_CONTEXT *pReplicaContext);
+VOID        __stopReplica(struct _REPLICA_CONTEXT *pReplicaContext);
+VOID        __printReplicaStats(struct _REPLICA_CONTEXT *pReplicaContext);
+PREPLICA_CONTEXT __createReplicaContext();
+BOOLEAN     __startReplicaLeader(PREPLICA_CONTEXT pReplicaContext);
+BOOLEAN     __startReplicaFollower(PREPLICA_CONTEXT pReplicaContext);
+VOID*       __runReplicaLeader(VOID *pArg);
+VOID*       __runReplicaFollower(VOID *pArg);
+VOID        __acceptReplicaFollower(PREPLICA_CONTEXT pReplicaContext);
+BOOLEAN     __readReplicaAcks(PREPLICA_CONTEXT pReplicaContext, PREPLICA_FOLLOWER pFollower);
+VOID        __dropReplicaFollower(PREPLICA_CONTEXT pReplicaContext, UINT FollowerIndex);
+VOID        __closeReplicaFollower(PREPLICA_FOLLOWER pFollower);
+VOID        __bootstrapReplicaFollowers(PREPLICA_CONTEXT pReplicaContext);
+BOOLEAN     __writeReplicaBootstrap(PREPLICA_CONTEXT pReplicaContext, INT Fd, ULONGLONG Sequence);
+BOOLEAN     __addReplicaBootstrapRecord(PREPLICA_RECORD pRecord, INT Fd, UCHAR *pBatch, UINT *pNumRecords, ULONGLONG Sequence);
+BOOLEAN     __sendReplicaBatch(INT Fd, UCHAR *pBatch, UINT NumRecords, ULONGLONG LeaderSequence);
+VOID        __sendReplicaLog(PREPLICA_CONTEXT pReplicaContext, UCHAR *pBatch);
+VOID        __trimReplicaLog(PREPLICA_CONTEXT pReplicaContext);
+BOOLEAN     __sendReplicaBuffer(INT Fd, VOID *pBuffer, size_t Length);
+BOOLEAN     __recvReplicaBuffer(INT Fd, VOID *pBuffer, size_t Length);
+ULONGLONG   __getReplicaTimeNs();
+
+
+// createReplicaLeaderContext()
+// This function allocates the context of a leader that takes followers on the port, 0 for any free port.
+// Nothing is listening till the replica is started
+PREPLICA_CONTEXT createReplicaLeaderContext(INT Port)
+{
+    PREPLICA_CONTEXT    pReplicaContext = __createReplicaContext();
+
+    pReplicaContext->bFollower  = FALSE;
+    pReplicaContext->Port       = Port;
+
+    return pReplicaContext;
+}
+
+// createReplicaFollowerContext()
+// This function allocates the context of a follower of the leader at host:port. Records from the leader are
+// given to pfnApply with pApplyContext
+PREPLICA_CONTEXT createReplicaFollowerContext(CHAR *pLeaderAddress, PREPLICA_APPLY_FN pfnApply, VOID *pApplyContext)
+{
+    PREPLICA_CONTEXT    pReplicaContext = __createReplicaContext();
+
+    pReplicaContext->bFollower      = TRUE;
+    pReplicaContext->pfnApply       = pfnApply;
+    pReplicaContext->pApplyContext  = pApplyContext;
+    strncpy(pReplicaContext->LeaderAddress, pLeaderAddress, sizeof(pReplicaContext->LeaderAddress) - 1);
+
+    return pReplicaContext;
+}
+
+// __createReplicaContext()
+// This function allocates memory for the context and initilize the function pointers
+PREPLICA_CONTEXT __createReplicaContext()
+{
+    PREPLICA_CONTEXT    pReplicaContext = NULL;
+
+    pReplicaContext = (PREPLICA_CONTEXT)malloc(sizeof(REPLICA_CONTEXT));
+    memset(pReplicaContext, 0, sizeof(REPLICA_CONTEXT));
+    pReplicaContext->ListenFd       = -1;
+    pReplicaContext->LeaderFd       = -1;
+    pReplicaContext->WakeFdList[0]  = -1;
+    pReplicaContext->WakeFdList[1]  = -1;
+    pReplicaContext->LogBaseSequence = 1;
+
+    // Initilize the function table
+    pReplicaContext->stReplicaFnTbl.startReplica            = __startReplica;
+    pReplicaContext->stReplicaFnTbl.lockReplica             = __lockReplica;
+    pReplicaContext->stReplicaFnTbl.unlockReplica           = __unlockReplica;
+    pReplicaContext->stReplicaFnTbl.appendReplicaRecord     = __appendReplicaRecord;
+    pReplicaContext->stReplicaFnTbl.addReplicaNamespace     = __addReplicaNamespace;
+    pReplicaContext->stReplicaFnTbl.waitReplicaBootstrap    = __waitReplicaBootstrap;
+    pReplicaContext->stReplicaFnTbl.waitReplicaFollowers    = __waitReplicaFollowers;
+    pReplicaContext->stReplicaFnTbl.waitReplicaLeader       = __waitReplicaLeader;
+    pReplicaContext->stReplicaFnTbl.stopReplica             = __stopReplica;
+    pReplicaContext->stReplicaFnTbl.printReplicaStats       = __printReplicaStats;
+
+    return pReplicaContext;
+}
+
+// destroyReplicaContext()
+// This function stops the replica thread and frees up the context
+VOID destroyReplicaContext(PREPLICA_CONTEXT *ppReplicaContext)
+{
+    if (*ppReplicaContext)
+    {
+        __stopReplica(*ppReplicaContext);
+        free((*ppReplicaContext)->pLogRecordList);
+        free((*ppReplicaContext)->pNamespaceList);
+        free(*ppReplicaContext);
+        *ppReplicaContext = NULL;
+    }
+}
+
+// __getReplicaTimeNs()
+// This function gets the wall clock time in ns, lag is measured against the send time of the leader
+// so both ends need synced clocks (they are the same clock on localhost)
+ULONGLONG __getReplicaTimeNs()
+{
+#if !defined(_MSC_VER)
+    struct timespec Time;
+
+    clock_gettime(CLOCK_REALTIME, &Time);
+    return (ULONGLONG)Time.tv_sec * 1000000000ULL + (ULONGLONG)Time.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+// __startReplica()
+// This function starts listening for followers on the leader or connects the follower to its leader, and
+// starts the replica thread. Prints why and returns FALSE if it cant
+BOOLEAN __startReplica(struct _REPLICA_CONTEXT *pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    pthread_mutex_init(&pReplicaContext->CommandMutex, NULL);
+    pthread_mutex_init(&pReplicaContext->LogMutex, NULL);
+    pthread_cond_init(&pReplicaContext->BootstrapCond, NULL);
+
+    if (!(pReplicaContext->bFollower ? __startReplicaFollower(pReplicaContext) : __startReplicaLeader(pReplicaContext)))
+    {
+        pthread_cond_destroy(&pReplicaContext->BootstrapCond);
+        pthread_mutex_destroy(&pReplicaContext->LogMutex);
+        pthread_mutex_destroy(&pReplicaContext->CommandMutex);
+        return FALSE;
+    }
+
+    pReplicaContext->bRunning = TRUE;
+    return TRUE;
+#else
+    printf("__startReplica: Replication needs POSIX sockets\n");
+    return FALSE;
+#endif
+}
+
+// __startReplicaLeader()
+// This function opens the listening socket and the wake pipe the command loop pokes the leader thread with
+BOOLEAN __startReplicaLeader(PREPLICA_CONTEXT pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    struct sockaddr_in  Address;
+    socklen_t           AddressLength   = sizeof(Address);
+    INT                 Option          = 1;
+
+    pReplicaContext->ListenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (pReplicaContext->ListenFd < 0)
+    {
+        printf("__startReplicaLeader: Unable to open a socket\n");
+        return FALSE;
+    }
+    setsockopt(pReplicaContext->ListenFd, SOL_SOCKET, SO_REUSEADDR, &Option, sizeof(Option));
+
+    memset(&Address, 0, sizeof(Address));
+    Address.sin_family      = AF_INET;
+    Address.sin_addr.s_addr = htonl(INADDR_ANY);
+    Address.sin_port        = htons((unsigned short)pReplicaContext->Port);
+
+    if (bind(pReplicaContext->ListenFd, (struct sockaddr*)&Address, sizeof(Address)) != 0 || listen(pReplicaContext->ListenFd, REPLICA_MAX_FOLLOWERS) != 0 ||
+        pipe(pReplicaContext->WakeFdList) != 0)
+    {
+        printf("__startReplicaLeader: Unable to listen on port %d\n", pReplicaContext->Port);
+        close(pReplicaContext->ListenFd);
+        pReplicaContext->ListenFd = -1;
+        return FALSE;
+    }
+
+    // Port 0 picks a free port, followers need to know which
+    getsockname(pReplicaContext->ListenFd, (struct sockaddr*)&Address, &AddressLength);
+    pReplicaContext->Port = ntohs(Address.sin_port);
+
+    fcntl(pReplicaContext->WakeFdList[0], F_SETFL, fcntl(pReplicaContext->WakeFdList[0], F_GETFL) | O_NONBLOCK);
+    fcntl(pReplicaContext->WakeFdList[1], F_SETFL, fcntl(pReplicaContext->WakeFdList[1], F_GETFL) | O_NONBLOCK);
+
+    if (pthread_create(&pReplicaContext->ReplicaThread, NULL, __runReplicaLeader, pReplicaContext) != 0)
+    {
+        printf("__startReplicaLeader: Unable to start the leader thread\n");
+        close(pReplicaContext->ListenFd);
+        close(pReplicaContext->WakeFdList[0]);
+        close(pReplicaContext->WakeFdList[1]);
+        pReplicaContext->ListenFd = -1;
+        return FALSE;
+    }
+
+    fprintf(stderr, "replica: leader listening on port %d\n", pReplicaContext->Port);
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+// __startReplicaFollower()
+// This function connects to the leader at host:port, the leader starts the bootstrap as soon as it accepts.
+// A leader started at the same time may not listen yet, the connect is retried for a few seconds
+BOOLEAN __startReplicaFollower(PREPLICA_CONTEXT pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    struct addrinfo     Hints;
+    struct addrinfo     *pAddressList   = NULL;
+    struct addrinfo     *pAddress       = NULL;
+    struct timespec     RetryTime       = { 0, REPLICA_CONNECT_RETRY_MS * 1000000L };
+    CHAR                Host[64];
+    CHAR                *pPort          = NULL;
+    INT                 Option          = 1;
+    UINT                Retry           = 0;
+
+    strcpy(Host, pReplicaContext->LeaderAddress);
+    pPort = strrchr(Host, ':');
+    if (pPort == NULL)
+    {
+        printf("__startReplicaFollower: Leader address %s is not host:port\n", pReplicaContext->LeaderAddress);
+        return FALSE;
+    }
+    *pPort++ = '\0';
+
+    memset(&Hints, 0, sizeof(Hints));
+    Hints.ai_family     = AF_UNSPEC;
+    Hints.ai_socktype   = SOCK_STREAM;
+    if (getaddrinfo(Host, pPort, &Hints, &pAddressList) != 0)
+    {
+        printf("__startReplicaFollower: Unable to resolve %s\n", pReplicaContext->LeaderAddress);
+        return FALSE;
+    }
+
+    for (Retry = 0; pReplicaContext->LeaderFd < 0 && Retry < REPLICA_CONNECT_RETRIES; Retry++)
+    {
+        if (Retry)
+        {
+            nanosleep(&RetryTime, NULL);
+        }
+
+        for (pAddress = pAddressList; pAddress; pAddress = pAddress->ai_next)
+        {
+            pReplicaContext->LeaderFd = socket(pAddress->ai_family, pAddress->ai_socktype, pAddress->ai_protocol);
+            if (pReplicaContext->LeaderFd < 0)
+            {
+                continue;
+            }
+            if (connect(pReplicaContext->LeaderFd, pAddress->ai_addr, pAddress->ai_addrlen) == 0)
+            {
+                break;
+            }
+            close(pReplicaContext->LeaderFd);
+            pReplicaContext->LeaderFd = -1;
+        }
+    }
+    freeaddrinfo(pAddressList);
+
+    if (pReplicaContext->LeaderFd < 0)
+    {
+        printf("__startReplicaFollower: Unable to connect to %s\n", pReplicaContext->LeaderAddress);
+        return FALSE;
+    }
+
+    // Acks are tiny, dont hold them back
+    setsockopt(pReplicaContext->LeaderFd, IPPROTO_TCP, TCP_NODELAY, &Option, sizeof(Option));
+
+    if (pthread_create(&pReplicaContext->ReplicaThread, NULL, __runReplicaFollower, pReplicaContext) != 0)
+    {
+        printf("__startReplicaFollower: Unable to start the follower thread\n");
+        close(pReplicaContext->LeaderFd);
+        pReplicaContext->LeaderFd = -1;
+        return FALSE;
+    }
+
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+// __lockReplica()
+// This function keeps the replica thread off the trees while the command loop runs a command
+VOID __lockReplica(struct _REPLICA_CONTEXT *pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    if (pReplicaContext->bRunning)
+    {
+        pthread_mutex_lock(&pReplicaContext->CommandMutex);
+    }
+#endif
+}
+
+// __unlockReplica()
+// This function lets the replica thread at the trees again after a command
+VOID __unlockReplica(struct _REPLICA_CONTEXT *pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    if (pReplicaContext->bRunning)
+    {
+        pthread_mutex_unlock(&pReplicaContext->CommandMutex);
+    }
+#endif
+}
+
+// __appendReplicaRecord()
+// This function gives the update the next sequence and logs it for the followers. Without followers nothing
+// is kept, a follower that comes later is bootstrapped past it. The leader thread is woken only if its
+// sleeping, updates that come in while it sends go out together in the next batch
+VOID __appendReplicaRecord(struct _REPLICA_CONTEXT *pReplicaContext, CHAR *pNamespace, REPLICA_OP Op, INT ID1, INT ID2, INT Value)
+{
+#if !defined(_MSC_VER)
+    PREPLICA_RECORD pRecord = NULL;
+    BOOLEAN         bWake   = FALSE;
+    CHAR            Wake    = 0;
+
+    if (!pReplicaContext->bRunning)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+    pReplicaContext->LastSequence++;
+
+    if (pReplicaContext->NumFollowers == 0)
+    {
+        pReplicaContext->NumLogRecords = 0;
+    }
+    else
+    {
+        if (pReplicaContext->NumLogRecords == 0)
+        {
+            pReplicaContext->LogBaseSequence = pReplicaContext->LastSequence;
+        }
+
+        // Grow the log by doubling
+        if (pReplicaContext->NumLogRecords == pReplicaContext->MaxLogRecords)
+        {
+            pReplicaContext->MaxLogRecords = pReplicaContext->MaxLogRecords ? pReplicaContext->MaxLogRecords * 2 : REPLICA_MIN_LOG_RECORDS;
+            pReplicaContext->pLogRecordList = (PREPLICA_RECORD)realloc(pReplicaContext->pLogRecordList, sizeof(REPLICA_RECORD) * pReplicaContext->MaxLogRecords);
+        }
+
+        pRecord = &pReplicaContext->pLogRecordList[pReplicaContext->NumLogRecords++];
+        memset(pRecord, 0, sizeof(REPLICA_RECORD));
+        pRecord->Sequence   = pReplicaContext->LastSequence;
+        pRecord->Op         = Op;
+        pRecord->ID1        = ID1;
+        pRecord->ID2        = ID2;
+        pRecord->Value      = Value;
+        strncpy(pRecord->Namespace, pNamespace, REPLICA_MAX_NAME_LENGTH - 1);
+
+        bWake = pReplicaContext->bSleeping;
+        pReplicaContext->bSleeping = FALSE;
+    }
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+
+    if (bWake && write(pReplicaContext->WakeFdList[1], &Wake, 1) < 0)
+    {
+        // Pipe is full, the leader thread has a wake up waiting anyway
+    }
+#endif
+}
+
+// __addReplicaNamespace()
+// This function adds a namespace to the ones a bootstrap walks. Called by the command loop, which holds
+// the command lock, so a bootstrap never sees the list half updated
+VOID __addReplicaNamespace(struct _REPLICA_CONTEXT *pReplicaContext, CHAR *pName, PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext)
+{
+    PREPLICA_NAMESPACE  pNamespace = NULL;
+
+    // Grow the namespace list by doubling
+    if (pReplicaContext->NumNamespaces == pReplicaContext->MaxNamespaces)
+    {
+        pReplicaContext->MaxNamespaces = pReplicaContext->MaxNamespaces ? pReplicaContext->MaxNamespaces * 2 : REPLICA_MIN_NAMESPACES;
+        pReplicaContext->pNamespaceList = (PREPLICA_NAMESPACE)realloc(pReplicaContext->pNamespaceList, sizeof(REPLICA_NAMESPACE) * pReplicaContext->MaxNamespaces);
+    }
+
+    pNamespace = &pReplicaContext->pNamespaceList[pReplicaContext->NumNamespaces++];
+    memset(pNamespace->Name, 0, sizeof(pNamespace->Name));
+    strncpy(pNamespace->Name, pName, REPLICA_MAX_NAME_LENGTH - 1);
+    pNamespace->pRbTreeContext      = pRbTreeContext;
+    pNamespace->pColdStoreContext   = pColdStoreContext;
+}
+
+// __waitReplicaBootstrap()
+// This function blocks the follower till the snapshot from the leader is applied. Returns FALSE if the
+// stream ended before
+BOOLEAN __waitReplicaBootstrap(struct _REPLICA_CONTEXT *pReplicaContext)
+{
+    BOOLEAN bBootstrapped = FALSE;
+
+#if !defined(_MSC_VER)
+    if (!pReplicaContext->bRunning)
+    {
+        return FALSE;
+    }
+
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+    while (!pReplicaContext->bBootstrapped && !pReplicaContext->bStop)
+    {
+        pthread_cond_wait(&pReplicaContext->BootstrapCond, &pReplicaContext->LogMutex);
+    }
+    bBootstrapped = pReplicaContext->bBootstrapped;
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+#endif
+
+    return bBootstrapped;
+}
+
+// __waitReplicaFollowers()
+// This function blocks the leader till as many followers as asked for are bootstrapped, so the commands that
+// follow reach all of them. Returns FALSE if they dont come in REPLICA_WAIT_FOLLOWERS_SECONDS
+BOOLEAN __waitReplicaFollowers(struct _REPLICA_CONTEXT *pReplicaContext, UINT NumFollowers)
+{
+    BOOLEAN             bFollowers      = FALSE;
+#if !defined(_MSC_VER)
+    struct timespec     Deadline;
+    UINT                NumStreaming    = 0;
+    UINT                Index           = 0;
+
+    if (!pReplicaContext->bRunning)
+    {
+        return FALSE;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &Deadline);
+    Deadline.tv_sec += REPLICA_WAIT_FOLLOWERS_SECONDS;
+
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+    do
+    {
+        for (Index = 0, NumStreaming = 0; Index < pReplicaContext->NumFollowers; Index++)
+        {
+            NumStreaming += pReplicaContext->FollowerList[Index].State == REPLICA_FOLLOWER_STREAMING;
+        }
+    } while (NumStreaming < NumFollowers && pthread_cond_timedwait(&pReplicaContext->BootstrapCond, &pReplicaContext->LogMutex, &Deadline) != ETIMEDOUT);
+    bFollowers = NumStreaming >= NumFollowers;
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+#endif
+
+    return bFollowers;
+}
+
+// __waitReplicaLeader()
+// This function blocks the follower till the leader has quit and everything it sent is applied. Called by the
+// command loop, which holds the command lock the follower thread applies under, so it lets go of it meanwhile
+VOID __waitReplicaLeader(struct _REPLICA_CONTEXT *pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    if (!pReplicaContext->bRunning)
+    {
+        return;
+    }
+
+    pthread_mutex_unlock(&pReplicaContext->CommandMutex);
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+    while (!pReplicaContext->bStop)
+    {
+        pthread_cond_wait(&pReplicaContext->BootstrapCond, &pReplicaContext->LogMutex);
+    }
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+    pthread_mutex_lock(&pReplicaContext->CommandMutex);
+#endif
+}
+
+// __stopReplica()
+// This function stops the replica thread and closes the sockets. The leader sends what is left of the log
+// to the followers first. Must be called without the command lock
+VOID __stopReplica(struct _REPLICA_CONTEXT *pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    CHAR    Wake = 0;
+
+    if (!pReplicaContext->bRunning)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+    pReplicaContext->bStop = TRUE;
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+
+    if (pReplicaContext->bFollower)
+    {
+        // Wakes the follower thread out of its read
+        shutdown(pReplicaContext->LeaderFd, SHUT_RDWR);
+    }
+    else if (write(pReplicaContext->WakeFdList[1], &Wake, 1) < 0)
+    {
+        // Leader thread looks at bStop at least every heartbeat
+    }
+
+    pthread_join(pReplicaContext->ReplicaThread, NULL);
+
+    if (pReplicaContext->bFollower)
+    {
+        close(pReplicaContext->LeaderFd);
+        pReplicaContext->LeaderFd = -1;
+    }
+    else
+    {
+        close(pReplicaContext->ListenFd);
+        close(pReplicaContext->WakeFdList[0]);
+        close(pReplicaContext->WakeFdList[1]);
+        pReplicaContext->ListenFd = -1;
+    }
+
+    pthread_cond_destroy(&pReplicaContext->BootstrapCond);
+    pthread_mutex_destroy(&pReplicaContext->LogMutex);
+    pthread_mutex_destroy(&pReplicaContext->CommandMutex);
+    pReplicaContext->bRunning = FALSE;
+#endif
+}
+
+// __sendReplicaBuffer()
+// This function sends the whole buffer, returns FALSE if the peer is gone or doesnt take it in time
+BOOLEAN __sendReplicaBuffer(INT Fd, VOID *pBuffer, size_t Length)
+{
+#if !defined(_MSC_VER)
+    UCHAR   *pNext  = (UCHAR*)pBuffer;
+    ssize_t Sent    = 0;
+
+    while (Length)
+    {
+        Sent = send(Fd, pNext, Length, MSG_NOSIGNAL);
+        if (Sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (Sent <= 0)
+        {
+            return FALSE;
+        }
+        pNext   += Sent;
+        Length  -= (size_t)Sent;
+    }
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+// __recvReplicaBuffer()
+// This function reads exactly the length, returns FALSE once the stream is closed
+BOOLEAN __recvReplicaBuffer(INT Fd, VOID *pBuffer, size_t Length)
+{
+#if !defined(_MSC_VER)
+    UCHAR   *pNext      = (UCHAR*)pBuffer;
+    ssize_t Received    = 0;
+
+    while (Length)
+    {
+        Received = recv(Fd, pNext, Length, 0);
+        if (Received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (Received <= 0)
+        {
+            return FALSE;
+        }
+        pNext   += Received;
+        Length  -= (size_t)Received;
+    }
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+// __sendReplicaBatch()
+// This function fills in the header in front of the records of the batch and sends the batch with one send
+BOOLEAN __sendReplicaBatch(INT Fd, UCHAR *pBatch, UINT NumRecords, ULONGLONG LeaderSequence)
+{
+    PREPLICA_BATCH_HEADER   pHeader = (PREPLICA_BATCH_HEADER)pBatch;
+
+    pHeader->Magic          = REPLICA_BATCH_MAGIC;
+    pHeader->NumRecords     = NumRecords;
+    pHeader->LeaderSequence = LeaderSequence;
+    pHeader->SendTimeNs     = __getReplicaTimeNs();
+
+    return __sendReplicaBuffer(Fd, pBatch, sizeof(REPLICA_BATCH_HEADER) + sizeof(REPLICA_RECORD) * NumRecords);
+}
+
+// __runReplicaLeader()
+// This is the leader thread. It sleeps in poll till an update is logged, a follower connects or acks, or the
+// heartbeat is due. Every round forks the bootstraps of new followers and sends each streaming follower the
+// records it hasnt got yet
+VOID* __runReplicaLeader(VOID *pArg)
+{
+#if !defined(_MSC_VER)
+    PREPLICA_CONTEXT    pReplicaContext = (PREPLICA_CONTEXT)pArg;
+    struct pollfd       PollList[2 + REPLICA_MAX_FOLLOWERS];
+    UCHAR               *pBatch         = NULL;
+    CHAR                WakeList[64];
+    UINT                Index           = 0;
+    BOOLEAN             bStop           = FALSE;
+
+    pBatch = (UCHAR*)malloc(sizeof(REPLICA_BATCH_HEADER) + sizeof(REPLICA_RECORD) * REPLICA_MAX_BATCH_RECORDS);
+
+    while (!bStop)
+    {
+        PollList[0].fd      = pReplicaContext->WakeFdList[0];
+        PollList[0].events  = POLLIN;
+        PollList[0].revents = 0;
+        PollList[1].fd      = pReplicaContext->NumFollowers < REPLICA_MAX_FOLLOWERS ? pReplicaContext->ListenFd : -1;
+        PollList[1].events  = POLLIN;
+        PollList[1].revents = 0;
+        for (Index = 0; Index < pReplicaContext->NumFollowers; Index++)
+        {
+            PollList[2 + Index].fd      = pReplicaContext->FollowerList[Index].Fd;
+            PollList[2 + Index].events  = POLLIN;
+            PollList[2 + Index].revents = 0;
+        }
+
+        // Nothing logged since the last send, sleep till there is
+        pthread_mutex_lock(&pReplicaContext->LogMutex);
+        pReplicaContext->bSleeping = TRUE;
+        bStop = pReplicaContext->bStop;
+        pthread_mutex_unlock(&pReplicaContext->LogMutex);
+
+        if (!bStop && poll(PollList, 2 + pReplicaContext->NumFollowers, REPLICA_HEARTBEAT_MS) < 0 && errno != EINTR)
+        {
+            break;
+        }
+
+        pthread_mutex_lock(&pReplicaContext->LogMutex);
+        pReplicaContext->bSleeping = FALSE;
+        bStop = pReplicaContext->bStop;
+        pthread_mutex_unlock(&pReplicaContext->LogMutex);
+
+        while (read(pReplicaContext->WakeFdList[0], WakeList, sizeof(WakeList)) > 0);
+
+        // Acks and hang ups, dropping a follower moves the last one into its place
+        for (Index = pReplicaContext->NumFollowers; Index > 0; Index--)
+        {
+            if ((PollList[1 + Index].revents & (POLLIN | POLLERR | POLLHUP)) &&
+                !__readReplicaAcks(pReplicaContext, &pReplicaContext->FollowerList[Index - 1]))
+            {
+                __dropReplicaFollower(pReplicaContext, Index - 1);
+            }
+        }
+
+        if (!bStop && (PollList[1].revents & POLLIN))
+        {
+            __acceptReplicaFollower(pReplicaContext);
+        }
+
+        __bootstrapReplicaFollowers(pReplicaContext);
+        __sendReplicaLog(pReplicaContext, pBatch);
+        __trimReplicaLog(pReplicaContext);
+    }
+
+    // Followers still bootstrapping dont get the end of the log, they see the leader go away
+    while (pReplicaContext->NumFollowers)
+    {
+        __closeReplicaFollower(&pReplicaContext->FollowerList[pReplicaContext->NumFollowers - 1]);
+        __dropReplicaFollower(pReplicaContext, pReplicaContext->NumFollowers - 1);
+    }
+
+    free(pBatch);
+#endif
+    return NULL;
+}
+
+// __acceptReplicaFollower()
+// This function takes a new follower, its bootstrap is forked in the same round
+VOID __acceptReplicaFollower(PREPLICA_CONTEXT pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    PREPLICA_FOLLOWER   pFollower       = NULL;
+    struct sockaddr_in  Address;
+    socklen_t           AddressLength   = sizeof(Address);
+    struct timeval      SendTimeout     = { REPLICA_SEND_TIMEOUT_SECONDS, 0 };
+    INT                 Option          = 1;
+    INT                 Fd              = -1;
+
+    Fd = accept(pReplicaContext->ListenFd, (struct sockaddr*)&Address, &AddressLength);
+    if (Fd < 0)
+    {
+        return;
+    }
+
+    // A follower that stops reading is dropped instead of stalling the others
+    setsockopt(Fd, IPPROTO_TCP, TCP_NODELAY, &Option, sizeof(Option));
+    setsockopt(Fd, SOL_SOCKET, SO_SNDTIMEO, &SendTimeout, sizeof(SendTimeout));
+
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+    pFollower = &pReplicaContext->FollowerList[pReplicaContext->NumFollowers++];
+    memset(pFollower, 0, sizeof(REPLICA_FOLLOWER));
+    pFollower->Fd           = Fd;
+    pFollower->State        = REPLICA_FOLLOWER_CONNECTED;
+    pFollower->BootstrapPid = -1;
+    snprintf(pFollower->Address, sizeof(pFollower->Address), "%s:%u", inet_ntoa(Address.sin_addr), ntohs(Address.sin_port));
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+
+    fprintf(stderr, "replica: follower %s connected\n", pFollower->Address);
+#endif
+}
+
+// __readReplicaAcks()
+// This function reads the sequences the follower acked, the last one counts. Returns FALSE if the follower hung up
+BOOLEAN __readReplicaAcks(PREPLICA_CONTEXT pReplicaContext, PREPLICA_FOLLOWER pFollower)
+{
+#if !defined(_MSC_VER)
+    ULONGLONG   AckList[64];
+    ssize_t     Length = 0;
+
+    // Acks are 8 bytes and sent whole, a partial one is only ever the tail of a read that got cut
+    Length = recv(pFollower->Fd, AckList, sizeof(AckList), MSG_DONTWAIT);
+    if (Length == 0 || (Length < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+    {
+        return FALSE;
+    }
+
+    if (Length >= (ssize_t)sizeof(ULONGLONG))
+    {
+        pthread_mutex_lock(&pReplicaContext->LogMutex);
+        pFollower->AckedSequence = AckList[Length / sizeof(ULONGLONG) - 1];
+        pthread_mutex_unlock(&pReplicaContext->LogMutex);
+    }
+#endif
+    return TRUE;
+}
+
+// __closeReplicaFollower()
+// This function ends the stream to a follower before it is dropped at quit. Closing a socket with acks still
+// unread makes the kernel reset the connection, and the reset can throw away the last batches the follower
+// hasnt read yet. So only the send side is shut and the acks are read till the follower hangs up (or a
+// heartbeat passes without any)
+VOID __closeReplicaFollower(PREPLICA_FOLLOWER pFollower)
+{
+#if !defined(_MSC_VER)
+    struct pollfd   PollFd;
+    ULONGLONG       AckList[64];
+
+    if (pFollower->State != REPLICA_FOLLOWER_STREAMING)
+    {
+        return;
+    }
+
+    shutdown(pFollower->Fd, SHUT_WR);
+
+    PollFd.fd     = pFollower->Fd;
+    PollFd.events = POLLIN;
+    while (poll(&PollFd, 1, REPLICA_HEARTBEAT_MS) > 0 && recv(pFollower->Fd, AckList, sizeof(AckList), 0) > 0);
+#endif
+}
+
+// __dropReplicaFollower()
+// This function closes the follower, a bootstrap still running for it is killed
+VOID __dropReplicaFollower(PREPLICA_CONTEXT pReplicaContext, UINT FollowerIndex)
+{
+#if !defined(_MSC_VER)
+    PREPLICA_FOLLOWER   pFollower = &pReplicaContext->FollowerList[FollowerIndex];
+
+    if (pFollower->BootstrapPid > 0)
+    {
+        kill(pFollower->BootstrapPid, SIGKILL);
+        waitpid(pFollower->BootstrapPid, NULL, 0);
+    }
+    close(pFollower->Fd);
+
+    if (!pReplicaContext->bStop)
+    {
+        fprintf(stderr, "replica: follower %s dropped at sequence %llu\n", pFollower->Address, pFollower->AckedSequence);
+    }
+
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+    *pFollower = pReplicaContext->FollowerList[--pReplicaContext->NumFollowers];
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+#endif
+}
+
+// __bootstrapReplicaFollowers()
+// This function forks a bootstrap for every new follower and starts streaming to the ones whose bootstrap
+// is over. The fork is done holding the command lock, so the child gets the trees as they are between two
+// commands, with all the updates up to the last logged sequence and none after it
+VOID __bootstrapReplicaFollowers(PREPLICA_CONTEXT pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    PREPLICA_FOLLOWER   pFollower   = NULL;
+    ULONGLONG           Sequence    = 0;
+    INT                 ChildPid    = 0;
+    INT                 Status      = 0;
+    UINT                Index       = 0;
+
+    for (Index = pReplicaContext->NumFollowers; Index > 0; Index--)
+    {
+        pFollower = &pReplicaContext->FollowerList[Index - 1];
+
+        if (pFollower->State == REPLICA_FOLLOWER_CONNECTED)
+        {
+            pthread_mutex_lock(&pReplicaContext->CommandMutex);
+            pthread_mutex_lock(&pReplicaContext->LogMutex);
+            Sequence = pReplicaContext->LastSequence;
+
+            ChildPid = fork();
+            if (ChildPid == 0)
+            {
+                // Child has only this thread and its own copy of the trees, it leaves without any exit handler
+                _exit(__writeReplicaBootstrap(pReplicaContext, pFollower->Fd, Sequence) ? 0 : 1);
+            }
+
+            if (ChildPid > 0)
+            {
+                pFollower->State        = REPLICA_FOLLOWER_BOOTSTRAP;
+                pFollower->BootstrapPid = ChildPid;
+                pFollower->NextSequence = Sequence + 1;
+            }
+            pthread_mutex_unlock(&pReplicaContext->LogMutex);
+            pthread_mutex_unlock(&pReplicaContext->CommandMutex);
+
+            if (ChildPid < 0)
+            {
+                __dropReplicaFollower(pReplicaContext, Index - 1);
+            }
+        }
+        else if (pFollower->State == REPLICA_FOLLOWER_BOOTSTRAP && waitpid(pFollower->BootstrapPid, &Status, WNOHANG) == pFollower->BootstrapPid)
+        {
+            pFollower->BootstrapPid = -1;
+            if (WIFEXITED(Status) && WEXITSTATUS(Status) == 0)
+            {
+                pthread_mutex_lock(&pReplicaContext->LogMutex);
+                pFollower->State = REPLICA_FOLLOWER_STREAMING;
+                pthread_cond_broadcast(&pReplicaContext->BootstrapCond);
+                pthread_mutex_unlock(&pReplicaContext->LogMutex);
+                fprintf(stderr, "replica: follower %s bootstrapped at sequence %llu\n", pFollower->Address, pFollower->NextSequence - 1);
+            }
+            else
+            {
+                __dropReplicaFollower(pReplicaContext, Index - 1);
+            }
+        }
+    }
+#endif
+}
+
+// __writeReplicaBootstrap()
+// This function runs in the forked child and sends all the events of every namespace in ID order, the frozen
+// ones merged in, in full batches. The last batch ends with the sequence the snapshot is at
+BOOLEAN __writeReplicaBootstrap(PREPLICA_CONTEXT pReplicaContext, INT Fd, ULONGLONG Sequence)
+{
+    PREPLICA_NAMESPACE  pNamespace      = NULL;
+    PRB_TREE_CONTEXT    pRbTreeContext  = NULL;
+    PCOLD_STORE_CONTEXT pColdStoreContext = NULL;
+    PRB_TREE_NODE       pRbTreeNode     = NULL;
+    PRADIX_SORT_RECORD  pColdRecordList = NULL;
+    UINT                NumColdRecords  = 0;
+    UCHAR               *pBatch         = NULL;
+    UINT                NumRecords      = 0;
+    REPLICA_RECORD      Record;
+    UINT                NamespaceIndex  = 0;
+    UINT                SegmentIndex    = 0;
+    UINT                Index           = 0;
+    BOOLEAN             bRetStatus      = TRUE;
+
+    pBatch = (UCHAR*)malloc(sizeof(REPLICA_BATCH_HEADER) + sizeof(REPLICA_RECORD) * REPLICA_MAX_BATCH_RECORDS);
+    memset(&Record, 0, sizeof(Record));
+    Record.Op = REPLICA_OP_BOOTSTRAP_EVENT;
+
+    for (NamespaceIndex = 0; NamespaceIndex < pReplicaContext->NumNamespaces && bRetStatus; NamespaceIndex++)
+    {
+        pNamespace          = &pReplicaContext->pNamespaceList[NamespaceIndex];
+        pRbTreeContext      = pNamespace->pRbTreeContext;
+        pColdStoreContext   = pNamespace->pColdStoreContext;
+        memcpy(Record.Namespace, pNamespace->Name, sizeof(Record.Namespace));
+
+        // Closest node to the smallest ID is the first event
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, INT_MIN);
+        for (SegmentIndex = 0; pColdStoreContext && SegmentIndex < pColdStoreContext->NumSegments && bRetStatus; SegmentIndex++)
+        {
+            NumColdRecords = pColdStoreContext->stColdStoreFnTbl.readColdStoreSegment(pColdStoreContext, SegmentIndex, &pColdRecordList);
+            for (Index = 0; Index < NumColdRecords && bRetStatus; Index++)
+            {
+                while (pRbTreeNode && pRbTreeNode->ID < pColdRecordList[Index].ID && bRetStatus)
+                {
+                    Record.ID1      = pRbTreeNode->ID;
+                    Record.Value    = pRbTreeNode->Count;
+                    bRetStatus      = __addReplicaBootstrapRecord(&Record, Fd, pBatch, &NumRecords, Sequence);
+                    pRbTreeNode     = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+                }
+                Record.ID1      = pColdRecordList[Index].ID;
+                Record.Value    = pColdRecordList[Index].Count;
+                bRetStatus      = bRetStatus && __addReplicaBootstrapRecord(&Record, Fd, pBatch, &NumRecords, Sequence);
+            }
+            free(pColdRecordList);
+        }
+
+        while (pRbTreeNode && bRetStatus)
+        {
+            Record.ID1      = pRbTreeNode->ID;
+            Record.Value    = pRbTreeNode->Count;
+            bRetStatus      = __addReplicaBootstrapRecord(&Record, Fd, pBatch, &NumRecords, Sequence);
+            pRbTreeNode     = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+        }
+    }
+
+    if (bRetStatus)
+    {
+        memset(&Record, 0, sizeof(Record));
+        Record.Op       = REPLICA_OP_BOOTSTRAP_DONE;
+        Record.Sequence = Sequence;
+        bRetStatus      = __addReplicaBootstrapRecord(&Record, Fd, pBatch, &NumRecords, Sequence) &&
+                          __sendReplicaBatch(Fd, pBatch, NumRecords, Sequence);
+    }
+
+    free(pBatch);
+    return bRetStatus;
+}
+
+// __addReplicaBootstrapRecord()
+// This function adds the record to the batch of the bootstrap, a full batch is sent first
+BOOLEAN __addReplicaBootstrapRecord(PREPLICA_RECORD pRecord, INT Fd, UCHAR *pBatch, UINT *pNumRecords, ULONGLONG Sequence)
+{
+    PREPLICA_RECORD pRecordList = (PREPLICA_RECORD)(pBatch + sizeof(REPLICA_BATCH_HEADER));
+
+    if (*pNumRecords == REPLICA_MAX_BATCH_RECORDS)
+    {
+        if (!__sendReplicaBatch(Fd, pBatch, *pNumRecords, Sequence))
+        {
+            return FALSE;
+        }
+        *pNumRecords = 0;
+    }
+
+    pRecordList[(*pNumRecords)++] = *pRecord;
+    return TRUE;
+}
+
+// __sendReplicaLog()
+// This function sends every streaming follower the logged records it hasnt got, in batches of up to
+// REPLICA_MAX_BATCH_RECORDS. Records are copied out of the log under the lock and sent without it, so the
+// command loop can go on logging. A follower that got nothing for a heartbeat gets an empty batch
+VOID __sendReplicaLog(PREPLICA_CONTEXT pReplicaContext, UCHAR *pBatch)
+{
+#if !defined(_MSC_VER)
+    PREPLICA_FOLLOWER   pFollower       = NULL;
+    ULONGLONG           LeaderSequence  = 0;
+    ULONGLONG           Now             = 0;
+    UINT                NumRecords      = 0;
+    UINT                StartIndex      = 0;
+    UINT                Index           = 0;
+
+    for (Index = pReplicaContext->NumFollowers; Index > 0; Index--)
+    {
+        pFollower = &pReplicaContext->FollowerList[Index - 1];
+        if (pFollower->State != REPLICA_FOLLOWER_STREAMING)
+        {
+            continue;
+        }
+
+        do
+        {
+            pthread_mutex_lock(&pReplicaContext->LogMutex);
+            LeaderSequence  = pReplicaContext->LastSequence;
+            NumRecords      = 0;
+            if (pFollower->NextSequence <= LeaderSequence)
+            {
+                StartIndex = (UINT)(pFollower->NextSequence - pReplicaContext->LogBaseSequence);
+                NumRecords = pReplicaContext->NumLogRecords - StartIndex;
+                if (NumRecords > REPLICA_MAX_BATCH_RECORDS)
+                {
+                    NumRecords = REPLICA_MAX_BATCH_RECORDS;
+                }
+                memcpy(pBatch + sizeof(REPLICA_BATCH_HEADER), &pReplicaContext->pLogRecordList[StartIndex], sizeof(REPLICA_RECORD) * NumRecords);
+            }
+            pthread_mutex_unlock(&pReplicaContext->LogMutex);
+
+            Now = __getReplicaTimeNs();
+            if (NumRecords == 0 && Now - pFollower->LastSendTimeNs < REPLICA_HEARTBEAT_MS * 1000000ULL)
+            {
+                break;
+            }
+
+            if (!__sendReplicaBatch(pFollower->Fd, pBatch, NumRecords, LeaderSequence))
+            {
+                __dropReplicaFollower(pReplicaContext, Index - 1);
+                break;
+            }
+
+            pthread_mutex_lock(&pReplicaContext->LogMutex);
+            pFollower->NextSequence     += NumRecords;
+            pFollower->LastSendTimeNs   = Now;
+            pFollower->NumBatches++;
+            pFollower->NumRecords       += NumRecords;
+            pthread_mutex_unlock(&pReplicaContext->LogMutex);
+
+        } while (NumRecords == REPLICA_MAX_BATCH_RECORDS);
+    }
+#endif
+}
+
+// __trimReplicaLog()
+// This function drops the records every follower got. The rest is moved down only once the dropped part is
+// at least as big, so a record is moved a few times at most
+VOID __trimReplicaLog(PREPLICA_CONTEXT pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    ULONGLONG   MinSequence     = 0;
+    UINT        NumDropped      = 0;
+    UINT        Index           = 0;
+
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+
+    // New followers are bootstrapped past everything logged so far
+    MinSequence = pReplicaContext->LastSequence + 1;
+    for (Index = 0; Index < pReplicaContext->NumFollowers; Index++)
+    {
+        if (pReplicaContext->FollowerList[Index].State != REPLICA_FOLLOWER_CONNECTED &&
+            pReplicaContext->FollowerList[Index].NextSequence < MinSequence)
+        {
+            MinSequence = pReplicaContext->FollowerList[Index].NextSequence;
+        }
+    }
+
+    if (pReplicaContext->NumLogRecords && MinSequence > pReplicaContext->LogBaseSequence)
+    {
+        NumDropped = (UINT)(MinSequence - pReplicaContext->LogBaseSequence);
+        if (NumDropped >= pReplicaContext->NumLogRecords)
+        {
+            pReplicaContext->NumLogRecords      = 0;
+            pReplicaContext->LogBaseSequence    = MinSequence;
+        }
+        else if (NumDropped >= pReplicaContext->NumLogRecords - NumDropped)
+        {
+            memmove(pReplicaContext->pLogRecordList, &pReplicaContext->pLogRecordList[NumDropped],
+                sizeof(REPLICA_RECORD) * (pReplicaContext->NumLogRecords - NumDropped));
+            pReplicaContext->NumLogRecords      -= NumDropped;
+            pReplicaContext->LogBaseSequence    = MinSequence;
+        }
+    }
+
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+#endif
+}
+
+// __runReplicaFollower()
+// This is the follower thread. Each batch from the leader is applied under the command lock as a whole and
+// acked with the last sequence applied. Lag is the time from the send of the batch to the end of its apply
+VOID* __runReplicaFollower(VOID *pArg)
+{
+#if !defined(_MSC_VER)
+    PREPLICA_CONTEXT        pReplicaContext = (PREPLICA_CONTEXT)pArg;
+    REPLICA_BATCH_HEADER    Header;
+    PREPLICA_RECORD         pRecordList     = NULL;
+    ULONGLONG               AppliedSequence = 0;
+    ULONGLONG               Now             = 0;
+    BOOLEAN                 bBootstrapped   = FALSE;
+    UINT                    Index           = 0;
+
+    pRecordList = (PREPLICA_RECORD)malloc(sizeof(REPLICA_RECORD) * REPLICA_MAX_BATCH_RECORDS);
+
+    while (__recvReplicaBuffer(pReplicaContext->LeaderFd, &Header, sizeof(Header)))
+    {
+        if (Header.Magic != REPLICA_BATCH_MAGIC || Header.NumRecords > REPLICA_MAX_BATCH_RECORDS)
+        {
+            fprintf(stderr, "replica: bad batch from %s, leader runs another build\n", pReplicaContext->LeaderAddress);
+            break;
+        }
+
+        if (Header.NumRecords && !__recvReplicaBuffer(pReplicaContext->LeaderFd, pRecordList, sizeof(REPLICA_RECORD) * Header.NumRecords))
+        {
+            break;
+        }
+
+        if (Header.NumRecords)
+        {
+            pthread_mutex_lock(&pReplicaContext->CommandMutex);
+            pReplicaContext->pfnApply(pReplicaContext->pApplyContext, pRecordList, Header.NumRecords);
+            pthread_mutex_unlock(&pReplicaContext->CommandMutex);
+        }
+        Now = __getReplicaTimeNs();
+
+        pthread_mutex_lock(&pReplicaContext->LogMutex);
+        for (Index = 0; Index < Header.NumRecords; Index++)
+        {
+            if (pRecordList[Index].Op == REPLICA_OP_BOOTSTRAP_DONE)
+            {
+                pReplicaContext->bBootstrapped = TRUE;
+                pthread_cond_broadcast(&pReplicaContext->BootstrapCond);
+            }
+            if (pRecordList[Index].Op != REPLICA_OP_BOOTSTRAP_EVENT)
+            {
+                pReplicaContext->AppliedSequence = pRecordList[Index].Sequence;
+            }
+        }
+        if (Header.LeaderSequence > pReplicaContext->LeaderSequence)
+        {
+            pReplicaContext->LeaderSequence = Header.LeaderSequence;
+        }
+        pReplicaContext->LastLagNs = Now > Header.SendTimeNs ? Now - Header.SendTimeNs : 0;
+        if (pReplicaContext->LastLagNs > pReplicaContext->MaxLagNs)
+        {
+            pReplicaContext->MaxLagNs = pReplicaContext->LastLagNs;
+        }
+        pReplicaContext->NumBatches++;
+        pReplicaContext->NumRecords += Header.NumRecords;
+        AppliedSequence = pReplicaContext->AppliedSequence;
+        bBootstrapped   = pReplicaContext->bBootstrapped;
+        pthread_mutex_unlock(&pReplicaContext->LogMutex);
+
+        // Leader only reads acks from followers that are streaming
+        if (bBootstrapped)
+        {
+            __sendReplicaBuffer(pReplicaContext->LeaderFd, &AppliedSequence, sizeof(AppliedSequence));
+        }
+    }
+
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+    if (!pReplicaContext->bStop)
+    {
+        fprintf(stderr, "replica: stream from %s ended at sequence %llu, serving what was applied\n", pReplicaContext->LeaderAddress,
+            pReplicaContext->AppliedSequence);
+    }
+    shutdown(pReplicaContext->LeaderFd, SHUT_RDWR);
+    pReplicaContext->bStop = TRUE;
+    pthread_cond_broadcast(&pReplicaContext->BootstrapCond);
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+
+    free(pRecordList);
+#endif
+    return NULL;
+}
+
+// __printReplicaStats()
+// This function prints the sequence of the leader and how far each follower got, or how far the follower is
+// behind its leader with the lag of its last batch
+VOID __printReplicaStats(struct _REPLICA_CONTEXT *pReplicaContext)
+{
+#if !defined(_MSC_VER)
+    PREPLICA_FOLLOWER   pFollower   = NULL;
+    UINT                Index       = 0;
+    CHAR                *StateList[] = { "connected", "bootstrap", "streaming" };
+
+    pthread_mutex_lock(&pReplicaContext->LogMutex);
+    if (pReplicaContext->bFollower)
+    {
+        printf("replica follower of %s %s applied %llu leader %llu behind %llu lag ms %.3f max %.3f batches %llu records %llu\n",
+            pReplicaContext->LeaderAddress, pReplicaContext->bStop ? "disconnected" : (pReplicaContext->bBootstrapped ? "streaming" : "bootstrap"),
+            pReplicaContext->AppliedSequence, pReplicaContext->LeaderSequence,
+            pReplicaContext->LeaderSequence > pReplicaContext->AppliedSequence ? pReplicaContext->LeaderSequence - pReplicaContext->AppliedSequence : 0,
+            pReplicaContext->LastLagNs / 1e6, pReplicaContext->MaxLagNs / 1e6, pReplicaContext->NumBatches, pReplicaContext->NumRecords);
+    }
+    else
+    {
+        printf("replica leader port %d sequence %llu log records %u followers %u\n", pReplicaContext->Port, pReplicaContext->LastSequence,
+            pReplicaContext->NumLogRecords, pReplicaContext->NumFollowers);
+        for (Index = 0; Index < pReplicaContext->NumFollowers; Index++)
+        {
+            pFollower = &pReplicaContext->FollowerList[Index];
+            printf("follower %s %s sent %llu acked %llu behind %llu batches %llu records %llu\n", pFollower->Address, StateList[pFollower->State],
+                pFollower->NextSequence ? pFollower->NextSequence - 1 : 0, pFollower->AckedSequence,
+                pReplicaContext->LastSequence - (pFollower->AckedSequence < pReplicaContext->LastSequence ? pFollower->AckedSequence : pReplicaContext->LastSequence),
+                pFollower->NumBatches, pFollower->NumRecords);
+        }
+    }
+    pthread_mutex_unlock(&pReplicaContext->LogMutex);
+#endif
+}
@@ -0,0 +1,153 @@
+//
+// This file contains all the header definitions for
+// the replication of the updates from a leader to read only followers
+//
+
+#ifndef _REPLICA_H_
+#define _REPLICA_H_
+
+#include "Types.h"
+#include "RbTree.h"
+#include "ColdStore.h"
+
+// Definitions
+#define REPLICA_MAX_NAME_LENGTH         40
+#define REPLICA_MAX_BATCH_RECORDS       1024
+#define REPLICA_MIN_LOG_RECORDS         1024
+#define REPLICA_MIN_NAMESPACES          8
+#define REPLICA_MAX_FOLLOWERS           32
+#define REPLICA_HEARTBEAT_MS            100
+#define REPLICA_SEND_TIMEOUT_SECONDS    5
+#define REPLICA_WAIT_FOLLOWERS_SECONDS  30
+#define REPLICA_CONNECT_RETRIES         50
+#define REPLICA_CONNECT_RETRY_MS        100
+#define REPLICA_BATCH_MAGIC             0x5242424C
+
+// Effect of an update, or a part of the bootstrap. Updates are sent as what they did so that a follower
+// ends up with the same counts whatever it holds frozen. Every update command is one record
+typedef enum _REPLICA_OP
+{
+    REPLICA_OP_SET,                 // Event ID1 has the count Value now, 0 if it was removed
+    REPLICA_OP_DELETE_RANGE,        // Events ID1 to ID2 were removed
+    REPLICA_OP_INCREASE_RANGE,      // Events ID1 to ID2 were increased by Value
+    REPLICA_OP_BOOTSTRAP_EVENT,     // Event ID1 with the count Value is in the snapshot
+    REPLICA_OP_BOOTSTRAP_DONE       // Snapshot is over, it has all the updates up to Sequence
+}REPLICA_OP;
+
+// Record of the update log, the same layout on the wire. Both ends run the same build
+typedef struct _REPLICA_RECORD
+{
+    ULONGLONG   Sequence;
+    INT         Op;
+    INT         ID1;
+    INT         ID2;
+    INT         Value;
+    CHAR        Namespace[REPLICA_MAX_NAME_LENGTH];
+}REPLICA_RECORD, *PREPLICA_RECORD;
+
+// Header in front of every batch of records the leader sends. A batch without records is a heartbeat,
+// it tells an idle follower how far the leader is
+typedef struct _REPLICA_BATCH_HEADER
+{
+    UINT        Magic;
+    UINT        NumRecords;
+    ULONGLONG   LeaderSequence;
+    ULONGLONG   SendTimeNs;
+}REPLICA_BATCH_HEADER, *PREPLICA_BATCH_HEADER;
+
+// Follower connected to the leader. A new one is bootstrapped by a forked child that writes the snapshot to
+// its socket, the log is streamed from NextSequence once the child is done
+typedef enum _REPLICA_FOLLOWER_STATE
+{
+    REPLICA_FOLLOWER_CONNECTED,
+    REPLICA_FOLLOWER_BOOTSTRAP,
+    REPLICA_FOLLOWER_STREAMING
+}REPLICA_FOLLOWER_STATE;
+
+typedef struct _REPLICA_FOLLOWER
+{
+    INT                     Fd;
+    CHAR                    Address[64];
+    REPLICA_FOLLOWER_STATE  State;
+    INT                     BootstrapPid;
+    ULONGLONG               NextSequence;
+    ULONGLONG               AckedSequence;
+    ULONGLONG               LastSendTimeNs;
+    ULONGLONG               NumBatches;
+    ULONGLONG               NumRecords;
+}REPLICA_FOLLOWER, *PREPLICA_FOLLOWER;
+
+// Namespace the leader bootstraps followers with
+typedef struct _REPLICA_NAMESPACE
+{
+    CHAR                Name[REPLICA_MAX_NAME_LENGTH];
+    PRB_TREE_CONTEXT    pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext;
+}REPLICA_NAMESPACE, *PREPLICA_NAMESPACE;
+
+// Called by the follower thread with the records of a batch, under the command lock
+typedef VOID(*PREPLICA_APPLY_FN)(VOID *pApplyContext, PREPLICA_RECORD pRecordList, UINT NumRecords);
+
+// Replica Context Definition
+// Leader: the command loop appends a record for every update under LogMutex, the leader thread accepts
+// followers and sends them the log in batches, as much as has piled up since its last send. The log keeps
+// only the records some follower still needs. Follower: the follower thread reads batches from the leader
+// and applies each one under CommandMutex, which the command loop holds while it runs a command. The leader
+// thread takes CommandMutex too while it forks a bootstrap, so the child sees the tree between commands
+typedef struct _REPLICA_CONTEXT
+{
+    BOOLEAN             bFollower;
+    BOOLEAN             bRunning;
+    BOOLEAN             bStop;
+    INT                 ListenFd;
+    INT                 Port;
+    INT                 WakeFdList[2];
+    BOOLEAN             bSleeping;
+    PREPLICA_RECORD     pLogRecordList;
+    UINT                NumLogRecords;
+    UINT                MaxLogRecords;
+    ULONGLONG           LogBaseSequence;
+    ULONGLONG           LastSequence;
+    PREPLICA_NAMESPACE  pNamespaceList;
+    UINT                NumNamespaces;
+    UINT                MaxNamespaces;
+    REPLICA_FOLLOWER    FollowerList[REPLICA_MAX_FOLLOWERS];
+    UINT                NumFollowers;
+    CHAR                LeaderAddress[64];
+    INT                 LeaderFd;
+    PREPLICA_APPLY_FN   pfnApply;
+    VOID                *pApplyContext;
+    BOOLEAN             bBootstrapped;
+    ULONGLONG           AppliedSequence;
+    ULONGLONG           LeaderSequence;
+    ULONGLONG           NumBatches;
+    ULONGLONG           NumRecords;
+    ULONGLONG           LastLagNs;
+    ULONGLONG           MaxLagNs;
+#if !defined(_MSC_VER)
+    pthread_t           ReplicaThread;
+    pthread_mutex_t     CommandMutex;
+    pthread_mutex_t     LogMutex;
+    pthread_cond_t      BootstrapCond;
+#endif
+    struct _REPLICA_FN_TBL
+    {
+        BOOLEAN(*startReplica)(struct _REPLICA_CONTEXT *pReplicaContext);
+        VOID(*lockReplica)(struct _REPLICA_CONTEXT *pReplicaContext);
+        VOID(*unlockReplica)(struct _REPLICA_CONTEXT *pReplicaContext);
+        VOID(*appendReplicaRecord)(struct _REPLICA_CONTEXT *pReplicaContext, CHAR *pNamespace, REPLICA_OP Op, INT ID1, INT ID2, INT Value);
+        VOID(*addReplicaNamespace)(struct _REPLICA_CONTEXT *pReplicaContext, CHAR *pName, PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext);
+        BOOLEAN(*waitReplicaBootstrap)(struct _REPLICA_CONTEXT *pReplicaContext);
+        BOOLEAN(*waitReplicaFollowers)(struct _REPLICA_CONTEXT *pReplicaContext, UINT NumFollowers);
+        VOID(*waitReplicaLeader)(struct _REPLICA_CONTEXT *pReplicaContext);
+        VOID(*stopReplica)(struct _REPLICA_CONTEXT *pReplicaContext);
+        VOID(*printReplicaStats)(struct _REPLICA_CONTEXT *pReplicaContext);
+    }stReplicaFnTbl;
+}REPLICA_CONTEXT, *PREPLICA_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside Replica.c
+PREPLICA_CONTEXT    createReplicaLeaderContext(INT Port);
+PREPLICA_CONTEXT    createReplicaFollowerContext(CHAR *pLeaderAddress, PREPLICA_APPLY_FN pfnApply, VOID *pApplyContext);
+VOID                destroyReplicaContext(PREPLICA_CONTEXT *ppReplicaContext);
+#endif
@@ -0,0 +1,788 @@
+//
+// This file implements the functions for the lock free skip list. Nodes are linked
+// and unlinked with compare and swap, counts are added atomically and a delete marks
+// the links of the node before it is unlinked. Deleted nodes are freed with epochs
+//
+
+#include "RbTree.h"
+
+// Nodes are handed out as PRB_TREE_NODE, callers read ID and Count through it
+STATIC_ASSERT(offsetof(SKIP_LIST_NODE, ID) == offsetof(RB_TREE_NODE, ID), SKIP_LIST_NODE_ID_OFFSET);
+STATIC_ASSERT(offsetof(SKIP_LIST_NODE, Count) == offsetof(RB_TREE_NODE, Count), SKIP_LIST_NODE_COUNT_OFFSET);
+
+// Thread local slot of the calling thread, the address of the tag tells the threads apart
+static SKIP_LIST_THREAD_LOCAL UCHAR                 SkipListThreadTag;
+static SKIP_LIST_THREAD_LOCAL PSKIP_LIST_CONTEXT    pSkipListThreadContext;
+static SKIP_LIST_THREAD_LOCAL PSKIP_LIST_THREAD     pSkipListThreadSlot;
+
+// Local Function Declarations
+PRB_TREE_NODE       __insertSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count);
+VOID                __deleteSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+PRB_TREE_NODE       __updateSkipListNodeCount(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count);
+PRB_TREE_NODE       __findSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID);
+VOID                __findSkipListNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, INT *pIDList, UINT NumIDs, PRB_TREE_NODE *ppRbTreeNodeList);
+PRB_TREE_NODE       __getNextIDSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+PRB_TREE_NODE       __getPrevIDSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+VOID                __initializeSkipListNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Length);
+VOID                __insertSkipListNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count, UINT Index);
+VOID                __initializeSkipList(struct _RB_TREE_CONTEXT *pRbTreeContext);
+UINT                __getSkipListArrayNodeHeight(UINT Index);
+VOID                __printSkipListStats(struct _RB_TREE_CONTEXT *pRbTreeContext);
+PSKIP_LIST_NODE     __buildSkipListNode(INT ID, INT Count, UINT Height);
+UINT                __getSkipListNodeHeight(PSKIP_LIST_THREAD pSkipListThread);
+UINT                __searchSkipListNode(PSKIP_LIST_CONTEXT pSkipListContext, INT ID, PSKIP_LIST_NODE *ppPredList, PSKIP_LIST_NODE *ppSuccList);
+PSKIP_LIST_NODE     __findPredSkipListNode(PSKIP_LIST_CONTEXT pSkipListContext, INT ID, PSKIP_LIST_NODE *ppSuccSkipListNode);
+PSKIP_LIST_THREAD   __getSkipListThread(PSKIP_LIST_CONTEXT pSkipListContext);
+PSKIP_LIST_THREAD   __enterSkipListEpoch(PSKIP_LIST_CONTEXT pSkipListContext);
+VOID                __advanceSkipListEpoch(PSKIP_LIST_CONTEXT pSkipListContext);
+VOID                __retireSkipListNode(PSKIP_LIST_CONTEXT pSkipListContext, PSKIP_LIST_THREAD pSkipListThread, PSKIP_LIST_NODE pSkipListNode);
+VOID                __freeSkipListRetireList(PSKIP_LIST_THREAD pSkipListThread, UINT Index);
+
+
+// initializeSkipListFnTbl()
+// This function creates the skip list and points the function table of the context to it. Insert, delete,
+// find, next and previous can be called from many threads at once without a lock. A node returned to a
+// thread stays valid till the thread finds or inserts again, so delete, update, next and previous
+// take nodes returned since the last find or insert of the same thread. Range delete, range increase,
+// loading in chunks, versions and the weighted and rank selects are not supported
+VOID initializeSkipListFnTbl(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    PSKIP_LIST_CONTEXT  pSkipListContext    = NULL;
+    UINT                Index               = 0;
+
+    pSkipListContext = (PSKIP_LIST_CONTEXT)calloc(1, sizeof(SKIP_LIST_CONTEXT));
+    pSkipListContext->pHeadSkipListNode = __buildSkipListNode(INT_MIN, 0, SKIP_LIST_MAX_LEVEL);
+    pSkipListContext->Level             = 1;
+    for (Index = 0; Index < SKIP_LIST_MAX_THREADS; Index++)
+    {
+        pSkipListContext->ThreadList[Index].Epoch = SKIP_LIST_QUIESCENT;
+    }
+    pRbTreeContext->pSkipListContext = pSkipListContext;
+
+    pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode              = __insertSkipListNode;
+    pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode              = __deleteSkipListNode;
+    pRbTreeContext->stRbTreeFnTbl.deleteRangeRbTreeNode         = NULL;
+    pRbTreeContext->stRbTreeFnTbl.increaseRangeRbTreeNode       = NULL;
+    pRbTreeContext->stRbTreeFnTbl.updateRbTreeNodeCount         = __updateSkipListNodeCount;
+    pRbTreeContext->stRbTreeFnTbl.findRbTreeNode                = __findSkipListNode;
+    pRbTreeContext->stRbTreeFnTbl.findRbTreeNodeBatch           = __findSkipListNodeBatch;
+    pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode           = __getNextIDSkipListNode;
+    pRbTreeContext->stRbTreeFnTbl.getPrevIDRbTreeNode           = __getPrevIDSkipListNode;
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTreeNodeArrayList = __initializeSkipListNodeArrayList;
+    pRbTreeContext->stRbTreeFnTbl.insertRbTreeNodeArrayList     = __insertSkipListNodeArrayList;
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTree              = __initializeSkipList;
+    pRbTreeContext->stRbTreeFnTbl.appendRbTreeNodeArrayList     = NULL;
+    pRbTreeContext->stRbTreeFnTbl.getPrefixCountRbTreeNode      = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNode         = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNodeBatch    = NULL;
+    pRbTreeContext->stRbTreeFnTbl.getRankRbTreeNode             = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectRankRbTreeNode          = NULL;
+    pRbTreeContext->stRbTreeFnTbl.printRbTreeStats              = __printSkipListStats;
+}
+
+// destroySkipList()
+// This function frees the nodes of the skip list, the ones still waiting for their epoch and the array list.
+// No other thread may be using the list anymore
+VOID destroySkipList(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    PSKIP_LIST_CONTEXT  pSkipListContext    = pRbTreeContext->pSkipListContext;
+    PSKIP_LIST_NODE     pSkipListNode       = NULL;
+    PSKIP_LIST_NODE     pNextSkipListNode   = NULL;
+    UINT                Index               = 0;
+    UINT                EpochIndex          = 0;
+
+    if (pSkipListContext == NULL)
+    {
+        return;
+    }
+
+    // Nodes left in the list, the ones in the array list go with it
+    pSkipListNode = (PSKIP_LIST_NODE)(pSkipListContext->pHeadSkipListNode->NextList[0] & ~SKIP_LIST_MARK);
+    while (pSkipListNode)
+    {
+        pNextSkipListNode = (PSKIP_LIST_NODE)(pSkipListNode->NextList[0] & ~SKIP_LIST_MARK);
+        if (!(pSkipListNode->State & SKIP_LIST_ARRAY_LIST))
+        {
+            free(pSkipListNode);
+        }
+        pSkipListNode = pNextSkipListNode;
+    }
+
+    for (Index = 0; Index < SKIP_LIST_MAX_THREADS; Index++)
+    {
+        for (EpochIndex = 0; EpochIndex < SKIP_LIST_EPOCHS; EpochIndex++)
+        {
+            __freeSkipListRetireList(&pSkipListContext->ThreadList[Index], EpochIndex);
+        }
+    }
+
+    if (pSkipListContext->pNodeArrayList)
+    {
+        __freeRbTreeArrayList(pRbTreeContext, pSkipListContext->pNodeArrayList);
+    }
+
+    if (pSkipListContext->pRecordList)
+    {
+        free(pSkipListContext->pRecordList);
+    }
+
+    // Slot of this thread is gone with the list
+    if (pSkipListThreadContext == pSkipListContext)
+    {
+        pSkipListThreadContext  = NULL;
+        pSkipListThreadSlot     = NULL;
+    }
+
+    free(pSkipListContext->pHeadSkipListNode);
+    free(pSkipListContext);
+    pRbTreeContext->pSkipListContext = NULL;
+}
+
+// releaseSkipListThread()
+// This function gives up the slot of the calling thread, a thread done with the list calls it before it
+// exits so that it doesnt hold back the epoch. Nodes it retired are freed by the next thread taking the slot
+VOID releaseSkipListThread(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    PSKIP_LIST_THREAD   pSkipListThread = __getSkipListThread(pRbTreeContext->pSkipListContext);
+
+    SKIP_LIST_STORE(&pSkipListThread->Epoch, SKIP_LIST_QUIESCENT);
+    SKIP_LIST_FENCE();
+    SKIP_LIST_STORE(&pSkipListThread->Owner, (size_t)0);
+
+    pSkipListThreadContext  = NULL;
+    pSkipListThreadSlot     = NULL;
+}
+
+// __buildSkipListNode()
+// This function allocates the node with room for Height links and initializes it from ID and Count
+PSKIP_LIST_NODE __buildSkipListNode(INT ID, INT Count, UINT Height)
+{
+    PSKIP_LIST_NODE pSkipListNode = NULL;
+
+    pSkipListNode = (PSKIP_LIST_NODE)calloc(1, offsetof(SKIP_LIST_NODE, NextList) + sizeof(size_t) * Height);
+    pSkipListNode->ID       = ID;
+    pSkipListNode->Count    = Count;
+    pSkipListNode->Height   = Height;
+
+    return pSkipListNode;
+}
+
+// __getSkipListNodeHeight()
+// This function draws the height of a new node, every level up is taken with a probability of 1/4
+UINT __getSkipListNodeHeight(PSKIP_LIST_THREAD pSkipListThread)
+{
+    ULONGLONG   Random  = pSkipListThread->RandomState;
+    UINT        Height  = 1;
+
+    // xorshift64
+    Random ^= Random << 13;
+    Random ^= Random >> 7;
+    Random ^= Random << 17;
+    pSkipListThread->RandomState = Random;
+
+    while (Height < SKIP_LIST_MAX_LEVEL && (Random & 3) == 0)
+    {
+        Height++;
+        Random >>= 2;
+    }
+
+    return Height;
+}
+
+// __getSkipListThread()
+// This function returns the slot of the calling thread, the first call of a thread on the list takes a free
+// slot. The slot is remembered in thread local storage, so only a thread moving between lists looks it up
+PSKIP_LIST_THREAD __getSkipListThread(PSKIP_LIST_CONTEXT pSkipListContext)
+{
+    PSKIP_LIST_THREAD   pSkipListThread = NULL;
+    size_t              Owner           = (size_t)&SkipListThreadTag;
+    UINT                Index           = 0;
+
+    if (pSkipListThreadContext == pSkipListContext)
+    {
+        return pSkipListThreadSlot;
+    }
+
+    for (Index = 0; Index < SKIP_LIST_MAX_THREADS; Index++)
+    {
+        if (SKIP_LIST_LOAD(&pSkipListContext->ThreadList[Index].Owner) == Owner)
+        {
+            break;
+        }
+    }
+
+    if (Index == SKIP_LIST_MAX_THREADS)
+    {
+        for (Index = 0; Index < SKIP_LIST_MAX_THREADS; Index++)
+        {
+            if (SKIP_LIST_LOAD(&pSkipListContext->ThreadList[Index].Owner) == 0 &&
+                SKIP_LIST_CAS(&pSkipListContext->ThreadList[Index].Owner, (size_t)0, Owner))
+            {
+                break;
+            }
+        }
+    }
+
+    if (Index == SKIP_LIST_MAX_THREADS)
+    {
+        printf("__getSkipListThread: More than %u threads on the skip list\r\n", SKIP_LIST_MAX_THREADS);
+        exit(-1);
+    }
+
+    pSkipListThread = &pSkipListContext->ThreadList[Index];
+    if (pSkipListThread->RandomState == 0)
+    {
+        pSkipListThread->RandomState = 0x9E3779B97F4A7C15ULL * (Index + 1);
+    }
+
+    pSkipListThreadContext  = pSkipListContext;
+    pSkipListThreadSlot     = pSkipListThread;
+
+    return pSkipListThread;
+}
+
+// __enterSkipListEpoch()
+// This function starts an operation of the calling thread. The thread announces the current epoch, nodes it
+// read before can be freed from now on. Its nodes retired two or more epochs ago are freed
+PSKIP_LIST_THREAD __enterSkipListEpoch(PSKIP_LIST_CONTEXT pSkipListContext)
+{
+    PSKIP_LIST_THREAD   pSkipListThread = __getSkipListThread(pSkipListContext);
+    size_t              Epoch           = SKIP_LIST_LOAD(&pSkipListContext->Epoch);
+    size_t              AnnouncedEpoch  = 0;
+    UINT                Index           = 0;
+
+    if (SKIP_LIST_LOAD(&pSkipListThread->Epoch) == Epoch)
+    {
+        return pSkipListThread;
+    }
+
+    // Announcement has to be seen by the others before the thread reads any link. The epoch may have moved
+    // on while the thread was quiescent and announcing, an advance that checked the slot before the store
+    // didnt see it, so announce again till the epoch read back is the one announced
+    do
+    {
+        AnnouncedEpoch = Epoch;
+        SKIP_LIST_STORE(&pSkipListThread->Epoch, AnnouncedEpoch);
+        SKIP_LIST_FENCE();
+        Epoch = SKIP_LIST_LOAD(&pSkipListContext->Epoch);
+    } while (Epoch != AnnouncedEpoch);
+
+    for (Index = 0; Index < SKIP_LIST_EPOCHS; Index++)
+    {
+        if (pSkipListThread->pRetireList[Index] && pSkipListThread->RetireEpochList[Index] + 2 <= Epoch)
+        {
+            __freeSkipListRetireList(pSkipListThread, Index);
+        }
+    }
+
+    return pSkipListThread;
+}
+
+// __advanceSkipListEpoch()
+// This function moves the epoch on if every thread in an operation has announced the current one
+VOID __advanceSkipListEpoch(PSKIP_LIST_CONTEXT pSkipListContext)
+{
+    size_t  Epoch       = SKIP_LIST_LOAD(&pSkipListContext->Epoch);
+    size_t  ThreadEpoch = 0;
+    UINT    Index       = 0;
+
+    for (Index = 0; Index < SKIP_LIST_MAX_THREADS; Index++)
+    {
+        ThreadEpoch = SKIP_LIST_LOAD(&pSkipListContext->ThreadList[Index].Epoch);
+        if (ThreadEpoch != SKIP_LIST_QUIESCENT && ThreadEpoch != Epoch)
+        {
+            return;
+        }
+    }
+
+    SKIP_LIST_CAS(&pSkipListContext->Epoch, Epoch, Epoch + 1);
+}
+
+// __retireSkipListNode()
+// This function puts an unlinked node on the retire list of the epoch it was unlinked in. A thread that
+// could still be reading it started its operation before the unlink, so it has announced at most that
+// epoch and the epoch cant move two past it till the thread is done. Nodes of the array list stay
+VOID __retireSkipListNode(PSKIP_LIST_CONTEXT pSkipListContext, PSKIP_LIST_THREAD pSkipListThread, PSKIP_LIST_NODE pSkipListNode)
+{
+    size_t  Epoch = SKIP_LIST_LOAD(&pSkipListContext->Epoch);
+    UINT    Index = (UINT)(Epoch % SKIP_LIST_EPOCHS);
+
+    if (SKIP_LIST_LOAD(&pSkipListNode->State) & SKIP_LIST_ARRAY_LIST)
+    {
+        return;
+    }
+
+    // List of the same slot from three epochs ago is safe to free
+    if (pSkipListThread->pRetireList[Index] && pSkipListThread->RetireEpochList[Index] != Epoch)
+    {
+        __freeSkipListRetireList(pSkipListThread, Index);
+    }
+
+    pSkipListNode->pRetireNext              = pSkipListThread->pRetireList[Index];
+    pSkipListThread->pRetireList[Index]     = pSkipListNode;
+    pSkipListThread->RetireEpochList[Index] = Epoch;
+
+    if (++pSkipListThread->NumRetired >= SKIP_LIST_RETIRE_BATCH)
+    {
+        pSkipListThread->NumRetired = 0;
+        __advanceSkipListEpoch(pSkipListContext);
+    }
+}
+
+// __freeSkipListRetireList()
+// This function frees the nodes on the retire list at Index
+VOID __freeSkipListRetireList(PSKIP_LIST_THREAD pSkipListThread, UINT Index)
+{
+    PSKIP_LIST_NODE pSkipListNode       = pSkipListThread->pRetireList[Index];
+    PSKIP_LIST_NODE pNextSkipListNode   = NULL;
+
+    while (pSkipListNode)
+    {
+        pNextSkipListNode = pSkipListNode->pRetireNext;
+        free(pSkipListNode);
+        pSkipListThread->NumFreed++;
+        pSkipListNode = pNextSkipListNode;
+    }
+
+    pSkipListThread->pRetireList[Index] = NULL;
+}
+
+// __searchSkipListNode()
+// This function fills the predecessor and the successor of the ID at every level, the successor is the first
+// node with an ID not less than ID. Deleted nodes on the way are unlinked, if the predecessor changed under
+// the unlink the search starts over from the head. Returns the number of levels filled
+UINT __searchSkipListNode(PSKIP_LIST_CONTEXT pSkipListContext, INT ID, PSKIP_LIST_NODE *ppPredList, PSKIP_LIST_NODE *ppSuccList)
+{
+    PSKIP_LIST_NODE pPredSkipListNode   = NULL;
+    PSKIP_LIST_NODE pSkipListNode       = NULL;
+    size_t          Next                = 0;
+    UINT            NumLevels           = 0;
+    INT             Level               = 0;
+    BOOLEAN         bRetry              = TRUE;
+
+    while (bRetry)
+    {
+        bRetry              = FALSE;
+        NumLevels           = (UINT)SKIP_LIST_LOAD(&pSkipListContext->Level);
+        pPredSkipListNode   = pSkipListContext->pHeadSkipListNode;
+
+        for (Level = (INT)NumLevels - 1; Level >= 0 && !bRetry; Level--)
+        {
+            pSkipListNode = (PSKIP_LIST_NODE)(SKIP_LIST_LOAD(&pPredSkipListNode->NextList[Level]) & ~SKIP_LIST_MARK);
+            while (pSkipListNode)
+            {
+                Next = SKIP_LIST_LOAD(&pSkipListNode->NextList[Level]);
+                if (Next & SKIP_LIST_MARK)
+                {
+                    if (!SKIP_LIST_CAS(&pPredSkipListNode->NextList[Level], (size_t)pSkipListNode, Next & ~SKIP_LIST_MARK))
+                    {
+                        bRetry = TRUE;
+                        break;
+                    }
+                    pSkipListNode = (PSKIP_LIST_NODE)(Next & ~SKIP_LIST_MARK);
+                }
+                else if (pSkipListNode->ID < ID)
+                {
+                    pPredSkipListNode   = pSkipListNode;
+                    pSkipListNode       = (PSKIP_LIST_NODE)Next;
+                }
+                else
+                {
+                    break;
+                }
+            }
+
+            ppPredList[Level] = pPredSkipListNode;
+            ppSuccList[Level] = pSkipListNode;
+        }
+    }
+
+    return NumLevels;
+}
+
+// __findPredSkipListNode()
+// This function returns the node with the largest ID less than ID, the head if there is none, and sets the
+// successor to the first node with an ID not less than ID. Deleted nodes are stepped over without writing
+// to the list, so readers dont fight over the cache lines of the links
+PSKIP_LIST_NODE __findPredSkipListNode(PSKIP_LIST_CONTEXT pSkipListContext, INT ID, PSKIP_LIST_NODE *ppSuccSkipListNode)
+{
+    PSKIP_LIST_NODE pPredSkipListNode   = pSkipListContext->pHeadSkipListNode;
+    PSKIP_LIST_NODE pSkipListNode       = NULL;
+    size_t          Next                = 0;
+    INT             Level               = 0;
+
+    for (Level = (INT)SKIP_LIST_LOAD(&pSkipListContext->Level) - 1; Level >= 0; Level--)
+    {
+        pSkipListNode = (PSKIP_LIST_NODE)(SKIP_LIST_LOAD(&pPredSkipListNode->NextList[Level]) & ~SKIP_LIST_MARK);
+        while (pSkipListNode)
+        {
+            Next = SKIP_LIST_LOAD(&pSkipListNode->NextList[Level]);
+            if (!(Next & SKIP_LIST_MARK))
+            {
+                if (pSkipListNode->ID >= ID)
+                {
+                    break;
+                }
+                pPredSkipListNode = pSkipListNode;
+            }
+            pSkipListNode = (PSKIP_LIST_NODE)(Next & ~SKIP_LIST_MARK);
+        }
+    }
+
+    *ppSuccSkipListNode = pSkipListNode;
+    return pPredSkipListNode;
+}
+
+// __insertSkipListNode()
+// This function adds Count to the event, the count of a node already in the list is added atomically. A new
+// node is in the list once it is linked at level 0, its upper levels are linked after that one by one.
+// If the node is deleted while its upper levels are linked, the levels linked after the delete are
+// unlinked here and the node is retired by whichever of the insert and the delete finishes last
+PRB_TREE_NODE __insertSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count)
+{
+    PSKIP_LIST_CONTEXT  pSkipListContext                = pRbTreeContext->pSkipListContext;
+    PSKIP_LIST_THREAD   pSkipListThread                 = __enterSkipListEpoch(pSkipListContext);
+    PSKIP_LIST_NODE     pPredList[SKIP_LIST_MAX_LEVEL];
+    PSKIP_LIST_NODE     pSuccList[SKIP_LIST_MAX_LEVEL];
+    PSKIP_LIST_NODE     pNewSkipListNode                = NULL;
+    size_t              Level                           = 0;
+    size_t              Next                            = 0;
+    UINT                NumLevels                       = 0;
+    UINT                Height                          = 0;
+    UINT                Index                           = 0;
+    BOOLEAN             bDeleted                        = FALSE;
+
+    while (TRUE)
+    {
+        NumLevels = __searchSkipListNode(pSkipListContext, ID, pPredList, pSuccList);
+        if (pSuccList[0] && pSuccList[0]->ID == ID)
+        {
+            // Node already exists! Add the Count to the existing Count of the Node
+            SKIP_LIST_ADD(&pSuccList[0]->Count, Count);
+            if (pNewSkipListNode)
+            {
+                free(pNewSkipListNode);
+            }
+            return (PRB_TREE_NODE)pSuccList[0];
+        }
+
+        if (pNewSkipListNode == NULL)
+        {
+            Height              = __getSkipListNodeHeight(pSkipListThread);
+            pNewSkipListNode    = __buildSkipListNode(ID, Count, Height);
+            while ((Level = SKIP_LIST_LOAD(&pSkipListContext->Level)) < Height && !SKIP_LIST_CAS(&pSkipListContext->Level, Level, (size_t)Height));
+        }
+
+        // Levels the search didnt see were empty, a node linked there since makes the link below fail
+        for (Index = NumLevels; Index < Height; Index++)
+        {
+            pPredList[Index] = pSkipListContext->pHeadSkipListNode;
+            pSuccList[Index] = NULL;
+        }
+
+        for (Index = 0; Index < Height; Index++)
+        {
+            pNewSkipListNode->NextList[Index] = (size_t)pSuccList[Index];
+        }
+
+        if (SKIP_LIST_CAS(&pPredList[0]->NextList[0], (size_t)pSuccList[0], (size_t)pNewSkipListNode))
+        {
+            break;
+        }
+    }
+    pSkipListThread->NumInserts++;
+
+    for (Index = 1; Index < Height && !bDeleted; Index++)
+    {
+        while (TRUE)
+        {
+            // A marked link means the node is being deleted, the rest of the levels are not linked
+            Next = SKIP_LIST_LOAD(&pNewSkipListNode->NextList[Index]);
+            if (Next & SKIP_LIST_MARK)
+            {
+                bDeleted = TRUE;
+                break;
+            }
+
+            if (Next != (size_t)pSuccList[Index] && !SKIP_LIST_CAS(&pNewSkipListNode->NextList[Index], Next, (size_t)pSuccList[Index]))
+            {
+                continue;
+            }
+
+            if (SKIP_LIST_CAS(&pPredList[Index]->NextList[Index], (size_t)pSuccList[Index], (size_t)pNewSkipListNode))
+            {
+                break;
+            }
+
+            // List changed around the node, find its neighbours at every level again
+            __searchSkipListNode(pSkipListContext, ID, pPredList, pSuccList);
+        }
+    }
+
+    if (SKIP_LIST_LOAD(&pNewSkipListNode->NextList[0]) & SKIP_LIST_MARK)
+    {
+        __searchSkipListNode(pSkipListContext, ID, pPredList, pSuccList);
+    }
+
+    if (SKIP_LIST_OR(&pNewSkipListNode->State, SKIP_LIST_LINKED) & SKIP_LIST_DELETED)
+    {
+        __retireSkipListNode(pSkipListContext, pSkipListThread, pNewSkipListNode);
+    }
+
+    return (PRB_TREE_NODE)pNewSkipListNode;
+}
+
+// __deleteSkipListNode()
+// This function deletes the node. Its links are marked from the top level down, the thread that marks the link
+// at level 0 owns the delete and unlinks the node at every level with a search. If another thread deleted
+// the node first nothing is done
+VOID __deleteSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    PSKIP_LIST_CONTEXT  pSkipListContext                = pRbTreeContext->pSkipListContext;
+    PSKIP_LIST_THREAD   pSkipListThread                 = __getSkipListThread(pSkipListContext);
+    PSKIP_LIST_NODE     pSkipListNode                   = (PSKIP_LIST_NODE)pRbTreeNode;
+    PSKIP_LIST_NODE     pPredList[SKIP_LIST_MAX_LEVEL];
+    PSKIP_LIST_NODE     pSuccList[SKIP_LIST_MAX_LEVEL];
+    size_t              Next                            = 0;
+    UINT                Index                           = 0;
+
+    // Epoch is not announced again, the node was read in the operation the thread announced last
+    for (Index = pSkipListNode->Height - 1; Index > 0; Index--)
+    {
+        while (!((Next = SKIP_LIST_LOAD(&pSkipListNode->NextList[Index])) & SKIP_LIST_MARK))
+        {
+            SKIP_LIST_CAS(&pSkipListNode->NextList[Index], Next, Next | SKIP_LIST_MARK);
+        }
+    }
+
+    while (TRUE)
+    {
+        Next = SKIP_LIST_LOAD(&pSkipListNode->NextList[0]);
+        if (Next & SKIP_LIST_MARK)
+        {
+            return;
+        }
+
+        if (SKIP_LIST_CAS(&pSkipListNode->NextList[0], Next, Next | SKIP_LIST_MARK))
+        {
+            break;
+        }
+    }
+    pSkipListThread->NumDeletes++;
+
+    __searchSkipListNode(pSkipListContext, pSkipListNode->ID, pPredList, pSuccList);
+
+    if (SKIP_LIST_OR(&pSkipListNode->State, SKIP_LIST_DELETED) & SKIP_LIST_LINKED)
+    {
+        __retireSkipListNode(pSkipListContext, pSkipListThread, pSkipListNode);
+    }
+}
+
+// __updateSkipListNodeCount()
+// This function adds Count to the count of the node atomically
+PRB_TREE_NODE __updateSkipListNodeCount(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count)
+{
+    // The node is all it takes, the context is there for the function table
+    (VOID)pRbTreeContext;
+
+    SKIP_LIST_ADD(&((PSKIP_LIST_NODE)pRbTreeNode)->Count, Count);
+
+    return pRbTreeNode;
+}
+
+// __findSkipListNode()
+// This function finds the node with the particular ID or if the ID doesnt exist returns the node
+// with the largest ID less than it, or the first node if there is none. Will return NULL if the list is empty
+PRB_TREE_NODE __findSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID)
+{
+    PSKIP_LIST_CONTEXT  pSkipListContext    = pRbTreeContext->pSkipListContext;
+    PSKIP_LIST_NODE     pPredSkipListNode   = NULL;
+    PSKIP_LIST_NODE     pSuccSkipListNode   = NULL;
+
+    __enterSkipListEpoch(pSkipListContext);
+
+    pPredSkipListNode = __findPredSkipListNode(pSkipListContext, ID, &pSuccSkipListNode);
+    if ((pSuccSkipListNode && pSuccSkipListNode->ID == ID) || pPredSkipListNode == pSkipListContext->pHeadSkipListNode)
+    {
+        return (PRB_TREE_NODE)pSuccSkipListNode;
+    }
+
+    return (PRB_TREE_NODE)pPredSkipListNode;
+}
+
+// __findSkipListNodeBatch()
+// This function does __findSkipListNode for a list of IDs one after the other
+VOID __findSkipListNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, INT *pIDList, UINT NumIDs, PRB_TREE_NODE *ppRbTreeNodeList)
+{
+    UINT    Index = 0;
+
+    for (Index = 0; Index < NumIDs; Index++)
+    {
+        ppRbTreeNodeList[Index] = __findSkipListNode(pRbTreeContext, pIDList[Index]);
+    }
+}
+
+// __getNextIDSkipListNode()
+// This function returns the next node with ID greater than the current node, deleted nodes are stepped over
+PRB_TREE_NODE __getNextIDSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    PSKIP_LIST_NODE pSkipListNode   = (PSKIP_LIST_NODE)(SKIP_LIST_LOAD(&((PSKIP_LIST_NODE)pRbTreeNode)->NextList[0]) & ~SKIP_LIST_MARK);
+    size_t          Next            = 0;
+
+    // Level 0 links are enough, the context is there for the function table
+    (VOID)pRbTreeContext;
+
+    while (pSkipListNode && ((Next = SKIP_LIST_LOAD(&pSkipListNode->NextList[0])) & SKIP_LIST_MARK))
+    {
+        pSkipListNode = (PSKIP_LIST_NODE)(Next & ~SKIP_LIST_MARK);
+    }
+
+    return (PRB_TREE_NODE)pSkipListNode;
+}
+
+// __getPrevIDSkipListNode()
+// This function returns the next node with ID less than the current node. There are no back links,
+// the node is searched for from the head
+PRB_TREE_NODE __getPrevIDSkipListNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    PSKIP_LIST_CONTEXT  pSkipListContext    = pRbTreeContext->pSkipListContext;
+    PSKIP_LIST_NODE     pPredSkipListNode   = NULL;
+    PSKIP_LIST_NODE     pSuccSkipListNode   = NULL;
+
+    pPredSkipListNode = __findPredSkipListNode(pSkipListContext, pRbTreeNode->ID, &pSuccSkipListNode);
+    if (pPredSkipListNode == pSkipListContext->pHeadSkipListNode)
+    {
+        return NULL;
+    }
+
+    return (PRB_TREE_NODE)pPredSkipListNode;
+}
+
+// __initializeSkipListNodeArrayList()
+// This function allocates memory for the events of the loaded file, the nodes are laid out once they are sorted
+VOID __initializeSkipListNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Length)
+{
+    pRbTreeContext->pSkipListContext->pRecordList   = (PRADIX_SORT_RECORD)malloc(sizeof(RADIX_SORT_RECORD) * (Length ? Length : 1));
+    pRbTreeContext->NumNodesRbTree                  = Length;
+    pRbTreeContext->ArrayListLength                 = Length;
+}
+
+// __insertSkipListNodeArrayList()
+// This funcion fills the event at Index of the array list
+VOID __insertSkipListNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count, UINT Index)
+{
+    pRbTreeContext->pSkipListContext->pRecordList[Index].ID     = ID;
+    pRbTreeContext->pSkipListContext->pRecordList[Index].Count  = Count;
+}
+
+// __initializeSkipList()
+// This function builds the skip list from the Array list in O(n) time. The events are sorted if the file was
+// not, then the nodes are laid out one after the other and linked left to right at every level
+VOID __initializeSkipList(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    PSKIP_LIST_CONTEXT  pSkipListContext                = pRbTreeContext->pSkipListContext;
+    PRADIX_SORT_RECORD  pRecordList                     = pSkipListContext->pRecordList;
+    PSKIP_LIST_NODE     pLastList[SKIP_LIST_MAX_LEVEL];
+    PSKIP_LIST_NODE     pSkipListNode                   = NULL;
+    UINT                NumRecords                      = pRbTreeContext->NumNodesRbTree;
+    UINT                Index                           = 0;
+    UINT                Level                           = 0;
+    UINT                Height                          = 0;
+    size_t              Offset                          = 0;
+
+    for (Index = 1; Index < NumRecords; Index++)
+    {
+        if (pRecordList[Index - 1].ID >= pRecordList[Index].ID)
+        {
+            NumRecords = sortRadixSortRecords(pRecordList, NumRecords, 0);
+            pRbTreeContext->NumNodesRbTree = NumRecords;
+            break;
+        }
+    }
+
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        Offset += offsetof(SKIP_LIST_NODE, NextList) + sizeof(size_t) * __getSkipListArrayNodeHeight(Index);
+    }
+
+    if (Offset)
+    {
+        pSkipListContext->pNodeArrayList = (UCHAR*)__allocateRbTreeArrayList(pRbTreeContext, Offset);
+    }
+    pSkipListContext->NumArrayListNodes = NumRecords;
+    pSkipListContext->ArrayListBytes    = Offset;
+
+    for (Level = 0; Level < SKIP_LIST_MAX_LEVEL; Level++)
+    {
+        pLastList[Level] = pSkipListContext->pHeadSkipListNode;
+    }
+
+    Offset = 0;
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        Height                  = __getSkipListArrayNodeHeight(Index);
+        pSkipListNode           = (PSKIP_LIST_NODE)(pSkipListContext->pNodeArrayList + Offset);
+        pSkipListNode->ID       = pRecordList[Index].ID;
+        pSkipListNode->Count    = pRecordList[Index].Count;
+        pSkipListNode->Height   = Height;
+        pSkipListNode->State    = SKIP_LIST_LINKED | SKIP_LIST_ARRAY_LIST;
+
+        for (Level = 0; Level < Height; Level++)
+        {
+            pSkipListNode->NextList[Level]      = 0;
+            pLastList[Level]->NextList[Level]   = (size_t)pSkipListNode;
+            pLastList[Level]                    = pSkipListNode;
+        }
+
+        if (Height > pSkipListContext->Level)
+        {
+            pSkipListContext->Level = Height;
+        }
+
+        Offset += offsetof(SKIP_LIST_NODE, NextList) + sizeof(size_t) * Height;
+    }
+
+    free(pSkipListContext->pRecordList);
+    pSkipListContext->pRecordList = NULL;
+}
+
+// __getSkipListArrayNodeHeight()
+// This function returns the height of the node at Index of the array list, 1 plus the number of times 4
+// divides Index + 1, so that the levels of the loaded list are evenly spaced
+UINT __getSkipListArrayNodeHeight(UINT Index)
+{
+    UINT    Position    = Index + 1;
+    UINT    Height      = 1;
+
+    while (Height < SKIP_LIST_MAX_LEVEL && (Position & 3) == 0)
+    {
+        Height++;
+        Position >>= 2;
+    }
+
+    return Height;
+}
+
+// __printSkipListStats()
+// This function prints the statistics of the skip list, the counts of all the threads added up
+VOID __printSkipListStats(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    PSKIP_LIST_CONTEXT  pSkipListContext    = pRbTreeContext->pSkipListContext;
+    ULONGLONG           NumInserts          = 0;
+    ULONGLONG           NumDeletes          = 0;
+    ULONGLONG           NumFreed            = 0;
+    UINT                NumThreads          = 0;
+    UINT                Index               = 0;
+
+    for (Index = 0; Index < SKIP_LIST_MAX_THREADS; Index++)
+    {
+        NumInserts  += pSkipListContext->ThreadList[Index].NumInserts;
+        NumDeletes  += pSkipListContext->ThreadList[Index].NumDeletes;
+        NumFreed    += pSkipListContext->ThreadList[Index].NumFreed;
+        NumThreads  += (pSkipListContext->ThreadList[Index].Owner != 0);
+    }
+
+    printf("skiplist nodes %llu levels %u epoch %llu inserts %llu deletes %llu freed %llu threads %u arraylist bytes %llu\n",
+        pSkipListContext->NumArrayListNodes + NumInserts - NumDeletes, (UINT)pSkipListContext->Level, (ULONGLONG)pSkipListContext->Epoch,
+        NumInserts, NumDeletes, NumFreed, NumThreads, pSkipListContext->ArrayListBytes);
+}
@@ -0,0 +1,101 @@
+//
+// This file contains all the header definitions for
+// the lock free skip list that can stand in for the tree
+//
+
+#ifndef _SKIP_LIST_H_
+#define _SKIP_LIST_H_
+
+#include "Types.h"
+#include "RadixSort.h"
+
+// Definitions
+#define SKIP_LIST_MAX_LEVEL     24
+#define SKIP_LIST_MAX_THREADS   128
+#define SKIP_LIST_EPOCHS        3
+#define SKIP_LIST_RETIRE_BATCH  64
+#define SKIP_LIST_CACHE_LINE    64
+#define SKIP_LIST_MARK          ((size_t)1)
+#define SKIP_LIST_QUIESCENT     ((size_t)-1)
+#define SKIP_LIST_LINKED        0x1
+#define SKIP_LIST_DELETED       0x2
+#define SKIP_LIST_ARRAY_LIST    0x4
+
+// Atomics on the link words, counts and node states. Links are node addresses with SKIP_LIST_MARK set in the
+// low bit once the node is deleted at that level. Words other threads write are read with SKIP_LIST_LOAD
+// (acquire) and written with SKIP_LIST_STORE (release). MSVC on x86 and x64 compiles volatile accesses as
+// acquire loads and release stores (/volatile:ms), the same code ReadAcquire and WriteRelease give
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SKIP_LIST_THREAD_LOCAL              __declspec(thread)
+#define SKIP_LIST_LOAD(pWord)               (*(pWord))
+#define SKIP_LIST_STORE(pWord, Value)       (*(pWord) = (Value))
+#define SKIP_LIST_CAS(pWord, Old, New)      (_InterlockedCompareExchangePointer((VOID* volatile*)(pWord), (VOID*)(New), (VOID*)(Old)) == (VOID*)(Old))
+#define SKIP_LIST_ADD(pCount, Value)        (_InterlockedExchangeAdd((volatile long*)(pCount), (long)(Value)) + (Value))
+#define SKIP_LIST_OR(pState, Value)         ((UINT)_InterlockedOr((volatile long*)(pState), (long)(Value)))
+#define SKIP_LIST_FENCE()                   _mm_mfence()
+#else
+#define SKIP_LIST_THREAD_LOCAL              __thread
+#define SKIP_LIST_LOAD(pWord)               __atomic_load_n((pWord), __ATOMIC_ACQUIRE)
+#define SKIP_LIST_STORE(pWord, Value)       __atomic_store_n((pWord), (Value), __ATOMIC_RELEASE)
+#define SKIP_LIST_CAS(pWord, Old, New)      __sync_bool_compare_and_swap((pWord), (Old), (New))
+#define SKIP_LIST_ADD(pCount, Value)        __sync_add_and_fetch((pCount), (Value))
+#define SKIP_LIST_OR(pState, Value)         __sync_fetch_and_or((pState), (Value))
+#define SKIP_LIST_FENCE()                   __sync_synchronize()
+#endif
+
+// Node of the skip list, ID and Count are laid out as in RB_TREE_NODE so callers of the function table
+// can read them from the returned node. NextList has Height links, a node is in the list at the levels
+// below its height. State has SKIP_LIST_LINKED once the insert is done linking the node and
+// SKIP_LIST_DELETED once the delete has unlinked it, whichever comes second retires the node
+typedef struct _SKIP_LIST_NODE
+{
+    INT                     ID;
+    volatile INT            Count;
+    UINT                    Height;
+    volatile UINT           State;
+    struct _SKIP_LIST_NODE  *pRetireNext;
+    volatile size_t         NextList[1];
+}SKIP_LIST_NODE, *PSKIP_LIST_NODE;
+
+// Slot of a thread using the list. Epoch is the epoch the thread announced at the start of its last operation,
+// nodes it retired wait in the list of the epoch they were retired in. The padding keeps the slots of
+// different threads off each others cache lines
+typedef struct _SKIP_LIST_THREAD
+{
+    volatile size_t     Owner;
+    volatile size_t     Epoch;
+    PSKIP_LIST_NODE     pRetireList[SKIP_LIST_EPOCHS];
+    size_t              RetireEpochList[SKIP_LIST_EPOCHS];
+    UINT                NumRetired;
+    ULONGLONG           RandomState;
+    ULONGLONG           NumInserts;
+    ULONGLONG           NumDeletes;
+    ULONGLONG           NumFreed;
+    UCHAR               Padding[SKIP_LIST_CACHE_LINE];
+}SKIP_LIST_THREAD, *PSKIP_LIST_THREAD;
+
+// Skip List Context Definition
+// Head has a link for every level, Level is the height of the tallest node so far. Nodes of the loaded
+// file are laid out one after the other in the array list and are never freed on their own, nodes
+// inserted later are allocated one by one. Deleted nodes are freed once every thread in an operation
+// has announced an epoch two past the one they were retired in
+typedef struct _SKIP_LIST_CONTEXT
+{
+    PSKIP_LIST_NODE     pHeadSkipListNode;
+    volatile size_t     Level;
+    volatile size_t     Epoch;
+    PRADIX_SORT_RECORD  pRecordList;
+    UCHAR               *pNodeArrayList;
+    ULONGLONG           NumArrayListNodes;
+    ULONGLONG           ArrayListBytes;
+    SKIP_LIST_THREAD    ThreadList[SKIP_LIST_MAX_THREADS];
+}SKIP_LIST_CONTEXT, *PSKIP_LIST_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside SkipList.c
+struct _RB_TREE_CONTEXT;
+VOID    initializeSkipListFnTbl(struct _RB_TREE_CONTEXT *pRbTreeContext);
+VOID    destroySkipList(struct _RB_TREE_CONTEXT *pRbTreeContext);
+VOID    releaseSkipListThread(struct _RB_TREE_CONTEXT *pRbTreeContext);
+#endif
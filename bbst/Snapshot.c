@@ -0,0 +1,315 @@
+//
+// This file implements the snapshot of the tree to a file. The process forks and the child
+// walks its copy on write view of the tree, so the parent only pauses for the fork.
+// The file has the same format as the input file, so a snapshot can be loaded back
+//
+
+#include "Snapshot.h"
+
+// Local Function Declarations
+BOOLEAN __takeSnapshot(struct _SNAPSHOT_CONTEXT *pSnapshotContext, CHAR *pPath);
+VOID    __pollSnapshot(struct _SNAPSHOT_CONTEXT *pSnapshotContext);
+VOID    __waitSnapshot(struct _SNAPSHOT_CONTEXT *pSnapshotContext);
+BOOLEAN __writeSnapshotFile(PSNAPSHOT_CONTEXT pSnapshotContext, INT PipeFd);
+VOID    __writeSnapshotEvent(PSNAPSHOT_CONTEXT pSnapshotContext, FILE *pFile, INT PipeFd, INT ID, INT Count, ULONGLONG *pNumEvents);
+VOID    __sendSnapshotMessage(PSNAPSHOT_CONTEXT pSnapshotContext, INT PipeFd, ULONGLONG NumEvents, BOOLEAN bDone, BOOLEAN bFailed);
+BOOLEAN __readSnapshotMessages(PSNAPSHOT_CONTEXT pSnapshotContext, BOOLEAN bBlock);
+VOID    __printSnapshotMessage(PSNAPSHOT_CONTEXT pSnapshotContext, PSNAPSHOT_MESSAGE pSnapshotMessage);
+
+
+// createSnapshotContext()
+// This function allocates memory for the context and initilize the function pointers
+// Events frozen in the cold store are written along with the ones in the tree
+PSNAPSHOT_CONTEXT createSnapshotContext(PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext)
+{
+    PSNAPSHOT_CONTEXT   pSnapshotContext = NULL;
+
+    pSnapshotContext = (PSNAPSHOT_CONTEXT)malloc(sizeof(SNAPSHOT_CONTEXT));
+    memset(pSnapshotContext, 0, sizeof(SNAPSHOT_CONTEXT));
+    pSnapshotContext->pRbTreeContext    = pRbTreeContext;
+    pSnapshotContext->pColdStoreContext = pColdStoreContext;
+    pSnapshotContext->PipeFd            = -1;
+
+    // Initilize the function table
+    pSnapshotContext->stSnapshotFnTbl.takeSnapshot  = __takeSnapshot;
+    pSnapshotContext->stSnapshotFnTbl.pollSnapshot  = __pollSnapshot;
+    pSnapshotContext->stSnapshotFnTbl.waitSnapshot  = __waitSnapshot;
+
+    return pSnapshotContext;
+}
+
+// destroySnapshotContext()
+// This function waits for a running snapshot and frees up the context
+VOID destroySnapshotContext(PSNAPSHOT_CONTEXT *ppSnapshotContext)
+{
+    if (*ppSnapshotContext)
+    {
+        __waitSnapshot(*ppSnapshotContext);
+        free((*ppSnapshotContext)->pPath);
+        free(*ppSnapshotContext);
+        *ppSnapshotContext = NULL;
+    }
+}
+
+// __writeSnapshotFile()
+// This function writes all the events in ID order to the file at pPath, walking the tree with getNextIDRbTreeNode.
+// Frozen segments are decoded one at a time and merged in. The number of events is not known up front, the
+// first line is padded and filled in at the end
+BOOLEAN __writeSnapshotFile(PSNAPSHOT_CONTEXT pSnapshotContext, INT PipeFd)
+{
+    PRB_TREE_CONTEXT    pRbTreeContext      = pSnapshotContext->pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext   = pSnapshotContext->pColdStoreContext;
+    PRB_TREE_NODE       pRbTreeNode         = NULL;
+    PRADIX_SORT_RECORD  pRecordList         = NULL;
+    UINT                NumRecords          = 0;
+    UINT                SegmentIndex        = 0;
+    UINT                Index               = 0;
+    FILE                *pFile              = NULL;
+    ULONGLONG           NumEvents           = 0;
+    BOOLEAN             bRetStatus          = TRUE;
+
+    pFile = fopen(pSnapshotContext->pPath, "w");
+    if (pFile == NULL)
+    {
+        return FALSE;
+    }
+    setvbuf(pFile, NULL, _IOFBF, SNAPSHOT_FILE_BUFFER_SIZE);
+
+    fprintf(pFile, "%10u\n", 0);
+
+    // Closest node to the smallest ID is the first event
+    pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.findRbTreeNode(pRbTreeContext, INT_MIN);
+    for (SegmentIndex = 0; pColdStoreContext && SegmentIndex < pColdStoreContext->NumSegments; SegmentIndex++)
+    {
+        NumRecords = pColdStoreContext->stColdStoreFnTbl.readColdStoreSegment(pColdStoreContext, SegmentIndex, &pRecordList);
+        for (Index = 0; Index < NumRecords; Index++)
+        {
+            while (pRbTreeNode && pRbTreeNode->ID < pRecordList[Index].ID)
+            {
+                __writeSnapshotEvent(pSnapshotContext, pFile, PipeFd, pRbTreeNode->ID, pRbTreeNode->Count, &NumEvents);
+                pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+            }
+            __writeSnapshotEvent(pSnapshotContext, pFile, PipeFd, pRecordList[Index].ID, pRecordList[Index].Count, &NumEvents);
+        }
+        free(pRecordList);
+    }
+
+    while (pRbTreeNode)
+    {
+        __writeSnapshotEvent(pSnapshotContext, pFile, PipeFd, pRbTreeNode->ID, pRbTreeNode->Count, &NumEvents);
+        pRbTreeNode = pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode(pRbTreeContext, pRbTreeNode);
+    }
+
+    fseek(pFile, 0, SEEK_SET);
+    fprintf(pFile, "%10u\n", (UINT)NumEvents);
+
+    if (ferror(pFile))
+    {
+        bRetStatus = FALSE;
+    }
+    if (fclose(pFile) != 0)
+    {
+        bRetStatus = FALSE;
+    }
+
+    __sendSnapshotMessage(pSnapshotContext, PipeFd, NumEvents, TRUE, !bRetStatus);
+
+    return bRetStatus;
+}
+
+// __writeSnapshotEvent()
+// This function writes a line for the event and reports the progress every SNAPSHOT_PROGRESS_EVENTS events
+VOID __writeSnapshotEvent(PSNAPSHOT_CONTEXT pSnapshotContext, FILE *pFile, INT PipeFd, INT ID, INT Count, ULONGLONG *pNumEvents)
+{
+    fprintf(pFile, "%d %d\n", ID, Count);
+
+    if (++(*pNumEvents) % SNAPSHOT_PROGRESS_EVENTS == 0)
+    {
+        __sendSnapshotMessage(pSnapshotContext, PipeFd, *pNumEvents, FALSE, FALSE);
+    }
+}
+
+// __sendSnapshotMessage()
+// This function reports the progress to the parent over the pipe, or prints it right away
+// when the snapshot is written in the foreground
+VOID __sendSnapshotMessage(PSNAPSHOT_CONTEXT pSnapshotContext, INT PipeFd, ULONGLONG NumEvents, BOOLEAN bDone, BOOLEAN bFailed)
+{
+    SNAPSHOT_MESSAGE    SnapshotMessage = { 0 };
+
+    SnapshotMessage.NumEvents   = NumEvents;
+    SnapshotMessage.bDone       = bDone;
+    SnapshotMessage.bFailed     = bFailed;
+
+#if !defined(_MSC_VER)
+    if (PipeFd >= 0)
+    {
+        if (write(PipeFd, &SnapshotMessage, sizeof(SnapshotMessage)) < 0)
+        {
+            // Parent may have gone away, nothing to be done about a lost report
+        }
+        return;
+    }
+#endif
+
+    __printSnapshotMessage(pSnapshotContext, &SnapshotMessage);
+}
+
+// __printSnapshotMessage()
+// This function prints a progress report of the snapshot. Reports go to stderr so that they
+// dont get mixed up with the output of the commands
+VOID __printSnapshotMessage(PSNAPSHOT_CONTEXT pSnapshotContext, PSNAPSHOT_MESSAGE pSnapshotMessage)
+{
+    if (pSnapshotMessage->bFailed)
+    {
+        fprintf(stderr, "snapshot %s: failed after %llu events\n", pSnapshotContext->pPath, pSnapshotMessage->NumEvents);
+    }
+    else if (pSnapshotMessage->bDone)
+    {
+        fprintf(stderr, "snapshot %s: done, %llu events\n", pSnapshotContext->pPath, pSnapshotMessage->NumEvents);
+    }
+    else
+    {
+        fprintf(stderr, "snapshot %s: %llu events written\n", pSnapshotContext->pPath, pSnapshotMessage->NumEvents);
+    }
+}
+
+// __takeSnapshot()
+// This function starts a snapshot of the tree to the file at pPath. The child gets a copy on write view of the
+// tree as it is now, the parent returns right after the fork. Returns FALSE if a snapshot is already running
+// or the snapshot couldnt be started. Without fork the file is written in the foreground
+BOOLEAN __takeSnapshot(struct _SNAPSHOT_CONTEXT *pSnapshotContext, CHAR *pPath)
+{
+#if !defined(_MSC_VER)
+    INT     PipeFdList[2]   = { -1, -1 };
+    INT     ChildPid        = 0;
+#endif
+
+    // Pick up the reports of the last snapshot first
+    __pollSnapshot(pSnapshotContext);
+    if (pSnapshotContext->bRunning)
+    {
+        return FALSE;
+    }
+
+    free(pSnapshotContext->pPath);
+    pSnapshotContext->pPath = (CHAR*)malloc(strlen(pPath) + 1);
+    strcpy(pSnapshotContext->pPath, pPath);
+
+#if !defined(_MSC_VER)
+    if (pipe(PipeFdList) != 0)
+    {
+        return FALSE;
+    }
+
+    // Buffered output would be written twice otherwise, once by each process
+    fflush(stdout);
+    fflush(stderr);
+
+    ChildPid = fork();
+    if (ChildPid < 0)
+    {
+        close(PipeFdList[0]);
+        close(PipeFdList[1]);
+        return FALSE;
+    }
+
+    if (ChildPid == 0)
+    {
+        // Child writes the file and leaves without running any of the exit handlers of the parent
+        close(PipeFdList[0]);
+        _exit(__writeSnapshotFile(pSnapshotContext, PipeFdList[1]) ? 0 : 1);
+    }
+
+    // Parent only reads the reports, without blocking the command loop
+    close(PipeFdList[1]);
+    fcntl(PipeFdList[0], F_SETFL, fcntl(PipeFdList[0], F_GETFL) | O_NONBLOCK);
+
+    pSnapshotContext->ChildPid  = ChildPid;
+    pSnapshotContext->PipeFd    = PipeFdList[0];
+    pSnapshotContext->bRunning  = TRUE;
+
+    return TRUE;
+#else
+    return __writeSnapshotFile(pSnapshotContext, -1);
+#endif
+}
+
+// __readSnapshotMessages()
+// This function prints the reports waiting on the pipe. Returns TRUE once the snapshot is over,
+// either with the final report or with the child gone without one
+BOOLEAN __readSnapshotMessages(PSNAPSHOT_CONTEXT pSnapshotContext, BOOLEAN bBlock)
+{
+#if !defined(_MSC_VER)
+    SNAPSHOT_MESSAGE    SnapshotMessage = { 0 };
+    ssize_t             Length          = 0;
+
+    if (bBlock)
+    {
+        fcntl(pSnapshotContext->PipeFd, F_SETFL, fcntl(pSnapshotContext->PipeFd, F_GETFL) & ~O_NONBLOCK);
+    }
+
+    while (TRUE)
+    {
+        Length = read(pSnapshotContext->PipeFd, &SnapshotMessage, sizeof(SnapshotMessage));
+        if (Length == sizeof(SnapshotMessage))
+        {
+            __printSnapshotMessage(pSnapshotContext, &SnapshotMessage);
+            if (SnapshotMessage.bDone)
+            {
+                return TRUE;
+            }
+        }
+        else if (Length == 0)
+        {
+            // Pipe closed without the final report, child died
+            SnapshotMessage.bFailed = TRUE;
+            __printSnapshotMessage(pSnapshotContext, &SnapshotMessage);
+            return TRUE;
+        }
+        else
+        {
+            // Nothing more to read for now
+            return FALSE;
+        }
+    }
+#else
+    return TRUE;
+#endif
+}
+
+// __pollSnapshot()
+// This function prints the reports of a running snapshot and cleans up after it once its over
+VOID __pollSnapshot(struct _SNAPSHOT_CONTEXT *pSnapshotContext)
+{
+    if (!pSnapshotContext->bRunning || !__readSnapshotMessages(pSnapshotContext, FALSE))
+    {
+        return;
+    }
+
+#if !defined(_MSC_VER)
+    close(pSnapshotContext->PipeFd);
+    waitpid(pSnapshotContext->ChildPid, NULL, 0);
+#endif
+    pSnapshotContext->PipeFd    = -1;
+    pSnapshotContext->bRunning  = FALSE;
+}
+
+// __waitSnapshot()
+// This function blocks till a running snapshot is over
+VOID __waitSnapshot(struct _SNAPSHOT_CONTEXT *pSnapshotContext)
+{
+    if (!pSnapshotContext->bRunning)
+    {
+        return;
+    }
+
+    // Blocking reads return only with a report or once the child is gone
+    while (!__readSnapshotMessages(pSnapshotContext, TRUE));
+
+#if !defined(_MSC_VER)
+    close(pSnapshotContext->PipeFd);
+    waitpid(pSnapshotContext->ChildPid, NULL, 0);
+#endif
+    pSnapshotContext->PipeFd    = -1;
+    pSnapshotContext->bRunning  = FALSE;
+}
@@ -0,0 +1,47 @@
+//
+// This file contains all the header definitions for
+// the background snapshot of the tree to a file
+//
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include "Types.h"
+#include "RbTree.h"
+#include "ColdStore.h"
+
+// Definitions
+#define SNAPSHOT_PROGRESS_EVENTS    (1 << 20)
+#define SNAPSHOT_FILE_BUFFER_SIZE   (1 << 20)
+
+// Message sent by the child back to the parent over the pipe, small enough to be written atomically
+typedef struct _SNAPSHOT_MESSAGE
+{
+    ULONGLONG   NumEvents;
+    BOOLEAN     bDone;
+    BOOLEAN     bFailed;
+}SNAPSHOT_MESSAGE, *PSNAPSHOT_MESSAGE;
+
+// Snapshot Context Definition
+// One snapshot runs at a time, the forked child writes the file while the parent keeps serving commands
+typedef struct _SNAPSHOT_CONTEXT
+{
+    PRB_TREE_CONTEXT    pRbTreeContext;
+    PCOLD_STORE_CONTEXT pColdStoreContext;
+    CHAR                *pPath;
+    INT                 ChildPid;
+    INT                 PipeFd;
+    BOOLEAN             bRunning;
+    struct _SNAPSHOT_FN_TBL
+    {
+        BOOLEAN(*takeSnapshot)(struct _SNAPSHOT_CONTEXT *pSnapshotContext, CHAR *pPath);
+        VOID(*pollSnapshot)(struct _SNAPSHOT_CONTEXT *pSnapshotContext);
+        VOID(*waitSnapshot)(struct _SNAPSHOT_CONTEXT *pSnapshotContext);
+    }stSnapshotFnTbl;
+}SNAPSHOT_CONTEXT, *PSNAPSHOT_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside Snapshot.c
+PSNAPSHOT_CONTEXT   createSnapshotContext(PRB_TREE_CONTEXT pRbTreeContext, PCOLD_STORE_CONTEXT pColdStoreContext);
+VOID                destroySnapshotContext(PSNAPSHOT_CONTEXT *ppSnapshotContext);
+#endif
@@ -0,0 +1,218 @@
+//
+// This file implements the loader that builds the tree while commands are served.
+// The input file is sorted, so every chunk read goes to the right of the tree and
+// a command has to wait only till the chunk with its ID is in
+//
+
+#include "StreamLoader.h"
+
+// Local Function Declarations
+BOOLEAN __startStreamLoader(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext);
+VOID    __lockStreamLoader(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext, LONGLONG ID);
+VOID    __unlockStreamLoader(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext);
+VOID    __stopStreamLoader(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext);
+VOID*   __runStreamLoader(VOID *pArg);
+
+
+// createStreamLoaderContext()
+// This function allocates memory for the context and initilize the function pointers.
+// Array list of the tree must be initialized for NumEvents already, the file is joined ChunkEvents at a time
+PSTREAM_LOADER_CONTEXT createStreamLoaderContext(PRB_TREE_CONTEXT pRbTreeContext, FILE *InputFileHandle, UINT NumEvents, UINT ChunkEvents)
+{
+    PSTREAM_LOADER_CONTEXT  pStreamLoaderContext = NULL;
+
+    pStreamLoaderContext = (PSTREAM_LOADER_CONTEXT)malloc(sizeof(STREAM_LOADER_CONTEXT));
+    memset(pStreamLoaderContext, 0, sizeof(STREAM_LOADER_CONTEXT));
+    pStreamLoaderContext->pRbTreeContext    = pRbTreeContext;
+    pStreamLoaderContext->InputFileHandle   = InputFileHandle;
+    pStreamLoaderContext->NumEvents         = NumEvents;
+    pStreamLoaderContext->ChunkEvents       = ChunkEvents ? ChunkEvents : STREAM_LOADER_CHUNK_EVENTS;
+    pStreamLoaderContext->LoadedMaxID       = LLONG_MIN;
+
+    // Initilize the function table
+    pStreamLoaderContext->stStreamLoaderFnTbl.startStreamLoader     = __startStreamLoader;
+    pStreamLoaderContext->stStreamLoaderFnTbl.lockStreamLoader      = __lockStreamLoader;
+    pStreamLoaderContext->stStreamLoaderFnTbl.unlockStreamLoader    = __unlockStreamLoader;
+    pStreamLoaderContext->stStreamLoaderFnTbl.stopStreamLoader      = __stopStreamLoader;
+
+    return pStreamLoaderContext;
+}
+
+// destroyStreamLoaderContext()
+// This function stops a running loader and frees up the context
+VOID destroyStreamLoaderContext(PSTREAM_LOADER_CONTEXT *ppStreamLoaderContext)
+{
+    if (*ppStreamLoaderContext)
+    {
+        __stopStreamLoader(*ppStreamLoaderContext);
+        free(*ppStreamLoaderContext);
+        *ppStreamLoaderContext = NULL;
+    }
+}
+
+// __startStreamLoader()
+// This function starts the loader thread. Returns FALSE if there are no threads, the caller then loads the
+// whole file itself
+BOOLEAN __startStreamLoader(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext)
+{
+#if !defined(_MSC_VER)
+    pthread_mutex_init(&pStreamLoaderContext->TreeMutex, NULL);
+    pthread_cond_init(&pStreamLoaderContext->LoadedCond, NULL);
+
+    if (pthread_create(&pStreamLoaderContext->LoaderThread, NULL, __runStreamLoader, pStreamLoaderContext) != 0)
+    {
+        pthread_cond_destroy(&pStreamLoaderContext->LoadedCond);
+        pthread_mutex_destroy(&pStreamLoaderContext->TreeMutex);
+        return FALSE;
+    }
+
+    pStreamLoaderContext->bRunning = TRUE;
+    return TRUE;
+#else
+    return FALSE;
+#endif
+}
+
+// __runStreamLoader()
+// This is the loader thread. Reading and parsing a chunk is done without the lock, only filling the array
+// list and joining the chunk to the tree keep the command loop out
+VOID* __runStreamLoader(VOID *pArg)
+{
+#if !defined(_MSC_VER)
+    PSTREAM_LOADER_CONTEXT  pStreamLoaderContext    = (PSTREAM_LOADER_CONTEXT)pArg;
+    PRB_TREE_CONTEXT        pRbTreeContext          = pStreamLoaderContext->pRbTreeContext;
+    UINT                    *pIDList                = NULL;
+    UINT                    *pCountList             = NULL;
+    UINT                    NumChunkEvents          = 0;
+    UINT                    Index                   = 0;
+    BOOLEAN                 bSorted                 = TRUE;
+
+    pIDList     = (UINT*)malloc(sizeof(UINT) * pStreamLoaderContext->ChunkEvents);
+    pCountList  = (UINT*)malloc(sizeof(UINT) * pStreamLoaderContext->ChunkEvents);
+
+    while (pStreamLoaderContext->NumEventsLoaded < pStreamLoaderContext->NumEvents)
+    {
+        NumChunkEvents = pStreamLoaderContext->NumEvents - pStreamLoaderContext->NumEventsLoaded;
+        if (NumChunkEvents > pStreamLoaderContext->ChunkEvents)
+        {
+            NumChunkEvents = pStreamLoaderContext->ChunkEvents;
+        }
+
+        for (Index = 0; Index < NumChunkEvents; Index++)
+        {
+            if (fscanf(pStreamLoaderContext->InputFileHandle, "%u %u", &pIDList[Index], &pCountList[Index]) != 2)
+            {
+                break;
+            }
+        }
+        NumChunkEvents = Index;
+
+        pthread_mutex_lock(&pStreamLoaderContext->TreeMutex);
+        if (pStreamLoaderContext->bStop || NumChunkEvents == 0)
+        {
+            pthread_mutex_unlock(&pStreamLoaderContext->TreeMutex);
+            break;
+        }
+
+        // Chunk can be joined only if its IDs are strictly increasing and greater than the ones in the tree
+        bSorted = ((LONGLONG)(INT)pIDList[0] > pStreamLoaderContext->LoadedMaxID);
+        for (Index = 1; Index < NumChunkEvents && bSorted; Index++)
+        {
+            bSorted = ((INT)pIDList[Index - 1] < (INT)pIDList[Index]);
+        }
+
+        if (bSorted)
+        {
+            for (Index = 0; Index < NumChunkEvents; Index++)
+            {
+                pRbTreeContext->stRbTreeFnTbl.insertRbTreeNodeArrayList(pRbTreeContext, pIDList[Index], pCountList[Index], pStreamLoaderContext->NumEventsLoaded + Index);
+            }
+            pRbTreeContext->stRbTreeFnTbl.appendRbTreeNodeArrayList(pRbTreeContext, pStreamLoaderContext->NumEventsLoaded, pStreamLoaderContext->NumEventsLoaded + NumChunkEvents - 1);
+        }
+        else
+        {
+            // Out of order chunk is inserted event by event, duplicate IDs add up. Commands already answered
+            // for these IDs didnt see them, streaming is meant for sorted files
+            for (Index = 0; Index < NumChunkEvents; Index++)
+            {
+                pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode(pRbTreeContext, pIDList[Index], pCountList[Index]);
+            }
+        }
+
+        for (Index = 0; Index < NumChunkEvents; Index++)
+        {
+            if ((INT)pIDList[Index] > pStreamLoaderContext->LoadedMaxID)
+            {
+                pStreamLoaderContext->LoadedMaxID = (INT)pIDList[Index];
+            }
+        }
+        pStreamLoaderContext->NumEventsLoaded += NumChunkEvents;
+
+        pthread_cond_broadcast(&pStreamLoaderContext->LoadedCond);
+        pthread_mutex_unlock(&pStreamLoaderContext->TreeMutex);
+    }
+
+    // Commands waiting for IDs that are not in the file can go now
+    pthread_mutex_lock(&pStreamLoaderContext->TreeMutex);
+    pStreamLoaderContext->bDone = TRUE;
+    pthread_cond_broadcast(&pStreamLoaderContext->LoadedCond);
+    pthread_mutex_unlock(&pStreamLoaderContext->TreeMutex);
+
+    free(pIDList);
+    free(pCountList);
+#endif
+    return NULL;
+}
+
+// __lockStreamLoader()
+// This function takes the tree for a command after waiting till all the events with IDs up to ID are loaded,
+// or the loading is over. LLONG_MIN doesnt wait and LLONG_MAX waits for the whole file
+VOID __lockStreamLoader(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext, LONGLONG ID)
+{
+#if !defined(_MSC_VER)
+    if (!pStreamLoaderContext->bRunning)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pStreamLoaderContext->TreeMutex);
+    while (!pStreamLoaderContext->bDone && pStreamLoaderContext->LoadedMaxID < ID)
+    {
+        pthread_cond_wait(&pStreamLoaderContext->LoadedCond, &pStreamLoaderContext->TreeMutex);
+    }
+#endif
+}
+
+// __unlockStreamLoader()
+// This function gives the tree back to the loader after a command
+VOID __unlockStreamLoader(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext)
+{
+#if !defined(_MSC_VER)
+    if (pStreamLoaderContext->bRunning)
+    {
+        pthread_mutex_unlock(&pStreamLoaderContext->TreeMutex);
+    }
+#endif
+}
+
+// __stopStreamLoader()
+// This function stops the loader after the chunk it is reading and waits for the thread to exit.
+// Must be called without the tree locked
+VOID __stopStreamLoader(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext)
+{
+#if !defined(_MSC_VER)
+    if (!pStreamLoaderContext->bRunning)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pStreamLoaderContext->TreeMutex);
+    pStreamLoaderContext->bStop = TRUE;
+    pthread_mutex_unlock(&pStreamLoaderContext->TreeMutex);
+
+    pthread_join(pStreamLoaderContext->LoaderThread, NULL);
+    pthread_cond_destroy(&pStreamLoaderContext->LoadedCond);
+    pthread_mutex_destroy(&pStreamLoaderContext->TreeMutex);
+    pStreamLoaderContext->bRunning = FALSE;
+#endif
+}
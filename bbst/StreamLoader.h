@@ -0,0 +1,47 @@
+//
+// This file contains all the header definitions for
+// the loader that builds the tree from the input file in the background
+//
+
+#ifndef _STREAM_LOADER_H_
+#define _STREAM_LOADER_H_
+
+#include "Types.h"
+#include "RbTree.h"
+
+// Definitions
+#define STREAM_LOADER_CHUNK_EVENTS  (1 << 16)    // Default chunk size
+
+// Stream Loader Context Definition
+// Loader thread reads the sorted input file a chunk at a time and joins each chunk to the right of the tree.
+// The tree is shared with the command loop under TreeMutex, LoadedCond is signaled after every chunk
+typedef struct _STREAM_LOADER_CONTEXT
+{
+    PRB_TREE_CONTEXT    pRbTreeContext;
+    FILE                *InputFileHandle;
+    UINT                NumEvents;
+    UINT                ChunkEvents;
+    UINT                NumEventsLoaded;
+    LONGLONG            LoadedMaxID;
+    BOOLEAN             bRunning;
+    BOOLEAN             bDone;
+    BOOLEAN             bStop;
+#if !defined(_MSC_VER)
+    pthread_t           LoaderThread;
+    pthread_mutex_t     TreeMutex;
+    pthread_cond_t      LoadedCond;
+#endif
+    struct _STREAM_LOADER_FN_TBL
+    {
+        BOOLEAN(*startStreamLoader)(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext);
+        VOID(*lockStreamLoader)(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext, LONGLONG ID);
+        VOID(*unlockStreamLoader)(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext);
+        VOID(*stopStreamLoader)(struct _STREAM_LOADER_CONTEXT *pStreamLoaderContext);
+    }stStreamLoaderFnTbl;
+}STREAM_LOADER_CONTEXT, *PSTREAM_LOADER_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside StreamLoader.c
+PSTREAM_LOADER_CONTEXT  createStreamLoaderContext(PRB_TREE_CONTEXT pRbTreeContext, FILE *InputFileHandle, UINT NumEvents, UINT ChunkEvents);
+VOID                    destroyStreamLoaderContext(PSTREAM_LOADER_CONTEXT *ppStreamLoaderContext);
+#endif
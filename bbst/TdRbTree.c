@@ -0,0 +1,809 @@
+//
+// This file implements the functions for the parent pointer free
+// red black tree. Insert and delete rebalance in a single pass from the root
+// down, next and previous walk a stack of the path from the root
+//
+
+#include "RbTree.h"
+
+// Nodes are handed out as PRB_TREE_NODE, callers read ID and Count through it
+STATIC_ASSERT(offsetof(TD_RB_TREE_NODE, ID) == offsetof(RB_TREE_NODE, ID), TD_RB_TREE_NODE_ID_OFFSET);
+STATIC_ASSERT(offsetof(TD_RB_TREE_NODE, Count) == offsetof(RB_TREE_NODE, Count), TD_RB_TREE_NODE_COUNT_OFFSET);
+
+// Local Function Declarations
+PRB_TREE_NODE       __insertTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count);
+VOID                __deleteTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+PRB_TREE_NODE       __findTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID);
+VOID                __findTdRbTreeNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, INT *pIDList, UINT NumIDs, PRB_TREE_NODE *ppRbTreeNodeList);
+PRB_TREE_NODE       __getNextIDTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+PRB_TREE_NODE       __getPrevIDTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode);
+VOID                __initializeTdRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Length);
+VOID                __insertTdRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count, UINT Index);
+VOID                __initializeTdRbTree(struct _RB_TREE_CONTEXT *pRbTreeContext);
+PTD_RB_TREE_NODE    __sortedArrayToTdRbTree(PRB_TREE_CONTEXT pRbTreeContext, INT StartIndex, INT EndIndex, UINT Height);
+PTD_RB_TREE_NODE    __buildTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID, INT Count);
+VOID                __freeTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PTD_RB_TREE_NODE pTdRbTreeNode);
+BOOLEAN             __isRedTdRbTreeNode(PTD_RB_TREE_NODE pTdRbTreeNode);
+PTD_RB_TREE_NODE    __rotateSingleTdRbTreeNode(PTD_RB_TREE_NODE pTdRbTreeNode, UINT Dir);
+PTD_RB_TREE_NODE    __rotateDoubleTdRbTreeNode(PTD_RB_TREE_NODE pTdRbTreeNode, UINT Dir);
+VOID                __fillPathTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PTD_RB_TREE_NODE pTdRbTreeNode);
+PRB_TREE_NODE       __updateTdRbTreeNodeCount(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count);
+VOID                __commitTdRbTreeVersion(struct _RB_TREE_CONTEXT *pRbTreeContext);
+BOOLEAN             __selectTdRbTreeVersion(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Version);
+PTD_RB_TREE_NODE    __copyOnWriteTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PTD_RB_TREE_NODE pParentTdRbTreeNode, UINT Dir);
+VOID                __releaseTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PTD_RB_TREE_NODE pTdRbTreeNode);
+VOID                __sortTdRbTreeNodeArrayList(PRB_TREE_CONTEXT pRbTreeContext);
+
+
+// initializeTdRbTreeFnTbl()
+// This function points the function table of the context to the top down variant.
+// Range delete and range increase are not supported by this variant, callers fall back to doing the events one by one.
+// Neither is loading the array list in chunks, the tree is built once the whole list is in. Nodes have no
+// subtree sums, so there is no weighted select either.
+// In the persistent mode the roots of the last NumVersions versions are kept in a ring
+VOID initializeTdRbTreeFnTbl(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    pRbTreeContext->stRbTreeFnTbl.insertRbTreeNode              = __insertTdRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.deleteRbTreeNode              = __deleteTdRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.deleteRangeRbTreeNode         = NULL;
+    pRbTreeContext->stRbTreeFnTbl.increaseRangeRbTreeNode       = NULL;
+    pRbTreeContext->stRbTreeFnTbl.updateRbTreeNodeCount         = __updateTdRbTreeNodeCount;
+    pRbTreeContext->stRbTreeFnTbl.findRbTreeNode                = __findTdRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.findRbTreeNodeBatch           = __findTdRbTreeNodeBatch;
+    pRbTreeContext->stRbTreeFnTbl.getNextIDRbTreeNode           = __getNextIDTdRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.getPrevIDRbTreeNode           = __getPrevIDTdRbTreeNode;
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTreeNodeArrayList = __initializeTdRbTreeNodeArrayList;
+    pRbTreeContext->stRbTreeFnTbl.insertRbTreeNodeArrayList     = __insertTdRbTreeNodeArrayList;
+    pRbTreeContext->stRbTreeFnTbl.initializeRbTree              = __initializeTdRbTree;
+    pRbTreeContext->stRbTreeFnTbl.appendRbTreeNodeArrayList     = NULL;
+    pRbTreeContext->stRbTreeFnTbl.getPrefixCountRbTreeNode      = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNode         = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectCountRbTreeNodeBatch    = NULL;
+    pRbTreeContext->stRbTreeFnTbl.getRankRbTreeNode             = NULL;
+    pRbTreeContext->stRbTreeFnTbl.selectRankRbTreeNode          = NULL;
+
+    if (pRbTreeContext->RbTreeArgs.NumVersions)
+    {
+        pRbTreeContext->pTdRbTreeVersionList = (PTD_RB_TREE_NODE*)calloc(pRbTreeContext->RbTreeArgs.NumVersions, sizeof(PTD_RB_TREE_NODE));
+        pRbTreeContext->stRbTreeFnTbl.commitRbTreeVersion   = __commitTdRbTreeVersion;
+        pRbTreeContext->stRbTreeFnTbl.selectRbTreeVersion   = __selectTdRbTreeVersion;
+    }
+}
+
+// destroyTdRbTree()
+// This function frees up the array list of the top down variant, rest of the nodes go with the node pool
+VOID destroyTdRbTree(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    pRbTreeContext->pRootTdRbTreeNode = NULL;
+
+    if (pRbTreeContext->pTdRbTreeNodeArrayList)
+    {
+        __freeRbTreeArrayList(pRbTreeContext, pRbTreeContext->pTdRbTreeNodeArrayList);
+        pRbTreeContext->pTdRbTreeNodeArrayList = NULL;
+    }
+
+    if (pRbTreeContext->pTdRbTreeVersionList)
+    {
+        free(pRbTreeContext->pTdRbTreeVersionList);
+        pRbTreeContext->pTdRbTreeVersionList = NULL;
+    }
+}
+
+// __buildTdRbTreeNode()
+// This function allocates and initializes the node from ID and Count
+PTD_RB_TREE_NODE __buildTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, INT ID, INT Count)
+{
+    PTD_RB_TREE_NODE    pTdRbTreeNode = NULL;
+
+    pTdRbTreeNode = (PTD_RB_TREE_NODE)pRbTreeContext->pNodePoolContext->stNodePoolFnTbl.allocateNode(pRbTreeContext->pNodePoolContext);
+    pTdRbTreeNode->ID                           = ID;
+    pTdRbTreeNode->Count                        = Count;
+    pTdRbTreeNode->Color                        = RED;
+    pTdRbTreeNode->RefCount                     = 1;
+    pTdRbTreeNode->pChild[TD_RB_TREE_LEFT]      = NULL;
+    pTdRbTreeNode->pChild[TD_RB_TREE_RIGHT]     = NULL;
+
+    return pTdRbTreeNode;
+}
+
+// __freeTdRbTreeNode()
+// This function gives a node back to the node pool
+VOID __freeTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PTD_RB_TREE_NODE pTdRbTreeNode)
+{
+    pRbTreeContext->pNodePoolContext->stNodePoolFnTbl.freeNode(pRbTreeContext->pNodePoolContext, pTdRbTreeNode);
+}
+
+// __copyOnWriteTdRbTreeNode()
+// This function returns the child of the parent in the direction Dir, ready to be changed. A child shared with
+// another version is copied first and the copy takes its place under the parent, so the parent has to be
+// writable already. Walking down from the head this way copies the path from the root to the changed node
+PTD_RB_TREE_NODE __copyOnWriteTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PTD_RB_TREE_NODE pParentTdRbTreeNode, UINT Dir)
+{
+    PTD_RB_TREE_NODE    pTdRbTreeNode       = pParentTdRbTreeNode->pChild[Dir];
+    PTD_RB_TREE_NODE    pCopyTdRbTreeNode   = NULL;
+
+    if (pTdRbTreeNode == NULL || pTdRbTreeNode->RefCount <= 1)
+    {
+        return pTdRbTreeNode;
+    }
+
+    pCopyTdRbTreeNode = (PTD_RB_TREE_NODE)pRbTreeContext->pNodePoolContext->stNodePoolFnTbl.allocateNode(pRbTreeContext->pNodePoolContext);
+    *pCopyTdRbTreeNode = *pTdRbTreeNode;
+    pCopyTdRbTreeNode->RefCount = 1;
+
+    // Children are now shared by the node and its copy
+    if (pCopyTdRbTreeNode->pChild[TD_RB_TREE_LEFT])
+    {
+        pCopyTdRbTreeNode->pChild[TD_RB_TREE_LEFT]->RefCount++;
+    }
+    if (pCopyTdRbTreeNode->pChild[TD_RB_TREE_RIGHT])
+    {
+        pCopyTdRbTreeNode->pChild[TD_RB_TREE_RIGHT]->RefCount++;
+    }
+
+    pTdRbTreeNode->RefCount--;
+    pParentTdRbTreeNode->pChild[Dir] = pCopyTdRbTreeNode;
+
+    return pCopyTdRbTreeNode;
+}
+
+// __releaseTdRbTreeNode()
+// This function drops a reference to the node, a node nobody points to anymore goes back to the
+// node pool along with the references it held on its children
+VOID __releaseTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PTD_RB_TREE_NODE pTdRbTreeNode)
+{
+    if (pTdRbTreeNode == NULL || --pTdRbTreeNode->RefCount)
+    {
+        return;
+    }
+
+    __releaseTdRbTreeNode(pRbTreeContext, pTdRbTreeNode->pChild[TD_RB_TREE_LEFT]);
+    __releaseTdRbTreeNode(pRbTreeContext, pTdRbTreeNode->pChild[TD_RB_TREE_RIGHT]);
+    __freeTdRbTreeNode(pRbTreeContext, pTdRbTreeNode);
+}
+
+// __isRedTdRbTreeNode()
+// This function returns TRUE for a red node, external (NULL) nodes are black
+BOOLEAN __isRedTdRbTreeNode(PTD_RB_TREE_NODE pTdRbTreeNode)
+{
+    return pTdRbTreeNode != NULL && pTdRbTreeNode->Color == RED;
+}
+
+// __rotateSingleTdRbTreeNode()
+// This function rotates the subtree in the direction Dir and returns the new root of the subtree.
+// The old root becomes red and the new root black
+PTD_RB_TREE_NODE __rotateSingleTdRbTreeNode(PTD_RB_TREE_NODE pTdRbTreeNode, UINT Dir)
+{
+    PTD_RB_TREE_NODE    pNewRootTdRbTreeNode = pTdRbTreeNode->pChild[!Dir];
+
+    pTdRbTreeNode->pChild[!Dir]         = pNewRootTdRbTreeNode->pChild[Dir];
+    pNewRootTdRbTreeNode->pChild[Dir]   = pTdRbTreeNode;
+
+    pTdRbTreeNode->Color                = RED;
+    pNewRootTdRbTreeNode->Color         = BLACK;
+
+    return pNewRootTdRbTreeNode;
+}
+
+// __rotateDoubleTdRbTreeNode()
+// This function does the double rotation in the direction Dir and returns the new root of the subtree
+PTD_RB_TREE_NODE __rotateDoubleTdRbTreeNode(PTD_RB_TREE_NODE pTdRbTreeNode, UINT Dir)
+{
+    pTdRbTreeNode->pChild[!Dir] = __rotateSingleTdRbTreeNode(pTdRbTreeNode->pChild[!Dir], !Dir);
+
+    return __rotateSingleTdRbTreeNode(pTdRbTreeNode, Dir);
+}
+
+// __insertTdRbTreeNode()
+// This function inserts the event in a single pass from the root. On the way down a black node with
+// two red children is flipped, and a red red violation caused by that is fixed right away with a
+// rotation at the grandparent, so the new node can always be added as a red leaf
+PRB_TREE_NODE __insertTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count)
+{
+    TD_RB_TREE_NODE     HeadTdRbTreeNode            = { 0 };
+    PTD_RB_TREE_NODE    pTempTdRbTreeNode           = NULL;
+    PTD_RB_TREE_NODE    pParentTdRbTreeNode         = NULL;
+    PTD_RB_TREE_NODE    pGrandParentTdRbTreeNode    = NULL;
+    PTD_RB_TREE_NODE    pGreatGrandTdRbTreeNode     = NULL;
+    PTD_RB_TREE_NODE    pNewTdRbTreeNode            = NULL;
+    UINT                Dir                         = TD_RB_TREE_LEFT;
+    UINT                LastDir                     = TD_RB_TREE_LEFT;
+    UINT                GreatGrandDir               = TD_RB_TREE_LEFT;
+
+    // Existing events are found through the hot cache or the hash index without walking down the tree
+    pTempTdRbTreeNode = (PTD_RB_TREE_NODE)__findFastPathRbTreeNode(pRbTreeContext, ID);
+    if (pTempTdRbTreeNode)
+    {
+        pTempTdRbTreeNode->Count += Count;
+        return (PRB_TREE_NODE)pTempTdRbTreeNode;
+    }
+
+    // Rotations below change the paths
+    pRbTreeContext->TdRbTreePathDepth = 0;
+
+    if (pRbTreeContext->pRootTdRbTreeNode == NULL)
+    {
+        // Tree is empty, new node is the root
+        pNewTdRbTreeNode = __buildTdRbTreeNode(pRbTreeContext, ID, Count);
+        pRbTreeContext->pRootTdRbTreeNode = pNewTdRbTreeNode;
+    }
+    else
+    {
+        // Head is a fake node above the root, so that a rotation at the root needs no special case
+        HeadTdRbTreeNode.Color                      = BLACK;
+        HeadTdRbTreeNode.pChild[TD_RB_TREE_RIGHT]   = pRbTreeContext->pRootTdRbTreeNode;
+        pGreatGrandTdRbTreeNode                     = &HeadTdRbTreeNode;
+        pTempTdRbTreeNode                           = __copyOnWriteTdRbTreeNode(pRbTreeContext, &HeadTdRbTreeNode, TD_RB_TREE_RIGHT);
+
+        while (TRUE)
+        {
+            if (pTempTdRbTreeNode == NULL)
+            {
+                // Hit a leaf, Node doesnt exist! Build one and add it to the tree as a red node
+                pNewTdRbTreeNode = __buildTdRbTreeNode(pRbTreeContext, ID, Count);
+                pParentTdRbTreeNode->pChild[Dir] = pNewTdRbTreeNode;
+                pTempTdRbTreeNode = pNewTdRbTreeNode;
+            }
+            else if (__isRedTdRbTreeNode(pTempTdRbTreeNode->pChild[TD_RB_TREE_LEFT]) &&
+                     __isRedTdRbTreeNode(pTempTdRbTreeNode->pChild[TD_RB_TREE_RIGHT]))
+            {
+                // Color flip, pushes the red up by a level
+                pTempTdRbTreeNode->Color = RED;
+                __copyOnWriteTdRbTreeNode(pRbTreeContext, pTempTdRbTreeNode, TD_RB_TREE_LEFT)->Color = BLACK;
+                __copyOnWriteTdRbTreeNode(pRbTreeContext, pTempTdRbTreeNode, TD_RB_TREE_RIGHT)->Color = BLACK;
+            }
+
+            // Fix the red red violation with the parent
+            if (__isRedTdRbTreeNode(pTempTdRbTreeNode) && __isRedTdRbTreeNode(pParentTdRbTreeNode))
+            {
+                GreatGrandDir = (pGreatGrandTdRbTreeNode->pChild[TD_RB_TREE_RIGHT] == pGrandParentTdRbTreeNode);
+
+                if (pTempTdRbTreeNode == pParentTdRbTreeNode->pChild[LastDir])
+                {
+                    pGreatGrandTdRbTreeNode->pChild[GreatGrandDir] = __rotateSingleTdRbTreeNode(pGrandParentTdRbTreeNode, !LastDir);
+                }
+                else
+                {
+                    pGreatGrandTdRbTreeNode->pChild[GreatGrandDir] = __rotateDoubleTdRbTreeNode(pGrandParentTdRbTreeNode, !LastDir);
+                }
+            }
+
+            if (pTempTdRbTreeNode->ID == ID)
+            {
+                break;
+            }
+
+            LastDir = Dir;
+            Dir = (pTempTdRbTreeNode->ID < ID);
+
+            if (pGrandParentTdRbTreeNode != NULL)
+            {
+                pGreatGrandTdRbTreeNode = pGrandParentTdRbTreeNode;
+            }
+            pGrandParentTdRbTreeNode = pParentTdRbTreeNode;
+            pParentTdRbTreeNode = pTempTdRbTreeNode;
+            pTempTdRbTreeNode = __copyOnWriteTdRbTreeNode(pRbTreeContext, pParentTdRbTreeNode, Dir);
+        }
+
+        pRbTreeContext->pRootTdRbTreeNode = HeadTdRbTreeNode.pChild[TD_RB_TREE_RIGHT];
+
+        if (pNewTdRbTreeNode == NULL)
+        {
+            // Node already exists! Add the Count to the existing Count of the Node
+            pTempTdRbTreeNode->Count += Count;
+            __updateHotCacheRbTreeNode(pRbTreeContext, ID, (PRB_TREE_NODE)pTempTdRbTreeNode);
+        }
+    }
+
+    // Root is always black
+    pRbTreeContext->pRootTdRbTreeNode->Color = BLACK;
+
+    if (pNewTdRbTreeNode == NULL)
+    {
+        return (PRB_TREE_NODE)pTempTdRbTreeNode;
+    }
+
+    // Keep the hash index and the hot cache in sync with the new node
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.insertHashIndexEntry(pRbTreeContext->pHashIndexContext, ID, pNewTdRbTreeNode);
+    }
+    __updateHotCacheRbTreeNode(pRbTreeContext, ID, (PRB_TREE_NODE)pNewTdRbTreeNode);
+
+    return (PRB_TREE_NODE)pNewTdRbTreeNode;
+}
+
+// __deleteTdRbTreeNode()
+// This function deletes the event in a single pass from the root. On the way down the current node
+// is made red by a color flip or a rotation, so the node finally unlinked is always red and no fixup
+// is needed. Like the bottom up delete, a degree 2 node takes the event of the largest node in its
+// left subtree and that node is unlinked instead
+VOID __deleteTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    TD_RB_TREE_NODE     HeadTdRbTreeNode            = { 0 };
+    PTD_RB_TREE_NODE    pTempTdRbTreeNode           = NULL;
+    PTD_RB_TREE_NODE    pParentTdRbTreeNode         = NULL;
+    PTD_RB_TREE_NODE    pGrandParentTdRbTreeNode    = NULL;
+    PTD_RB_TREE_NODE    pSiblingTdRbTreeNode        = NULL;
+    PTD_RB_TREE_NODE    pFoundTdRbTreeNode          = NULL;
+    INT                 ID                          = pRbTreeNode->ID;
+    UINT                Dir                         = TD_RB_TREE_RIGHT;
+    UINT                LastDir                     = TD_RB_TREE_RIGHT;
+    UINT                GrandParentDir              = TD_RB_TREE_RIGHT;
+
+    if (pRbTreeContext->pRootTdRbTreeNode == NULL)
+    {
+        return;
+    }
+
+    // Drop the event from the hash index and the hot cache first, node may get a different ID below
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.deleteHashIndexEntry(pRbTreeContext->pHashIndexContext, ID);
+    }
+    __updateHotCacheRbTreeNode(pRbTreeContext, ID, NULL);
+
+    // Rotations below change the paths
+    pRbTreeContext->TdRbTreePathDepth = 0;
+
+    HeadTdRbTreeNode.Color                      = BLACK;
+    HeadTdRbTreeNode.pChild[TD_RB_TREE_RIGHT]   = pRbTreeContext->pRootTdRbTreeNode;
+    pTempTdRbTreeNode                           = &HeadTdRbTreeNode;
+
+    // Walk down to the largest node not greater than ID in the left subtree of ID,
+    // pushing a red node down along the way
+    while (pTempTdRbTreeNode->pChild[Dir] != NULL)
+    {
+        LastDir = Dir;
+
+        pGrandParentTdRbTreeNode = pParentTdRbTreeNode;
+        pParentTdRbTreeNode = pTempTdRbTreeNode;
+        pTempTdRbTreeNode = __copyOnWriteTdRbTreeNode(pRbTreeContext, pParentTdRbTreeNode, Dir);
+        Dir = (pTempTdRbTreeNode->ID < ID);
+
+        if (pTempTdRbTreeNode->ID == ID)
+        {
+            pFoundTdRbTreeNode = pTempTdRbTreeNode;
+        }
+
+        if (__isRedTdRbTreeNode(pTempTdRbTreeNode) || __isRedTdRbTreeNode(pTempTdRbTreeNode->pChild[Dir]))
+        {
+            continue;
+        }
+
+        if (__isRedTdRbTreeNode(pTempTdRbTreeNode->pChild[!Dir]))
+        {
+            // Red child on the other side, rotate it up so the current node becomes red
+            __copyOnWriteTdRbTreeNode(pRbTreeContext, pTempTdRbTreeNode, !Dir);
+            pParentTdRbTreeNode->pChild[LastDir] = __rotateSingleTdRbTreeNode(pTempTdRbTreeNode, Dir);
+            pParentTdRbTreeNode = pParentTdRbTreeNode->pChild[LastDir];
+        }
+        else
+        {
+            pSiblingTdRbTreeNode = __copyOnWriteTdRbTreeNode(pRbTreeContext, pParentTdRbTreeNode, !LastDir);
+            if (pSiblingTdRbTreeNode == NULL)
+            {
+                continue;
+            }
+
+            if (!__isRedTdRbTreeNode(pSiblingTdRbTreeNode->pChild[TD_RB_TREE_LEFT]) &&
+                !__isRedTdRbTreeNode(pSiblingTdRbTreeNode->pChild[TD_RB_TREE_RIGHT]))
+            {
+                // Sibling has no red child, color flip
+                pParentTdRbTreeNode->Color = BLACK;
+                pSiblingTdRbTreeNode->Color = RED;
+                pTempTdRbTreeNode->Color = RED;
+            }
+            else
+            {
+                // Borrow the red child of the sibling with a rotation at the parent
+                GrandParentDir = (pGrandParentTdRbTreeNode->pChild[TD_RB_TREE_RIGHT] == pParentTdRbTreeNode);
+
+                if (__isRedTdRbTreeNode(pSiblingTdRbTreeNode->pChild[LastDir]))
+                {
+                    __copyOnWriteTdRbTreeNode(pRbTreeContext, pSiblingTdRbTreeNode, LastDir);
+                    pGrandParentTdRbTreeNode->pChild[GrandParentDir] = __rotateDoubleTdRbTreeNode(pParentTdRbTreeNode, LastDir);
+                }
+                else
+                {
+                    __copyOnWriteTdRbTreeNode(pRbTreeContext, pSiblingTdRbTreeNode, !LastDir);
+                    pGrandParentTdRbTreeNode->pChild[GrandParentDir] = __rotateSingleTdRbTreeNode(pParentTdRbTreeNode, LastDir);
+                }
+
+                pTempTdRbTreeNode->Color = RED;
+                pGrandParentTdRbTreeNode->pChild[GrandParentDir]->Color = RED;
+                pGrandParentTdRbTreeNode->pChild[GrandParentDir]->pChild[TD_RB_TREE_LEFT]->Color = BLACK;
+                pGrandParentTdRbTreeNode->pChild[GrandParentDir]->pChild[TD_RB_TREE_RIGHT]->Color = BLACK;
+            }
+        }
+    }
+
+    if (pFoundTdRbTreeNode)
+    {
+        // Move the event of the last node into the found node and unlink the last node
+        if (pFoundTdRbTreeNode != pTempTdRbTreeNode)
+        {
+            pFoundTdRbTreeNode->ID      = pTempTdRbTreeNode->ID;
+            pFoundTdRbTreeNode->Count   = pTempTdRbTreeNode->Count;
+
+            // The moved event now lives in the found node
+            if (pRbTreeContext->pHashIndexContext)
+            {
+                pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.insertHashIndexEntry(pRbTreeContext->pHashIndexContext, pFoundTdRbTreeNode->ID, pFoundTdRbTreeNode);
+            }
+            __updateHotCacheRbTreeNode(pRbTreeContext, pFoundTdRbTreeNode->ID, (PRB_TREE_NODE)pFoundTdRbTreeNode);
+        }
+
+        pParentTdRbTreeNode->pChild[pParentTdRbTreeNode->pChild[TD_RB_TREE_RIGHT] == pTempTdRbTreeNode] =
+            pTempTdRbTreeNode->pChild[pTempTdRbTreeNode->pChild[TD_RB_TREE_LEFT] == NULL];
+
+        __freeTdRbTreeNode(pRbTreeContext, pTempTdRbTreeNode);
+    }
+
+    // Update the root and keep it black
+    pRbTreeContext->pRootTdRbTreeNode = HeadTdRbTreeNode.pChild[TD_RB_TREE_RIGHT];
+    if (pRbTreeContext->pRootTdRbTreeNode)
+    {
+        pRbTreeContext->pRootTdRbTreeNode->Color = BLACK;
+    }
+}
+
+// __updateTdRbTreeNodeCount()
+// This function adds Count to the Count of an existing node and returns the node. With versions the node
+// may be shared through any of its ancestors, so the path to it is copied and the copy is returned
+PRB_TREE_NODE __updateTdRbTreeNodeCount(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode, INT Count)
+{
+    TD_RB_TREE_NODE     HeadTdRbTreeNode    = { 0 };
+    PTD_RB_TREE_NODE    pTempTdRbTreeNode   = NULL;
+    INT                 ID                  = pRbTreeNode->ID;
+
+    if (pRbTreeContext->RbTreeArgs.NumVersions == 0)
+    {
+        pRbTreeNode->Count += Count;
+        return pRbTreeNode;
+    }
+
+    // Copies replace the nodes on the path
+    pRbTreeContext->TdRbTreePathDepth = 0;
+
+    HeadTdRbTreeNode.pChild[TD_RB_TREE_RIGHT]   = pRbTreeContext->pRootTdRbTreeNode;
+    pTempTdRbTreeNode                           = __copyOnWriteTdRbTreeNode(pRbTreeContext, &HeadTdRbTreeNode, TD_RB_TREE_RIGHT);
+    while (pTempTdRbTreeNode->ID != ID)
+    {
+        pTempTdRbTreeNode = __copyOnWriteTdRbTreeNode(pRbTreeContext, pTempTdRbTreeNode, ID > pTempTdRbTreeNode->ID);
+    }
+    pRbTreeContext->pRootTdRbTreeNode = HeadTdRbTreeNode.pChild[TD_RB_TREE_RIGHT];
+
+    pTempTdRbTreeNode->Count += Count;
+
+    return (PRB_TREE_NODE)pTempTdRbTreeNode;
+}
+
+// __commitTdRbTreeVersion()
+// This function keeps the current tree as the next version. The version ring holds a reference to the root,
+// so the nodes of the version are copied instead of changed from now on. The version falling out of the
+// ring is released and the nodes only it was using go back to the node pool
+VOID __commitTdRbTreeVersion(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    UINT    Slot = pRbTreeContext->NumTdRbTreeVersions % pRbTreeContext->RbTreeArgs.NumVersions;
+
+    if (pRbTreeContext->NumTdRbTreeVersions >= pRbTreeContext->RbTreeArgs.NumVersions)
+    {
+        __releaseTdRbTreeNode(pRbTreeContext, pRbTreeContext->pTdRbTreeVersionList[Slot]);
+    }
+
+    pRbTreeContext->pTdRbTreeVersionList[Slot] = pRbTreeContext->pRootTdRbTreeNode;
+    if (pRbTreeContext->pRootTdRbTreeNode)
+    {
+        pRbTreeContext->pRootTdRbTreeNode->RefCount++;
+    }
+
+    pRbTreeContext->NumTdRbTreeVersions++;
+}
+
+// __selectTdRbTreeVersion()
+// This function points the root at a kept version so that find, next and previous read that version,
+// RB_TREE_CURRENT_VERSION goes back to the current tree. Returns FALSE if the version is not kept anymore.
+// Only reads are allowed while an old version is selected
+BOOLEAN __selectTdRbTreeVersion(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Version)
+{
+    // Paths on the stack belong to the version read last
+    pRbTreeContext->TdRbTreePathDepth = 0;
+
+    if (pRbTreeContext->bTdRbTreeVersionSelected)
+    {
+        pRbTreeContext->pRootTdRbTreeNode           = pRbTreeContext->pWorkRootTdRbTreeNode;
+        pRbTreeContext->bTdRbTreeVersionSelected    = FALSE;
+    }
+
+    if (Version == RB_TREE_CURRENT_VERSION)
+    {
+        return TRUE;
+    }
+
+    if (Version >= pRbTreeContext->NumTdRbTreeVersions ||
+        pRbTreeContext->NumTdRbTreeVersions - Version > pRbTreeContext->RbTreeArgs.NumVersions)
+    {
+        return FALSE;
+    }
+
+    pRbTreeContext->pWorkRootTdRbTreeNode       = pRbTreeContext->pRootTdRbTreeNode;
+    pRbTreeContext->pRootTdRbTreeNode           = pRbTreeContext->pTdRbTreeVersionList[Version % pRbTreeContext->RbTreeArgs.NumVersions];
+    pRbTreeContext->bTdRbTreeVersionSelected    = TRUE;
+
+    return TRUE;
+}
+
+// __findTdRbTreeNode()
+// This function finds the node with the particular ID or if the ID doesnt exist returns the node
+// with closest ID. The path walked is kept, so that next and previous can start from it
+// Will return NULL if root is NULL
+PRB_TREE_NODE __findTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID)
+{
+    PTD_RB_TREE_NODE    pTempTdRbTreeNode = NULL;
+
+    // Exact matches are answered by the hot cache or the hash index, the tree is walked only for the closest ID
+    pTempTdRbTreeNode = (PTD_RB_TREE_NODE)__findFastPathRbTreeNode(pRbTreeContext, ID);
+    if (pTempTdRbTreeNode)
+    {
+        return (PRB_TREE_NODE)pTempTdRbTreeNode;
+    }
+
+    pRbTreeContext->TdRbTreePathDepth = 0;
+    pTempTdRbTreeNode = pRbTreeContext->pRootTdRbTreeNode;
+    while (pTempTdRbTreeNode)
+    {
+        pRbTreeContext->TdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth++] = pTempTdRbTreeNode;
+
+        if (ID == pTempTdRbTreeNode->ID)
+        {
+            __updateHotCacheRbTreeNode(pRbTreeContext, ID, (PRB_TREE_NODE)pTempTdRbTreeNode);
+            break;
+        }
+        else if (pTempTdRbTreeNode->pChild[ID > pTempTdRbTreeNode->ID] == NULL)
+        {
+            break;
+        }
+
+        pTempTdRbTreeNode = pTempTdRbTreeNode->pChild[ID > pTempTdRbTreeNode->ID];
+    }
+
+    return (PRB_TREE_NODE)pTempTdRbTreeNode;
+}
+
+// __findTdRbTreeNodeBatch()
+// This function does __findTdRbTreeNode for a list of IDs one after the other
+VOID __findTdRbTreeNodeBatch(struct _RB_TREE_CONTEXT *pRbTreeContext, INT *pIDList, UINT NumIDs, PRB_TREE_NODE *ppRbTreeNodeList)
+{
+    UINT    Index = 0;
+
+    for (Index = 0; Index < NumIDs; Index++)
+    {
+        ppRbTreeNodeList[Index] = __findTdRbTreeNode(pRbTreeContext, pIDList[Index]);
+    }
+}
+
+// __fillPathTdRbTreeNode()
+// This function makes sure the path stack ends at the node, walks down from the root if it doesnt
+VOID __fillPathTdRbTreeNode(PRB_TREE_CONTEXT pRbTreeContext, PTD_RB_TREE_NODE pTdRbTreeNode)
+{
+    PTD_RB_TREE_NODE    pTempTdRbTreeNode = NULL;
+
+    if (pRbTreeContext->TdRbTreePathDepth &&
+        pRbTreeContext->TdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth - 1] == pTdRbTreeNode)
+    {
+        return;
+    }
+
+    pRbTreeContext->TdRbTreePathDepth = 0;
+    pTempTdRbTreeNode = pRbTreeContext->pRootTdRbTreeNode;
+    while (pTempTdRbTreeNode)
+    {
+        pRbTreeContext->TdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth++] = pTempTdRbTreeNode;
+        if (pTempTdRbTreeNode == pTdRbTreeNode)
+        {
+            break;
+        }
+        pTempTdRbTreeNode = pTempTdRbTreeNode->pChild[pTdRbTreeNode->ID > pTempTdRbTreeNode->ID];
+    }
+}
+
+// __getNextIDTdRbTreeNode()
+// This function returns the next node with ID greater than the current node
+// It assumes that current Node exists. Successive calls continue on the same path stack, so
+// walking a range costs O(1) amortized per node
+PRB_TREE_NODE __getNextIDTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    PTD_RB_TREE_NODE    *pTdRbTreePathStack = pRbTreeContext->TdRbTreePathStack;
+    PTD_RB_TREE_NODE    pTempTdRbTreeNode   = NULL;
+
+    __fillPathTdRbTreeNode(pRbTreeContext, (PTD_RB_TREE_NODE)pRbTreeNode);
+
+    // The node with greater ID will be either the node with smallest ID in the right subtree
+    // or the closest ancestor whose left subtree has the node
+    pTempTdRbTreeNode = ((PTD_RB_TREE_NODE)pRbTreeNode)->pChild[TD_RB_TREE_RIGHT];
+    if (pTempTdRbTreeNode != NULL)
+    {
+        while (pTempTdRbTreeNode != NULL)
+        {
+            pTdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth++] = pTempTdRbTreeNode;
+            pTempTdRbTreeNode = pTempTdRbTreeNode->pChild[TD_RB_TREE_LEFT];
+        }
+    }
+    else
+    {
+        while (--pRbTreeContext->TdRbTreePathDepth &&
+               pTdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth - 1]->pChild[TD_RB_TREE_RIGHT] == pTdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth]);
+    }
+
+    if (pRbTreeContext->TdRbTreePathDepth == 0)
+    {
+        return NULL;
+    }
+
+    return (PRB_TREE_NODE)pTdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth - 1];
+}
+
+// __getPrevIDTdRbTreeNode()
+// This function returns the next node with ID less than the current node
+// It assumes that current Node exists
+PRB_TREE_NODE __getPrevIDTdRbTreeNode(struct _RB_TREE_CONTEXT *pRbTreeContext, PRB_TREE_NODE pRbTreeNode)
+{
+    PTD_RB_TREE_NODE    *pTdRbTreePathStack = pRbTreeContext->TdRbTreePathStack;
+    PTD_RB_TREE_NODE    pTempTdRbTreeNode   = NULL;
+
+    __fillPathTdRbTreeNode(pRbTreeContext, (PTD_RB_TREE_NODE)pRbTreeNode);
+
+    // The node with lesser ID will be either the node with largest ID in the left subtree
+    // or the closest ancestor whose right subtree has the node
+    pTempTdRbTreeNode = ((PTD_RB_TREE_NODE)pRbTreeNode)->pChild[TD_RB_TREE_LEFT];
+    if (pTempTdRbTreeNode != NULL)
+    {
+        while (pTempTdRbTreeNode != NULL)
+        {
+            pTdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth++] = pTempTdRbTreeNode;
+            pTempTdRbTreeNode = pTempTdRbTreeNode->pChild[TD_RB_TREE_RIGHT];
+        }
+    }
+    else
+    {
+        while (--pRbTreeContext->TdRbTreePathDepth &&
+               pTdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth - 1]->pChild[TD_RB_TREE_LEFT] == pTdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth]);
+    }
+
+    if (pRbTreeContext->TdRbTreePathDepth == 0)
+    {
+        return NULL;
+    }
+
+    return (PRB_TREE_NODE)pTdRbTreePathStack[pRbTreeContext->TdRbTreePathDepth - 1];
+}
+
+// __initializeTdRbTreeNodeArrayList()
+// This function allocates memory for the array list
+VOID __initializeTdRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, UINT Length)
+{
+    pRbTreeContext->pTdRbTreeNodeArrayList  = (PTD_RB_TREE_NODE)__allocateRbTreeArrayList(pRbTreeContext, sizeof(TD_RB_TREE_NODE) * Length);
+    pRbTreeContext->NumNodesRbTree          = Length;
+    pRbTreeContext->ArrayListLength         = Length;
+
+    // Size the hash index up front for all the events, avoids growing it while loading
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        destroyHashIndexContext(&pRbTreeContext->pHashIndexContext);
+        pRbTreeContext->pHashIndexContext = createHashIndexContext(Length * 2);
+    }
+}
+
+// __insertTdRbTreeNodeArrayList()
+// This funcion fills the node at Index of the array list
+VOID __insertTdRbTreeNodeArrayList(struct _RB_TREE_CONTEXT *pRbTreeContext, INT ID, INT Count, UINT Index)
+{
+    PTD_RB_TREE_NODE    pTdRbTreeNode = &pRbTreeContext->pTdRbTreeNodeArrayList[Index];
+
+    pTdRbTreeNode->ID                           = ID;
+    pTdRbTreeNode->Count                        = Count;
+    pTdRbTreeNode->Color                        = BLACK;
+    pTdRbTreeNode->RefCount                     = 1;
+    pTdRbTreeNode->pChild[TD_RB_TREE_LEFT]      = NULL;
+    pTdRbTreeNode->pChild[TD_RB_TREE_RIGHT]     = NULL;
+
+    if (pRbTreeContext->pHashIndexContext)
+    {
+        pRbTreeContext->pHashIndexContext->stHashIndexFnTbl.insertHashIndexEntry(pRbTreeContext->pHashIndexContext, ID, pTdRbTreeNode);
+    }
+}
+
+// __initializeTdRbTree()
+// This function builds the tree from the Array list in O(n) time
+VOID __initializeTdRbTree(struct _RB_TREE_CONTEXT *pRbTreeContext)
+{
+    // Build needs the events strictly sorted by ID
+    __sortTdRbTreeNodeArrayList(pRbTreeContext);
+
+    // Get the height of the RB Tree
+    pRbTreeContext->RbTreeHeight = (UINT)(log(pRbTreeContext->NumNodesRbTree) / log(2));
+
+    pRbTreeContext->pRootTdRbTreeNode = __sortedArrayToTdRbTree(pRbTreeContext, 0, pRbTreeContext->NumNodesRbTree - 1, 0);
+
+    // With a single event the root is also the last level, keep it black
+    if (pRbTreeContext->pRootTdRbTreeNode)
+    {
+        pRbTreeContext->pRootTdRbTreeNode->Color = BLACK;
+    }
+
+    // Loaded tree is version 0
+    if (pRbTreeContext->RbTreeArgs.NumVersions)
+    {
+        __commitTdRbTreeVersion(pRbTreeContext);
+    }
+}
+
+// __sortTdRbTreeNodeArrayList()
+// This function sorts the array list by ID if the input file was not strictly sorted and merges the events
+// with the same ID, like __sortRbTreeNodeArrayList
+VOID __sortTdRbTreeNodeArrayList(PRB_TREE_CONTEXT pRbTreeContext)
+{
+    PTD_RB_TREE_NODE    pTdRbTreeNodeArrayList  = pRbTreeContext->pTdRbTreeNodeArrayList;
+    PRADIX_SORT_RECORD  pRecordList             = NULL;
+    UINT                NumRecords              = pRbTreeContext->NumNodesRbTree;
+    UINT                Index                   = 0;
+
+    for (Index = 1; Index < NumRecords; Index++)
+    {
+        if (pTdRbTreeNodeArrayList[Index - 1].ID >= pTdRbTreeNodeArrayList[Index].ID)
+        {
+            break;
+        }
+    }
+
+    if (Index >= NumRecords)
+    {
+        return;
+    }
+
+    pRecordList = (PRADIX_SORT_RECORD)malloc(sizeof(RADIX_SORT_RECORD) * NumRecords);
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        pRecordList[Index].ID       = pTdRbTreeNodeArrayList[Index].ID;
+        pRecordList[Index].Count    = pTdRbTreeNodeArrayList[Index].Count;
+    }
+
+    NumRecords = sortRadixSortRecords(pRecordList, NumRecords, 0);
+
+    for (Index = 0; Index < NumRecords; Index++)
+    {
+        __insertTdRbTreeNodeArrayList(pRbTreeContext, pRecordList[Index].ID, pRecordList[Index].Count, Index);
+    }
+    pRbTreeContext->NumNodesRbTree = NumRecords;
+
+    free(pRecordList);
+}
+
+// __sortedArrayToTdRbTree()
+// THis is the recursive function to build the tree from a sorted array list
+PTD_RB_TREE_NODE __sortedArrayToTdRbTree(PRB_TREE_CONTEXT pRbTreeContext, INT StartIndex, INT EndIndex, UINT Height)
+{
+    PTD_RB_TREE_NODE    pTdRbTreeNode   = NULL;
+    INT                 MidIndex        = 0;
+
+    if (StartIndex > EndIndex)
+    {
+        return NULL;
+    }
+
+    // Middle element is the root, recurse for left child and right child
+    MidIndex = StartIndex + (EndIndex - StartIndex) / 2;
+    pTdRbTreeNode = &pRbTreeContext->pTdRbTreeNodeArrayList[MidIndex];
+
+    pTdRbTreeNode->pChild[TD_RB_TREE_LEFT]  = __sortedArrayToTdRbTree(pRbTreeContext, StartIndex, MidIndex - 1, Height + 1);
+    pTdRbTreeNode->pChild[TD_RB_TREE_RIGHT] = __sortedArrayToTdRbTree(pRbTreeContext, MidIndex + 1, EndIndex, Height + 1);
+
+    // Color the nodes in the last level Red to maintain the Red Black Tree Property
+    if (Height == pRbTreeContext->RbTreeHeight)
+    {
+        pTdRbTreeNode->Color = RED;
+    }
+
+    return pTdRbTreeNode;
+}
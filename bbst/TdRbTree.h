@@ -0,0 +1,35 @@
+//
+// This file contains all the header definitions for
+// the parent pointer free Red Black Tree with top down rebalancing
+//
+
+#ifndef _TD_RB_TREE_H_
+#define _TD_RB_TREE_H_
+
+#include "Types.h"
+
+// Definitions
+#define TD_RB_TREE_LEFT         0
+#define TD_RB_TREE_RIGHT        1
+#define TD_RB_TREE_MAX_HEIGHT   96
+
+// Node without the parent pointer, insert and delete rebalance on the way down so the
+// parent is never needed. ID and Count are laid out as in RB_TREE_NODE, so callers of the
+// function table can read them from the returned node in either variant.
+// RefCount is the number of parents and versions pointing to the node, only the persistent
+// mode shares nodes so it stays 1 otherwise
+typedef struct _TD_RB_TREE_NODE
+{
+    INT    ID;
+    INT    Count;
+    UINT   Color;
+    UINT   RefCount;
+    struct _TD_RB_TREE_NODE *pChild[2];
+}TD_RB_TREE_NODE, *PTD_RB_TREE_NODE;
+
+// Funtion Prototypes
+// Following functions can be accessed outside TdRbTree.c
+struct _RB_TREE_CONTEXT;
+VOID    initializeTdRbTreeFnTbl(struct _RB_TREE_CONTEXT *pRbTreeContext);
+VOID    destroyTdRbTree(struct _RB_TREE_CONTEXT *pRbTreeContext);
+#endif
@@ -0,0 +1,334 @@
+//
+// This file implements the functions for the
+// timer wheel that expires events nobody increases
+//
+
+#include "TimerWheel.h"
+
+// Local Function Declarations
+VOID        __touchTimerWheelEntry(struct _TIMER_WHEEL_CONTEXT *pTimerWheelContext, INT ID);
+UINT        __expireTimerWheelEntries(struct _TIMER_WHEEL_CONTEXT *pTimerWheelContext, INT *pIDList, UINT MaxIDs);
+VOID        __printTimerWheelStats(struct _TIMER_WHEEL_CONTEXT *pTimerWheelContext);
+VOID        __scheduleTimerWheelEntry(PTIMER_WHEEL_CONTEXT pTimerWheelContext, PTIMER_WHEEL_ENTRY pTimerWheelEntry);
+VOID        __cascadeTimerWheel(PTIMER_WHEEL_CONTEXT pTimerWheelContext);
+VOID        __removeTimerWheelEntry(PTIMER_WHEEL_CONTEXT pTimerWheelContext, PTIMER_WHEEL_ENTRY pTimerWheelEntry);
+VOID        __growTimerWheelBuckets(PTIMER_WHEEL_CONTEXT pTimerWheelContext);
+UINT        __getTimerWheelBucket(PTIMER_WHEEL_CONTEXT pTimerWheelContext, INT ID);
+ULONGLONG   __getTimerWheelTick(PTIMER_WHEEL_CONTEXT pTimerWheelContext);
+ULONGLONG   __getTimerWheelTimeMs();
+
+
+// createTimerWheelContext()
+// This function allocates memory for the context and the hash buckets of the timers, and initilize the function
+// pointers. Events that are not touched for TtlMs are expired. The ms are read from pClockMs if its not NULL,
+// so the caller can run the wheel on a clock of its own
+PTIMER_WHEEL_CONTEXT createTimerWheelContext(UINT TtlMs, ULONGLONG *pClockMs)
+{
+    PTIMER_WHEEL_CONTEXT    pTimerWheelContext  = NULL;
+    UINT                    Log2Buckets         = 0;
+
+    // Allocate memory for the wheel, all the slots start out empty
+    pTimerWheelContext = (PTIMER_WHEEL_CONTEXT)malloc(sizeof(TIMER_WHEEL_CONTEXT));
+    memset(pTimerWheelContext, 0, sizeof(TIMER_WHEEL_CONTEXT));
+
+    while ((1U << Log2Buckets) < TIMER_WHEEL_MIN_BUCKETS)
+    {
+        Log2Buckets++;
+    }
+
+    pTimerWheelContext->TtlMs           = TtlMs ? TtlMs : 1;
+    pTimerWheelContext->pClockMs        = pClockMs;
+    pTimerWheelContext->StartMs         = pClockMs ? *pClockMs : __getTimerWheelTimeMs();
+    pTimerWheelContext->NumBuckets      = 1U << Log2Buckets;
+    pTimerWheelContext->HashShift       = 32 - Log2Buckets;
+    pTimerWheelContext->ppBucketList    = (PTIMER_WHEEL_ENTRY*)calloc(pTimerWheelContext->NumBuckets, sizeof(PTIMER_WHEEL_ENTRY));
+
+    // Initilize the function table
+    pTimerWheelContext->stTimerWheelFnTbl.touchTimerWheelEntry      = __touchTimerWheelEntry;
+    pTimerWheelContext->stTimerWheelFnTbl.expireTimerWheelEntries   = __expireTimerWheelEntries;
+    pTimerWheelContext->stTimerWheelFnTbl.printTimerWheelStats      = __printTimerWheelStats;
+
+    return pTimerWheelContext;
+}
+
+// destroyTimerWheelContext()
+// This function frees all the timers and then the context
+VOID destroyTimerWheelContext(PTIMER_WHEEL_CONTEXT *ppTimerWheelContext)
+{
+    PTIMER_WHEEL_ENTRY  pTimerWheelEntry    = NULL;
+    PTIMER_WHEEL_ENTRY  pHashNext           = NULL;
+    UINT                Bucket              = 0;
+
+    if (*ppTimerWheelContext)
+    {
+        for (Bucket = 0; Bucket < (*ppTimerWheelContext)->NumBuckets; Bucket++)
+        {
+            for (pTimerWheelEntry = (*ppTimerWheelContext)->ppBucketList[Bucket]; pTimerWheelEntry; pTimerWheelEntry = pHashNext)
+            {
+                pHashNext = pTimerWheelEntry->pHashNext;
+                free(pTimerWheelEntry);
+            }
+        }
+        free((*ppTimerWheelContext)->ppBucketList);
+        free(*ppTimerWheelContext);
+        *ppTimerWheelContext = NULL;
+    }
+}
+
+// __getTimerWheelBucket()
+// This function returns the hash bucket of the ID using fibonacci hashing
+UINT __getTimerWheelBucket(PTIMER_WHEEL_CONTEXT pTimerWheelContext, INT ID)
+{
+    return ((UINT)ID * 2654435769U) >> pTimerWheelContext->HashShift;
+}
+
+// __touchTimerWheelEntry()
+// This function marks the event as touched now. An event with a timer only gets the new tick, the timer is
+// checked when it fires. An event without one gets a timer at now + Ttl
+VOID __touchTimerWheelEntry(struct _TIMER_WHEEL_CONTEXT *pTimerWheelContext, INT ID)
+{
+    PTIMER_WHEEL_ENTRY  pTimerWheelEntry    = NULL;
+    ULONGLONG           Tick                = __getTimerWheelTick(pTimerWheelContext);
+    UINT                Bucket              = __getTimerWheelBucket(pTimerWheelContext, ID);
+
+    pTimerWheelContext->NumTouches++;
+
+    for (pTimerWheelEntry = pTimerWheelContext->ppBucketList[Bucket]; pTimerWheelEntry; pTimerWheelEntry = pTimerWheelEntry->pHashNext)
+    {
+        if (pTimerWheelEntry->ID == ID)
+        {
+            pTimerWheelEntry->LastTick = Tick;
+            return;
+        }
+    }
+
+    pTimerWheelEntry = (PTIMER_WHEEL_ENTRY)malloc(sizeof(TIMER_WHEEL_ENTRY));
+    pTimerWheelEntry->ID            = ID;
+    pTimerWheelEntry->LastTick      = Tick;
+    pTimerWheelEntry->DeadlineTick  = Tick + pTimerWheelContext->TtlMs;
+    pTimerWheelEntry->pHashNext     = pTimerWheelContext->ppBucketList[Bucket];
+    pTimerWheelContext->ppBucketList[Bucket] = pTimerWheelEntry;
+    pTimerWheelContext->NumEntries++;
+
+    __scheduleTimerWheelEntry(pTimerWheelContext, pTimerWheelEntry);
+
+    // Keep the chains short, a bucket per timer
+    if (pTimerWheelContext->NumEntries > pTimerWheelContext->NumBuckets)
+    {
+        __growTimerWheelBuckets(pTimerWheelContext);
+    }
+}
+
+// __scheduleTimerWheelEntry()
+// This function puts the timer in the slot of its deadline, on the lowest level that reaches it from the current
+// tick. A deadline already gone goes in the current slot, one too far out is clamped and put back when it fires
+VOID __scheduleTimerWheelEntry(PTIMER_WHEEL_CONTEXT pTimerWheelContext, PTIMER_WHEEL_ENTRY pTimerWheelEntry)
+{
+    ULONGLONG   Delta   = 0;
+    UINT        Level   = 0;
+    UINT        Slot    = 0;
+
+    if (pTimerWheelEntry->DeadlineTick < pTimerWheelContext->CurrentTick)
+    {
+        pTimerWheelEntry->DeadlineTick = pTimerWheelContext->CurrentTick;
+    }
+
+    Delta = pTimerWheelEntry->DeadlineTick - pTimerWheelContext->CurrentTick;
+    if (Delta > TIMER_WHEEL_MAX_DELTA)
+    {
+        Delta = TIMER_WHEEL_MAX_DELTA;
+        pTimerWheelEntry->DeadlineTick = pTimerWheelContext->CurrentTick + Delta;
+    }
+
+    while (Level < TIMER_WHEEL_LEVELS - 1 && (Delta >> (TIMER_WHEEL_SLOT_BITS * (Level + 1))) != 0)
+    {
+        Level++;
+    }
+
+    Slot = TIMER_WHEEL_SLOT(pTimerWheelEntry->DeadlineTick, Level);
+    pTimerWheelEntry->pSlotNext = pTimerWheelContext->pSlotList[Level][Slot];
+    pTimerWheelContext->pSlotList[Level][Slot] = pTimerWheelEntry;
+    pTimerWheelContext->NumLevelEntryList[Level]++;
+}
+
+// __cascadeTimerWheel()
+// This function moves the timers of the higher level slots that start at the current tick down the levels, a
+// level is cascaded when all the ticks below it wrap to 0
+VOID __cascadeTimerWheel(PTIMER_WHEEL_CONTEXT pTimerWheelContext)
+{
+    PTIMER_WHEEL_ENTRY  pTimerWheelEntry    = NULL;
+    PTIMER_WHEEL_ENTRY  pSlotNext           = NULL;
+    UINT                Level               = 0;
+    UINT                Slot                = 0;
+
+    for (Level = TIMER_WHEEL_LEVELS - 1; Level > 0; Level--)
+    {
+        if (pTimerWheelContext->CurrentTick & ((1ULL << (TIMER_WHEEL_SLOT_BITS * Level)) - 1))
+        {
+            continue;
+        }
+
+        Slot = TIMER_WHEEL_SLOT(pTimerWheelContext->CurrentTick, Level);
+        pTimerWheelEntry = pTimerWheelContext->pSlotList[Level][Slot];
+        pTimerWheelContext->pSlotList[Level][Slot] = NULL;
+
+        for (; pTimerWheelEntry; pTimerWheelEntry = pSlotNext)
+        {
+            pSlotNext = pTimerWheelEntry->pSlotNext;
+            pTimerWheelContext->NumLevelEntryList[Level]--;
+            pTimerWheelContext->NumCascaded++;
+            __scheduleTimerWheelEntry(pTimerWheelContext, pTimerWheelEntry);
+        }
+    }
+}
+
+// __expireTimerWheelEntries()
+// This function runs the wheel up to now and takes out the timers of the events that were not touched for Ttl,
+// their IDs go to IDList. Timers of events touched since they were set are put back at the last touch + Ttl.
+// Stops once MaxIDs events are expired, the rest of the slot is done on the next call, so a burst of expiries
+// is spread over the calls. Every timer is moved down at most once per level, O(1) a timer. Returns the number
+// of expired IDs
+UINT __expireTimerWheelEntries(struct _TIMER_WHEEL_CONTEXT *pTimerWheelContext, INT *pIDList, UINT MaxIDs)
+{
+    PTIMER_WHEEL_ENTRY  pTimerWheelEntry    = NULL;
+    PTIMER_WHEEL_ENTRY  *ppSlot             = NULL;
+    ULONGLONG           Now                 = __getTimerWheelTick(pTimerWheelContext);
+    ULONGLONG           NextTick            = 0;
+    UINT                NumIDs              = 0;
+    UINT                Level               = 0;
+
+    while (pTimerWheelContext->CurrentTick <= Now)
+    {
+        // Nothing to expire, the wheel goes straight to now
+        if (pTimerWheelContext->NumEntries == 0)
+        {
+            pTimerWheelContext->CurrentTick = Now + 1;
+            pTimerWheelContext->bCascaded   = FALSE;
+            break;
+        }
+
+        if (!pTimerWheelContext->bCascaded)
+        {
+            __cascadeTimerWheel(pTimerWheelContext);
+            pTimerWheelContext->bCascaded = TRUE;
+        }
+
+        // Level 0 is empty, nothing happens till the lowest level with timers is cascaded again
+        if (pTimerWheelContext->NumLevelEntryList[0] == 0)
+        {
+            for (Level = 1; pTimerWheelContext->NumLevelEntryList[Level] == 0; Level++);
+
+            NextTick = ((pTimerWheelContext->CurrentTick >> (TIMER_WHEEL_SLOT_BITS * Level)) + 1) << (TIMER_WHEEL_SLOT_BITS * Level);
+            pTimerWheelContext->CurrentTick = NextTick <= Now ? NextTick : Now + 1;
+            pTimerWheelContext->bCascaded   = FALSE;
+            continue;
+        }
+
+        ppSlot = &pTimerWheelContext->pSlotList[0][TIMER_WHEEL_SLOT(pTimerWheelContext->CurrentTick, 0)];
+        while (*ppSlot)
+        {
+            if (NumIDs == MaxIDs)
+            {
+                return NumIDs;
+            }
+
+            pTimerWheelEntry = *ppSlot;
+            *ppSlot = pTimerWheelEntry->pSlotNext;
+            pTimerWheelContext->NumLevelEntryList[0]--;
+
+            if (pTimerWheelEntry->LastTick + pTimerWheelContext->TtlMs > pTimerWheelContext->CurrentTick)
+            {
+                // Touched since the timer was set
+                pTimerWheelEntry->DeadlineTick = pTimerWheelEntry->LastTick + pTimerWheelContext->TtlMs;
+                pTimerWheelContext->NumRescheduled++;
+                __scheduleTimerWheelEntry(pTimerWheelContext, pTimerWheelEntry);
+            }
+            else
+            {
+                pIDList[NumIDs++] = pTimerWheelEntry->ID;
+                pTimerWheelContext->NumExpired++;
+                __removeTimerWheelEntry(pTimerWheelContext, pTimerWheelEntry);
+            }
+        }
+
+        pTimerWheelContext->CurrentTick++;
+        pTimerWheelContext->bCascaded = FALSE;
+    }
+
+    return NumIDs;
+}
+
+// __removeTimerWheelEntry()
+// This function takes the timer out of the hash chain of its ID and frees it, it is already out of its slot
+VOID __removeTimerWheelEntry(PTIMER_WHEEL_CONTEXT pTimerWheelContext, PTIMER_WHEEL_ENTRY pTimerWheelEntry)
+{
+    PTIMER_WHEEL_ENTRY  *ppHashNext = &pTimerWheelContext->ppBucketList[__getTimerWheelBucket(pTimerWheelContext, pTimerWheelEntry->ID)];
+
+    while (*ppHashNext != pTimerWheelEntry)
+    {
+        ppHashNext = &(*ppHashNext)->pHashNext;
+    }
+
+    *ppHashNext = pTimerWheelEntry->pHashNext;
+    pTimerWheelContext->NumEntries--;
+    free(pTimerWheelEntry);
+}
+
+// __growTimerWheelBuckets()
+// This function doubles the hash buckets and moves the timers to their new chains
+VOID __growTimerWheelBuckets(PTIMER_WHEEL_CONTEXT pTimerWheelContext)
+{
+    PTIMER_WHEEL_ENTRY  *ppOldBucketList    = pTimerWheelContext->ppBucketList;
+    PTIMER_WHEEL_ENTRY  pTimerWheelEntry    = NULL;
+    PTIMER_WHEEL_ENTRY  pHashNext           = NULL;
+    UINT                NumOldBuckets       = pTimerWheelContext->NumBuckets;
+    UINT                Bucket              = 0;
+    UINT                NewBucket           = 0;
+
+    pTimerWheelContext->NumBuckets  = NumOldBuckets * 2;
+    pTimerWheelContext->HashShift--;
+    pTimerWheelContext->ppBucketList = (PTIMER_WHEEL_ENTRY*)calloc(pTimerWheelContext->NumBuckets, sizeof(PTIMER_WHEEL_ENTRY));
+
+    for (Bucket = 0; Bucket < NumOldBuckets; Bucket++)
+    {
+        for (pTimerWheelEntry = ppOldBucketList[Bucket]; pTimerWheelEntry; pTimerWheelEntry = pHashNext)
+        {
+            pHashNext = pTimerWheelEntry->pHashNext;
+            NewBucket = __getTimerWheelBucket(pTimerWheelContext, pTimerWheelEntry->ID);
+            pTimerWheelEntry->pHashNext = pTimerWheelContext->ppBucketList[NewBucket];
+            pTimerWheelContext->ppBucketList[NewBucket] = pTimerWheelEntry;
+        }
+    }
+
+    free(ppOldBucketList);
+}
+
+// __printTimerWheelStats()
+// This function prints the timers on the wheel and what was done with the ones that fired
+VOID __printTimerWheelStats(struct _TIMER_WHEEL_CONTEXT *pTimerWheelContext)
+{
+    printf("ttl ms %u timers %llu touches %llu expired %llu rescheduled %llu cascaded %llu\n", pTimerWheelContext->TtlMs,
+        pTimerWheelContext->NumEntries, pTimerWheelContext->NumTouches, pTimerWheelContext->NumExpired,
+        pTimerWheelContext->NumRescheduled, pTimerWheelContext->NumCascaded);
+}
+
+// __getTimerWheelTick()
+// This function returns the ms since the wheel was created
+ULONGLONG __getTimerWheelTick(PTIMER_WHEEL_CONTEXT pTimerWheelContext)
+{
+    return (pTimerWheelContext->pClockMs ? *pTimerWheelContext->pClockMs : __getTimerWheelTimeMs()) - pTimerWheelContext->StartMs;
+}
+
+// __getTimerWheelTimeMs()
+// This function gets the monotonic time in ms, clock() counts the time since the program started on windows
+ULONGLONG __getTimerWheelTimeMs()
+{
+#if !defined(_MSC_VER)
+    struct timespec Time;
+
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (ULONGLONG)Time.tv_sec * 1000ULL + (ULONGLONG)Time.tv_nsec / 1000000ULL;
+#else
+    return (ULONGLONG)clock() * 1000ULL / CLOCKS_PER_SEC;
+#endif
+}
@@ -0,0 +1,66 @@
+//
+// This file contains all the header definitions for
+// the timer wheel that expires events nobody increases
+//
+
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include "Types.h"
+
+// Definitions
+#define TIMER_WHEEL_LEVELS          4
+#define TIMER_WHEEL_SLOT_BITS       8
+#define TIMER_WHEEL_SLOTS           (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_MAX_DELTA       0xFFFFFFFFULL
+#define TIMER_WHEEL_MIN_BUCKETS     1024
+
+// Slot of the deadline at a level, a level has the next 8 bits of the tick above the level below it
+#define TIMER_WHEEL_SLOT(Tick, Level)   ((UINT)((Tick) >> (TIMER_WHEEL_SLOT_BITS * (Level))) & (TIMER_WHEEL_SLOTS - 1))
+
+// Timer of an event, in the hash chain of its ID and in the slot of its deadline. Touches only move LastTick,
+// the timer stays where it is and is put back at LastTick + Ttl when its slot comes round
+typedef struct _TIMER_WHEEL_ENTRY
+{
+    INT                         ID;
+    ULONGLONG                   LastTick;
+    ULONGLONG                   DeadlineTick;
+    struct _TIMER_WHEEL_ENTRY   *pSlotNext;
+    struct _TIMER_WHEEL_ENTRY   *pHashNext;
+}TIMER_WHEEL_ENTRY, *PTIMER_WHEEL_ENTRY;
+
+// Timer Wheel Context Definition
+// Ticks are ms since the wheel was created, on the monotonic clock or on the clock pClockMs points at. Level 0 has a slot for each of the next 256 ticks, level 1 for each
+// of the next 256 spans of 256 ticks and so on, a slot of a higher level is cascaded down when the ticks below
+// it wrap. All the ticks before CurrentTick are done, bCascaded is set once the current tick has been cascaded.
+// Levels below the lowest one with timers are skipped a span at a time
+typedef struct _TIMER_WHEEL_CONTEXT
+{
+    UINT                TtlMs;
+    ULONGLONG           *pClockMs;
+    ULONGLONG           StartMs;
+    ULONGLONG           CurrentTick;
+    BOOLEAN             bCascaded;
+    PTIMER_WHEEL_ENTRY  pSlotList[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    ULONGLONG           NumLevelEntryList[TIMER_WHEEL_LEVELS];
+    PTIMER_WHEEL_ENTRY  *ppBucketList;
+    UINT                NumBuckets;
+    UINT                HashShift;
+    ULONGLONG           NumEntries;
+    ULONGLONG           NumTouches;
+    ULONGLONG           NumRescheduled;
+    ULONGLONG           NumCascaded;
+    ULONGLONG           NumExpired;
+    struct _TIMER_WHEEL_FN_TBL
+    {
+        VOID(*touchTimerWheelEntry)(struct _TIMER_WHEEL_CONTEXT *pTimerWheelContext, INT ID);
+        UINT(*expireTimerWheelEntries)(struct _TIMER_WHEEL_CONTEXT *pTimerWheelContext, INT *pIDList, UINT MaxIDs);
+        VOID(*printTimerWheelStats)(struct _TIMER_WHEEL_CONTEXT *pTimerWheelContext);
+    }stTimerWheelFnTbl;
+}TIMER_WHEEL_CONTEXT, *PTIMER_WHEEL_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside TimerWheel.c
+PTIMER_WHEEL_CONTEXT    createTimerWheelContext(UINT TtlMs, ULONGLONG *pClockMs);
+VOID                    destroyTimerWheelContext(PTIMER_WHEEL_CONTEXT *ppTimerWheelContext);
+#endif
@@ -7,13 +7,25 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <math.h>
 #include <string.h>
 #include <limits.h>
+#include <time.h>
+#if !defined(_MSC_VER)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#endif
 
 typedef unsigned int UINT;
+typedef unsigned long long ULONGLONG;
+typedef long long LONGLONG;
 typedef unsigned char UCHAR;
+typedef unsigned short USHORT;
 typedef char CHAR;
 typedef int INT;
 typedef bool BOOLEAN;
@@ -23,4 +35,15 @@ typedef void VOID;
 #define TRUE    1
 #define FALSE   0
 
+// Software prefetch hint, used to overlap the cache misses of independent tree walks
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#define PREFETCH(Address)   _mm_prefetch((const char*)(Address), _MM_HINT_T0)
+#else
+#define PREFETCH(Address)   __builtin_prefetch((Address), 0, 3)
+#endif
+
+// Compile time check, a false condition declares an array of negative size and stops the build
+#define STATIC_ASSERT(Condition, Name)  typedef CHAR Name[(Condition) ? 1 : -1]
+
 #endif
@@ -0,0 +1,196 @@
+//
+// This file implements the functions for the
+// write combining buffer of the increases
+//
+
+#include "WriteCombine.h"
+
+// Local Function Declarations
+BOOLEAN     __addWriteCombineDelta(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext, INT ID, INT Delta, INT *pPendingDelta);
+BOOLEAN     __findWriteCombineDelta(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext, INT ID);
+UINT        __drainWriteCombineBuffer(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext, PRADIX_SORT_RECORD *ppRecordList);
+ULONGLONG   __getWriteCombineAgeMs(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext);
+VOID        __printWriteCombineStats(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext);
+UINT        __getWriteCombineSlot(PWRITE_COMBINE_CONTEXT pWriteCombineContext, INT ID);
+ULONGLONG   __getWriteCombineTimeMs();
+
+
+// createWriteCombineContext()
+// This function allocates memory for the context, the table and the record list, and initilize the function
+// pointers. The buffer holds up to MaxEntries IDs, the table has the power of 2 at least twice that many slots
+PWRITE_COMBINE_CONTEXT createWriteCombineContext(UINT MaxEntries)
+{
+    PWRITE_COMBINE_CONTEXT  pWriteCombineContext    = NULL;
+    UINT                    Log2Capacity            = 0;
+
+    // Allocate memory for the buffer
+    pWriteCombineContext = (PWRITE_COMBINE_CONTEXT)malloc(sizeof(WRITE_COMBINE_CONTEXT));
+    memset(pWriteCombineContext, 0, sizeof(WRITE_COMBINE_CONTEXT));
+
+    if (MaxEntries < WRITE_COMBINE_MIN_ENTRIES)
+    {
+        MaxEntries = WRITE_COMBINE_MIN_ENTRIES;
+    }
+    if (MaxEntries > WRITE_COMBINE_MAX_ENTRIES)
+    {
+        MaxEntries = WRITE_COMBINE_MAX_ENTRIES;
+    }
+    while ((1U << Log2Capacity) < 2 * MaxEntries)
+    {
+        Log2Capacity++;
+    }
+
+    pWriteCombineContext->MaxEntries    = MaxEntries;
+    pWriteCombineContext->Capacity      = 1U << Log2Capacity;
+    pWriteCombineContext->HashShift     = 32 - Log2Capacity;
+    pWriteCombineContext->pEntryTable   = (PWRITE_COMBINE_ENTRY)calloc(pWriteCombineContext->Capacity, sizeof(WRITE_COMBINE_ENTRY));
+    pWriteCombineContext->pRecordList   = (PRADIX_SORT_RECORD)malloc(sizeof(RADIX_SORT_RECORD) * MaxEntries);
+
+    // Initilize the function table
+    pWriteCombineContext->stWriteCombineFnTbl.addWriteCombineDelta      = __addWriteCombineDelta;
+    pWriteCombineContext->stWriteCombineFnTbl.findWriteCombineDelta     = __findWriteCombineDelta;
+    pWriteCombineContext->stWriteCombineFnTbl.drainWriteCombineBuffer   = __drainWriteCombineBuffer;
+    pWriteCombineContext->stWriteCombineFnTbl.getWriteCombineAgeMs      = __getWriteCombineAgeMs;
+    pWriteCombineContext->stWriteCombineFnTbl.printWriteCombineStats    = __printWriteCombineStats;
+
+    return pWriteCombineContext;
+}
+
+// destroyWriteCombineContext()
+// This function deallocates and frees up the context
+VOID destroyWriteCombineContext(PWRITE_COMBINE_CONTEXT *ppWriteCombineContext)
+{
+    if (*ppWriteCombineContext)
+    {
+        free((*ppWriteCombineContext)->pEntryTable);
+        free((*ppWriteCombineContext)->pRecordList);
+        free(*ppWriteCombineContext);
+        *ppWriteCombineContext = NULL;
+    }
+}
+
+// __getWriteCombineSlot()
+// This function returns the home slot of the ID using fibonacci hashing
+UINT __getWriteCombineSlot(PWRITE_COMBINE_CONTEXT pWriteCombineContext, INT ID)
+{
+    return ((UINT)ID * 2654435769U) >> pWriteCombineContext->HashShift;
+}
+
+// __addWriteCombineDelta()
+// This function adds Delta to the pending delta of the ID, taking a new slot for an ID not in the buffer, and
+// gives back the pending delta. Returns TRUE once the buffer holds MaxEntries IDs and has to be drained
+BOOLEAN __addWriteCombineDelta(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext, INT ID, INT Delta, INT *pPendingDelta)
+{
+    UINT    Slot = __getWriteCombineSlot(pWriteCombineContext, ID);
+
+    while (pWriteCombineContext->pEntryTable[Slot].bUsed && pWriteCombineContext->pEntryTable[Slot].ID != ID)
+    {
+        Slot = (Slot + 1) & (pWriteCombineContext->Capacity - 1);
+    }
+
+    if (!pWriteCombineContext->pEntryTable[Slot].bUsed)
+    {
+        if (pWriteCombineContext->NumEntries == 0)
+        {
+            pWriteCombineContext->FirstTimeMs = __getWriteCombineTimeMs();
+        }
+        pWriteCombineContext->pEntryTable[Slot].bUsed   = TRUE;
+        pWriteCombineContext->pEntryTable[Slot].ID      = ID;
+        pWriteCombineContext->pEntryTable[Slot].Delta   = 0;
+        pWriteCombineContext->NumEntries++;
+    }
+
+    pWriteCombineContext->pEntryTable[Slot].Delta += Delta;
+    pWriteCombineContext->NumDeltas++;
+    *pPendingDelta = pWriteCombineContext->pEntryTable[Slot].Delta;
+
+    return pWriteCombineContext->NumEntries >= pWriteCombineContext->MaxEntries;
+}
+
+// __findWriteCombineDelta()
+// This function returns TRUE if the ID has a pending delta
+BOOLEAN __findWriteCombineDelta(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext, INT ID)
+{
+    UINT    Slot = __getWriteCombineSlot(pWriteCombineContext, ID);
+
+    while (pWriteCombineContext->pEntryTable[Slot].bUsed)
+    {
+        if (pWriteCombineContext->pEntryTable[Slot].ID == ID)
+        {
+            return TRUE;
+        }
+        Slot = (Slot + 1) & (pWriteCombineContext->Capacity - 1);
+    }
+
+    return FALSE;
+}
+
+// __drainWriteCombineBuffer()
+// This function takes all the pending deltas out of the buffer as records sorted by ID, so that they go in the
+// tree in one ordered pass. The record list belongs to the buffer and is valid till the next drain
+UINT __drainWriteCombineBuffer(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext, PRADIX_SORT_RECORD *ppRecordList)
+{
+    UINT    NumRecords  = 0;
+    UINT    Slot        = 0;
+
+    if (pWriteCombineContext->NumEntries == 0)
+    {
+        *ppRecordList = NULL;
+        return 0;
+    }
+
+    for (Slot = 0; Slot < pWriteCombineContext->Capacity; Slot++)
+    {
+        if (pWriteCombineContext->pEntryTable[Slot].bUsed)
+        {
+            pWriteCombineContext->pRecordList[NumRecords].ID    = pWriteCombineContext->pEntryTable[Slot].ID;
+            pWriteCombineContext->pRecordList[NumRecords].Count = pWriteCombineContext->pEntryTable[Slot].Delta;
+            pWriteCombineContext->pEntryTable[Slot].bUsed       = FALSE;
+            NumRecords++;
+        }
+    }
+
+    // IDs are unique in the table, nothing is merged
+    NumRecords = sortRadixSortRecords(pWriteCombineContext->pRecordList, NumRecords, 1);
+
+    pWriteCombineContext->NumEntries = 0;
+    pWriteCombineContext->NumDrains++;
+    pWriteCombineContext->NumDrainedRecords += NumRecords;
+
+    *ppRecordList = pWriteCombineContext->pRecordList;
+    return NumRecords;
+}
+
+// __getWriteCombineAgeMs()
+// This function returns how long the oldest pending delta has been waiting, 0 when the buffer is empty
+ULONGLONG __getWriteCombineAgeMs(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext)
+{
+    if (pWriteCombineContext->NumEntries == 0)
+    {
+        return 0;
+    }
+
+    return __getWriteCombineTimeMs() - pWriteCombineContext->FirstTimeMs;
+}
+
+// __printWriteCombineStats()
+// This function prints how many increases the buffer took and how many tree updates they turned into
+VOID __printWriteCombineStats(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext)
+{
+    printf("writecombine entries %u pending %u increases %llu flushes %llu updates %llu\n", pWriteCombineContext->MaxEntries,
+        pWriteCombineContext->NumEntries, pWriteCombineContext->NumDeltas, pWriteCombineContext->NumDrains, pWriteCombineContext->NumDrainedRecords);
+}
+
+// __getWriteCombineTimeMs()
+// This function gets the monotonic time in ms, the age threshold is not used without it
+ULONGLONG __getWriteCombineTimeMs()
+{
+#if !defined(_MSC_VER)
+    struct timespec Time;
+
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (ULONGLONG)Time.tv_sec * 1000ULL + (ULONGLONG)Time.tv_nsec / 1000000ULL;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,53 @@
+//
+// This file contains all the header definitions for
+// the write combining buffer of the increases
+//
+
+#ifndef _WRITE_COMBINE_H_
+#define _WRITE_COMBINE_H_
+
+#include "Types.h"
+#include "RadixSort.h"
+
+// Definitions
+#define WRITE_COMBINE_MIN_ENTRIES   16
+#define WRITE_COMBINE_MAX_ENTRIES   (1 << 20)
+
+// Slot of the buffer, a slot is free when bUsed is FALSE
+typedef struct _WRITE_COMBINE_ENTRY
+{
+    INT     ID;
+    INT     Delta;
+    BOOLEAN bUsed;
+}WRITE_COMBINE_ENTRY, *PWRITE_COMBINE_ENTRY;
+
+// Write Combine Context Definition
+// Linear probing table of the deltas by ID with twice as many slots as MaxEntries, so it never gets more than half
+// full. Drained into RecordList sorted by ID. FirstTimeMs is when the oldest delta came in
+typedef struct _WRITE_COMBINE_CONTEXT
+{
+    UINT                    MaxEntries;
+    UINT                    Capacity;
+    UINT                    HashShift;
+    PWRITE_COMBINE_ENTRY    pEntryTable;
+    PRADIX_SORT_RECORD      pRecordList;
+    UINT                    NumEntries;
+    ULONGLONG               FirstTimeMs;
+    ULONGLONG               NumDeltas;
+    ULONGLONG               NumDrains;
+    ULONGLONG               NumDrainedRecords;
+    struct _WRITE_COMBINE_FN_TBL
+    {
+        BOOLEAN(*addWriteCombineDelta)(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext, INT ID, INT Delta, INT *pPendingDelta);
+        BOOLEAN(*findWriteCombineDelta)(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext, INT ID);
+        UINT(*drainWriteCombineBuffer)(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext, PRADIX_SORT_RECORD *ppRecordList);
+        ULONGLONG(*getWriteCombineAgeMs)(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext);
+        VOID(*printWriteCombineStats)(struct _WRITE_COMBINE_CONTEXT *pWriteCombineContext);
+    }stWriteCombineFnTbl;
+}WRITE_COMBINE_CONTEXT, *PWRITE_COMBINE_CONTEXT;
+
+// Funtion Prototypes
+// Following functions can be accessed outside WriteCombine.c
+PWRITE_COMBINE_CONTEXT  createWriteCombineContext(UINT MaxEntries);
+VOID                    destroyWriteCombineContext(PWRITE_COMBINE_CONTEXT *ppWriteCombineContext);
+#endif